@@ -55,7 +55,13 @@ inline constexpr std::uint16_t cmTableAlignRight = 3061;
 inline constexpr std::uint16_t cmTableAlignNumber = 3062;
 inline constexpr std::uint16_t cmReflowParagraphs = 3070;
 inline constexpr std::uint16_t cmFormatDocument = 3071;
+inline constexpr std::uint16_t cmShowOutline = 3072;
+inline constexpr std::uint16_t cmCheckLinks = 3073;
 inline constexpr std::uint16_t cmToggleSmartList = 3080;
+inline constexpr std::uint16_t cmFindInFiles = 3090;
+inline constexpr std::uint16_t cmReplaceInFiles = 3091;
+// Posted by a project search window once its replace can be applied.
+inline constexpr std::uint16_t cmApplyReplaceInFiles = 3092;
 inline constexpr std::uint16_t cmAbout = ck::commands::common::About;
 inline constexpr std::uint16_t cmReturnToLauncher = ck::commands::common::ReturnToLauncher;
 
@@ -23,6 +23,10 @@ inline constexpr std::uint16_t Level6 = 4016;
 inline constexpr std::uint16_t Level7 = 4017;
 inline constexpr std::uint16_t Level8 = 4018;
 inline constexpr std::uint16_t Level9 = 4019;
+inline constexpr std::uint16_t Follow = 4020;
+inline constexpr std::uint16_t Query = 4021;
+inline constexpr std::uint16_t ExportSelection = 4022;
+inline constexpr std::uint16_t Compare = 4023;
 
 } // namespace ck::commands::json_view
 
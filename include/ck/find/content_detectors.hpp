@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+namespace ck::find
+{
+
+// Leading bytes read from each candidate. The same block feeds the magic
+// number table and the binary/text heuristic used by content search.
+inline constexpr std::size_t kContentHeaderSize = 1024;
+
+using ContentTagMask = std::uint64_t;
+
+struct ContentHeader
+{
+    std::array<unsigned char, kContentHeaderSize> bytes{};
+    std::size_t length = 0;
+
+    std::span<const unsigned char> view() const { return {bytes.data(), length}; }
+};
+
+struct DetectedContent
+{
+    ContentTagMask tags = 0;
+    bool binary = false;
+};
+
+// Every tag accepted in TypeFilterOptions::detectorTags, e.g. "png",
+// "image", "archive", "elf", "text".
+std::span<const std::string_view> knownContentTags();
+
+// Returns the mask for a single (case-insensitive) tag or nullopt when the
+// tag is not part of the detector table.
+std::optional<ContentTagMask> contentTagMask(std::string_view tag);
+
+bool readContentHeader(const std::filesystem::path &path, ContentHeader &header);
+DetectedContent classifyContentHeader(std::span<const unsigned char> header);
+
+// Detection results keyed by device/inode and revalidated against the
+// file's mtime and size, so unchanged files are never read twice.
+class ContentDetectorCache
+{
+public:
+    std::optional<DetectedContent> detect(const std::filesystem::path &path);
+    void clear();
+    std::size_t size() const;
+
+private:
+    struct FileIdentity
+    {
+        std::uintmax_t device = 0;
+        std::uintmax_t inode = 0;
+
+        bool operator==(const FileIdentity &) const noexcept = default;
+    };
+
+    struct FileIdentityHash
+    {
+        std::size_t operator()(const FileIdentity &id) const noexcept
+        {
+            std::size_t h1 = std::hash<std::uintmax_t>{}(id.device);
+            std::size_t h2 = std::hash<std::uintmax_t>{}(id.inode);
+            return h1 ^ (h2 << 1);
+        }
+    };
+
+    struct Entry
+    {
+        std::int64_t mtimeNs = 0;
+        std::uintmax_t size = 0;
+        DetectedContent content{};
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<FileIdentity, Entry, FileIdentityHash> m_entries;
+};
+
+ContentDetectorCache &sharedContentDetectorCache();
+
+} // namespace ck::find
@@ -2,6 +2,7 @@
 
 #include "ck/find/search_model.hpp"
 
+#include <cstddef>
 #include <filesystem>
 #include <optional>
 #include <ostream>
@@ -23,6 +24,10 @@ struct SearchExecutionOptions
     bool includeActions = true;
     bool captureMatches = false;
     bool filterContent = true;
+    // Reuse and refresh the per-specification match cache. Directories whose
+    // mtime is unchanged since the previous run are replayed, not re-listed.
+    bool useResultCache = false;
+    std::filesystem::path resultCacheDirectory;
 };
 
 struct SearchExecutionResult
@@ -30,6 +35,8 @@ struct SearchExecutionResult
     int exitCode = 0;
     std::vector<std::filesystem::path> matches;
     std::vector<std::string> command;
+    std::size_t directoriesScanned = 0;
+    std::size_t directoriesReused = 0;
 };
 
 std::filesystem::path specificationStorageDirectory();
@@ -41,6 +48,8 @@ bool saveSpecification(const SearchSpecification &spec, const std::string &name)
 bool removeSpecification(const std::string &nameOrSlug);
 
 std::string normaliseSpecificationName(const std::string &name);
+// File-system friendly form of a specification name, as used for storage.
+std::string specificationSlug(const std::string &name);
 
 std::vector<std::string> buildFindCommand(const SearchSpecification &spec, bool includeActions = true);
 SearchExecutionResult executeSpecification(const SearchSpecification &spec,
@@ -48,4 +57,13 @@ SearchExecutionResult executeSpecification(const SearchSpecification &spec,
                                            std::ostream *forwardStdout = nullptr,
                                            std::ostream *forwardStderr = nullptr);
 
+// Runs several specifications over one shared traversal: each directory is
+// listed once and every entry is tested against all specifications whose
+// roots cover it. Results and forwardStdout streams are index-aligned with
+// specs. The result cache is not consulted in this mode.
+std::vector<SearchExecutionResult> executeSpecifications(const std::vector<SearchSpecification> &specs,
+                                                         const SearchExecutionOptions &options = {},
+                                                         const std::vector<std::ostream *> &forwardStdout = {},
+                                                         std::ostream *forwardStderr = nullptr);
+
 } // namespace ck::find
@@ -123,6 +123,10 @@ const CommandLabel kDefaultLabels[] = {
     {commands::json_view::Level7, "ck-json-view", "Level 7"},
     {commands::json_view::Level8, "ck-json-view", "Level 8"},
     {commands::json_view::Level9, "ck-json-view", "Level 9"},
+    {commands::json_view::Follow, "ck-json-view", "Follow"},
+    {commands::json_view::Query, "ck-json-view", "Query"},
+    {commands::json_view::ExportSelection, "ck-json-view", "Export Selection"},
+    {commands::json_view::Compare, "ck-json-view", "Compare"},
 
     {commands::chat::NewChat, "ck-chat", "New Chat"},
     {commands::chat::ManageModels, "ck-chat", "Manage Models"},
@@ -183,6 +187,10 @@ const CommandLabel kDefaultLabels[] = {
     {commands::edit::cmTableAlignNumber, "ck-edit", "Align Number"},
     {commands::edit::cmReflowParagraphs, "ck-edit", "Reflow"},
     {commands::edit::cmFormatDocument, "ck-edit", "Format Document"},
+    {commands::edit::cmShowOutline, "ck-edit", "Outline"},
+    {commands::edit::cmCheckLinks, "ck-edit", "Check Links"},
+    {commands::edit::cmFindInFiles, "ck-edit", "Find in Files"},
+    {commands::edit::cmReplaceInFiles, "ck-edit", "Replace in Files"},
 };
 
 const CommandHelp kDefaultHelps[] = {
@@ -291,6 +299,10 @@ const CommandHelp kDefaultHelps[] = {
     {commands::json_view::Level7, "Expand nodes to depth 7."},
     {commands::json_view::Level8, "Expand nodes to depth 8."},
     {commands::json_view::Level9, "Expand nodes to depth 9."},
+    {commands::json_view::Follow, "Keep reading records appended to a JSON Lines file."},
+    {commands::json_view::Query, "Select values with a JSONPath expression."},
+    {commands::json_view::ExportSelection, "Write the selected value to a file."},
+    {commands::json_view::Compare, "Show the differences between this document and another file."},
 
     {commands::chat::NewChat, "Start a new chat session."},
     {commands::chat::ManageModels, "Open the model management dialog."},
@@ -351,6 +363,10 @@ const CommandHelp kDefaultHelps[] = {
     {commands::edit::cmTableAlignNumber, "Align column contents for numbers."},
     {commands::edit::cmReflowParagraphs, "Reflow the selected paragraphs."},
     {commands::edit::cmFormatDocument, "Format the entire document."},
+    {commands::edit::cmShowOutline, "Jump to a heading of the document."},
+    {commands::edit::cmCheckLinks, "List links to references, footnotes and headings that do not exist."},
+    {commands::edit::cmFindInFiles, "Search the Markdown files under a directory."},
+    {commands::edit::cmReplaceInFiles, "Replace text in the Markdown files under a directory."},
 };
 
 const KeyBinding kLinuxBindings[] = {
@@ -408,6 +424,10 @@ const KeyBinding kLinuxBindings[] = {
     {commands::json_view::Level7, TKey(kbAlt7), "Alt-7"},
     {commands::json_view::Level8, TKey(kbAlt8), "Alt-8"},
     {commands::json_view::Level9, TKey(kbAlt9), "Alt-9"},
+    {commands::json_view::Follow, TKey(kbCtrlT), "Ctrl-T"},
+    {commands::json_view::Query, TKey(kbCtrlJ), "Ctrl-J"},
+    {commands::json_view::ExportSelection, TKey(kbCtrlE), "Ctrl-E"},
+    {commands::json_view::Compare, TKey(kbCtrlD), "Ctrl-D"},
 
     {commands::chat::NewChat, TKey(kbCtrlN), "Ctrl-N"},
     {commands::chat::ManageModels, TKey(kbF2), "F2"},
@@ -513,6 +533,10 @@ const KeyBinding kMacBindings[] = {
     {commands::json_view::Level7, TKey('7', kbCtrlShift), "Ctrl-7"},
     {commands::json_view::Level8, TKey('8', kbCtrlShift), "Ctrl-8"},
     {commands::json_view::Level9, TKey('9', kbCtrlShift), "Ctrl-9"},
+    {commands::json_view::Follow, TKey(kbCtrlT), "Ctrl-T"},
+    {commands::json_view::Query, TKey(kbCtrlJ), "Ctrl-J"},
+    {commands::json_view::ExportSelection, TKey(kbCtrlE), "Ctrl-E"},
+    {commands::json_view::Compare, TKey(kbCtrlD), "Ctrl-D"},
 
     {commands::chat::NewChat, TKey(kbCtrlN), "Ctrl-N"},
     {commands::chat::ManageModels, TKey(kbF2), "F2"},
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ck::edit
+{
+
+// Replace the file at path with parts written one after another.  They go
+// to a new file of a unique name beside it, which takes the old file's
+// mode and owner and is synced to disk before it is renamed over it; the
+// directory is synced after the rename.  So neither a failed write nor a
+// crash leaves anything but the old file or the whole new one.  A symbolic
+// link is followed, so the file it points to is the one replaced.  Throws
+// std::runtime_error on failure.
+void writeFileAtomically(const std::string &path, const std::vector<std::string_view> &parts);
+
+} // namespace ck::edit
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ck::edit
+{
+
+// A file too large for the editor buffer.  The bytes stay mapped read-only
+// while a background pass records where every lineStride-th line starts;
+// edits are kept as pieces over the mapping, so memory grows with the
+// edited text only.  Lines end after '\n', as in LineIndex.
+class LargeFileDocument
+{
+public:
+    // Files from this size on open as large files.
+    static constexpr std::uint64_t kThreshold = 64ull << 20;
+    static constexpr std::size_t kLineStride = 1024;
+
+    // Throws std::runtime_error when the file cannot be read.
+    explicit LargeFileDocument(const std::string &path);
+    ~LargeFileDocument();
+
+    LargeFileDocument(const LargeFileDocument &) = delete;
+    LargeFileDocument &operator=(const LargeFileDocument &) = delete;
+
+    const std::string &path() const noexcept { return filePath; }
+    std::size_t size() const noexcept { return textSize; }
+    bool modified() const noexcept { return edited; }
+
+    bool indexComplete() const noexcept { return indexDone.load(std::memory_order_acquire); }
+    // Lines of the file found by the background pass so far.
+    std::size_t indexedLines() const noexcept { return indexedLineCount.load(std::memory_order_acquire); }
+    void waitForIndex();
+
+    // Line lookups are exact at any time; past the indexed part they scan
+    // the mapping from the last recorded line.
+    std::size_t lineCount() const;
+    std::size_t lineStart(std::size_t line) const;
+    std::size_t lineOf(std::size_t offset) const;
+    // Text of line without its line break, cut after maxBytes.
+    std::string line(std::size_t line, std::size_t maxBytes = SIZE_MAX) const;
+    std::string read(std::size_t offset, std::size_t length) const;
+
+    // First match of needle at or after from.
+    bool find(std::string_view needle, std::size_t from, bool caseSensitive, std::size_t &found) const;
+    void replace(std::size_t offset, std::size_t length, std::string_view text);
+    // Write the current text to path through a temporary file.
+    void save(const std::string &path) const;
+
+private:
+    struct Piece
+    {
+        // In additions rather than the file.
+        bool added = false;
+        std::size_t start = 0;
+        std::size_t length = 0;
+    };
+
+    std::string filePath;
+    const char *data = nullptr;
+    std::size_t dataSize = 0;
+    bool mapped = false;
+    std::string owned;
+
+    std::vector<Piece> pieces;
+    std::string additions;
+    std::size_t textSize = 0;
+    bool edited = false;
+
+    // Start of line i * kLineStride of the file.
+    mutable std::mutex indexMutex;
+    std::condition_variable indexFinished;
+    std::vector<std::size_t> checkpoints;
+    std::atomic<std::size_t> indexedLineCount{0};
+    std::atomic<bool> indexDone{false};
+    std::atomic<bool> stopping{false};
+    std::thread indexer;
+
+    void buildIndex();
+    std::size_t fileNewlinesBefore(std::size_t offset) const;
+    // Offset just past the given newline of the file, counting from 0;
+    // SIZE_MAX when the file has fewer newlines.
+    std::size_t fileOffsetAfterNewline(std::size_t newline) const;
+    std::size_t pieceNewlines(const Piece &piece) const;
+    std::string_view pieceText(const Piece &piece) const noexcept;
+    // Pass the text from offset on to visit in spans until it returns false.
+    void forEachSpan(std::size_t offset, const std::function<bool(std::string_view)> &visit) const;
+};
+
+} // namespace ck::edit
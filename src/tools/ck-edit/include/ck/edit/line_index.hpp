@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ck::edit
+{
+
+// Line starts of a text buffer, kept up to date from edits instead of being
+// rescanned.  Lines end after '\n' (so a CRLF pair counts once); a text with
+// n newlines has n + 1 lines, the last one possibly empty.  Lookups in both
+// directions and edits cost O(log lines) plus the size of the inserted text.
+//
+// Each line also carries a number of display rows for soft wrapping.  Lines
+// that were not measured since they were last edited count as one row.
+class LineIndex
+{
+public:
+    LineIndex();
+
+    // Index a text given in up to two pieces, as stored around the gap of
+    // an editor buffer.
+    void assign(std::string_view head, std::string_view tail = {});
+    // The bytes [start, end) were replaced by text.
+    void replace(std::size_t start, std::size_t end, std::string_view text);
+
+    std::size_t lineCount() const noexcept;
+    std::size_t byteCount() const noexcept;
+    // Line containing offset; offsets at or past the end map to the last line.
+    std::size_t lineOf(std::size_t offset) const noexcept;
+    // Offset of the first byte of line; byteCount() past the last line.
+    std::size_t lineStart(std::size_t line) const noexcept;
+
+    bool rowsMeasured(std::size_t line) const noexcept;
+    void setRows(std::size_t line, std::uint32_t rows) noexcept;
+    // Forget all measurements, e.g. when the wrap width changes.
+    void resetRows() noexcept;
+    std::size_t rowCount() const noexcept;
+    // Rows of the lines before line.
+    std::size_t rowsBefore(std::size_t line) const noexcept;
+    // Line shown on row and the row within it; rows past the end map to
+    // the last row of the last line.
+    std::size_t lineAtRow(std::size_t row, std::size_t &rowInLine) const noexcept;
+
+private:
+    static constexpr std::uint32_t nil = UINT32_MAX;
+
+    // Treap ordered by line number; each node is one line.
+    struct LineNode
+    {
+        std::uint32_t left = nil;
+        std::uint32_t right = nil;
+        std::uint32_t priority = 0;
+        // Bytes of this line, including its newline.
+        std::uint32_t length = 0;
+        // Display rows, 0 when not measured.
+        std::uint32_t rows = 0;
+        // Lines, bytes and display rows of the subtree.
+        std::uint32_t lines = 0;
+        std::uint32_t bytes = 0;
+        std::uint32_t rowSum = 0;
+    };
+
+    std::vector<LineNode> nodes;
+    std::vector<std::uint32_t> freeNodes;
+    std::uint32_t root = nil;
+    std::uint32_t seed = 0x9e3779b9u;
+
+    std::uint32_t lineCountOf(std::uint32_t node) const noexcept;
+    std::uint32_t byteCountOf(std::uint32_t node) const noexcept;
+    std::uint32_t rowCountOf(std::uint32_t node) const noexcept;
+    void setRows(std::uint32_t node, std::size_t line, std::uint32_t rows) noexcept;
+    void pull(std::uint32_t node) noexcept;
+    std::uint32_t allocate(std::uint32_t length);
+    void release(std::uint32_t node);
+    std::uint32_t build(const std::vector<std::uint32_t> &lengths);
+    void split(std::uint32_t node, std::size_t count, std::uint32_t &left, std::uint32_t &right) noexcept;
+    std::uint32_t merge(std::uint32_t left, std::uint32_t right) noexcept;
+};
+
+} // namespace ck::edit
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "markdown_index.hpp"
+#include "markdown_parser.hpp"
+#include "text_rope.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ck::edit
+{
+
+// Line kinds, parser states and index of one version of a document.
+struct MarkdownDocumentAnalysis
+{
+    std::uint64_t version = 0;
+    // Version this one was derived from, 0 for a full analysis.
+    std::uint64_t previousVersion = 0;
+    std::vector<MarkdownLineKind> lineKinds;
+    // Fingerprint of the parser state each line starts in.
+    std::vector<std::uint64_t> entryStates;
+    // Full states at the start of some lines, ascending, roughly every
+    // checkpointInterval lines; line 0 always has one.
+    std::vector<std::size_t> checkpointLines;
+    std::vector<MarkdownParserState> checkpointStates;
+    // Byte offset of each checkpoint line, where analysis can resume.
+    std::vector<std::size_t> checkpointOffsets;
+    std::size_t textBytes = 0;
+    // Lines whose analysis may differ from the previous version.
+    std::size_t firstChangedLine = 0;
+    std::size_t endChangedLine = 0;
+    // Headings, link definitions and links, kept up to date with the lines.
+    MarkdownDocumentIndex index;
+
+    static constexpr std::size_t checkpointInterval = 128;
+
+    // Closest stored state at or before line; returns its line number.
+    std::size_t stateBefore(std::size_t line, MarkdownParserState &state) const;
+};
+
+// Lines that edits since some version may have touched, as the editor
+// tracks them, so that analysis need not compare the texts.
+struct MarkdownTextChange
+{
+    // First line whose text may differ; SIZE_MAX when nothing changed.
+    std::size_t firstLine = SIZE_MAX;
+    // Lines at the end whose text is unchanged.
+    std::size_t unchangedTail = SIZE_MAX;
+    // Lines of the text after the edits.
+    std::size_t lineCount = 1;
+
+    bool empty() const noexcept { return firstLine == SIZE_MAX; }
+    // Record an edit of lines [first, last] of a text of lineCount lines.
+    void addEdit(std::size_t first, std::size_t last, std::size_t lineCountBefore) noexcept;
+    // Follow this change with a later one.
+    void merge(const MarkdownTextChange &later) noexcept;
+    // Every line may have changed.
+    static MarkdownTextChange everything(std::size_t lineCount) noexcept { return {0, 0, lineCount}; }
+};
+
+std::uint64_t fingerprintState(const MarkdownParserState &state) noexcept;
+
+// Analyze every line of text.
+MarkdownDocumentAnalysis analyzeDocument(std::string_view text, std::uint64_t version);
+// Analyze text given the previous version and what changed since: lines
+// before the change are reused, and analysis stops once a line in the
+// unchanged tail starts in the same state as before.  Only the lines
+// analyzed are read from the rope.
+MarkdownDocumentAnalysis analyzeDocument(const TextRope &text, std::uint64_t version,
+                                         const MarkdownDocumentAnalysis *previous = nullptr,
+                                         const MarkdownTextChange &change = {});
+
+// Runs analyzeDocument on a worker thread, each version against the last
+// one analyzed.  Requests submitted while the worker is busy replace each
+// other, their changes merged, so only the newest waiting version is
+// analyzed.  The text comes as a rope snapshot, so the caller does not copy
+// it; change is what changed since the version submitted before.
+class MarkdownBackgroundAnalysis
+{
+public:
+    MarkdownBackgroundAnalysis() = default;
+    ~MarkdownBackgroundAnalysis();
+
+    MarkdownBackgroundAnalysis(const MarkdownBackgroundAnalysis &) = delete;
+    MarkdownBackgroundAnalysis &operator=(const MarkdownBackgroundAnalysis &) = delete;
+
+    void submit(std::uint64_t version, TextRope text, const MarkdownTextChange &change);
+    // Newest finished analysis, or null.
+    std::shared_ptr<const MarkdownDocumentAnalysis> latest() const;
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool pending = false;
+    std::uint64_t pendingVersion = 0;
+    TextRope pendingText;
+    MarkdownTextChange pendingChange;
+    std::shared_ptr<const MarkdownDocumentAnalysis> published;
+    std::thread worker;
+
+    void run();
+};
+
+} // namespace ck::edit
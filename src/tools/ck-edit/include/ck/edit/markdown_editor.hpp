@@ -3,11 +3,18 @@
 #include "ck/app_info.hpp"
 #include "ck/commands/ck_edit.hpp"
 #include "ck/ui/clock_aware_application.hpp"
+#include "large_file.hpp"
+#include "line_index.hpp"
+#include "markdown_analysis.hpp"
+#include "markdown_format.hpp"
 #include "markdown_parser.hpp"
+#include "project_search.hpp"
+#include "text_rope.hpp"
 
 #define Uses_TWindow
 #define Uses_TFrame
 #define Uses_TScrollBar
+#define Uses_TScroller
 #define Uses_TIndicator
 #define Uses_TView
 #define Uses_TEditWindow
@@ -39,6 +46,7 @@
 #define Uses_TCheckBoxes
 #define Uses_TSItem
 #define Uses_TButton
+#define Uses_TListViewer
 #define Uses_TFindDialogRec
 #define Uses_TReplaceDialogRec
 #include <tvision/tv.h>
@@ -48,6 +56,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <climits>
 
@@ -178,21 +187,38 @@ public:
     void convertToDefinitionList();
     void reflowParagraphs();
     void formatDocument();
+    // List the headings and move to the one chosen.
+    void showOutline();
+    // List links whose reference, footnote or heading does not exist.
+    void checkLinks();
     void toggleSmartListContinuation();
     bool isSmartListContinuationEnabled() const noexcept { return smartListContinuation; }
 
     virtual void handleEvent(TEvent &event) override;
     virtual void draw() override;
+    virtual Boolean insertBuffer(const char *p, uint offset, uint length, Boolean allowUndo, Boolean selectText) override;
 
     MarkdownAnalyzer &analyzer() noexcept { return markdownAnalyzer; }
     uint topLinePointer();
     std::string lineText(uint linePtr);
+    // lineText without copying when the line is on one side of the gap;
+    // otherwise it is copied into scratch.  Valid until the next edit.
+    std::string_view lineTextView(uint linePtr, std::string &scratch);
     void notifyInfoView();
     void refreshCursorMetrics();
     int documentLineNumber() const noexcept;
     int documentColumnNumber() const noexcept;
     uint stateVersion() const noexcept { return cachedStateVersion; }
     void buildStatusContext(struct MarkdownStatusContext &context);
+    // Submit the text to the background analysis when it changed since the
+    // last submission, and take up a finished analysis of the current text.
+    void pollAnalysis();
+    // The newest finished analysis, which may trail the text by the last
+    // edits; null until the worker has finished one.  pollAnalysis takes up
+    // the next as soon as it is done.
+    std::shared_ptr<const MarkdownDocumentAnalysis> currentAnalysis();
+    // Select length bytes from column of lineNumber and scroll them into view.
+    void selectInLine(int lineNumber, std::size_t column, std::size_t length);
 
 private:
     friend class MarkdownInfoView;
@@ -204,14 +230,21 @@ private:
     bool smartListContinuation = true;
     uint cachedStateVersion = 0;
 
-    MarkdownParserState statusStateCache{};
-    uint statusCachePrefixPtr = UINT_MAX;
-    uint statusCacheVersion = 0;
+    MarkdownStateCheckpoints parserCheckpoints;
+    MarkdownBackgroundAnalysis backgroundAnalysis;
+    std::shared_ptr<const MarkdownDocumentAnalysis> documentAnalysis;
+    std::uint64_t contentVersion = 1;
+    std::uint64_t submittedVersion = 0;
+    // Lines edited since the last submission.
+    MarkdownTextChange analysisChange;
     std::vector<int> pendingInfoLines;
     bool infoViewNeedsFullRefresh = false;
-    bool lineNumberCacheValid = false;
-    uint lineNumberCachePtr = 0;
-    int lineNumberCacheNumber = 0;
+    LineIndex lineIndex;
+    bool lineIndexValid = false;
+    // Copy of the buffer kept in step by insertBuffer; copying it is the
+    // O(1) snapshot handed to the background analysis.
+    TextRope documentText;
+    bool documentTextValid = false;
     int cursorLineNumber = 0;
     int cursorColumnNumber = 0;
     int wrapTopSegmentOffset = 0;
@@ -219,20 +252,27 @@ private:
     TPoint wrapCursorScreenPos {0, 0};
 
     void onContentModified();
+    // Submit the text if it changed and take up a newer finished analysis;
+    // true when one was taken.
+    bool takeAnalysis(bool &incremental);
     void queueInfoLine(int lineNumber);
     void queueInfoLineRange(int firstLine, int lastLine);
     void requestInfoViewFullRefresh();
     void clearInfoViewQueue();
+    const LineIndex &documentLines();
+    MarkdownParserState parserStateForLine(int lineNumber);
+    const TextRope &documentRope();
     int lineNumberForPointer(uint pointer);
     uint pointerForLine(int lineNumber);
     void enqueuePendingInfoLine(int lineNumber);
-    void resetLineNumberCache();
-    int computeLineNumberForPointer(uint pointer);
     void applyInlineCommand(const InlineCommandSpec &spec);
     void removeFormattingAround(uint start, uint end);
     bool ensureSelection();
     std::string readRange(uint start, uint end);
     void replaceRange(uint start, uint end, const std::string &text);
+    // Apply non-overlapping edits against the current text as one undoable
+    // change, leaving the cursor after the last of them.
+    void applyEdits(std::vector<TextEdit> edits);
     void indentRangeWith(const std::string &prefix);
     void unindentBlockQuote();
     void insertListItems(int count, bool ordered);
@@ -240,6 +280,8 @@ private:
     int promptForCount(const char *title);
     std::string promptForText(const char *title, const char *label, const std::string &initial = {});
     int promptForNumeric(const char *title, const char *label, int defaultValue, int minValue, int maxValue);
+    // Index of the choice picked from a list, or -1.
+    int promptForChoice(const char *title, const std::vector<std::string> &choices);
     bool continueListOnEnter(TEvent &event);
 
     struct BlockSelection
@@ -268,6 +310,9 @@ private:
     static std::string trim(std::string_view text);
     static bool lineIsWhitespace(const std::string &line);
     LinePattern analyzeLinePattern(const std::string &line) const;
+    // Index of the text as it is now, analyzed here when the background
+    // one trails it, so that a new id is checked against every line.
+    std::shared_ptr<const MarkdownDocumentAnalysis> analysisOfCurrentText();
     std::string generateUniqueReferenceId(const std::string &prefix);
     std::string generateUniqueFootnoteId();
     void appendDefinition(const std::string &definition);
@@ -284,7 +329,21 @@ private:
         int lineColumns = 0;
     };
 
+    // Layouts by line number at wrapLayoutWidth.  An edit drops the layouts
+    // of the lines it touched and renumbers those below; the row counts kept
+    // in lineIndex survive edits to other lines in the same way.
+    std::unordered_map<int, WrapLayout> wrapLayoutCache;
+    int wrapLayoutWidth = 0;
+
     void computeWrapLayout(uint linePtr, WrapLayout &layout);
+    void prepareWrapCache();
+    // Forget the layouts of lines firstLine to lastLine, which an edit
+    // replaced, and move those after them by lineDelta.
+    void invalidateWrapLayouts(int firstLine, int lastLine, int lineDelta);
+    void rememberWrapLayout(int lineNumber, const WrapLayout &layout);
+    int wrapRowsOf(int lineNumber);
+    // Display rows of the lines [firstLine, lastLine).
+    int wrapRowsBetween(int firstLine, int lastLine);
     void computeWrapLayoutFromCells(const TScreenCell *cells, int lineColumns, int wrapWidth, WrapLayout &layout);
     int wrapSegmentForColumn(const WrapLayout &layout, int column) const;
     static void buildWordWrapSegments(const TScreenCell *cells, int lineColumns, int wrapWidth, std::vector<WrapSegment> &segments);
@@ -292,8 +351,8 @@ private:
     int wrapSegmentCount(const WrapLayout &layout) const;
     WrapSegment segmentAt(const WrapLayout &layout, int index) const;
     void normalizeWrapTop(int &docLine, int &segmentOffset);
-    int computeWrapCaretRow(int docLine, int segmentOffset, uint caretLinePtr, const WrapLayout &caretLayout, int caretSegment) const;
-    void ensureWrapViewport(const WrapLayout &caretLayout, int caretSegment);
+    int computeWrapCaretRow(int docLine, int segmentOffset, int caretSegment) const;
+    void ensureWrapViewport(int caretSegment);
     void updateWrapCursorVisualPosition(const WrapLayout &caretLayout, int caretSegment);
     int currentWrapLocalColumn(const WrapLayout &layout, int segmentIndex) const;
     void updateWrapStateAfterMovement(bool preserveDesiredColumn);
@@ -422,6 +481,101 @@ protected:
     static TFrame *initFrame(TRect bounds);
 };
 
+// Pages through a LargeFileDocument, reading lines as they are drawn.
+// Enter edits the line under the cursor; the edit is kept as a piece over
+// the mapped file until the document is saved.
+class LargeFileView : public TScroller
+{
+public:
+    LargeFileView(const TRect &bounds, TScrollBar *hScrollBar, TScrollBar *vScrollBar,
+                  std::unique_ptr<LargeFileDocument> document) noexcept;
+
+    const LargeFileDocument &document() const noexcept { return *largeDocument; }
+    virtual void draw() override;
+    virtual void handleEvent(TEvent &event) override;
+    virtual void setState(ushort aState, Boolean enable) override;
+    virtual Boolean valid(ushort command) override;
+    // Grow the scroll range as the background index finds lines.
+    void pollIndex();
+    // Move to line, or once the background index reaches it.
+    void goToLine(std::size_t line);
+
+private:
+    std::unique_ptr<LargeFileDocument> largeDocument;
+    std::size_t cursorLine = 0;
+    std::size_t knownLines = 1;
+    bool indexFollowed = false;
+    // Line the cursor is headed for, past the lines indexed so far, until
+    // the index reaches it.
+    std::optional<std::size_t> returnLine;
+
+    void moveCursor(std::size_t line);
+    void editLine();
+    void find(bool prompt);
+    bool save();
+    void updateLimit();
+};
+
+class LargeFileWindow : public TWindow
+{
+public:
+    LargeFileWindow(const TRect &bounds, std::unique_ptr<LargeFileDocument> document) noexcept;
+    LargeFileView *view() noexcept { return fileView; }
+
+private:
+    LargeFileView *fileView = nullptr;
+};
+
+// Lists the matches of a project search as they arrive.  Enter opens the
+// match under the cursor; a replace runs once the search has finished.
+class ProjectSearchView : public TScroller
+{
+public:
+    ProjectSearchView(const TRect &bounds, TScrollBar *hScrollBar, TScrollBar *vScrollBar,
+                      std::unique_ptr<ProjectSearchJob> job, std::string replacement, bool replacing) noexcept;
+
+    virtual void draw() override;
+    virtual void handleEvent(TEvent &event) override;
+    // Take up new matches; true when there were some, when the search has
+    // just finished and while a finished replace waits for applyReplace.
+    bool poll();
+    bool searching() const noexcept { return !searchDone; }
+    // The search finished for a replace that has not been applied yet.
+    bool replacePending() const noexcept { return searchDone && replacing; }
+    bool replaceRunning() const noexcept { return replaceJob && !replaceJob->finished(); }
+    bool replaceFinished() const noexcept { return replaceJob && replaceJob->finished(); }
+    // Ask to start a pending replace, or report a finished one.
+    void applyReplace();
+
+    const std::vector<ProjectMatch> &matches() const noexcept { return items; }
+    const ProjectSearchQuery &query() const noexcept { return searchJob->query(); }
+
+private:
+    std::unique_ptr<ProjectSearchJob> searchJob;
+    std::unique_ptr<ProjectReplaceJob> replaceJob;
+    std::string replacement;
+    bool replacing = false;
+    bool searchDone = false;
+    std::vector<ProjectMatch> items;
+    std::size_t cursorItem = 0;
+
+    void moveCursor(std::size_t item);
+    void openCursorItem();
+};
+
+class ProjectSearchWindow : public TWindow
+{
+public:
+    ProjectSearchWindow(const TRect &bounds, const std::string &rootName, std::unique_ptr<ProjectSearchJob> job,
+                        std::string replacement, bool replacing) noexcept;
+    ProjectSearchView *view() noexcept { return searchView; }
+    void updateTitle();
+
+private:
+    ProjectSearchView *searchView = nullptr;
+    std::string titlePrefix;
+};
+
 class MarkdownEditorApp : public ck::ui::ClockAwareApplication
 {
 public:
@@ -437,14 +591,24 @@ public:
     void updateMenuBarForMode(bool markdownMode);
     void refreshUiMode();
     void showDocumentSavedMessage(const std::string &path);
+    // Open the file of match, or bring up its window, and select the match.
+    void openSearchResult(const ProjectMatch &match);
+    // The editor or large-file window showing path, if any.
+    TWindow *windowForFile(const std::string &path);
 
 private:
     MarkdownEditWindow *openEditor(const char *fileName, Boolean visible);
+    // Open fileName in an editor window, or in a large-file window when it
+    // is too big to load.
+    void openDocument(const char *fileName);
     void fileOpen();
     void fileNew();
     void changeDir();
     void showAbout();
     void dispatchToEditor(ushort command);
+    void findInFiles(bool replace);
+    void applyProjectReplaces();
+    void pollProjectSearches();
     void clearStatusMessage();
 
     std::atomic<uint32_t> statusMessageCounter = 0;
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "text_rope.hpp"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace ck::edit
+{
+
+// Document-wide rewrites, each made in one pass over the text.  The result
+// is a list of edits against the text, ascending and not overlapping, that
+// touch only the bytes that change.
+
+// Trim trailing blanks (two or more spaces stay as a hard line break),
+// collapse runs of blank lines into one and end the text with a newline.
+std::vector<TextEdit> formatMarkdownEdits(std::string_view text);
+
+// Rewrap the paragraphs of text, which are separated by blank lines, to
+// lines of at most width columns.
+std::vector<TextEdit> reflowParagraphEdits(std::string_view text, std::size_t width = 80);
+
+} // namespace ck::edit
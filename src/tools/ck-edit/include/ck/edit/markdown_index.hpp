@@ -0,0 +1,87 @@
+#pragma once
+
+#include "markdown_parser.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace ck::edit
+{
+
+enum class MarkdownIndexKind
+{
+    Heading,
+    // [id]: target
+    ReferenceDefinition,
+    // [^id]: text
+    FootnoteDefinition,
+    // [text][id] or [id][]
+    ReferenceUse,
+    // [^id]
+    FootnoteUse,
+    // [text](#anchor)
+    AnchorLink
+};
+
+struct MarkdownIndexEntry
+{
+    MarkdownIndexKind kind = MarkdownIndexKind::Heading;
+    std::size_t line = 0;
+    // Byte column where the construct starts.
+    std::size_t column = 0;
+    // Heading level, 0 for other entries.
+    int level = 0;
+    // Heading text, the normalized id of a definition or reference, or the
+    // lowercased anchor of a link.
+    std::string text;
+};
+
+// Headings, link definitions and links of a document by line, with lookup
+// tables over them.  Entries are taken from one line at a time, so an
+// incremental analysis keeps those of the lines it did not analyze again.
+class MarkdownDocumentIndex
+{
+public:
+    // Lines must be added in order.
+    void addLine(std::size_t line, std::string_view text, const MarkdownLineInfo &info);
+    // Copy the entries of previous on lines [from, to), moved by shift lines.
+    void addEntries(const MarkdownDocumentIndex &previous, std::size_t from, std::size_t to, std::ptrdiff_t shift);
+    // Build the lookup tables once every line was added.
+    void finish();
+
+    const std::vector<MarkdownIndexEntry> &entries() const noexcept { return indexEntries; }
+    // Positions in entries() of the headings.
+    const std::vector<std::size_t> &headings() const noexcept { return headingEntries; }
+
+    bool hasReference(std::string_view id) const;
+    bool hasFootnote(std::string_view id) const;
+    bool hasAnchor(std::string_view anchor) const;
+    // prefix and the first number from 1 on that no reference definition
+    // uses yet.
+    std::string uniqueReferenceId(std::string_view prefix) const;
+    // "fn" and the first number from 1 on that no footnote uses yet.
+    std::string uniqueFootnoteId() const;
+    // References, footnotes and anchor links that nothing in the document
+    // defines, in document order.
+    std::vector<MarkdownIndexEntry> brokenLinks() const;
+
+    // Labels compare lowercased, with runs of whitespace as one space.
+    static std::string normalizeId(std::string_view id);
+    // The anchor GitHub gives a heading: lowercased, punctuation dropped and
+    // spaces turned into '-'.
+    static std::string anchorFor(std::string_view heading);
+
+private:
+    std::vector<MarkdownIndexEntry> indexEntries;
+    std::vector<std::size_t> headingEntries;
+    std::unordered_set<std::string> referenceIds;
+    std::unordered_set<std::string> footnoteIds;
+    std::unordered_set<std::string> anchors;
+
+    void addLinks(std::size_t line, std::string_view text, std::size_t from);
+};
+
+} // namespace ck::edit
@@ -99,28 +99,52 @@ struct MarkdownParserState
     std::string fenceLanguage;
 };
 
+// Parser states at the start of every interval-th line, so the state at
+// any line can be resumed from at most interval - 1 lines earlier.  Only a
+// contiguous run from line 0 is kept; edits drop the checkpoints after the
+// first changed line.
+class MarkdownStateCheckpoints
+{
+public:
+    explicit MarkdownStateCheckpoints(std::size_t interval = 128);
+
+    std::size_t interval() const noexcept { return checkpointInterval; }
+    // Closest checkpoint at or before line: stores its state and returns
+    // its line number.
+    std::size_t nearest(std::size_t line, MarkdownParserState &state) const;
+    // state is the state at the start of line; kept if it extends the run.
+    void record(std::size_t line, const MarkdownParserState &state);
+    // Lines from line on changed, so the states after it may have too.
+    void invalidateFrom(std::size_t line);
+    void clear();
+
+private:
+    std::size_t checkpointInterval;
+    std::vector<MarkdownParserState> states;
+};
+
 class MarkdownAnalyzer
 {
 public:
     MarkdownAnalyzer() = default;
 
-    MarkdownParserState computeStateBefore(const std::string &text);
-    MarkdownLineInfo analyzeLine(const std::string &line, MarkdownParserState &state) const;
+    MarkdownParserState computeStateBefore(std::string_view text);
+    MarkdownLineInfo analyzeLine(std::string_view line, MarkdownParserState &state) const;
     const MarkdownSpan *spanAtColumn(const MarkdownLineInfo &info, std::size_t column) const;
     std::string describeLine(const MarkdownLineInfo &info) const;
     std::string describeSpan(const MarkdownSpan &span) const;
     std::string describeTableCell(const MarkdownLineInfo &info, std::size_t column) const;
 
 private:
-    static bool isHorizontalRule(const std::string &trimmed) noexcept;
-    static bool isTableSeparator(const std::string &trimmed) noexcept;
-    static std::vector<MarkdownTableCell> parseTableRow(const std::string &line);
-    static std::vector<MarkdownTableAlignment> parseAlignmentRow(const std::string &line);
-    static std::string trimLeft(std::string_view view) noexcept;
-    static std::string trimRight(std::string_view view) noexcept;
-    static std::string trim(std::string_view view) noexcept;
-    static bool isHtmlBlockStart(const std::string &trimmed) noexcept;
-    MarkdownLineInfo analyzeFencedState(const std::string &line, MarkdownParserState &state) const;
+    static bool isHorizontalRule(std::string_view trimmed) noexcept;
+    static bool isTableSeparator(std::string_view trimmed) noexcept;
+    static std::vector<MarkdownTableCell> parseTableRow(std::string_view line);
+    static std::vector<MarkdownTableAlignment> parseAlignmentRow(std::string_view line);
+    static std::string_view trimLeft(std::string_view view) noexcept;
+    static std::string_view trimRight(std::string_view view) noexcept;
+    static std::string_view trim(std::string_view view) noexcept;
+    static bool isHtmlBlockStart(std::string_view trimmed) noexcept;
+    MarkdownLineInfo analyzeFencedState(std::string_view line, MarkdownParserState &state) const;
     void parseInline(const std::string &line, MarkdownLineInfo &info) const;
     void parseEmphasis(const std::string &line, std::vector<MarkdownSpan> &spans) const;
     void parseCodeSpans(const std::string &line, std::vector<MarkdownSpan> &spans) const;
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace ck::edit
+{
+
+struct ProjectSearchQuery
+{
+    // Literal text, or an ECMAScript regular expression when regex is set;
+    // a regular expression is matched against one line at a time.
+    std::string pattern;
+    bool regex = false;
+    bool caseSensitive = false;
+    // Files searched; all regular files when empty.  Directories whose
+    // names start with '.' are skipped.
+    std::function<bool(const std::filesystem::path &)> fileFilter;
+};
+
+struct ProjectMatch
+{
+    std::string path;
+    // Line and byte column of the match, counting from 0.
+    std::size_t line = 0;
+    std::size_t column = 0;
+    std::size_t length = 0;
+    // The line, cut after kLineTextLimit bytes.
+    std::string lineText;
+
+    static constexpr std::size_t kLineTextLimit = 240;
+};
+
+// A compiled query.  Literal patterns go through a Boyer-Moore-Horspool
+// searcher, so a pattern is looked for in whole files at once.
+class ProjectMatcher
+{
+public:
+    // Throws std::regex_error for a malformed regular expression.
+    explicit ProjectMatcher(const ProjectSearchQuery &query);
+
+    struct Match
+    {
+        std::size_t start = 0;
+        std::size_t length = 0;
+    };
+
+    // Matches in text, in order and not overlapping; empty matches of a
+    // regular expression are left out.
+    std::vector<Match> findAll(std::string_view text) const;
+    // Text with every match replaced.  For regular expressions, $1 and so
+    // on in replacement stand for the groups of the match.
+    std::string replaceAll(std::string_view text, std::string_view replacement, std::size_t &count) const;
+
+private:
+    std::string pattern;
+    bool useRegex = false;
+    bool caseSensitive = false;
+    std::regex expression;
+
+    // Pass every match to visit with the regex match behind it, if any.
+    void forEachMatch(std::string_view text,
+                      const std::function<void(std::size_t, std::size_t, const std::cmatch *)> &visit) const;
+};
+
+// A query running over a directory tree: one thread lists the files while
+// a pool of workers maps and searches them.  Each file's matches are handed
+// out together as soon as it has been searched.
+class ProjectSearchJob
+{
+public:
+    // Throws std::regex_error for a malformed regular expression.
+    ProjectSearchJob(std::filesystem::path root, ProjectSearchQuery query, unsigned threads = 0);
+    ProjectSearchJob(const ProjectSearchJob &) = delete;
+    ProjectSearchJob &operator=(const ProjectSearchJob &) = delete;
+    // Cancels and waits for the threads.
+    ~ProjectSearchJob();
+
+    // Up to limit matches not handed out yet.
+    std::vector<ProjectMatch> takeResults(std::size_t limit = SIZE_MAX);
+    // True once every file was searched and every match handed out.
+    bool finished() const;
+    void cancel();
+
+    const std::filesystem::path &root() const noexcept { return rootPath; }
+    const ProjectSearchQuery &query() const noexcept { return searchQuery; }
+    std::size_t filesSearched() const noexcept { return searchedFiles.load(std::memory_order_relaxed); }
+
+private:
+    std::filesystem::path rootPath;
+    ProjectSearchQuery searchQuery;
+    ProjectMatcher matcher;
+
+    mutable std::mutex mutex;
+    std::condition_variable filesQueued;
+    std::deque<std::filesystem::path> pendingFiles;
+    bool listingDone = false;
+    unsigned runningWorkers = 0;
+    std::vector<ProjectMatch> results;
+    std::atomic<bool> cancelled{false};
+    std::atomic<std::size_t> searchedFiles{0};
+
+    std::thread lister;
+    std::vector<std::thread> workers;
+
+    void listFiles();
+    void work();
+    void searchFile(const std::filesystem::path &path, std::vector<ProjectMatch> &found) const;
+};
+
+struct ProjectReplaceSummary
+{
+    std::size_t files = 0;
+    std::size_t replacements = 0;
+    // One message per file that could not be rewritten.
+    std::vector<std::string> errors;
+};
+
+// Replace every match of query in each of paths.  A changed file goes
+// through writeFileAtomically, so readers see either the old or the new
+// text.
+ProjectReplaceSummary replaceInFiles(const std::vector<std::string> &paths, const ProjectSearchQuery &query,
+                                     std::string_view replacement);
+
+// replaceInFiles on a thread of its own.
+class ProjectReplaceJob
+{
+public:
+    // Throws std::regex_error for a malformed regular expression.
+    ProjectReplaceJob(std::vector<std::string> paths, const ProjectSearchQuery &query, std::string replacement);
+    ProjectReplaceJob(const ProjectReplaceJob &) = delete;
+    ProjectReplaceJob &operator=(const ProjectReplaceJob &) = delete;
+    // Cancels and waits for the file being rewritten.
+    ~ProjectReplaceJob();
+
+    bool finished() const noexcept { return done.load(std::memory_order_acquire); }
+    void cancel() noexcept { cancelled.store(true, std::memory_order_relaxed); }
+    std::size_t filesDone() const noexcept { return doneFiles.load(std::memory_order_relaxed); }
+    std::size_t fileCount() const noexcept { return filePaths.size(); }
+    // Complete once finished() holds.
+    const ProjectReplaceSummary &summary() const noexcept { return replaceSummary; }
+
+private:
+    std::vector<std::string> filePaths;
+    std::string replacementText;
+    ProjectMatcher matcher;
+    ProjectReplaceSummary replaceSummary;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> doneFiles{0};
+    std::thread worker;
+
+    void run();
+};
+
+} // namespace ck::edit
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ck::edit
+{
+
+// Replace the bytes [start, end) with text.
+struct TextEdit
+{
+    std::size_t start = 0;
+    std::size_t end = 0;
+    std::string text;
+};
+
+// Text stored as a treap of chunks that is never modified in place: an edit
+// copies the O(log n) nodes on its path and shares the rest, so copying a
+// rope is an O(1) snapshot that other threads may read while the original
+// goes on changing.
+class TextRope
+{
+public:
+    TextRope() = default;
+    explicit TextRope(std::string_view text) { assign(text); }
+
+    // Take a text given in up to two pieces, as stored around the gap of
+    // an editor buffer.
+    void assign(std::string_view head, std::string_view tail = {});
+    void replace(std::size_t start, std::size_t end, std::string_view text);
+    // Apply edits given against the current text; they must not overlap.
+    void apply(std::vector<TextEdit> edits);
+
+    std::size_t size() const noexcept;
+    std::string substr(std::size_t start, std::size_t length) const;
+    std::string str() const;
+    // Pass the chunks in order.
+    void forEachChunk(const std::function<void(std::string_view)> &visit) const;
+    // Pass the chunks from offset on, the first cut to start there, until
+    // visit returns false; reaching offset takes O(log n).
+    void forEachChunkFrom(std::size_t offset, const std::function<bool(std::string_view)> &visit) const;
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node
+    {
+        std::shared_ptr<const std::string> text;
+        NodePtr left;
+        NodePtr right;
+        std::uint32_t priority = 0;
+        // Bytes of the subtree.
+        std::size_t bytes = 0;
+    };
+
+    NodePtr root;
+    std::uint32_t seed = 0x9e3779b9u;
+
+    static std::size_t bytesOf(const NodePtr &node) noexcept { return node ? node->bytes : 0; }
+    static NodePtr make(const Node &from, NodePtr left, NodePtr right);
+    NodePtr build(std::string_view text);
+    static void splitEndingBefore(const NodePtr &node, std::size_t offset, NodePtr &left, NodePtr &right);
+    static void splitStartingBefore(const NodePtr &node, std::size_t offset, NodePtr &left, NodePtr &right);
+    static NodePtr merge(const NodePtr &left, const NodePtr &right);
+};
+
+} // namespace ck::edit
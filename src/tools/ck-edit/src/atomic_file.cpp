@@ -0,0 +1,167 @@
+#include "ck/edit/atomic_file.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ck::edit
+{
+namespace
+{
+constexpr int kTempNameAttempts = 100;
+
+// Name beside target for the text on its way in, hidden on Unix.
+std::filesystem::path tempPathFor(const std::filesystem::path &target, std::mt19937 &random)
+{
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "%08x", static_cast<unsigned>(random()));
+    return target.parent_path() / ("." + target.filename().string() + "." + suffix + ".tmp");
+}
+
+#if !defined(_WIN32)
+bool writeAll(int fd, std::string_view text)
+{
+    while (!text.empty())
+    {
+        ssize_t written = ::write(fd, text.data(), text.size());
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        text.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+// Make the rename itself durable; 0 or an errno.  Some file systems cannot
+// sync a directory and say EINVAL, which leaves nothing more to do.
+int syncDirectory(const std::filesystem::path &directory)
+{
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+    int error = ::fsync(fd) != 0 && errno != EINVAL ? errno : 0;
+    ::close(fd);
+    return error;
+}
+#endif
+} // namespace
+
+void writeFileAtomically(const std::string &path, const std::vector<std::string_view> &parts)
+{
+    // Renaming over a symbolic link would replace the link rather than the
+    // file it points to.
+    std::error_code ec;
+    std::filesystem::path target = std::filesystem::canonical(path, ec);
+    if (ec)
+        target = path;
+    std::random_device seed;
+    std::mt19937 random(seed());
+
+#if !defined(_WIN32)
+    struct stat old = {};
+    bool existed = ::stat(target.c_str(), &old) == 0;
+    // O_EXCL so that no file already there is overwritten; a new file gets
+    // the mode the umask allows.
+    std::string temp;
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < kTempNameAttempts; ++attempt)
+    {
+        temp = tempPathFor(target, random).string();
+        fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0 && errno != EEXIST)
+            break;
+    }
+    if (fd < 0)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+
+    bool written = true;
+    for (std::string_view part : parts)
+    {
+        if (!(written = writeAll(fd, part)))
+            break;
+    }
+    int error = errno;
+    if (written && existed)
+    {
+        // Keeping another user's ownership needs privileges; without them
+        // the file goes to whoever saved it.
+        if (::fchown(fd, old.st_uid, old.st_gid) != 0)
+            errno = 0;
+        if (::fchmod(fd, old.st_mode & 07777) != 0)
+        {
+            written = false;
+            error = errno;
+        }
+    }
+    // The data must be on disk before the rename is, or a crash could
+    // leave an empty file under the old name.
+    if (written && ::fsync(fd) != 0)
+    {
+        written = false;
+        error = errno;
+    }
+    if (::close(fd) != 0 && written)
+    {
+        written = false;
+        error = errno;
+    }
+    if (written && ::rename(temp.c_str(), target.c_str()) != 0)
+    {
+        written = false;
+        error = errno;
+    }
+    if (!written)
+    {
+        ::unlink(temp.c_str());
+        throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+    if ((error = syncDirectory(target.parent_path())) != 0)
+        throw std::runtime_error(path + ": " + std::strerror(error));
+#else
+    std::filesystem::path temp;
+    for (int attempt = 0; attempt < kTempNameAttempts; ++attempt)
+    {
+        temp = tempPathFor(target, random);
+        if (!std::filesystem::exists(temp, ec))
+            break;
+    }
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open())
+            throw std::runtime_error(temp.string() + ": cannot write file");
+        for (std::string_view part : parts)
+            stream.write(part.data(), static_cast<std::streamsize>(part.size()));
+        if (!stream.good())
+        {
+            stream.close();
+            std::filesystem::remove(temp, ec);
+            throw std::runtime_error(temp.string() + ": write failed");
+        }
+    }
+    std::filesystem::file_status status = std::filesystem::status(target, ec);
+    if (std::filesystem::exists(status))
+        std::filesystem::permissions(temp, status.permissions(), ec);
+    std::filesystem::rename(temp, target, ec);
+    if (ec)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(temp, ignored);
+        throw std::runtime_error(path + ": " + ec.message());
+    }
+#endif
+}
+
+} // namespace ck::edit
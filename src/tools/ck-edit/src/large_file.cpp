@@ -0,0 +1,396 @@
+#include "ck/edit/large_file.hpp"
+
+#include "ck/edit/atomic_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ck::edit
+{
+namespace
+{
+// The background pass publishes what it found after each block.
+constexpr std::size_t kIndexBlock = 16u << 20;
+constexpr std::size_t kSearchChunk = 1u << 20;
+
+std::size_t countNewlines(const char *text, std::size_t length) noexcept
+{
+    return static_cast<std::size_t>(std::count(text, text + length, '\n'));
+}
+
+void foldAscii(char *text, std::size_t length) noexcept
+{
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        char ch = text[i];
+        text[i] = ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch | 0x20) : ch;
+    }
+}
+} // namespace
+
+LargeFileDocument::LargeFileDocument(const std::string &path) : filePath(path)
+{
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    struct stat sb
+    {
+    };
+    if (::fstat(fd, &sb) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+    if (S_ISREG(sb.st_mode) && sb.st_size > 0)
+    {
+        void *mapping = ::mmap(nullptr, static_cast<std::size_t>(sb.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            data = static_cast<const char *>(mapping);
+            dataSize = static_cast<std::size_t>(sb.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+#endif
+    if (!mapped)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error(path + ": cannot open file");
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        owned = std::move(ss).str();
+        data = owned.data();
+        dataSize = owned.size();
+    }
+
+    textSize = dataSize;
+    if (dataSize > 0)
+        pieces.push_back({false, 0, dataSize});
+    checkpoints.push_back(0);
+    indexedLineCount.store(1, std::memory_order_release);
+    indexer = std::thread([this]() { buildIndex(); });
+}
+
+LargeFileDocument::~LargeFileDocument()
+{
+    stopping.store(true, std::memory_order_release);
+    if (indexer.joinable())
+        indexer.join();
+#if !defined(_WIN32)
+    if (mapped)
+        ::munmap(const_cast<char *>(data), dataSize);
+#endif
+}
+
+void LargeFileDocument::buildIndex()
+{
+#if !defined(_WIN32)
+    if (mapped)
+        ::madvise(const_cast<char *>(data), dataSize, MADV_SEQUENTIAL);
+#endif
+    std::size_t lines = 1;
+    std::size_t offset = 0;
+    std::vector<std::size_t> found;
+    while (offset < dataSize && !stopping.load(std::memory_order_acquire))
+    {
+        std::size_t blockEnd = std::min(dataSize, offset + kIndexBlock);
+        while (offset < blockEnd)
+        {
+            const void *hit = std::memchr(data + offset, '\n', blockEnd - offset);
+            if (!hit)
+            {
+                offset = blockEnd;
+                break;
+            }
+            offset = static_cast<std::size_t>(static_cast<const char *>(hit) - data) + 1;
+            if (lines % kLineStride == 0)
+                found.push_back(offset);
+            ++lines;
+        }
+        std::lock_guard<std::mutex> lock(indexMutex);
+        checkpoints.insert(checkpoints.end(), found.begin(), found.end());
+        found.clear();
+        indexedLineCount.store(lines, std::memory_order_release);
+    }
+#if !defined(_WIN32)
+    if (mapped)
+        ::madvise(const_cast<char *>(data), dataSize, MADV_NORMAL);
+#endif
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        indexDone.store(true, std::memory_order_release);
+    }
+    indexFinished.notify_all();
+}
+
+void LargeFileDocument::waitForIndex()
+{
+    std::unique_lock<std::mutex> lock(indexMutex);
+    indexFinished.wait(lock, [this]() { return indexDone.load(std::memory_order_acquire); });
+}
+
+std::size_t LargeFileDocument::fileNewlinesBefore(std::size_t offset) const
+{
+    std::size_t index = 0;
+    std::size_t from = 0;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), offset);
+        index = static_cast<std::size_t>(it - checkpoints.begin()) - 1;
+        from = checkpoints[index];
+    }
+    return index * kLineStride + countNewlines(data + from, offset - from);
+}
+
+std::size_t LargeFileDocument::fileOffsetAfterNewline(std::size_t newline) const
+{
+    std::size_t line = newline + 1;
+    std::size_t index = 0;
+    std::size_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(indexMutex);
+        index = std::min(line / kLineStride, checkpoints.size() - 1);
+        offset = checkpoints[index];
+    }
+    for (std::size_t skip = line - index * kLineStride; skip > 0; --skip)
+    {
+        const void *hit = std::memchr(data + offset, '\n', dataSize - offset);
+        if (!hit)
+            return SIZE_MAX;
+        offset = static_cast<std::size_t>(static_cast<const char *>(hit) - data) + 1;
+    }
+    return offset;
+}
+
+std::string_view LargeFileDocument::pieceText(const Piece &piece) const noexcept
+{
+    const char *base = piece.added ? additions.data() : data;
+    return {base + piece.start, piece.length};
+}
+
+std::size_t LargeFileDocument::pieceNewlines(const Piece &piece) const
+{
+    if (piece.added)
+        return countNewlines(additions.data() + piece.start, piece.length);
+    return fileNewlinesBefore(piece.start + piece.length) - fileNewlinesBefore(piece.start);
+}
+
+std::size_t LargeFileDocument::lineCount() const
+{
+    std::size_t newlines = 0;
+    for (const Piece &piece : pieces)
+        newlines += pieceNewlines(piece);
+    return newlines + 1;
+}
+
+std::size_t LargeFileDocument::lineStart(std::size_t line) const
+{
+    if (line == 0)
+        return 0;
+    std::size_t remaining = line;
+    std::size_t position = 0;
+    for (const Piece &piece : pieces)
+    {
+        if (!piece.added)
+        {
+            // Look the line up in the file first; counting the newlines of
+            // the whole piece may mean scanning past the index.
+            std::size_t before = fileNewlinesBefore(piece.start);
+            std::size_t after = fileOffsetAfterNewline(before + remaining - 1);
+            if (after <= piece.start + piece.length)
+                return position + (after - piece.start);
+            remaining -= fileNewlinesBefore(piece.start + piece.length) - before;
+            position += piece.length;
+            continue;
+        }
+        std::size_t newlines = pieceNewlines(piece);
+        if (remaining > newlines)
+        {
+            remaining -= newlines;
+            position += piece.length;
+            continue;
+        }
+        std::string_view text = pieceText(piece);
+        std::size_t pos = 0;
+        for (; remaining > 0; --remaining)
+            pos = text.find('\n', pos) + 1;
+        return position + pos;
+    }
+    return textSize;
+}
+
+std::size_t LargeFileDocument::lineOf(std::size_t offset) const
+{
+    offset = std::min(offset, textSize);
+    std::size_t line = 0;
+    std::size_t position = 0;
+    for (const Piece &piece : pieces)
+    {
+        if (offset >= position + piece.length)
+        {
+            line += pieceNewlines(piece);
+            position += piece.length;
+            continue;
+        }
+        std::size_t within = offset - position;
+        if (piece.added)
+            line += countNewlines(additions.data() + piece.start, within);
+        else
+            line += fileNewlinesBefore(piece.start + within) - fileNewlinesBefore(piece.start);
+        break;
+    }
+    return line;
+}
+
+void LargeFileDocument::forEachSpan(std::size_t offset, const std::function<bool(std::string_view)> &visit) const
+{
+    std::size_t position = 0;
+    for (const Piece &piece : pieces)
+    {
+        if (offset >= position + piece.length)
+        {
+            position += piece.length;
+            continue;
+        }
+        std::string_view text = pieceText(piece).substr(offset > position ? offset - position : 0);
+        position += piece.length;
+        if (!visit(text))
+            return;
+    }
+}
+
+std::string LargeFileDocument::line(std::size_t line, std::size_t maxBytes) const
+{
+    std::string result;
+    forEachSpan(lineStart(line), [&](std::string_view span) {
+        std::size_t end = std::min(span.find('\n'), span.size());
+        std::size_t take = std::min(end, maxBytes - result.size());
+        result.append(span.data(), take);
+        return end == span.size() && result.size() < maxBytes;
+    });
+    if (!result.empty() && result.back() == '\r' && result.size() < maxBytes)
+        result.pop_back();
+    return result;
+}
+
+std::string LargeFileDocument::read(std::size_t offset, std::size_t length) const
+{
+    std::string result;
+    length = std::min(length, textSize - std::min(offset, textSize));
+    result.reserve(length);
+    forEachSpan(offset, [&](std::string_view span) {
+        result.append(span.data(), std::min(span.size(), length - result.size()));
+        return result.size() < length;
+    });
+    return result;
+}
+
+bool LargeFileDocument::find(std::string_view needle, std::size_t from, bool caseSensitive, std::size_t &found) const
+{
+    if (needle.empty() || from >= textSize)
+        return false;
+    // Search a window that keeps the last needle.size() - 1 bytes of the
+    // previous chunk, so matches across chunks and pieces are seen.
+    std::string pattern(needle);
+    if (!caseSensitive)
+        foldAscii(pattern.data(), pattern.size());
+    std::boyer_moore_horspool_searcher searcher(pattern.begin(), pattern.end());
+    std::string window;
+    std::size_t windowStart = from;
+    bool hit = false;
+    forEachSpan(from, [&](std::string_view span) {
+        while (!span.empty())
+        {
+            std::size_t take = std::min(span.size(), kSearchChunk);
+            std::size_t kept = window.size();
+            window.append(span.data(), take);
+            span.remove_prefix(take);
+            if (!caseSensitive)
+                foldAscii(window.data() + kept, take);
+            auto match = std::search(window.begin(), window.end(), searcher);
+            if (match != window.end())
+            {
+                found = windowStart + static_cast<std::size_t>(match - window.begin());
+                hit = true;
+                return false;
+            }
+            std::size_t drop = window.size() - std::min(window.size(), needle.size() - 1);
+            window.erase(0, drop);
+            windowStart += drop;
+        }
+        return true;
+    });
+    return hit;
+}
+
+void LargeFileDocument::replace(std::size_t offset, std::size_t length, std::string_view text)
+{
+    offset = std::min(offset, textSize);
+    length = std::min(length, textSize - offset);
+    std::size_t end = offset + length;
+
+    std::vector<Piece> next;
+    next.reserve(pieces.size() + 2);
+    std::size_t position = 0;
+    bool placed = false;
+    auto place = [&]() {
+        if (!placed && !text.empty())
+        {
+            next.push_back({true, additions.size(), text.size()});
+            additions.append(text);
+        }
+        placed = true;
+    };
+    for (const Piece &piece : pieces)
+    {
+        std::size_t pieceEnd = position + piece.length;
+        if (pieceEnd <= offset || position >= end)
+        {
+            if (position >= end)
+                place();
+            next.push_back(piece);
+        }
+        else
+        {
+            // Keep the parts of the piece outside [offset, end).
+            if (position < offset)
+                next.push_back({piece.added, piece.start, offset - position});
+            place();
+            if (pieceEnd > end)
+                next.push_back({piece.added, piece.start + (end - position), pieceEnd - end});
+        }
+        position = pieceEnd;
+    }
+    place();
+    pieces = std::move(next);
+    textSize = textSize - length + text.size();
+    edited = true;
+}
+
+void LargeFileDocument::save(const std::string &path) const
+{
+    std::vector<std::string_view> parts;
+    parts.reserve(pieces.size());
+    for (const Piece &piece : pieces)
+        parts.push_back(pieceText(piece));
+    writeFileAtomically(path, parts);
+}
+
+} // namespace ck::edit
@@ -0,0 +1,312 @@
+#include "ck/edit/markdown_editor.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace ck::edit
+{
+    namespace
+    {
+        // Columns reachable by horizontal scrolling; lines are read no
+        // further than the visible part.
+        constexpr int kLargeFileColumns = 4096;
+        // Bytes per column when reading the visible part of a line.
+        constexpr std::size_t kBytesPerColumn = 4;
+        // Tab stops, as TEditor draws them.
+        constexpr std::size_t kTabWidth = 8;
+        // Room to lengthen a line while editing it.
+        constexpr std::size_t kLineEditRoom = 4096;
+
+        std::string expandTabs(std::string_view text)
+        {
+            std::string result;
+            result.reserve(text.size());
+            std::size_t column = 0;
+            for (char c : text)
+            {
+                if (c == '\t')
+                {
+                    std::size_t next = (column / kTabWidth + 1) * kTabWidth;
+                    result.append(next - column, ' ');
+                    column = next;
+                    continue;
+                }
+                result.push_back(c);
+                // UTF-8 continuation bytes share the column of their lead byte.
+                if ((static_cast<unsigned char>(c) & 0xC0) != 0x80)
+                    ++column;
+            }
+            return result;
+        }
+    } // namespace
+
+    LargeFileView::LargeFileView(const TRect &bounds, TScrollBar *hScrollBar, TScrollBar *vScrollBar,
+                                 std::unique_ptr<LargeFileDocument> document) noexcept
+        : TScroller(bounds, hScrollBar, vScrollBar), largeDocument(std::move(document))
+    {
+        growMode = gfGrowHiX | gfGrowHiY;
+        options |= ofSelectable;
+        eventMask |= evBroadcast;
+        updateLimit();
+    }
+
+    void LargeFileView::updateLimit()
+    {
+        knownLines = largeDocument->indexComplete() ? largeDocument->lineCount() : largeDocument->indexedLines();
+        knownLines = std::max<std::size_t>(knownLines, 1);
+        int lines = static_cast<int>(std::min<std::size_t>(knownLines, INT_MAX));
+        setLimit(kLargeFileColumns, lines);
+    }
+
+    void LargeFileView::pollIndex()
+    {
+        if (indexFollowed)
+            return;
+        indexFollowed = largeDocument->indexComplete();
+        std::size_t previous = knownLines;
+        updateLimit();
+        if (returnLine && (*returnLine < knownLines || indexFollowed))
+            moveCursor(*returnLine);
+        else if (knownLines != previous)
+            drawView();
+    }
+
+    void LargeFileView::draw()
+    {
+        TColorAttr normal = getColor(1);
+        TColorAttr current = getColor(2);
+        std::size_t maxBytes = static_cast<std::size_t>(delta.x + size.x) * kBytesPerColumn;
+        for (int row = 0; row < size.y; ++row)
+        {
+            TDrawBuffer buffer;
+            auto line = static_cast<std::size_t>(delta.y) + static_cast<std::size_t>(row);
+            TColorAttr color = line == cursorLine ? current : normal;
+            buffer.moveChar(0, ' ', color, size.x);
+            if (line < knownLines)
+            {
+                std::string text = expandTabs(largeDocument->line(line, maxBytes));
+                buffer.moveStr(0, text, color, size.x, delta.x);
+            }
+            writeLine(0, row, size.x, 1, buffer);
+        }
+    }
+
+    void LargeFileView::moveCursor(std::size_t line)
+    {
+        returnLine.reset();
+        cursorLine = std::min(line, knownLines - 1);
+        int top = delta.y;
+        auto cursor = static_cast<int>(std::min<std::size_t>(cursorLine, INT_MAX));
+        if (cursor < top)
+            top = cursor;
+        else if (cursor >= top + size.y)
+            top = cursor - size.y + 1;
+        if (top != delta.y)
+            scrollTo(delta.x, top);
+        drawView();
+    }
+
+    void LargeFileView::goToLine(std::size_t line)
+    {
+        // The cursor goes as far as the index has reached and on to the
+        // line once pollIndex finds it.
+        updateLimit();
+        moveCursor(line);
+        if (line >= knownLines)
+            returnLine = line;
+    }
+
+    void LargeFileView::handleEvent(TEvent &event)
+    {
+        TScroller::handleEvent(event);
+        if (event.what == evKeyDown)
+        {
+            std::size_t page = static_cast<std::size_t>(std::max(1, size.y - 1));
+            switch (event.keyDown.keyCode)
+            {
+            case kbUp:
+                moveCursor(cursorLine > 0 ? cursorLine - 1 : 0);
+                break;
+            case kbDown:
+                moveCursor(cursorLine + 1);
+                break;
+            case kbPgUp:
+                moveCursor(cursorLine > page ? cursorLine - page : 0);
+                break;
+            case kbPgDn:
+                moveCursor(cursorLine + page);
+                break;
+            case kbCtrlPgUp:
+            case kbCtrlHome:
+                moveCursor(0);
+                break;
+            case kbCtrlPgDn:
+            case kbCtrlEnd:
+                moveCursor(knownLines - 1);
+                break;
+            case kbEnter:
+                editLine();
+                break;
+            default:
+                return;
+            }
+            clearEvent(event);
+        }
+        else if (event.what == evCommand)
+        {
+            switch (event.message.command)
+            {
+            case cmFind:
+                find(true);
+                break;
+            case cmSearchAgain:
+                find(false);
+                break;
+            case cmSave:
+                save();
+                break;
+            default:
+                return;
+            }
+            clearEvent(event);
+        }
+    }
+
+    void LargeFileView::setState(ushort aState, Boolean enable)
+    {
+        TScroller::setState(aState, enable);
+        if ((aState & sfActive) != 0)
+        {
+            TCommandSet commands;
+            commands.enableCmd(cmFind);
+            commands.enableCmd(cmSearchAgain);
+            commands.enableCmd(cmSave);
+            if (enable)
+                enableCommands(commands);
+            else
+                disableCommands(commands);
+        }
+    }
+
+    void LargeFileView::editLine()
+    {
+        if (!largeDocument->indexComplete())
+        {
+            messageBox("The file is still being indexed; try again shortly.", mfInformation | mfOKButton);
+            return;
+        }
+        // inputBox stops at 255 characters, so the line gets an input line
+        // as long as it is; the input line scrolls.
+        std::string text = largeDocument->line(cursorLine);
+        std::size_t limit = text.size() + kLineEditRoom;
+        std::vector<char> data(limit + 1, '\0');
+        std::memcpy(data.data(), text.data(), text.size());
+
+        auto *dialog = new TDialog(TRect(0, 0, 66, 8), "Edit Line");
+        dialog->options |= ofCentered;
+        auto *input = new TInputLine(TRect(3, 3, 63, 4), static_cast<uint>(limit));
+        dialog->insert(input);
+        dialog->insert(new TLabel(TRect(2, 2, 10, 3), "~L~ine", input));
+        dialog->insert(new TButton(TRect(41, 5, 51, 7), "O~K~", cmOK, bfDefault));
+        dialog->insert(new TButton(TRect(53, 5, 63, 7), "Cancel", cmCancel, bfNormal));
+        input->setData(data.data());
+        dialog->selectNext(False);
+
+        TView *validated = TProgram::application->validView(dialog);
+        if (!validated)
+            return;
+        dialog = static_cast<TDialog *>(validated);
+        ushort result = TProgram::deskTop->execView(dialog);
+        if (result != cmCancel)
+            input->getData(data.data());
+        TObject::destroy(dialog);
+
+        std::string edited(data.data());
+        if (result == cmCancel || edited == text)
+            return;
+        largeDocument->replace(largeDocument->lineStart(cursorLine), text.size(), edited);
+        drawView();
+    }
+
+    void LargeFileView::find(bool prompt)
+    {
+        if (prompt || TEditor::findStr[0] == '\0')
+        {
+            TFindDialogRec rec(TEditor::findStr, TEditor::editorFlags);
+            if (TEditor::editorDialog(edFind, &rec) == cmCancel)
+                return;
+            std::strcpy(TEditor::findStr, rec.find);
+            TEditor::editorFlags = rec.options;
+        }
+        // Start after the cursor line when searching again.
+        std::size_t from = largeDocument->lineStart(prompt ? cursorLine : cursorLine + 1);
+        std::size_t found = 0;
+        bool caseSensitive = (TEditor::editorFlags & efCaseSensitive) != 0;
+        if (!largeDocument->find(TEditor::findStr, from, caseSensitive, found))
+        {
+            TEditor::editorDialog(edSearchFailed);
+            return;
+        }
+        goToLine(largeDocument->lineOf(found));
+    }
+
+    bool LargeFileView::save()
+    {
+        std::string path = largeDocument->path();
+        try
+        {
+            largeDocument->save(path);
+            largeDocument = std::make_unique<LargeFileDocument>(path);
+        }
+        catch (const std::exception &error)
+        {
+            messageBox(error.what(), mfError | mfOKButton);
+            return false;
+        }
+        // The saved file is indexed again in the background.
+        indexFollowed = false;
+        goToLine(cursorLine);
+        if (auto *app = dynamic_cast<MarkdownEditorApp *>(TProgram::application))
+            app->showDocumentSavedMessage(path);
+        return true;
+    }
+
+    Boolean LargeFileView::valid(ushort command)
+    {
+        if (command == cmValid || !largeDocument->modified())
+            return True;
+        std::ostringstream text;
+        text << largeDocument->path() << " has been modified. Save?";
+        switch (messageBox(text.str().c_str(), mfConfirmation | mfYesNoCancel))
+        {
+        case cmYes:
+            return save() ? True : False;
+        case cmNo:
+            return True;
+        default:
+            return False;
+        }
+    }
+
+    LargeFileWindow::LargeFileWindow(const TRect &bounds, std::unique_ptr<LargeFileDocument> document) noexcept
+        : TWindowInit(&TWindow::initFrame), TWindow(bounds, nullptr, wnNoNumber)
+    {
+        options |= ofTileable;
+        std::filesystem::path path(document->path());
+        std::string titleText = path.filename().string() + " (large file)";
+        title = newStr(titleText.c_str());
+
+        TScrollBar *hScrollBar = standardScrollBar(sbHorizontal | sbHandleKeyboard);
+        TScrollBar *vScrollBar = standardScrollBar(sbVertical);
+        TRect viewRect = getExtent();
+        viewRect.grow(-1, -1);
+        fileView = new LargeFileView(viewRect, hScrollBar, vScrollBar, std::move(document));
+        insert(fileView);
+    }
+
+} // namespace ck::edit
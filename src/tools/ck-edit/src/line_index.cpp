@@ -0,0 +1,372 @@
+#include "ck/edit/line_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ck::edit
+{
+namespace
+{
+// Append the lengths of the lines of text to lengths, the first one extended
+// by carry bytes; returns the length of the unterminated remainder.
+std::uint32_t appendLineLengths(std::string_view text, std::uint32_t carry, std::vector<std::uint32_t> &lengths)
+{
+    const char *data = text.data();
+    std::size_t pos = 0;
+    while (pos < text.size())
+    {
+        const void *hit = std::memchr(data + pos, '\n', text.size() - pos);
+        if (!hit)
+            break;
+        std::size_t next = static_cast<std::size_t>(static_cast<const char *>(hit) - data) + 1;
+        lengths.push_back(carry + static_cast<std::uint32_t>(next - pos));
+        carry = 0;
+        pos = next;
+    }
+    return carry + static_cast<std::uint32_t>(text.size() - pos);
+}
+} // namespace
+
+LineIndex::LineIndex()
+{
+    assign({});
+}
+
+void LineIndex::assign(std::string_view head, std::string_view tail)
+{
+    nodes.clear();
+    freeNodes.clear();
+    std::vector<std::uint32_t> lengths;
+    std::uint32_t rest = appendLineLengths(head, 0, lengths);
+    lengths.push_back(appendLineLengths(tail, rest, lengths));
+    nodes.reserve(lengths.size());
+    root = build(lengths);
+}
+
+void LineIndex::replace(std::size_t start, std::size_t end, std::string_view text)
+{
+    std::size_t total = byteCount();
+    start = std::min(start, total);
+    end = std::clamp(end, start, total);
+
+    std::size_t first = lineOf(start);
+    std::size_t last = lineOf(end);
+    std::size_t firstStart = lineStart(first);
+
+    std::uint32_t before = nil;
+    std::uint32_t rest = nil;
+    std::uint32_t middle = nil;
+    std::uint32_t after = nil;
+    split(root, first, before, rest);
+    split(rest, last - first + 1, middle, after);
+
+    // The touched lines become the part of the first one before start, the
+    // new text and the part of the last one from end on.
+    auto head = static_cast<std::uint32_t>(start - firstStart);
+    auto tail = static_cast<std::uint32_t>(firstStart + byteCountOf(middle) - end);
+    release(middle);
+
+    std::vector<std::uint32_t> lengths;
+    lengths.push_back(appendLineLengths(text, head, lengths) + tail);
+    root = merge(merge(before, build(lengths)), after);
+}
+
+std::size_t LineIndex::lineCount() const noexcept
+{
+    return lineCountOf(root);
+}
+
+std::size_t LineIndex::byteCount() const noexcept
+{
+    return byteCountOf(root);
+}
+
+std::size_t LineIndex::lineOf(std::size_t offset) const noexcept
+{
+    if (offset >= byteCount())
+        return lineCount() - 1;
+    std::size_t line = 0;
+    std::uint32_t node = root;
+    while (node != nil)
+    {
+        const LineNode &current = nodes[node];
+        std::uint32_t leftBytes = byteCountOf(current.left);
+        if (offset < leftBytes)
+        {
+            node = current.left;
+            continue;
+        }
+        line += lineCountOf(current.left);
+        offset -= leftBytes;
+        if (offset < current.length)
+            return line;
+        offset -= current.length;
+        ++line;
+        node = current.right;
+    }
+    return line;
+}
+
+std::size_t LineIndex::lineStart(std::size_t line) const noexcept
+{
+    if (line >= lineCount())
+        return byteCount();
+    std::size_t offset = 0;
+    std::uint32_t node = root;
+    while (node != nil)
+    {
+        const LineNode &current = nodes[node];
+        std::uint32_t leftLines = lineCountOf(current.left);
+        if (line < leftLines)
+        {
+            node = current.left;
+            continue;
+        }
+        offset += byteCountOf(current.left);
+        if (line == leftLines)
+            return offset;
+        offset += current.length;
+        line -= leftLines + 1;
+        node = current.right;
+    }
+    return offset;
+}
+
+bool LineIndex::rowsMeasured(std::size_t line) const noexcept
+{
+    std::uint32_t node = root;
+    while (node != nil)
+    {
+        const LineNode &current = nodes[node];
+        std::uint32_t leftLines = lineCountOf(current.left);
+        if (line < leftLines)
+            node = current.left;
+        else if (line == leftLines)
+            return current.rows != 0;
+        else
+        {
+            line -= leftLines + 1;
+            node = current.right;
+        }
+    }
+    return false;
+}
+
+void LineIndex::setRows(std::size_t line, std::uint32_t rows) noexcept
+{
+    if (line < lineCount())
+        setRows(root, line, rows);
+}
+
+void LineIndex::setRows(std::uint32_t node, std::size_t line, std::uint32_t rows) noexcept
+{
+    std::uint32_t leftLines = lineCountOf(nodes[node].left);
+    if (line < leftLines)
+        setRows(nodes[node].left, line, rows);
+    else if (line == leftLines)
+        nodes[node].rows = rows;
+    else
+        setRows(nodes[node].right, line - leftLines - 1, rows);
+    pull(node);
+}
+
+void LineIndex::resetRows() noexcept
+{
+    for (LineNode &node : nodes)
+    {
+        node.rows = 0;
+        node.rowSum = node.lines;
+    }
+}
+
+std::size_t LineIndex::rowCount() const noexcept
+{
+    return rowCountOf(root);
+}
+
+std::size_t LineIndex::rowsBefore(std::size_t line) const noexcept
+{
+    if (line >= lineCount())
+        return rowCount();
+    std::size_t rows = 0;
+    std::uint32_t node = root;
+    while (node != nil)
+    {
+        const LineNode &current = nodes[node];
+        std::uint32_t leftLines = lineCountOf(current.left);
+        if (line < leftLines)
+        {
+            node = current.left;
+            continue;
+        }
+        rows += rowCountOf(current.left);
+        if (line == leftLines)
+            return rows;
+        rows += std::max<std::uint32_t>(current.rows, 1);
+        line -= leftLines + 1;
+        node = current.right;
+    }
+    return rows;
+}
+
+std::size_t LineIndex::lineAtRow(std::size_t row, std::size_t &rowInLine) const noexcept
+{
+    std::size_t total = rowCount();
+    if (row >= total)
+    {
+        std::size_t last = lineCount() - 1;
+        rowInLine = total - rowsBefore(last) - 1;
+        return last;
+    }
+    std::size_t line = 0;
+    std::uint32_t node = root;
+    while (node != nil)
+    {
+        const LineNode &current = nodes[node];
+        std::uint32_t leftRows = rowCountOf(current.left);
+        if (row < leftRows)
+        {
+            node = current.left;
+            continue;
+        }
+        line += lineCountOf(current.left);
+        row -= leftRows;
+        std::uint32_t rows = std::max<std::uint32_t>(current.rows, 1);
+        if (row < rows)
+        {
+            rowInLine = row;
+            return line;
+        }
+        row -= rows;
+        ++line;
+        node = current.right;
+    }
+    rowInLine = 0;
+    return line;
+}
+
+std::uint32_t LineIndex::lineCountOf(std::uint32_t node) const noexcept
+{
+    return node == nil ? 0 : nodes[node].lines;
+}
+
+std::uint32_t LineIndex::byteCountOf(std::uint32_t node) const noexcept
+{
+    return node == nil ? 0 : nodes[node].bytes;
+}
+
+std::uint32_t LineIndex::rowCountOf(std::uint32_t node) const noexcept
+{
+    return node == nil ? 0 : nodes[node].rowSum;
+}
+
+void LineIndex::pull(std::uint32_t node) noexcept
+{
+    LineNode &current = nodes[node];
+    current.lines = lineCountOf(current.left) + 1 + lineCountOf(current.right);
+    current.bytes = byteCountOf(current.left) + current.length + byteCountOf(current.right);
+    current.rowSum = rowCountOf(current.left) + std::max<std::uint32_t>(current.rows, 1) + rowCountOf(current.right);
+}
+
+std::uint32_t LineIndex::allocate(std::uint32_t length)
+{
+    // xorshift32; the shape only has to be balanced on average.
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    std::uint32_t node;
+    if (!freeNodes.empty())
+    {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else
+    {
+        node = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[node] = LineNode{nil, nil, seed, length, 0, 1, length, 1};
+    return node;
+}
+
+void LineIndex::release(std::uint32_t node)
+{
+    if (node == nil)
+        return;
+    std::vector<std::uint32_t> pending{node};
+    while (!pending.empty())
+    {
+        std::uint32_t current = pending.back();
+        pending.pop_back();
+        if (nodes[current].left != nil)
+            pending.push_back(nodes[current].left);
+        if (nodes[current].right != nil)
+            pending.push_back(nodes[current].right);
+        freeNodes.push_back(current);
+    }
+}
+
+std::uint32_t LineIndex::build(const std::vector<std::uint32_t> &lengths)
+{
+    // Cartesian tree in one pass: the stack holds the right spine.
+    std::vector<std::uint32_t> spine;
+    for (std::uint32_t length : lengths)
+    {
+        std::uint32_t node = allocate(length);
+        std::uint32_t last = nil;
+        while (!spine.empty() && nodes[spine.back()].priority < nodes[node].priority)
+        {
+            last = spine.back();
+            spine.pop_back();
+            pull(last);
+        }
+        nodes[node].left = last;
+        if (!spine.empty())
+            nodes[spine.back()].right = node;
+        spine.push_back(node);
+    }
+    for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+        pull(*it);
+    return spine.empty() ? nil : spine.front();
+}
+
+void LineIndex::split(std::uint32_t node, std::size_t count, std::uint32_t &left, std::uint32_t &right) noexcept
+{
+    if (node == nil)
+    {
+        left = right = nil;
+        return;
+    }
+    std::uint32_t leftLines = lineCountOf(nodes[node].left);
+    if (leftLines < count)
+    {
+        split(nodes[node].right, count - leftLines - 1, nodes[node].right, right);
+        left = node;
+    }
+    else
+    {
+        split(nodes[node].left, count, left, nodes[node].left);
+        right = node;
+    }
+    pull(node);
+}
+
+std::uint32_t LineIndex::merge(std::uint32_t left, std::uint32_t right) noexcept
+{
+    if (left == nil)
+        return right;
+    if (right == nil)
+        return left;
+    if (nodes[left].priority > nodes[right].priority)
+    {
+        nodes[left].right = merge(nodes[left].right, right);
+        pull(left);
+        return left;
+    }
+    nodes[right].left = merge(left, nodes[right].left);
+    pull(right);
+    return right;
+}
+
+} // namespace ck::edit
@@ -0,0 +1,301 @@
+#include "ck/edit/markdown_analysis.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ck::edit
+{
+namespace
+{
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+std::uint64_t hashValue(std::uint64_t hash, std::uint64_t value) noexcept
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+std::uint64_t hashText(std::uint64_t hash, const std::string &text) noexcept
+{
+    hash = hashValue(hash, text.size());
+    for (char ch : text)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+// forEachSpanFrom(offset, visit) passes the text from offset on in spans
+// until visit returns false.
+template <typename ForEachSpanFrom>
+MarkdownDocumentAnalysis analyzeText(const ForEachSpanFrom &forEachSpanFrom, std::size_t size, std::uint64_t version,
+                                     const MarkdownDocumentAnalysis *previous, const MarkdownTextChange &change)
+{
+    constexpr std::size_t interval = MarkdownDocumentAnalysis::checkpointInterval;
+    MarkdownDocumentAnalysis result;
+    result.version = version;
+    result.textBytes = size;
+
+    MarkdownParserState state;
+    std::size_t line = 0;
+    std::size_t offset = 0;
+    // Lines from stableFrom on are unchanged and were lineShift lines and
+    // byteShift bytes earlier in the previous version.
+    std::size_t stableFrom = SIZE_MAX;
+    std::ptrdiff_t lineShift = 0;
+    std::ptrdiff_t byteShift = 0;
+
+    if (previous && !previous->checkpointLines.empty())
+    {
+        result.previousVersion = previous->version;
+        if (change.empty())
+        {
+            result = *previous;
+            result.version = version;
+            result.previousVersion = previous->version;
+            result.firstChangedLine = result.endChangedLine = 0;
+            return result;
+        }
+        std::size_t lineCount = std::max<std::size_t>(change.lineCount, 1);
+        result.firstChangedLine = std::min(change.firstLine, lineCount - 1);
+        stableFrom = std::max(result.firstChangedLine + 1, lineCount - std::min(change.unchangedTail, lineCount));
+        lineShift = static_cast<std::ptrdiff_t>(lineCount) - static_cast<std::ptrdiff_t>(previous->lineKinds.size());
+        byteShift = static_cast<std::ptrdiff_t>(size) - static_cast<std::ptrdiff_t>(previous->textBytes);
+
+        // Everything before the first changed line is reused, resuming from
+        // the closest checkpoint.
+        auto it = std::upper_bound(previous->checkpointLines.begin(), previous->checkpointLines.end(),
+                                   result.firstChangedLine);
+        auto kept = static_cast<std::size_t>(it - previous->checkpointLines.begin());
+        result.checkpointLines.assign(previous->checkpointLines.begin(), it);
+        result.checkpointStates.assign(previous->checkpointStates.begin(), previous->checkpointStates.begin() + kept);
+        result.checkpointOffsets.assign(previous->checkpointOffsets.begin(),
+                                        previous->checkpointOffsets.begin() + kept);
+        line = result.checkpointLines.back();
+        state = result.checkpointStates.back();
+        offset = result.checkpointOffsets.back();
+        result.lineKinds.reserve(lineCount);
+        result.entryStates.reserve(lineCount);
+        result.lineKinds.assign(previous->lineKinds.begin(), previous->lineKinds.begin() + line);
+        result.entryStates.assign(previous->entryStates.begin(), previous->entryStates.begin() + line);
+        result.index.addEntries(previous->index, 0, line, 0);
+    }
+    else
+    {
+        result.checkpointLines.push_back(0);
+        result.checkpointStates.push_back(state);
+        result.checkpointOffsets.push_back(0);
+    }
+
+    MarkdownAnalyzer analyzer;
+    // Analyze one line without its newline; false once the rest is known.
+    auto takeLine = [&](std::string_view lineText) {
+        std::uint64_t entryState = fingerprintState(state);
+        if (line >= stableFrom)
+        {
+            auto oldLine = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(line) - lineShift);
+            if (oldLine < previous->entryStates.size() && previous->entryStates[oldLine] == entryState)
+            {
+                // Same text from the same state: the rest is as before.
+                result.lineKinds.insert(result.lineKinds.end(), previous->lineKinds.begin() + oldLine,
+                                        previous->lineKinds.end());
+                result.entryStates.insert(result.entryStates.end(), previous->entryStates.begin() + oldLine,
+                                          previous->entryStates.end());
+                result.index.addEntries(previous->index, oldLine, SIZE_MAX, lineShift);
+                for (std::size_t i = 0; i < previous->checkpointLines.size(); ++i)
+                {
+                    std::size_t oldCheckpoint = previous->checkpointLines[i];
+                    if (oldCheckpoint < oldLine)
+                        continue;
+                    auto shifted = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(oldCheckpoint) + lineShift);
+                    if (shifted <= result.checkpointLines.back())
+                        continue;
+                    result.checkpointLines.push_back(shifted);
+                    result.checkpointStates.push_back(previous->checkpointStates[i]);
+                    result.checkpointOffsets.push_back(static_cast<std::size_t>(
+                        static_cast<std::ptrdiff_t>(previous->checkpointOffsets[i]) + byteShift));
+                }
+                return false;
+            }
+        }
+        if (line % interval == 0 && line > result.checkpointLines.back())
+        {
+            result.checkpointLines.push_back(line);
+            result.checkpointStates.push_back(state);
+            result.checkpointOffsets.push_back(offset);
+        }
+        result.entryStates.push_back(entryState);
+
+        offset += lineText.size() + 1;
+        if (!lineText.empty() && lineText.back() == '\r')
+            lineText.remove_suffix(1);
+        MarkdownLineInfo info = analyzer.analyzeLine(lineText, state);
+        result.lineKinds.push_back(info.kind);
+        result.index.addLine(line, lineText, info);
+        ++line;
+        return true;
+    };
+
+    // A line split between spans is gathered in partial.
+    std::string partial;
+    bool stopped = false;
+    forEachSpanFrom(offset, [&](std::string_view span) {
+        while (true)
+        {
+            const void *hit = std::memchr(span.data(), '\n', span.size());
+            if (!hit)
+            {
+                partial.append(span);
+                return true;
+            }
+            auto end = static_cast<std::size_t>(static_cast<const char *>(hit) - span.data());
+            if (partial.empty())
+            {
+                stopped = !takeLine(span.substr(0, end));
+            }
+            else
+            {
+                partial.append(span.substr(0, end));
+                stopped = !takeLine(partial);
+                partial.clear();
+            }
+            if (stopped)
+                return false;
+            span.remove_prefix(end + 1);
+        }
+    });
+    // The last line ends without a newline.
+    if (!stopped)
+        takeLine(partial);
+    result.endChangedLine = line;
+    result.index.finish();
+    return result;
+}
+} // namespace
+
+std::size_t MarkdownDocumentAnalysis::stateBefore(std::size_t line, MarkdownParserState &state) const
+{
+    auto it = std::upper_bound(checkpointLines.begin(), checkpointLines.end(), line);
+    if (it == checkpointLines.begin())
+    {
+        state = MarkdownParserState{};
+        return 0;
+    }
+    auto index = static_cast<std::size_t>(it - checkpointLines.begin()) - 1;
+    state = checkpointStates[index];
+    return checkpointLines[index];
+}
+
+std::uint64_t fingerprintState(const MarkdownParserState &state) noexcept
+{
+    std::uint64_t hash = kFnvOffset;
+    hash = hashValue(hash, (state.inFence ? 1u : 0u) | (state.fenceIndented ? 2u : 0u) |
+                               (state.tableActive ? 4u : 0u) | (state.tableHeaderConfirmed ? 8u : 0u));
+    hash = hashValue(hash, static_cast<std::uint64_t>(state.tableRowCounter));
+    hash = hashText(hash, state.fenceMarker);
+    hash = hashText(hash, state.fenceLabel);
+    hash = hashText(hash, state.fenceLanguage);
+    hash = hashValue(hash, state.tableAlignments.size());
+    for (MarkdownTableAlignment alignment : state.tableAlignments)
+        hash = hashValue(hash, static_cast<std::uint64_t>(alignment));
+    return hash;
+}
+
+void MarkdownTextChange::addEdit(std::size_t first, std::size_t last, std::size_t lineCountBefore) noexcept
+{
+    firstLine = std::min(firstLine, first);
+    unchangedTail = std::min(unchangedTail, lineCountBefore - 1 - std::min(last, lineCountBefore - 1));
+}
+
+void MarkdownTextChange::merge(const MarkdownTextChange &later) noexcept
+{
+    firstLine = std::min(firstLine, later.firstLine);
+    unchangedTail = std::min(unchangedTail, later.unchangedTail);
+    lineCount = later.lineCount;
+}
+
+MarkdownDocumentAnalysis analyzeDocument(std::string_view text, std::uint64_t version)
+{
+    auto forEachSpanFrom = [text](std::size_t offset, const auto &visit) { visit(text.substr(offset)); };
+    return analyzeText(forEachSpanFrom, text.size(), version, nullptr, {});
+}
+
+MarkdownDocumentAnalysis analyzeDocument(const TextRope &text, std::uint64_t version,
+                                         const MarkdownDocumentAnalysis *previous, const MarkdownTextChange &change)
+{
+    auto forEachSpanFrom = [&text](std::size_t offset, const std::function<bool(std::string_view)> &visit) {
+        text.forEachChunkFrom(offset, visit);
+    };
+    return analyzeText(forEachSpanFrom, text.size(), version, previous, change);
+}
+
+MarkdownBackgroundAnalysis::~MarkdownBackgroundAnalysis()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+void MarkdownBackgroundAnalysis::submit(std::uint64_t version, TextRope text, const MarkdownTextChange &change)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // A request not yet taken is replaced; its change still applies.
+        if (pending)
+            pendingChange.merge(change);
+        else
+            pendingChange = change;
+        pendingVersion = version;
+        pendingText = std::move(text);
+        pending = true;
+        if (!worker.joinable())
+            worker = std::thread([this]() { run(); });
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<const MarkdownDocumentAnalysis> MarkdownBackgroundAnalysis::latest() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return published;
+}
+
+void MarkdownBackgroundAnalysis::run()
+{
+    std::shared_ptr<const MarkdownDocumentAnalysis> previous;
+    while (true)
+    {
+        TextRope snapshot;
+        MarkdownTextChange change;
+        std::uint64_t version = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || pending; });
+            if (stopping)
+                return;
+            snapshot = std::move(pendingText);
+            change = pendingChange;
+            version = pendingVersion;
+            pending = false;
+        }
+        auto result = std::make_shared<const MarkdownDocumentAnalysis>(
+            analyzeDocument(snapshot, version, previous.get(), change));
+        previous = result;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            published = std::move(result);
+        }
+    }
+}
+
+} // namespace ck::edit
@@ -394,6 +394,93 @@ namespace ck::edit
             return result;
         }
 
+        constexpr int kDirectoryHistoryId = 12;
+
+        struct FindInFilesRec
+        {
+            char find[maxFindStrLen] = "";
+            char replace[maxReplaceStrLen] = "";
+            char directory[MAXPATH] = "";
+            // 0x0001 case sensitive, 0x0002 regular expression.
+            ushort options = 0;
+        };
+
+        ushort runFindInFilesDialog(FindInFilesRec &rec, bool replace)
+        {
+            int extra = replace ? 3 : 0;
+            auto *dialog = new TDialog(TRect(0, 0, 52, 16 + extra), replace ? "Replace in Files" : "Find in Files");
+            dialog->options |= ofCentered;
+
+            auto *findInput = new TInputLine(TRect(3, 3, 46, 4), maxFindStrLen);
+            dialog->insert(findInput);
+            dialog->insert(new TLabel(TRect(2, 2, 15, 3), "~T~ext to find", findInput));
+            dialog->insert(new THistory(TRect(46, 3, 49, 4), findInput, kFindHistoryId));
+
+            TInputLine *replaceInput = nullptr;
+            if (replace)
+            {
+                replaceInput = new TInputLine(TRect(3, 6, 46, 7), maxReplaceStrLen);
+                dialog->insert(replaceInput);
+                dialog->insert(new TLabel(TRect(2, 5, 12, 6), "~N~ew text", replaceInput));
+                dialog->insert(new THistory(TRect(46, 6, 49, 7), replaceInput, kReplaceHistoryId));
+            }
+
+            auto *directoryInput = new TInputLine(TRect(3, 6 + extra, 46, 7 + extra), MAXPATH);
+            dialog->insert(directoryInput);
+            dialog->insert(new TLabel(TRect(2, 5 + extra, 14, 6 + extra), "~D~irectory", directoryInput));
+            dialog->insert(new THistory(TRect(46, 6 + extra, 49, 7 + extra), directoryInput, kDirectoryHistoryId));
+
+            auto *optionBoxes = new TCheckBoxes(
+                TRect(3, 8 + extra, 49, 10 + extra),
+                new TSItem("~C~ase sensitive",
+                           new TSItem("~R~egular expression", nullptr)));
+            dialog->insert(optionBoxes);
+
+            dialog->insert(new TButton(TRect(27, 12 + extra, 37, 14 + extra), "O~K~", cmOK, bfDefault));
+            dialog->insert(new TButton(TRect(39, 12 + extra, 49, 14 + extra), "Cancel", cmCancel, bfNormal));
+
+            findInput->setData(rec.find);
+            if (replaceInput)
+                replaceInput->setData(rec.replace);
+            directoryInput->setData(rec.directory);
+            optionBoxes->setData(&rec.options);
+
+            dialog->selectNext(False);
+
+            TView *validated = TProgram::application->validView(dialog);
+            if (!validated)
+                return cmCancel;
+            dialog = static_cast<TDialog *>(validated);
+
+            ushort result = TProgram::deskTop->execView(dialog);
+            if (result != cmCancel)
+            {
+                findInput->getData(rec.find);
+                if (replaceInput)
+                    replaceInput->getData(rec.replace);
+                directoryInput->getData(rec.directory);
+                optionBoxes->getData(&rec.options);
+            }
+            TObject::destroy(dialog);
+            return result;
+        }
+
+        // Call visit for each view of group, front to back.
+        template <typename Visit>
+        void forEachView(TGroup *group, Visit visit)
+        {
+            TView *first = group ? group->first() : nullptr;
+            if (!first)
+                return;
+            TView *view = first;
+            do
+            {
+                TView *next = view->next;
+                visit(view);
+                view = next;
+            } while (view != first);
+        }
+
         bool operator==(const MarkdownStatusContext &lhs, const MarkdownStatusContext &rhs) noexcept
         {
             return lhs.hasEditor == rhs.hasEditor && lhs.markdownMode == rhs.markdownMode &&
@@ -534,6 +621,7 @@ namespace ck::edit
                 addCommand(cmClearHeading);
                 addCommand(cmMakeParagraph);
                 addCommand(cmInsertLineBreak);
+                addCommand(cmShowOutline);
                 break;
             case MarkdownLineKind::BlockQuote:
                 addCommand(cmToggleBlockQuote);
@@ -812,7 +900,10 @@ namespace ck::edit
         {
             return *new TSubMenu("Doc~u~ment", kbNoKey) +
                    *new TMenuItem("Reflow Paragraphs", cmReflowParagraphs, kbNoKey) +
-                   *new TMenuItem("Format Document", cmFormatDocument, kbNoKey);
+                   *new TMenuItem("Format Document", cmFormatDocument, kbNoKey) +
+                   newLine() +
+                   *new TMenuItem("~O~utline...", cmShowOutline, kbNoKey) +
+                   *new TMenuItem("Check ~L~inks...", cmCheckLinks, kbNoKey);
         }
 
         TSubMenu &makeTableMenu()
@@ -866,7 +957,10 @@ namespace ck::edit
                              newLine() +
                              *new TMenuItem("~F~ind...", cmFind, kbNoKey, hcNoContext) +
                              *new TMenuItem("~R~eplace...", cmReplace, kbNoKey, hcNoContext) +
-                             *new TMenuItem("Find ~N~ext", cmSearchAgain, kbNoKey, hcNoContext);
+                             *new TMenuItem("Find ~N~ext", cmSearchAgain, kbNoKey, hcNoContext) +
+                             newLine() +
+                             *new TMenuItem("Find in Fi~l~es...", cmFindInFiles, kbNoKey, hcNoContext) +
+                             *new TMenuItem("Replace in File~s~...", cmReplaceInFiles, kbNoKey, hcNoContext);
 
             if (markdownMode)
             {
@@ -935,19 +1029,7 @@ namespace ck::edit
             return MarkdownParserState{};
         if (cachedPrefixPtr == topPtr && cachedVersion == editor->stateVersion())
             return cachedState;
-        MarkdownParserState state;
-        uint ptr = 0;
-        while (ptr < topPtr && ptr < editor->bufLen)
-        {
-            uint end = editor->lineEnd(ptr);
-            std::string line = editor->readRange(ptr, end);
-            editor->analyzer().analyzeLine(line, state);
-            uint next = editor->nextLine(ptr);
-            if (next <= ptr)
-                break;
-            ptr = next;
-        }
-        cachedState = state;
+        cachedState = editor->parserStateForLine(editor->lineNumberForPointer(topPtr));
         cachedPrefixPtr = topPtr;
         cachedVersion = editor->stateVersion();
         return cachedState;
@@ -973,7 +1055,8 @@ namespace ck::edit
             return info;
 
         std::string incomingFenceLabel = state.fenceLabel;
-        MarkdownLineInfo lineInfo = editor->analyzer().analyzeLine(editor->lineText(linePtr), state);
+        std::string scratch;
+        MarkdownLineInfo lineInfo = editor->analyzer().analyzeLine(editor->lineTextView(linePtr, scratch), state);
         info.hasLine = true;
         info.lineKind = lineInfo.kind;
         std::string baseLabel = editor->analyzer().describeLine(lineInfo);
@@ -1687,7 +1770,7 @@ namespace ck::edit
         disableCommands(ts);
 
         while (--argc > 0)
-            openEditor(*++argv, True);
+            openDocument(*++argv);
         cascade();
         refreshUiMode();
     }
@@ -1704,11 +1787,35 @@ namespace ck::edit
         return win;
     }
 
+    void MarkdownEditorApp::openDocument(const char *fileName)
+    {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(fileName, ec);
+        if (ec || size < LargeFileDocument::kThreshold)
+        {
+            openEditor(fileName, True);
+            return;
+        }
+        std::unique_ptr<LargeFileDocument> document;
+        try
+        {
+            document = std::make_unique<LargeFileDocument>(fileName);
+        }
+        catch (const std::exception &error)
+        {
+            messageBox(error.what(), mfError | mfOKButton);
+            return;
+        }
+        TRect r = deskTop->getExtent();
+        if (auto *win = (LargeFileWindow *)validView(new LargeFileWindow(r, std::move(document))))
+            deskTop->insert(win);
+    }
+
     void MarkdownEditorApp::fileOpen()
     {
         char name[MAXPATH] = "*.md";
         if (execDialog(new TFileDialog("*.*", "Open file", "~N~ame", fdOpenButton, 100), name) != cmCancel)
-            openEditor(name, True);
+            openDocument(name);
     }
 
     void MarkdownEditorApp::fileNew()
@@ -1730,15 +1837,124 @@ namespace ck::edit
     {
         if (!deskTop->current)
             return;
-        auto *win = dynamic_cast<MarkdownEditWindow *>(deskTop->current);
-        if (!win)
-            return;
         TEvent ev;
         ev.what = evCommand;
         ev.message.command = command;
+        if (auto *large = dynamic_cast<LargeFileWindow *>(deskTop->current))
+        {
+            large->view()->handleEvent(ev);
+            return;
+        }
+        auto *win = dynamic_cast<MarkdownEditWindow *>(deskTop->current);
+        if (!win)
+            return;
         win->editor()->handleEvent(ev);
     }
 
+    void MarkdownEditorApp::findInFiles(bool replace)
+    {
+        static FindInFilesRec rec;
+        if (rec.directory[0] == '\0')
+        {
+            std::error_code ec;
+            std::string current = std::filesystem::current_path(ec).string();
+            std::strncpy(rec.directory, current.c_str(), sizeof(rec.directory) - 1);
+        }
+        if (runFindInFilesDialog(rec, replace) == cmCancel || rec.find[0] == '\0')
+            return;
+        std::error_code ec;
+        if (!std::filesystem::is_directory(rec.directory, ec))
+        {
+            messageBox("The directory to search does not exist.", mfError | mfOKButton);
+            return;
+        }
+
+        ProjectSearchQuery query;
+        query.pattern = rec.find;
+        query.caseSensitive = (rec.options & 0x0001) != 0;
+        query.regex = (rec.options & 0x0002) != 0;
+        query.fileFilter = [](const std::filesystem::path &path) {
+            return MarkdownFileEditor::isMarkdownFileName(path.string());
+        };
+        std::unique_ptr<ProjectSearchJob> job;
+        try
+        {
+            job = std::make_unique<ProjectSearchJob>(rec.directory, std::move(query));
+        }
+        catch (const std::regex_error &error)
+        {
+            std::string message = std::string("Invalid regular expression: ") + error.what();
+            messageBox(message.c_str(), mfError | mfOKButton);
+            return;
+        }
+        TRect r = deskTop->getExtent();
+        auto *win = (ProjectSearchWindow *)validView(
+            new ProjectSearchWindow(r, rec.directory, std::move(job), rec.replace, replace));
+        if (win)
+            deskTop->insert(win);
+    }
+
+    void MarkdownEditorApp::pollProjectSearches()
+    {
+        forEachView(deskTop, [this](TView *view) {
+            auto *win = dynamic_cast<ProjectSearchWindow *>(view);
+            if (!win || !win->view()->poll())
+                return;
+            win->updateTitle();
+            // The replace asks for confirmation and reports its result, which
+            // cannot run from idle.
+            if (win->view()->replacePending() || win->view()->replaceFinished())
+            {
+                TEvent event;
+                event.what = evCommand;
+                event.message.command = cmApplyReplaceInFiles;
+                event.message.infoPtr = nullptr;
+                putEvent(event);
+            }
+        });
+    }
+
+    void MarkdownEditorApp::applyProjectReplaces()
+    {
+        forEachView(deskTop, [](TView *view) {
+            if (auto *win = dynamic_cast<ProjectSearchWindow *>(view))
+                win->view()->applyReplace();
+        });
+    }
+
+    TWindow *MarkdownEditorApp::windowForFile(const std::string &path)
+    {
+        TWindow *found = nullptr;
+        forEachView(deskTop, [&](TView *view) {
+            std::string name;
+            if (auto *edit = dynamic_cast<MarkdownEditWindow *>(view))
+                name = edit->editor()->fileName;
+            else if (auto *large = dynamic_cast<LargeFileWindow *>(view))
+                name = large->view()->document().path();
+            std::error_code ec;
+            if (!found && !name.empty() && std::filesystem::equivalent(name, path, ec))
+                found = static_cast<TWindow *>(view);
+        });
+        return found;
+    }
+
+    void MarkdownEditorApp::openSearchResult(const ProjectMatch &match)
+    {
+        TWindow *window = windowForFile(match.path);
+        if (window)
+            window->select();
+        else
+        {
+            openDocument(match.path.c_str());
+            window = dynamic_cast<TWindow *>(deskTop->current);
+        }
+        if (auto *edit = dynamic_cast<MarkdownEditWindow *>(window))
+            edit->editor()->selectInLine(static_cast<int>(std::min<std::size_t>(match.line, INT_MAX)), match.column,
+                                         match.length);
+        else if (auto *large = dynamic_cast<LargeFileWindow *>(window))
+            large->view()->goToLine(match.line);
+    }
+
     void MarkdownEditorApp::showDocumentSavedMessage(const std::string &path)
     {
         if (!statusLine)
@@ -1844,9 +2060,20 @@ namespace ck::edit
         case cmTableAlignNumber:
         case cmReflowParagraphs:
         case cmFormatDocument:
+        case cmShowOutline:
+        case cmCheckLinks:
         case cmToggleSmartList:
             dispatchToEditor(event.message.command);
             break;
+        case cmFindInFiles:
+            findInFiles(false);
+            break;
+        case cmReplaceInFiles:
+            findInFiles(true);
+            break;
+        case cmApplyReplaceInFiles:
+            applyProjectReplaces();
+            break;
         case cmReturnToLauncher:
             std::exit(ck::launcher::kReturnToLauncherExitCode);
             break;
@@ -1866,6 +2093,19 @@ namespace ck::edit
     {
         ck::ui::ClockAwareApplication::idle();
 
+        if (deskTop && deskTop->current)
+        {
+            if (auto *win = dynamic_cast<MarkdownEditWindow *>(deskTop->current))
+            {
+                if (auto *ed = win->editor())
+                    ed->pollAnalysis();
+            }
+            else if (auto *large = dynamic_cast<LargeFileWindow *>(deskTop->current))
+                large->view()->pollIndex();
+        }
+        if (deskTop)
+            pollProjectSearches();
+
         uint32_t token = pendingStatusMessageClear.load(std::memory_order_acquire);
         if (token == 0)
             return;
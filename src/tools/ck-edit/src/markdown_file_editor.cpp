@@ -3,12 +3,12 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
 #include <optional>
-#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string_view>
@@ -22,6 +22,11 @@ namespace ck::edit
         const std::array<std::string_view, 7> kMarkdownExtensions = {
             ".md", ".markdown", ".mdown", ".mkd", ".mkdn", ".mdtxt", ".mdtext"};
 
+        // Wrapped rows measured before trusting the row index; moves further
+        // than this go by estimated rows for unmeasured lines.
+        constexpr int kWrapMeasureRows = 512;
+        constexpr std::size_t kWrapLayoutCacheLimit = 4096;
+
         bool cellIsWhitespace(const TScreenCell &cell)
         {
             if (cell._ch.isWideCharTrail())
@@ -80,6 +85,41 @@ namespace ck::edit
             std::reverse(name.begin(), name.end());
             return name;
         }
+
+        constexpr const char *kAnalysisPending = "The document is still being analyzed; try again shortly.";
+
+        // A list of strings for promptForChoice; a TListBox would need the
+        // strings copied into a collection.
+        class ChoiceListViewer : public TListViewer
+        {
+        public:
+            ChoiceListViewer(const TRect &bounds, TScrollBar *vScrollBar, const std::vector<std::string> &choices)
+                : TListViewer(bounds, 1, nullptr, vScrollBar), items(choices)
+            {
+                setRange(static_cast<short>(std::min<std::size_t>(items.size(), SHRT_MAX)));
+            }
+
+            virtual void getText(char *dest, short item, short maxLen) override
+            {
+                std::size_t length = 0;
+                if (item >= 0 && static_cast<std::size_t>(item) < items.size() && maxLen > 0)
+                {
+                    const std::string &text = items[static_cast<std::size_t>(item)];
+                    length = std::min(text.size(), static_cast<std::size_t>(maxLen));
+                    std::memcpy(dest, text.data(), length);
+                }
+                dest[length] = '\0';
+            }
+
+            virtual void selectItem(short item) override
+            {
+                TListViewer::selectItem(item);
+                message(owner, evCommand, cmOK, this);
+            }
+
+        private:
+            const std::vector<std::string> &items;
+        };
     } // namespace
 
     bool MarkdownFileEditor::isMarkdownFileName(std::string_view path)
@@ -378,73 +418,24 @@ namespace ck::edit
         return pattern;
     }
 
-    std::string MarkdownFileEditor::generateUniqueReferenceId(const std::string &prefix)
+    std::shared_ptr<const MarkdownDocumentAnalysis> MarkdownFileEditor::analysisOfCurrentText()
     {
-        std::set<std::string> ids;
-        std::string text = readRange(0, bufLen);
-        std::size_t pos = 0;
-        while (pos < text.size())
-        {
-            std::size_t end = text.find('\n', pos);
-            std::string_view line(text.c_str() + pos, (end == std::string::npos ? text.size() - pos : end - pos));
-            std::size_t start = 0;
-            while (start < line.size() && (line[start] == ' ' || line[start] == '\t'))
-                ++start;
-            if (start < line.size() && line[start] == '[')
-            {
-                std::size_t close = line.find(']', start);
-                if (close != std::string::npos && close + 1 < line.size() && line[close + 1] == ':')
-                {
-                    ids.emplace(std::string(line.substr(start + 1, close - start - 1)));
-                }
-            }
-            if (end == std::string::npos)
-                break;
-            pos = end + 1;
-        }
-
-        if (prefix.empty())
-            return "ref1";
+        auto analysis = currentAnalysis();
+        if (analysis && analysis->version == contentVersion)
+            return analysis;
+        // Ids defined by the last edits would be missing from an older
+        // index; this full pass runs only for the insert commands.
+        return std::make_shared<const MarkdownDocumentAnalysis>(analyzeDocument(documentRope(), contentVersion));
+    }
 
-        for (int i = 1; i < 10000; ++i)
-        {
-            std::string candidate = prefix + std::to_string(i);
-            if (!ids.count(candidate))
-                return candidate;
-        }
-        return prefix + "x";
+    std::string MarkdownFileEditor::generateUniqueReferenceId(const std::string &prefix)
+    {
+        return analysisOfCurrentText()->index.uniqueReferenceId(prefix);
     }
 
     std::string MarkdownFileEditor::generateUniqueFootnoteId()
     {
-        std::set<std::string> ids;
-        std::string text = readRange(0, bufLen);
-        std::size_t pos = 0;
-        while (pos < text.size())
-        {
-            std::size_t end = text.find('\n', pos);
-            std::string_view line(text.c_str() + pos, (end == std::string::npos ? text.size() - pos : end - pos));
-            std::size_t start = 0;
-            while (start < line.size() && (line[start] == ' ' || line[start] == '\t'))
-                ++start;
-            if (start + 2 < line.size() && line[start] == '[' && line[start + 1] == '^')
-            {
-                std::size_t close = line.find(']', start);
-                if (close != std::string::npos && close + 1 < line.size() && line[close + 1] == ':')
-                    ids.emplace(std::string(line.substr(start + 2, close - start - 2)));
-            }
-            if (end == std::string::npos)
-                break;
-            pos = end + 1;
-        }
-
-        for (int i = 1; i < 10000; ++i)
-        {
-            std::string candidate = "fn" + std::to_string(i);
-            if (!ids.count(candidate))
-                return candidate;
-        }
-        return "fn";
+        return analysisOfCurrentText()->index.uniqueFootnoteId();
     }
 
     void MarkdownFileEditor::appendDefinition(const std::string &definition)
@@ -1107,6 +1098,26 @@ namespace ck::edit
         }
     }
 
+    int MarkdownFileEditor::promptForChoice(const char *title, const std::vector<std::string> &choices)
+    {
+        auto *dialog = new TDialog(TRect(0, 0, 66, 20), title);
+        dialog->options |= ofCentered;
+        auto *scrollBar = new TScrollBar(TRect(62, 2, 63, 16));
+        dialog->insert(scrollBar);
+        auto *list = new ChoiceListViewer(TRect(3, 2, 62, 16), scrollBar, choices);
+        dialog->insert(list);
+        dialog->insert(new TButton(TRect(41, 17, 51, 19), "O~K~", cmOK, bfDefault));
+        dialog->insert(new TButton(TRect(53, 17, 63, 19), "Cancel", cmCancel, bfNormal));
+        list->select();
+
+        if (!TProgram::application->validView(dialog))
+            return -1;
+        ushort result = TProgram::deskTop->execView(dialog);
+        int choice = result == cmOK && list->range > 0 ? list->focused : -1;
+        TObject::destroy(dialog);
+        return choice;
+    }
+
     void MarkdownFileEditor::insertLink()
     {
         std::string label = promptForText("Insert Link", "Link text", hasSelection() ? readRange(std::min(selStart, selEnd), std::max(selStart, selEnd)) : "");
@@ -1283,11 +1294,10 @@ namespace ck::edit
         MarkdownParserState state;
         uint ptr = 0;
         TableContext working;
+        std::string scratch;
         while (ptr < bufLen)
         {
-            uint end = lineEnd(ptr);
-            std::string line = readRange(ptr, end);
-            MarkdownLineInfo info = markdownAnalyzer.analyzeLine(line, state);
+            MarkdownLineInfo info = markdownAnalyzer.analyzeLine(lineTextView(ptr, scratch), state);
             bool isTableLine = info.kind == MarkdownLineKind::TableRow || info.kind == MarkdownLineKind::TableSeparator;
             if (isTableLine)
             {
@@ -1537,13 +1547,6 @@ namespace ck::edit
         replaceRange(start, end, out.str());
         unlock();
         onContentModified();
-
-        uint newPtr = start;
-        int offset = bodyCells.empty() ? 1 : 2 + std::min(bodyIndex, static_cast<int>(bodyCells.size()) - 1);
-        offset = std::max(offset, 1);
-        for (int i = 0; i < offset; ++i)
-            newPtr = lineMove(newPtr, 1);
-        setCurPtr(newPtr, 0);
     }
 
     void MarkdownFileEditor::tableInsertColumnBefore()
@@ -1644,28 +1647,6 @@ namespace ck::edit
         replaceRange(start, end, out.str());
         unlock();
         onContentModified();
-
-        int rowOffset = 0;
-        if (context.activeRow == TableContext::ActiveRow::Header)
-            rowOffset = 0;
-        else if (context.activeRow == TableContext::ActiveRow::Separator)
-            rowOffset = 1;
-        else if (context.activeRow == TableContext::ActiveRow::Body)
-        {
-            rowOffset = 2;
-            for (std::size_t i = 0; i < context.bodyPtrs.size(); ++i)
-            {
-                if (context.bodyPtrs[i] == context.activePtr)
-                {
-                    rowOffset += static_cast<int>(i);
-                    break;
-                }
-            }
-        }
-        uint newPtr = start;
-        for (int i = 0; i < rowOffset; ++i)
-            newPtr = lineMove(newPtr, 1);
-        setCurPtr(newPtr, 0);
     }
 
     void MarkdownFileEditor::tableDeleteTable()
@@ -1710,126 +1691,95 @@ namespace ck::edit
         uint start = std::min(selStart, selEnd);
         uint end = std::max(selStart, selEnd);
         std::string text = readRange(start, end);
-        if (text.empty())
+        std::vector<TextEdit> edits = reflowParagraphEdits(text);
+        if (edits.empty())
             return;
 
-        std::vector<std::string> paragraphs;
-        std::vector<std::string> separators;
-        std::size_t pos = 0;
-        while (pos < text.size())
+        std::size_t length = text.size();
+        for (TextEdit &edit : edits)
         {
-            std::size_t next = text.find("\n\n", pos);
-            if (next == std::string::npos)
-            {
-                paragraphs.push_back(text.substr(pos));
-                separators.emplace_back();
-                break;
-            }
-            paragraphs.push_back(text.substr(pos, next - pos));
-            std::size_t sepEnd = next;
-            while (sepEnd < text.size() && text[sepEnd] == '\n')
-                ++sepEnd;
-            separators.push_back(text.substr(next, sepEnd - next));
-            pos = sepEnd;
+            length = length + edit.text.size() - (edit.end - edit.start);
+            edit.start += start;
+            edit.end += start;
         }
-        if (paragraphs.empty())
-        {
-            paragraphs.push_back(text);
-            separators.emplace_back();
-        }
-
-        auto reflowParagraph = [](const std::string &paragraph)
-        {
-            std::istringstream stream(paragraph);
-            std::string word;
-            std::string output;
-            int lineLength = 0;
-            while (stream >> word)
-            {
-                if (lineLength == 0)
-                {
-                    output += word;
-                    lineLength = static_cast<int>(word.size());
-                }
-                else if (lineLength + 1 + static_cast<int>(word.size()) > 80)
-                {
-                    output.push_back('\n');
-                    output += word;
-                    lineLength = static_cast<int>(word.size());
-                }
-                else
-                {
-                    output.push_back(' ');
-                    output += word;
-                    lineLength += 1 + static_cast<int>(word.size());
-                }
-            }
-            return output;
-        };
-
-        std::string result;
-        for (std::size_t i = 0; i < paragraphs.size(); ++i)
-        {
-            std::string reflowed = reflowParagraph(paragraphs[i]);
-            if (!result.empty() && result.back() != '\n' && !reflowed.empty())
-                result.push_back('\n');
-            result += reflowed;
-            result += separators[i];
-        }
-
-        lock();
-        replaceRange(start, end, result);
-        unlock();
-        setSelect(start, start + result.size(), True);
+        applyEdits(std::move(edits));
+        // Selecting past the last change would move the cursor and with it
+        // the gap that holds the undo data.
+        setSelect(start, std::min(curPtr, start + static_cast<uint>(length)), False);
         onContentModified();
     }
 
     void MarkdownFileEditor::formatDocument()
     {
         std::string text = readRange(0, bufLen);
-        std::istringstream input(text);
-        std::ostringstream output;
-        std::string line;
-        bool previousBlank = false;
+        std::vector<TextEdit> edits = formatMarkdownEdits(text);
+        if (edits.empty())
+            return;
+        applyEdits(std::move(edits));
+        onContentModified();
+    }
 
-        while (std::getline(input, line))
+    void MarkdownFileEditor::showOutline()
+    {
+        auto analysis = currentAnalysis();
+        if (!analysis)
         {
-            std::size_t endPos = line.size();
-            std::size_t trailingSpaces = 0;
-            while (endPos > 0 && (line[endPos - 1] == ' ' || line[endPos - 1] == '\t'))
-            {
-                ++trailingSpaces;
-                --endPos;
-            }
-            std::string trimmed = line.substr(0, endPos);
-            if (trailingSpaces >= 2)
-                trimmed.append("  ");
-
-            bool isBlank = trimLeft(trimmed).empty();
-            if (isBlank)
-            {
-                if (!previousBlank)
-                {
-                    output << '\n';
-                    previousBlank = true;
-                }
-                continue;
-            }
-
-            if (previousBlank && output.tellp() > 0 && output.str().back() != '\n')
-                output << '\n';
-            previousBlank = false;
-            output << trimmed << '\n';
+            messageBox(kAnalysisPending, mfInformation | mfOKButton);
+            return;
         }
+        const MarkdownDocumentIndex &index = analysis->index;
+        if (index.headings().empty())
+        {
+            messageBox("The document has no headings.", mfInformation | mfOKButton);
+            return;
+        }
+        std::vector<std::string> choices;
+        choices.reserve(index.headings().size());
+        for (std::size_t entry : index.headings())
+        {
+            const MarkdownIndexEntry &heading = index.entries()[entry];
+            choices.push_back(std::string(static_cast<std::size_t>(std::max(0, heading.level - 1)) * 2, ' ') +
+                              heading.text);
+        }
+        int choice = promptForChoice("Outline", choices);
+        if (choice >= 0)
+            selectInLine(static_cast<int>(index.entries()[index.headings()[static_cast<std::size_t>(choice)]].line), 0,
+                         0);
+    }
 
-        std::string formatted = output.str();
-        if (!formatted.empty() && formatted.back() != '\n')
-            formatted.push_back('\n');
-
-        lock();
-        replaceRange(0, bufLen, formatted);
-        unlock();
-        onContentModified();
+    void MarkdownFileEditor::checkLinks()
+    {
+        auto analysis = currentAnalysis();
+        if (!analysis)
+        {
+            messageBox(kAnalysisPending, mfInformation | mfOKButton);
+            return;
+        }
+        std::vector<MarkdownIndexEntry> broken = analysis->index.brokenLinks();
+        if (broken.empty())
+        {
+            messageBox("Every reference, footnote and heading link resolves.", mfInformation | mfOKButton);
+            return;
+        }
+        std::vector<std::string> choices;
+        choices.reserve(broken.size());
+        for (const MarkdownIndexEntry &entry : broken)
+        {
+            std::string text = std::to_string(entry.line + 1) + ": ";
+            if (entry.kind == MarkdownIndexKind::ReferenceUse)
+                text += "no definition for [" + entry.text + "]";
+            else if (entry.kind == MarkdownIndexKind::FootnoteUse)
+                text += "no footnote [^" + entry.text + "]";
+            else
+                text += "no heading for #" + entry.text;
+            choices.push_back(std::move(text));
+        }
+        int choice = promptForChoice("Broken Links", choices);
+        if (choice >= 0)
+        {
+            const MarkdownIndexEntry &entry = broken[static_cast<std::size_t>(choice)];
+            selectInLine(static_cast<int>(entry.line), entry.column, 0);
+        }
     }
 
     void MarkdownFileEditor::toggleSmartListContinuation()
@@ -1978,12 +1928,6 @@ namespace ck::edit
         replaceRange(start, end, out.str());
         unlock();
         onContentModified();
-
-        uint newPtr = start;
-        int offset = 2 + insertIndex;
-        for (int i = 0; i < offset; ++i)
-            newPtr = lineMove(newPtr, 1);
-        setCurPtr(newPtr, 0);
     }
 
     void MarkdownFileEditor::insertTableColumn(TableContext &context, bool after)
@@ -2045,29 +1989,6 @@ namespace ck::edit
         replaceRange(start, end, out.str());
         unlock();
         onContentModified();
-
-        int rowOffset = 0;
-        if (context.activeRow == TableContext::ActiveRow::Header)
-            rowOffset = 0;
-        else if (context.activeRow == TableContext::ActiveRow::Separator)
-            rowOffset = 1;
-        else if (context.activeRow == TableContext::ActiveRow::Body)
-        {
-            rowOffset = 2;
-            for (std::size_t i = 0; i < context.bodyPtrs.size(); ++i)
-            {
-                if (context.bodyPtrs[i] == context.activePtr)
-                {
-                    rowOffset += static_cast<int>(i);
-                    break;
-                }
-            }
-        }
-
-        uint newPtr = start;
-        for (int i = 0; i < rowOffset; ++i)
-            newPtr = lineMove(newPtr, 1);
-        setCurPtr(newPtr, 0);
     }
 
     void MarkdownFileEditor::alignTableColumn(TableContext &context, MarkdownTableAlignment alignment)
@@ -2121,75 +2042,13 @@ namespace ck::edit
         replaceRange(start, end, out.str());
         unlock();
         onContentModified();
-
-        uint newPtr = start;
-        int rowOffset = 0;
-        if (context.activeRow == TableContext::ActiveRow::Separator)
-            rowOffset = 1;
-        else if (context.activeRow == TableContext::ActiveRow::Body)
-        {
-            rowOffset = 2;
-            for (std::size_t i = 0; i < context.bodyPtrs.size(); ++i)
-            {
-                if (context.bodyPtrs[i] == context.activePtr)
-                {
-                    rowOffset += static_cast<int>(i);
-                    break;
-                }
-            }
-        }
-        for (int i = 0; i < rowOffset; ++i)
-            newPtr = lineMove(newPtr, 1);
-        setCurPtr(newPtr, 0);
     }
 
     void MarkdownFileEditor::queueInfoLine(int lineNumber)
     {
-        if (infoViewNeedsFullRefresh || !markdownMode || lineNumber < 0)
-            return;
-
+        // Lines whose state changes as a consequence (e.g. after a new fence)
+        // are redrawn once the background analysis catches up.
         enqueuePendingInfoLine(lineNumber);
-
-        if (bufLen == 0)
-            return;
-
-        uint linePtr = pointerForLine(lineNumber);
-        if (linePtr >= bufLen)
-            return;
-
-        std::string prefix = readRange(0, linePtr);
-        MarkdownParserState state = analyzer().computeStateBefore(prefix);
-        std::string text = lineText(linePtr);
-        MarkdownLineInfo info = analyzer().analyzeLine(text, state);
-
-        if (!info.fenceOpens)
-            return;
-
-        MarkdownParserState cascadeState = state;
-        uint currentPtr = nextLine(linePtr);
-        int currentLine = lineNumber + 1;
-        constexpr int kMaxFencePropagation = 4096;
-        int processed = 0;
-        while (cascadeState.inFence && currentLine <= lineNumber + kMaxFencePropagation)
-        {
-            if (currentPtr >= bufLen)
-                break;
-
-            enqueuePendingInfoLine(currentLine);
-
-            std::string currentText = lineText(currentPtr);
-            MarkdownLineInfo currentInfo = analyzer().analyzeLine(currentText, cascadeState);
-
-            uint nextPtr = nextLine(currentPtr);
-            if (nextPtr <= currentPtr)
-                break;
-
-            currentPtr = nextPtr;
-            ++currentLine;
-            ++processed;
-            if (processed >= kMaxFencePropagation)
-                break;
-        }
     }
 
     void MarkdownFileEditor::queueInfoLineRange(int firstLine, int lastLine)
@@ -2224,93 +2083,172 @@ namespace ck::edit
         infoViewNeedsFullRefresh = false;
     }
 
-    void MarkdownFileEditor::resetLineNumberCache()
+    const LineIndex &MarkdownFileEditor::documentLines()
     {
-        lineNumberCachePtr = lineStart(curPtr);
-        lineNumberCacheNumber = cursorLineNumber;
-        lineNumberCacheValid = true;
+        // Loading a file fills the buffer without going through
+        // insertBuffer, so the index is rebuilt whenever it falls out of step.
+        if (!lineIndexValid || lineIndex.byteCount() != bufLen)
+        {
+            lineIndex.assign(std::string_view(buffer, curPtr),
+                             std::string_view(buffer + curPtr + gapLen, bufLen - curPtr));
+            lineIndexValid = true;
+        }
+        return lineIndex;
     }
 
-    int MarkdownFileEditor::lineNumberForPointer(uint pointer)
+    Boolean MarkdownFileEditor::insertBuffer(const char *p, uint offset, uint length, Boolean allowUndo,
+                                             Boolean selectText)
     {
-        if (bufLen == 0)
-            return 0;
-
-        if (pointer >= bufLen)
+        // Every change to the buffer, undo included, replaces the selection
+        // with new text here; the text ends up just before the gap.
+        uint start = selStart;
+        uint end = selEnd;
+        int firstLine = lineNumberForPointer(start);
+        int lastLine = lineNumberForPointer(end);
+        parserCheckpoints.invalidateFrom(static_cast<std::size_t>(firstLine));
+        ++contentVersion;
+        std::size_t lineCount = lineIndex.lineCount();
+        Boolean inserted = TFileEditor::insertBuffer(p, offset, length, allowUndo, selectText);
+        if (inserted)
         {
-            if (bufLen == 0)
-                return 0;
-            int lastLine = lineNumberForPointer(bufLen - 1);
-            return bufChar(bufLen - 1) == '\n' ? lastLine + 1 : lastLine;
+            std::string_view text(buffer + curPtr - length, length);
+            analysisChange.addEdit(static_cast<std::size_t>(firstLine), static_cast<std::size_t>(lastLine), lineCount);
+            lineIndex.replace(start, end, text);
+            if (documentTextValid)
+                documentText.replace(start, end, text);
+            int newLines = static_cast<int>(std::count(text.begin(), text.end(), '\n'));
+            invalidateWrapLayouts(firstLine, lastLine, newLines - (lastLine - firstLine));
         }
+        else
+        {
+            lineIndexValid = documentTextValid = false;
+            wrapLayoutCache.clear();
+        }
+        return inserted;
+    }
 
-        uint target = lineStart(pointer);
-
-        if (!lineNumberCacheValid)
+    MarkdownParserState MarkdownFileEditor::parserStateForLine(int lineNumber)
+    {
+        MarkdownParserState state;
+        if (lineNumber <= 0)
+            return state;
+        auto target = static_cast<std::size_t>(lineNumber);
+        std::size_t line = parserCheckpoints.nearest(target, state);
+        if (documentAnalysis && documentAnalysis->version == contentVersion)
+        {
+            MarkdownParserState analyzed;
+            std::size_t analyzedLine = documentAnalysis->stateBefore(target, analyzed);
+            if (analyzedLine > line)
+            {
+                line = analyzedLine;
+                state = std::move(analyzed);
+            }
+        }
+        uint ptr = pointerForLine(static_cast<int>(line));
+        std::string scratch;
+        while (line < target && ptr < bufLen)
         {
-            lineNumberCacheNumber = computeLineNumberForPointer(curPtr);
-            lineNumberCachePtr = lineStart(curPtr);
-            cursorLineNumber = lineNumberCacheNumber;
-            lineNumberCacheValid = true;
+            analyzer().analyzeLine(lineTextView(ptr, scratch), state);
+            parserCheckpoints.record(++line, state);
+            uint next = nextLine(ptr);
+            if (next <= ptr)
+                break;
+            ptr = next;
         }
+        return state;
+    }
 
-        uint currentPtr = lineNumberCachePtr;
-        int currentNumber = lineNumberCacheNumber;
+    const TextRope &MarkdownFileEditor::documentRope()
+    {
+        // Rebuilt like the line index when loading bypassed insertBuffer.
+        if (!documentTextValid || documentText.size() != bufLen)
+        {
+            documentText.assign(std::string_view(buffer, curPtr),
+                                std::string_view(buffer + curPtr + gapLen, bufLen - curPtr));
+            documentTextValid = true;
+        }
+        return documentText;
+    }
 
-        if (target == currentPtr)
-            return currentNumber;
+    void MarkdownFileEditor::pollAnalysis()
+    {
+        if (!markdownMode)
+            return;
+        bool incremental = false;
+        if (!takeAnalysis(incremental))
+            return;
 
-        if (target > currentPtr)
+        // Lines after an opened or closed fence change state without being
+        // edited; redraw the info view if any of them are on screen.
+        if (!infoView || !(infoView->state & sfVisible))
+            return;
+        std::size_t top = static_cast<std::size_t>(std::max(0, delta.y));
+        std::size_t bottom = top + static_cast<std::size_t>(std::max(0, size.y));
+        if (!incremental || (documentAnalysis->firstChangedLine < bottom && documentAnalysis->endChangedLine > top))
         {
-            while (currentPtr < target)
-            {
-                uint next = nextLine(currentPtr);
-                if (next <= currentPtr)
-                {
-                    currentPtr = target;
-                    break;
-                }
-                ++currentNumber;
-                currentPtr = next;
-            }
+            infoView->invalidateState();
+            infoView->drawView();
         }
-        else
+    }
+
+    bool MarkdownFileEditor::takeAnalysis(bool &incremental)
+    {
+        if (submittedVersion != contentVersion)
         {
-            while (currentPtr > target)
-            {
-                uint prev = lineMove(currentPtr, -1);
-                if (prev >= currentPtr)
-                {
-                    currentPtr = target;
-                    break;
-                }
-                --currentNumber;
-                currentPtr = prev;
-            }
+            // A rope rebuilt from the buffer may differ anywhere from the
+            // one submitted before.
+            bool rebuilt = !documentTextValid || documentText.size() != bufLen;
+            const TextRope &text = documentRope();
+            std::size_t lineCount = documentLines().lineCount();
+            if (rebuilt)
+                analysisChange = MarkdownTextChange::everything(lineCount);
+            analysisChange.lineCount = lineCount;
+            backgroundAnalysis.submit(contentVersion, text, analysisChange);
+            analysisChange = {};
+            submittedVersion = contentVersion;
         }
+        // Analyses of earlier versions are taken too, so that one arrives
+        // while typing goes on; the worker skips to the newest text.
+        auto latest = backgroundAnalysis.latest();
+        if (!latest || latest == documentAnalysis)
+            return false;
+        incremental = documentAnalysis && latest->previousVersion == documentAnalysis->version;
+        documentAnalysis = std::move(latest);
+        return true;
+    }
 
-        lineNumberCachePtr = currentPtr;
-        lineNumberCacheNumber = currentNumber;
-        if (pointer == curPtr)
-            cursorLineNumber = currentNumber;
-        return currentNumber;
+    std::shared_ptr<const MarkdownDocumentAnalysis> MarkdownFileEditor::currentAnalysis()
+    {
+        bool incremental = false;
+        takeAnalysis(incremental);
+        return documentAnalysis;
+    }
+
+    int MarkdownFileEditor::lineNumberForPointer(uint pointer)
+    {
+        return static_cast<int>(documentLines().lineOf(std::min(pointer, bufLen)));
     }
 
     uint MarkdownFileEditor::pointerForLine(int lineNumber)
     {
         if (lineNumber <= 0)
             return 0;
-        if (bufLen == 0)
-            return 0;
-        uint ptr = 0;
-        for (int i = 0; i < lineNumber && ptr < bufLen; ++i)
-        {
-            uint next = nextLine(ptr);
-            if (next <= ptr)
-                return bufLen;
-            ptr = next;
-        }
-        return ptr;
+        return static_cast<uint>(documentLines().lineStart(static_cast<std::size_t>(lineNumber)));
+    }
+
+    void MarkdownFileEditor::selectInLine(int lineNumber, std::size_t column, std::size_t length)
+    {
+        uint start = pointerForLine(lineNumber);
+        uint end = lineEnd(start);
+        uint from = start + static_cast<uint>(std::min<std::size_t>(column, end - start));
+        uint to = from + static_cast<uint>(std::min<std::size_t>(length, end - from));
+        lock();
+        setSelect(from, to, True);
+        trackCursor(True);
+        unlock();
+        refreshCursorMetrics();
+        updateWrapStateAfterMovement(false);
+        notifyInfoView();
     }
 
     void MarkdownFileEditor::enqueuePendingInfoLine(int lineNumber)
@@ -2584,6 +2522,14 @@ namespace ck::edit
                 formatDocument();
                 clearEvent(event);
                 return;
+            case cmShowOutline:
+                showOutline();
+                clearEvent(event);
+                return;
+            case cmCheckLinks:
+                checkLinks();
+                clearEvent(event);
+                return;
             case cmToggleSmartList:
                 toggleSmartListContinuation();
                 clearEvent(event);
@@ -2649,6 +2595,7 @@ namespace ck::edit
 
         TAttrPair color = getColor(0x0201);
         uint linePtr = topLinePointer();
+        int lineNumber = delta.y;
         int row = 0;
         int wrapWidth = std::max(1, size.x);
         std::vector<TScreenCell> segmentBuffer(static_cast<std::size_t>(size.x));
@@ -2683,12 +2630,14 @@ namespace ck::edit
 
             if (layout.segments.empty())
                 layout.segments.push_back({0, 0});
+            rememberWrapLayout(lineNumber, layout);
 
             int segmentCount = wrapSegmentCount(layout);
             if (skipSegments >= segmentCount)
             {
                 skipSegments -= segmentCount;
                 linePtr = nextLine(linePtr);
+                ++lineNumber;
                 continue;
             }
 
@@ -2712,6 +2661,7 @@ namespace ck::edit
                 ++row;
             }
             linePtr = nextLine(linePtr);
+            ++lineNumber;
         }
         setCursor(wrapCursorScreenPos.x, wrapCursorScreenPos.y);
         notifyInfoView();
@@ -2730,9 +2680,14 @@ namespace ck::edit
 
     std::string MarkdownFileEditor::readRange(uint start, uint end)
     {
-        std::string result;
-        for (uint i = start; i < end && i < bufLen; ++i)
-            result.push_back(bufChar(i));
+        end = std::min(end, bufLen);
+        if (start >= end)
+            return {};
+        // The text before the gap, then the text after it.
+        uint split = std::clamp(curPtr, start, end);
+        std::string result(end - start, '\0');
+        std::memcpy(result.data(), buffer + start, split - start);
+        std::memcpy(result.data() + (split - start), buffer + split + gapLen, end - split);
         return result;
     }
 
@@ -2746,65 +2701,66 @@ namespace ck::edit
         return cursorColumnNumber;
     }
 
-    int MarkdownFileEditor::computeLineNumberForPointer(uint pointer)
-    {
-        if (bufLen == 0)
-            return 0;
-
-        if (pointer >= bufLen)
-        {
-            if (bufLen == 0)
-                return 0;
-            uint lastPtr = bufLen - 1;
-            int lastLine = computeLineNumberForPointer(lastPtr);
-            return bufChar(lastPtr) == '\n' ? lastLine + 1 : lastLine;
-        }
-
-        uint target = lineStart(pointer);
-        uint current = 0;
-        int lineNumber = 0;
-        while (current < target)
-        {
-            uint next = nextLine(current);
-            if (next <= current)
-            {
-                current = target;
-                break;
-            }
-            ++lineNumber;
-            current = next;
-        }
-        return lineNumber;
-    }
-
     void MarkdownFileEditor::refreshCursorMetrics()
     {
-        if (bufLen == 0)
-        {
-            cursorLineNumber = 0;
-            cursorColumnNumber = 0;
-            lineNumberCachePtr = 0;
-            lineNumberCacheNumber = 0;
-            lineNumberCacheValid = true;
-            return;
-        }
-
         cursorLineNumber = lineNumberForPointer(curPtr);
-        uint linePtr = lineStart(curPtr);
-        cursorColumnNumber = charPos(linePtr, curPtr);
-        lineNumberCachePtr = linePtr;
-        lineNumberCacheNumber = cursorLineNumber;
-        lineNumberCacheValid = true;
-        if (indicator)
+        cursorColumnNumber = bufLen == 0 ? 0 : charPos(lineStart(curPtr), curPtr);
+        if (bufLen != 0 && indicator)
             indicator->setValue(TPoint(cursorColumnNumber, cursorLineNumber), modified);
     }
 
     void MarkdownFileEditor::replaceRange(uint start, uint end, const std::string &text)
     {
-        queueInfoLineRange(lineNumberForPointer(start), lineNumberForPointer(end));
-        deleteRange(start, end, False);
-        setCurPtr(start, 0);
-        insertText(text.c_str(), text.size(), False);
+        // Block rewrites mostly return the text they were given; only the
+        // bytes between the common prefix and suffix are replaced.  The
+        // cursor is left after them: moving it would move the gap and drop
+        // TEditor's undo data, and the replace is meant to be one Undo step.
+        std::size_t prefix = 0;
+        while (prefix < text.size() && start + prefix < end && bufChar(start + prefix) == text[prefix])
+            ++prefix;
+        std::size_t suffix = 0;
+        while (suffix < text.size() - prefix && start + prefix + suffix < end &&
+               bufChar(end - suffix - 1) == text[text.size() - suffix - 1])
+            ++suffix;
+        uint from = start + static_cast<uint>(prefix);
+        uint to = end - static_cast<uint>(suffix);
+        std::size_t length = text.size() - prefix - suffix;
+        if (from < to || length > 0)
+        {
+            queueInfoLineRange(lineNumberForPointer(from), lineNumberForPointer(to));
+            setSelect(from, to, False);
+            insertText(text.data() + prefix, static_cast<uint>(length), False);
+        }
+    }
+
+    void MarkdownFileEditor::applyEdits(std::vector<TextEdit> edits)
+    {
+        if (edits.empty())
+            return;
+        // One replace from the first edit to the end of the last, with the
+        // text between them copied over, so one Undo takes the batch back.
+        std::sort(edits.begin(), edits.end(), [](const TextEdit &a, const TextEdit &b) { return a.start < b.start; });
+        std::size_t start = edits.front().start;
+        std::size_t end = edits.back().end;
+        std::size_t length = end - start;
+        for (const TextEdit &edit : edits)
+            length = length + edit.text.size() - (edit.end - edit.start);
+        std::string text;
+        text.reserve(length);
+        std::size_t pos = start;
+        for (const TextEdit &edit : edits)
+        {
+            text += readRange(static_cast<uint>(pos), static_cast<uint>(edit.start));
+            text += edit.text;
+            pos = edit.end;
+        }
+        // Queuing lines one by one would cost more than redrawing all.
+        if (edits.size() > 1)
+            requestInfoViewFullRefresh();
+
+        lock();
+        replaceRange(static_cast<uint>(start), static_cast<uint>(end), text);
+        unlock();
     }
 
     std::string MarkdownFileEditor::lineText(uint linePtr)
@@ -2812,6 +2768,18 @@ namespace ck::edit
         return readRange(linePtr, lineEnd(linePtr));
     }
 
+    std::string_view MarkdownFileEditor::lineTextView(uint linePtr, std::string &scratch)
+    {
+        uint end = lineEnd(linePtr);
+        if (end <= curPtr)
+            return std::string_view(buffer + linePtr, end - linePtr);
+        if (linePtr >= curPtr)
+            return std::string_view(buffer + linePtr + gapLen, end - linePtr);
+        scratch.assign(buffer + linePtr, curPtr - linePtr);
+        scratch.append(buffer + curPtr + gapLen, end - curPtr);
+        return scratch;
+    }
+
     void MarkdownFileEditor::buildWordWrapSegments(const TScreenCell *cells,
                                                    int lineColumns,
                                                    int wrapWidth,
@@ -2964,12 +2932,90 @@ namespace ck::edit
             return;
         }
 
+        prepareWrapCache();
+        int lineNumber = lineNumberForPointer(linePtr);
+        auto cached = wrapLayoutCache.find(lineNumber);
+        if (cached != wrapLayoutCache.end())
+        {
+            layout = cached->second;
+            return;
+        }
+
         int wrapWidth = std::max(1, size.x);
         int bufferWidth = std::max(lineColumns + 1, wrapWidth);
         std::vector<TScreenCell> cells(static_cast<std::size_t>(bufferWidth));
         TAttrPair color = getColor(0x0201);
         formatLine(cells.data(), linePtr, bufferWidth, color);
         computeWrapLayoutFromCells(cells.data(), lineColumns, wrapWidth, layout);
+        rememberWrapLayout(lineNumber, layout);
+    }
+
+    void MarkdownFileEditor::prepareWrapCache()
+    {
+        int width = std::max(1, size.x);
+        if (wrapLayoutWidth != width)
+        {
+            documentLines();
+            lineIndex.resetRows();
+            wrapLayoutCache.clear();
+            wrapLayoutWidth = width;
+        }
+    }
+
+    void MarkdownFileEditor::invalidateWrapLayouts(int firstLine, int lastLine, int lineDelta)
+    {
+        // The cache is bounded, so walking it costs less than walking the
+        // edited lines of a large replace.
+        if (lineDelta == 0)
+        {
+            std::erase_if(wrapLayoutCache,
+                          [&](const auto &entry) { return entry.first >= firstLine && entry.first <= lastLine; });
+            return;
+        }
+        std::unordered_map<int, WrapLayout> moved;
+        moved.reserve(wrapLayoutCache.size());
+        for (auto &[lineNumber, layout] : wrapLayoutCache)
+        {
+            if (lineNumber < firstLine)
+                moved.emplace(lineNumber, std::move(layout));
+            else if (lineNumber > lastLine)
+                moved.emplace(lineNumber + lineDelta, std::move(layout));
+        }
+        wrapLayoutCache.swap(moved);
+    }
+
+    void MarkdownFileEditor::rememberWrapLayout(int lineNumber, const WrapLayout &layout)
+    {
+        prepareWrapCache();
+        if (wrapLayoutCache.size() >= kWrapLayoutCacheLimit)
+            wrapLayoutCache.clear();
+        wrapLayoutCache[lineNumber] = layout;
+        documentLines();
+        lineIndex.setRows(static_cast<std::size_t>(lineNumber), static_cast<std::uint32_t>(wrapSegmentCount(layout)));
+    }
+
+    int MarkdownFileEditor::wrapRowsOf(int lineNumber)
+    {
+        if (documentLines().rowsMeasured(static_cast<std::size_t>(lineNumber)))
+            return static_cast<int>(lineIndex.rowsBefore(static_cast<std::size_t>(lineNumber) + 1) -
+                                    lineIndex.rowsBefore(static_cast<std::size_t>(lineNumber)));
+        WrapLayout layout;
+        computeWrapLayout(pointerForLine(lineNumber), layout);
+        return wrapSegmentCount(layout);
+    }
+
+    int MarkdownFileEditor::wrapRowsBetween(int firstLine, int lastLine)
+    {
+        if (lastLine <= firstLine)
+            return 0;
+        if (lastLine - firstLine <= kWrapMeasureRows)
+        {
+            for (int line = firstLine; line < lastLine; ++line)
+                wrapRowsOf(line);
+        }
+        const LineIndex &lines = documentLines();
+        return static_cast<int>(lines.rowsBefore(static_cast<std::size_t>(lastLine)) -
+                                lines.rowsBefore(static_cast<std::size_t>(firstLine)));
     }
 
     int MarkdownFileEditor::wrapSegmentForColumn(const WrapLayout &layout, int column) const
@@ -2989,12 +3035,8 @@ namespace ck::edit
 
     int MarkdownFileEditor::documentLineCount() const
     {
-        if (bufLen == 0)
-            return 1;
         auto *self = const_cast<MarkdownFileEditor *>(this);
-        int lastLine = self->lineNumberForPointer(bufLen - 1);
-        bool hasTrailingNewline = self->bufChar(bufLen - 1) == '\n';
-        return lastLine + 1 + (hasTrailingNewline ? 1 : 0);
+        return static_cast<int>(self->documentLines().lineCount());
     }
 
     int MarkdownFileEditor::wrapSegmentCount(const WrapLayout &layout) const
@@ -3021,83 +3063,50 @@ namespace ck::edit
 
         int totalLines = std::max(1, documentLineCount());
         docLine = std::clamp(docLine, 0, totalLines - 1);
+        if (segmentOffset >= 0 && segmentOffset < wrapRowsOf(docLine))
+            return;
 
-        while (true)
+        // Measure the lines a short move crosses, so that the row index is
+        // exact there; the move itself is a lookup in the index.
+        if (segmentOffset < 0)
         {
-            uint linePtr = pointerForLine(docLine);
-            WrapLayout layout;
-            computeWrapLayout(linePtr, layout);
-            int segmentCount = wrapSegmentCount(layout);
-
-            if (segmentOffset < 0)
-            {
-                if (docLine == 0)
-                {
-                    segmentOffset = 0;
-                    break;
-                }
-                --docLine;
-                uint prevPtr = pointerForLine(docLine);
-                WrapLayout prevLayout;
-                computeWrapLayout(prevPtr, prevLayout);
-                segmentOffset += wrapSegmentCount(prevLayout);
-                continue;
-            }
-
-            if (segmentOffset >= segmentCount)
-            {
-                segmentOffset -= segmentCount;
-                if (docLine >= totalLines - 1)
-                {
-                    segmentOffset = std::max(0, segmentCount - 1);
-                    break;
-                }
-                ++docLine;
-                continue;
-            }
-
-            break;
+            for (int line = docLine - 1, rows = 0; line >= 0 && rows < -segmentOffset && rows < kWrapMeasureRows;
+                 --line)
+                rows += wrapRowsOf(line);
+        }
+        else
+        {
+            for (int line = docLine, rows = 0; line < totalLines && rows <= segmentOffset && rows < kWrapMeasureRows;
+                 ++line)
+                rows += wrapRowsOf(line);
         }
-    }
-
-    int MarkdownFileEditor::computeWrapCaretRow(int docLine,
-                                               int segmentOffset,
-                                               uint caretLinePtr,
-                                               const WrapLayout &caretLayout,
-                                               int caretSegment) const
-    {
-        auto *self = const_cast<MarkdownFileEditor *>(this);
-        int row = -segmentOffset;
-        int lineNumber = docLine;
-        int caretLineNumber = cursorLineNumber;
-        uint linePtr = self->pointerForLine(docLine);
 
-        if (caretLineNumber >= lineNumber)
+        const LineIndex &lines = documentLines();
+        long long target = static_cast<long long>(lines.rowsBefore(static_cast<std::size_t>(docLine))) + segmentOffset;
+        if (target < 0)
         {
-            while (lineNumber < caretLineNumber)
-            {
-                WrapLayout layout;
-                self->computeWrapLayout(linePtr, layout);
-                row += wrapSegmentCount(layout);
-                linePtr = self->nextLine(linePtr);
-                ++lineNumber;
-            }
-            row += caretSegment;
+            docLine = 0;
+            segmentOffset = 0;
+            return;
         }
-        else
+        if (target >= static_cast<long long>(lines.rowCount()))
         {
-            while (lineNumber > caretLineNumber)
-            {
-                --lineNumber;
-                linePtr = self->pointerForLine(lineNumber);
-                WrapLayout layout;
-                self->computeWrapLayout(linePtr, layout);
-                row -= wrapSegmentCount(layout);
-            }
-            row += caretSegment;
+            docLine = totalLines - 1;
+            segmentOffset = std::max(0, wrapRowsOf(docLine) - 1);
+            return;
         }
+        std::size_t rowInLine = 0;
+        docLine = static_cast<int>(lines.lineAtRow(static_cast<std::size_t>(target), rowInLine));
+        segmentOffset = static_cast<int>(rowInLine);
+    }
 
-        return row;
+    int MarkdownFileEditor::computeWrapCaretRow(int docLine, int segmentOffset, int caretSegment) const
+    {
+        auto *self = const_cast<MarkdownFileEditor *>(this);
+        int caretLineNumber = cursorLineNumber;
+        int row = caretLineNumber >= docLine ? self->wrapRowsBetween(docLine, caretLineNumber)
+                                              : -self->wrapRowsBetween(caretLineNumber, docLine);
+        return row - segmentOffset + caretSegment;
     }
 
     int MarkdownFileEditor::currentWrapLocalColumn(const WrapLayout &layout, int segmentIndex) const
@@ -3108,28 +3117,27 @@ namespace ck::edit
         return std::max(0, cursorColumnNumber - segment.startColumn);
     }
 
-    void MarkdownFileEditor::ensureWrapViewport(const WrapLayout &caretLayout, int caretSegment)
+    void MarkdownFileEditor::ensureWrapViewport(int caretSegment)
     {
         int docLine = delta.y;
         int segmentOffset = wrapTopSegmentOffset;
         normalizeWrapTop(docLine, segmentOffset);
 
-        uint caretLinePtr = lineStart(curPtr);
-        int caretRow = computeWrapCaretRow(docLine, segmentOffset, caretLinePtr, caretLayout, caretSegment);
+        int caretRow = computeWrapCaretRow(docLine, segmentOffset, caretSegment);
 
         int viewHeight = std::max(1, size.y);
         while (caretRow < 0)
         {
             segmentOffset += caretRow;
             normalizeWrapTop(docLine, segmentOffset);
-            caretRow = computeWrapCaretRow(docLine, segmentOffset, caretLinePtr, caretLayout, caretSegment);
+            caretRow = computeWrapCaretRow(docLine, segmentOffset, caretSegment);
         }
 
         while (caretRow >= viewHeight)
         {
             segmentOffset += caretRow - (viewHeight - 1);
             normalizeWrapTop(docLine, segmentOffset);
-            caretRow = computeWrapCaretRow(docLine, segmentOffset, caretLinePtr, caretLayout, caretSegment);
+            caretRow = computeWrapCaretRow(docLine, segmentOffset, caretSegment);
         }
 
         bool docLineChanged = docLine != delta.y;
@@ -3153,8 +3161,7 @@ namespace ck::edit
         int segmentOffset = wrapTopSegmentOffset;
         normalizeWrapTop(docLine, segmentOffset);
 
-        uint caretLinePtr = lineStart(curPtr);
-        int caretRow = computeWrapCaretRow(docLine, segmentOffset, caretLinePtr, caretLayout, caretSegment);
+        int caretRow = computeWrapCaretRow(docLine, segmentOffset, caretSegment);
         caretRow = std::clamp(caretRow, 0, std::max(0, size.y - 1));
 
         int column = cursorColumnNumber;
@@ -3180,7 +3187,7 @@ namespace ck::edit
         if (!preserveDesiredColumn)
             wrapDesiredVisualColumn = currentWrapLocalColumn(caretLayout, caretSegment);
 
-        ensureWrapViewport(caretLayout, caretSegment);
+        ensureWrapViewport(caretSegment);
         updateWrapCursorVisualPosition(caretLayout, caretSegment);
     }
 
@@ -3344,9 +3351,6 @@ namespace ck::edit
     {
         refreshCursorMetrics();
         ++cachedStateVersion;
-        statusCachePrefixPtr = UINT_MAX;
-        statusCacheVersion = 0;
-        resetLineNumberCache();
         if (infoView)
         {
             infoView->invalidateState();
@@ -3395,40 +3399,7 @@ namespace ck::edit
 
         context.hasCursorLine = true;
 
-        MarkdownParserState state;
-        if (statusCacheVersion == cachedStateVersion && statusCachePrefixPtr != UINT_MAX && statusCachePrefixPtr <= linePtr)
-        {
-            state = statusStateCache;
-            uint ptr = statusCachePrefixPtr;
-            while (ptr < linePtr && ptr < bufLen)
-            {
-                uint end = lineEnd(ptr);
-                std::string line = readRange(ptr, end);
-                analyzer().analyzeLine(line, state);
-                uint next = nextLine(ptr);
-                if (next <= ptr)
-                    break;
-                ptr = next;
-            }
-        }
-        else
-        {
-            state = MarkdownParserState{};
-            uint ptr = 0;
-            while (ptr < linePtr && ptr < bufLen)
-            {
-                uint end = lineEnd(ptr);
-                std::string line = readRange(ptr, end);
-                analyzer().analyzeLine(line, state);
-                uint next = nextLine(ptr);
-                if (next <= ptr)
-                    break;
-                ptr = next;
-            }
-        }
-        statusStateCache = state;
-        statusCachePrefixPtr = linePtr;
-        statusCacheVersion = cachedStateVersion;
+        MarkdownParserState state = parserStateForLine(lineNumberForPointer(linePtr));
 
         MarkdownLineInfo info = analyzer().analyzeLine(lineText(linePtr), state);
         context.lineKind = info.kind;
@@ -0,0 +1,134 @@
+#include "ck/edit/markdown_format.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace ck::edit
+{
+namespace
+{
+// Record that original, found at start, becomes replacement, leaving out
+// their common prefix and suffix.
+void addEdit(std::vector<TextEdit> &edits, std::size_t start, std::string_view original, std::string_view replacement)
+{
+    std::size_t limit = std::min(original.size(), replacement.size());
+    std::size_t prefix = 0;
+    while (prefix < limit && original[prefix] == replacement[prefix])
+        ++prefix;
+    std::size_t suffix = 0;
+    while (suffix < limit - prefix && original[original.size() - suffix - 1] == replacement[replacement.size() - suffix - 1])
+        ++suffix;
+    if (prefix == original.size() && prefix == replacement.size())
+        return;
+    std::size_t from = start + prefix;
+    std::size_t to = start + original.size() - suffix;
+    replacement = replacement.substr(prefix, replacement.size() - prefix - suffix);
+    if (!edits.empty() && edits.back().end == from)
+    {
+        edits.back().end = to;
+        edits.back().text.append(replacement);
+        return;
+    }
+    edits.push_back(TextEdit{from, to, std::string(replacement)});
+}
+
+bool isBlank(char ch) noexcept
+{
+    return ch == ' ' || ch == '\t';
+}
+
+// Whitespace as std::istream sees it when reading words.
+bool isWordSeparator(char ch) noexcept
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+std::string reflowParagraph(std::string_view paragraph, std::size_t width)
+{
+    std::string output;
+    output.reserve(paragraph.size());
+    std::size_t lineLength = 0;
+    std::size_t pos = 0;
+    while (true)
+    {
+        while (pos < paragraph.size() && isWordSeparator(paragraph[pos]))
+            ++pos;
+        if (pos == paragraph.size())
+            break;
+        std::size_t end = pos;
+        while (end < paragraph.size() && !isWordSeparator(paragraph[end]))
+            ++end;
+        std::string_view word = paragraph.substr(pos, end - pos);
+        pos = end;
+        if (lineLength == 0)
+            lineLength = word.size();
+        else if (lineLength + 1 + word.size() > width)
+        {
+            output.push_back('\n');
+            lineLength = word.size();
+        }
+        else
+        {
+            output.push_back(' ');
+            lineLength += 1 + word.size();
+        }
+        output.append(word);
+    }
+    return output;
+}
+} // namespace
+
+std::vector<TextEdit> formatMarkdownEdits(std::string_view text)
+{
+    std::vector<TextEdit> edits;
+    bool previousBlank = false;
+    std::size_t start = 0;
+    while (start < text.size())
+    {
+        const void *hit = std::memchr(text.data() + start, '\n', text.size() - start);
+        std::size_t end = hit ? static_cast<std::size_t>(static_cast<const char *>(hit) - text.data()) : text.size();
+        std::size_t next = hit ? end + 1 : end;
+        std::string_view line = text.substr(start, next - start);
+
+        std::size_t contentEnd = end;
+        while (contentEnd > start && isBlank(text[contentEnd - 1]))
+            --contentEnd;
+        if (contentEnd == start)
+        {
+            // One blank line stays of each run.
+            addEdit(edits, start, line, previousBlank ? "" : "\n");
+            previousBlank = true;
+        }
+        else
+        {
+            std::string_view tail = end - contentEnd >= 2 ? "  \n" : "\n";
+            addEdit(edits, contentEnd, text.substr(contentEnd, next - contentEnd), tail);
+            previousBlank = false;
+        }
+        start = next;
+    }
+    return edits;
+}
+
+std::vector<TextEdit> reflowParagraphEdits(std::string_view text, std::size_t width)
+{
+    std::vector<TextEdit> edits;
+    std::size_t pos = 0;
+    while (pos < text.size())
+    {
+        std::size_t next = text.find("\n\n", pos);
+        std::size_t end = next == std::string_view::npos ? text.size() : next;
+        std::string_view paragraph = text.substr(pos, end - pos);
+        addEdit(edits, pos, paragraph, reflowParagraph(paragraph, width));
+        if (next == std::string_view::npos)
+            break;
+        // The newlines between paragraphs stay as they are.
+        pos = end;
+        while (pos < text.size() && text[pos] == '\n')
+            ++pos;
+    }
+    return edits;
+}
+
+} // namespace ck::edit
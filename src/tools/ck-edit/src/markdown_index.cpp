@@ -0,0 +1,343 @@
+#include "ck/edit/markdown_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+namespace ck::edit
+{
+namespace
+{
+bool isSpace(char ch) noexcept
+{
+    return ch == ' ' || ch == '\t';
+}
+
+char lowerAscii(char ch) noexcept
+{
+    return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch | 0x20) : ch;
+}
+
+// Position of the ']' closing the bracket at open, or npos.
+std::size_t closingBracket(std::string_view text, std::size_t open)
+{
+    int depth = 0;
+    for (std::size_t i = open; i < text.size(); ++i)
+    {
+        if (text[i] == '\\')
+            ++i;
+        else if (text[i] == '[')
+            ++depth;
+        else if (text[i] == ']' && --depth == 0)
+            return i;
+    }
+    return std::string_view::npos;
+}
+
+// Heading text without its markers and closing sequence.
+std::string_view headingText(std::string_view text, std::size_t start)
+{
+    std::size_t pos = start;
+    while (pos < text.size() && text[pos] == '#')
+        ++pos;
+    std::string_view content = text.substr(pos);
+    while (!content.empty() && isSpace(content.front()))
+        content.remove_prefix(1);
+    while (!content.empty() && isSpace(content.back()))
+        content.remove_suffix(1);
+    std::size_t end = content.size();
+    while (end > 0 && content[end - 1] == '#')
+        --end;
+    if (end == 0 || (end < content.size() && isSpace(content[end - 1])))
+    {
+        content = content.substr(0, end);
+        while (!content.empty() && isSpace(content.back()))
+            content.remove_suffix(1);
+    }
+    return content;
+}
+} // namespace
+
+void MarkdownDocumentIndex::addLine(std::size_t line, std::string_view text, const MarkdownLineInfo &info)
+{
+    switch (info.kind)
+    {
+    case MarkdownLineKind::CodeFenceStart:
+    case MarkdownLineKind::CodeFenceEnd:
+    case MarkdownLineKind::FencedCode:
+    case MarkdownLineKind::IndentedCode:
+    case MarkdownLineKind::Html:
+        return;
+    default:
+        break;
+    }
+
+    std::size_t start = 0;
+    while (start < text.size() && isSpace(text[start]))
+        ++start;
+
+    if (info.kind == MarkdownLineKind::Heading && start < text.size() && text[start] == '#')
+    {
+        MarkdownIndexEntry entry;
+        entry.kind = MarkdownIndexKind::Heading;
+        entry.line = line;
+        entry.column = start;
+        entry.level = info.headingLevel;
+        entry.text = std::string(headingText(text, start));
+        indexEntries.push_back(std::move(entry));
+    }
+    else if (start < text.size() && text[start] == '[')
+    {
+        std::size_t close = closingBracket(text, start);
+        if (close != std::string_view::npos && close + 1 < text.size() && text[close + 1] == ':')
+        {
+            bool footnote = close > start + 1 && text[start + 1] == '^';
+            std::string_view label = text.substr(start + (footnote ? 2 : 1), close - start - (footnote ? 2 : 1));
+            if (!label.empty())
+            {
+                MarkdownIndexEntry entry;
+                entry.kind = footnote ? MarkdownIndexKind::FootnoteDefinition : MarkdownIndexKind::ReferenceDefinition;
+                entry.line = line;
+                entry.column = start;
+                entry.text = normalizeId(label);
+                indexEntries.push_back(std::move(entry));
+                // The target of a reference definition is no link text.
+                if (!footnote)
+                    return;
+                addLinks(line, text, close + 2);
+                return;
+            }
+        }
+    }
+    addLinks(line, text, start);
+}
+
+void MarkdownDocumentIndex::addLinks(std::size_t line, std::string_view text, std::size_t from)
+{
+    auto add = [&](MarkdownIndexKind kind, std::size_t column, std::string id) {
+        MarkdownIndexEntry entry;
+        entry.kind = kind;
+        entry.line = line;
+        entry.column = column;
+        entry.text = std::move(id);
+        indexEntries.push_back(std::move(entry));
+    };
+
+    std::size_t i = from;
+    while (i < text.size())
+    {
+        char ch = text[i];
+        if (ch == '\\')
+        {
+            i += 2;
+            continue;
+        }
+        if (ch == '`')
+        {
+            // Code spans end at a run of as many backticks.
+            std::size_t run = i;
+            while (run < text.size() && text[run] == '`')
+                ++run;
+            std::string_view fence = text.substr(i, run - i);
+            std::size_t end = run;
+            while ((end = text.find(fence, end)) != std::string_view::npos)
+            {
+                std::size_t after = end + fence.size();
+                if (after >= text.size() || text[after] != '`')
+                    break;
+                while (after < text.size() && text[after] == '`')
+                    ++after;
+                end = after;
+            }
+            i = end == std::string_view::npos ? run : end + fence.size();
+            continue;
+        }
+        if (ch != '[')
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t close = closingBracket(text, i);
+        if (close == std::string_view::npos)
+            break;
+        if (close > i + 1 && text[i + 1] == '^')
+        {
+            std::string_view label = text.substr(i + 2, close - i - 2);
+            if (!label.empty())
+                add(MarkdownIndexKind::FootnoteUse, i, normalizeId(label));
+            i = close + 1;
+            continue;
+        }
+        if (close + 1 < text.size() && text[close + 1] == '[')
+        {
+            std::size_t labelClose = text.find(']', close + 2);
+            if (labelClose == std::string_view::npos)
+                break;
+            std::string_view label = text.substr(close + 2, labelClose - close - 2);
+            if (label.empty())
+                label = text.substr(i + 1, close - i - 1);
+            if (!label.empty())
+                add(MarkdownIndexKind::ReferenceUse, i, normalizeId(label));
+            i = labelClose + 1;
+            continue;
+        }
+        if (close + 1 < text.size() && text[close + 1] == '(')
+        {
+            std::size_t targetEnd = text.find(')', close + 2);
+            if (targetEnd == std::string_view::npos)
+                break;
+            std::string_view target = text.substr(close + 2, targetEnd - close - 2);
+            while (!target.empty() && isSpace(target.front()))
+                target.remove_prefix(1);
+            if (!target.empty() && target.front() == '#')
+            {
+                target = target.substr(1, target.find_first_of(" \t") - 1);
+                std::string anchor(target);
+                std::transform(anchor.begin(), anchor.end(), anchor.begin(), lowerAscii);
+                add(MarkdownIndexKind::AnchorLink, i, std::move(anchor));
+            }
+            i = targetEnd + 1;
+            continue;
+        }
+        // Text in brackets may still hold links.
+        ++i;
+    }
+}
+
+void MarkdownDocumentIndex::addEntries(const MarkdownDocumentIndex &previous, std::size_t from, std::size_t to,
+                                       std::ptrdiff_t shift)
+{
+    const std::vector<MarkdownIndexEntry> &source = previous.indexEntries;
+    auto first = std::lower_bound(source.begin(), source.end(), from,
+                                  [](const MarkdownIndexEntry &entry, std::size_t line) { return entry.line < line; });
+    for (auto it = first; it != source.end() && it->line < to; ++it)
+    {
+        indexEntries.push_back(*it);
+        indexEntries.back().line = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(it->line) + shift);
+    }
+}
+
+void MarkdownDocumentIndex::finish()
+{
+    headingEntries.clear();
+    referenceIds.clear();
+    footnoteIds.clear();
+    anchors.clear();
+    // Repeated headings get -1, -2 and so on, as on GitHub.
+    std::unordered_map<std::string, int> anchorCounts;
+    for (std::size_t i = 0; i < indexEntries.size(); ++i)
+    {
+        const MarkdownIndexEntry &entry = indexEntries[i];
+        switch (entry.kind)
+        {
+        case MarkdownIndexKind::Heading:
+        {
+            headingEntries.push_back(i);
+            std::string anchor = anchorFor(entry.text);
+            int count = anchorCounts[anchor]++;
+            anchors.insert(count == 0 ? anchor : anchor + "-" + std::to_string(count));
+            break;
+        }
+        case MarkdownIndexKind::ReferenceDefinition:
+            referenceIds.insert(entry.text);
+            break;
+        case MarkdownIndexKind::FootnoteDefinition:
+            footnoteIds.insert(entry.text);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool MarkdownDocumentIndex::hasReference(std::string_view id) const
+{
+    return referenceIds.count(normalizeId(id)) != 0;
+}
+
+bool MarkdownDocumentIndex::hasFootnote(std::string_view id) const
+{
+    return footnoteIds.count(normalizeId(id)) != 0;
+}
+
+bool MarkdownDocumentIndex::hasAnchor(std::string_view anchor) const
+{
+    std::string key(anchor);
+    std::transform(key.begin(), key.end(), key.begin(), lowerAscii);
+    return anchors.count(key) != 0;
+}
+
+std::string MarkdownDocumentIndex::uniqueReferenceId(std::string_view prefix) const
+{
+    std::string base = prefix.empty() ? std::string("ref") : std::string(prefix);
+    for (int i = 1; i < 10000; ++i)
+    {
+        std::string candidate = base + std::to_string(i);
+        if (!hasReference(candidate))
+            return candidate;
+    }
+    return base + "x";
+}
+
+std::string MarkdownDocumentIndex::uniqueFootnoteId() const
+{
+    for (int i = 1; i < 10000; ++i)
+    {
+        std::string candidate = "fn" + std::to_string(i);
+        if (!hasFootnote(candidate))
+            return candidate;
+    }
+    return "fn";
+}
+
+std::vector<MarkdownIndexEntry> MarkdownDocumentIndex::brokenLinks() const
+{
+    std::vector<MarkdownIndexEntry> broken;
+    for (const MarkdownIndexEntry &entry : indexEntries)
+    {
+        bool missing = (entry.kind == MarkdownIndexKind::ReferenceUse && referenceIds.count(entry.text) == 0) ||
+                       (entry.kind == MarkdownIndexKind::FootnoteUse && footnoteIds.count(entry.text) == 0) ||
+                       (entry.kind == MarkdownIndexKind::AnchorLink && anchors.count(entry.text) == 0);
+        if (missing)
+            broken.push_back(entry);
+    }
+    return broken;
+}
+
+std::string MarkdownDocumentIndex::normalizeId(std::string_view id)
+{
+    std::string result;
+    result.reserve(id.size());
+    bool space = false;
+    for (char ch : id)
+    {
+        if (isSpace(ch) || ch == '\n')
+        {
+            space = !result.empty();
+            continue;
+        }
+        if (space)
+            result.push_back(' ');
+        space = false;
+        result.push_back(lowerAscii(ch));
+    }
+    return result;
+}
+
+std::string MarkdownDocumentIndex::anchorFor(std::string_view heading)
+{
+    std::string result;
+    result.reserve(heading.size());
+    for (char ch : heading)
+    {
+        auto byte = static_cast<unsigned char>(ch);
+        if (byte >= 0x80 || std::isalnum(byte) || ch == '-' || ch == '_')
+            result.push_back(lowerAscii(ch));
+        else if (ch == ' ')
+            result.push_back('-');
+    }
+    return result;
+}
+
+} // namespace ck::edit
@@ -59,32 +59,56 @@ std::string columnNameFromIndex(std::size_t index)
 
 } // namespace
 
-MarkdownParserState MarkdownAnalyzer::computeStateBefore(const std::string &text)
+MarkdownStateCheckpoints::MarkdownStateCheckpoints(std::size_t interval)
+    : checkpointInterval(std::max<std::size_t>(interval, 1)), states(1)
+{
+}
+
+std::size_t MarkdownStateCheckpoints::nearest(std::size_t line, MarkdownParserState &state) const
+{
+    std::size_t index = std::min(line / checkpointInterval, states.size() - 1);
+    state = states[index];
+    return index * checkpointInterval;
+}
+
+void MarkdownStateCheckpoints::record(std::size_t line, const MarkdownParserState &state)
+{
+    if (line % checkpointInterval == 0 && line / checkpointInterval == states.size())
+        states.push_back(state);
+}
+
+void MarkdownStateCheckpoints::invalidateFrom(std::size_t line)
+{
+    // The checkpoint at line itself still only depends on earlier lines.
+    std::size_t keep = line / checkpointInterval + 1;
+    if (keep < states.size())
+        states.resize(keep);
+}
+
+void MarkdownStateCheckpoints::clear()
+{
+    states.resize(1);
+}
+
+MarkdownParserState MarkdownAnalyzer::computeStateBefore(std::string_view text)
 {
     MarkdownParserState state;
     std::size_t offset = 0;
     while (offset < text.size())
     {
         std::size_t end = text.find('\n', offset);
-        std::string line;
-        if (end == std::string::npos)
-        {
-            line = text.substr(offset);
-            offset = text.size();
-        }
-        else
-        {
-            line = text.substr(offset, end - offset);
-            offset = end + 1;
-        }
+        if (end == std::string_view::npos)
+            end = text.size();
+        std::string_view line = text.substr(offset, end - offset);
+        offset = end + 1;
         if (!line.empty() && line.back() == '\r')
-            line.pop_back();
+            line.remove_suffix(1);
         analyzeLine(line, state);
     }
     return state;
 }
 
-MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, MarkdownParserState &state) const
+MarkdownLineInfo MarkdownAnalyzer::analyzeLine(std::string_view line, MarkdownParserState &state) const
 {
     auto resetTable = [&]() {
         state.tableActive = false;
@@ -100,17 +124,17 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
     }
 
     MarkdownLineInfo info;
-    auto parse = [&](std::string src) {
-        info.inlineText = std::move(src);
+    auto parse = [&](std::string_view src) {
+        info.inlineText.assign(src.data(), src.size());
         parseInline(info.inlineText, info);
     };
 
-    std::string trimmed = trim(line);
+    std::string_view trimmed = trim(line);
     if (trimmed.empty())
     {
         info.kind = MarkdownLineKind::Blank;
         resetTable();
-        parse(std::string(line));
+        parse(line);
         return info;
     }
 
@@ -118,7 +142,7 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
     {
         info.kind = MarkdownLineKind::Html;
         resetTable();
-        parse(std::string(line));
+        parse(line);
         return info;
     }
 
@@ -139,15 +163,14 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
                 state.fenceIndented = false;
                 if (trimmed.size() > count)
                 {
-                    auto lang = trim(trimmed.substr(count));
-                    info.language = lang;
+                    info.language = trim(trimmed.substr(count));
                 }
                 info.inFence = true;
                 info.fenceLabel = describeLine(info);
                 state.fenceLabel = info.fenceLabel;
                 state.fenceLanguage = info.language;
                 resetTable();
-                parse(std::string(line));
+                parse(line);
                 return info;
             }
         }
@@ -171,7 +194,7 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
     {
         info.kind = MarkdownLineKind::IndentedCode;
         resetTable();
-        parse(std::string(line));
+        parse(line);
         return info;
     }
 
@@ -193,11 +216,10 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
             info.kind = MarkdownLineKind::Heading;
             info.headingLevel = static_cast<int>(level);
             resetTable();
-            std::string content_str = std::string(trimmed.substr(level));
-            std::string_view content = content_str;
+            std::string_view content = trimmed.substr(level);
             while (!content.empty() && content.front() == ' ')
-                content = content.substr(1);
-            parse(std::string(content));
+                content.remove_prefix(1);
+            parse(content);
             return info;
         }
     }
@@ -206,7 +228,7 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
     {
         info.kind = MarkdownLineKind::HorizontalRule;
         resetTable();
-        parse(std::string(line));
+        parse(line);
         return info;
     }
 
@@ -221,7 +243,7 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
             state.tableRowCounter = 1;
         info.tableRowIndex = state.tableRowCounter;
         state.tableAlignments = info.tableAlignments;
-        parse(std::string(line));
+        parse(line);
         return info;
     }
 
@@ -259,7 +281,7 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
         info.kind = isOrdered ? MarkdownLineKind::OrderedListItem : MarkdownLineKind::BulletListItem;
         info.isOrdered = isOrdered;
         info.marker = marker;
-        std::string rest;
+        std::string_view rest;
         if (isOrdered)
         {
             std::size_t skip = marker.size();
@@ -294,13 +316,13 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeLine(const std::string &line, Markdown
         info.isTableHeader = !state.tableHeaderConfirmed;
         info.tableRowIndex = state.tableRowCounter + 1;
         state.tableRowCounter = info.tableRowIndex;
-        parse(std::string(line));
+        parse(line);
         return info;
     }
 
     info.kind = MarkdownLineKind::Paragraph;
     resetTable();
-    parse(std::string(line));
+    parse(line);
     return info;
 }
 
@@ -440,7 +462,7 @@ std::string MarkdownAnalyzer::describeTableCell(const MarkdownLineInfo &info, st
     return out.str();
 }
 
-bool MarkdownAnalyzer::isHorizontalRule(const std::string &trimmed) noexcept
+bool MarkdownAnalyzer::isHorizontalRule(std::string_view trimmed) noexcept
 {
     if (trimmed.size() < 3)
         return false;
@@ -458,19 +480,19 @@ bool MarkdownAnalyzer::isHorizontalRule(const std::string &trimmed) noexcept
     return count >= 3;
 }
 
-bool MarkdownAnalyzer::isTableSeparator(const std::string &trimmed) noexcept
+bool MarkdownAnalyzer::isTableSeparator(std::string_view trimmed) noexcept
 {
     if (trimmed.empty())
         return false;
-    if (trimmed.find('|') == std::string::npos)
+    if (trimmed.find('|') == std::string_view::npos)
         return false;
     std::size_t start = 0;
     while (start < trimmed.size())
     {
         std::size_t end = trimmed.find('|', start);
-        if (end == std::string::npos)
+        if (end == std::string_view::npos)
             end = trimmed.size();
-        std::string_view cell(trimmed.data() + start, end - start);
+        std::string_view cell = trimmed.substr(start, end - start);
         auto t = trim(cell);
         if (!t.empty())
         {
@@ -483,7 +505,7 @@ bool MarkdownAnalyzer::isTableSeparator(const std::string &trimmed) noexcept
     return true;
 }
 
-std::vector<MarkdownTableCell> MarkdownAnalyzer::parseTableRow(const std::string &line)
+std::vector<MarkdownTableCell> MarkdownAnalyzer::parseTableRow(std::string_view line)
 {
     std::vector<MarkdownTableCell> cells;
     std::size_t len = line.size();
@@ -537,7 +559,7 @@ std::vector<MarkdownTableCell> MarkdownAnalyzer::parseTableRow(const std::string
     return cells;
 }
 
-std::vector<MarkdownTableAlignment> MarkdownAnalyzer::parseAlignmentRow(const std::string &line)
+std::vector<MarkdownTableAlignment> MarkdownAnalyzer::parseAlignmentRow(std::string_view line)
 {
     std::vector<MarkdownTableAlignment> alignments;
     auto cells = parseTableRow(line);
@@ -562,30 +584,28 @@ std::vector<MarkdownTableAlignment> MarkdownAnalyzer::parseAlignmentRow(const st
     return alignments;
 }
 
-std::string MarkdownAnalyzer::trimLeft(std::string_view view) noexcept
+std::string_view MarkdownAnalyzer::trimLeft(std::string_view view) noexcept
 {
     std::size_t pos = 0;
     while (pos < view.size() && isWhitespace(view[pos]))
         ++pos;
-    return std::string(view.substr(pos));
+    return view.substr(pos);
 }
 
-std::string MarkdownAnalyzer::trimRight(std::string_view view) noexcept
+std::string_view MarkdownAnalyzer::trimRight(std::string_view view) noexcept
 {
-    if (view.empty())
-        return std::string();
     std::size_t end = view.size();
     while (end > 0 && isWhitespace(view[end - 1]))
         --end;
-    return std::string(view.substr(0, end));
+    return view.substr(0, end);
 }
 
-std::string MarkdownAnalyzer::trim(std::string_view view) noexcept
+std::string_view MarkdownAnalyzer::trim(std::string_view view) noexcept
 {
     return trimLeft(trimRight(view));
 }
 
-bool MarkdownAnalyzer::isHtmlBlockStart(const std::string &trimmed) noexcept
+bool MarkdownAnalyzer::isHtmlBlockStart(std::string_view trimmed) noexcept
 {
     if (trimmed.size() < 3)
         return false;
@@ -596,14 +616,14 @@ bool MarkdownAnalyzer::isHtmlBlockStart(const std::string &trimmed) noexcept
     return std::isalpha(static_cast<unsigned char>(trimmed[1])) != 0;
 }
 
-MarkdownLineInfo MarkdownAnalyzer::analyzeFencedState(const std::string &line, MarkdownParserState &state) const
+MarkdownLineInfo MarkdownAnalyzer::analyzeFencedState(std::string_view line, MarkdownParserState &state) const
 {
     MarkdownLineInfo info;
     info.inFence = true;
     info.fenceLabel = state.fenceLabel;
     info.language = state.fenceLanguage;
-    std::string trimmed = trim(line);
-    if (!state.fenceMarker.empty() && trimmed.rfind(state.fenceMarker, 0) == 0)
+    std::string_view trimmed = trim(line);
+    if (!state.fenceMarker.empty() && trimmed.substr(0, state.fenceMarker.size()) == state.fenceMarker)
     {
         info.kind = MarkdownLineKind::CodeFenceEnd;
         info.fenceCloses = true;
@@ -616,7 +636,7 @@ MarkdownLineInfo MarkdownAnalyzer::analyzeFencedState(const std::string &line, M
     {
         info.kind = MarkdownLineKind::FencedCode;
     }
-    info.inlineText = line;
+    info.inlineText.assign(line.data(), line.size());
     parseInline(info.inlineText, info);
     return info;
 }
@@ -781,7 +801,7 @@ void MarkdownAnalyzer::parseLinksAndImages(const std::string &line, std::vector<
                         span.kind = isImage ? MarkdownSpanKind::Image : MarkdownSpanKind::Link;
                         span.start = isImage ? i - 1 : i;
                         span.end = k;
-                        std::string url = trim(std::string_view(line.data() + urlStart, urlEnd - urlStart));
+                        std::string url(trim(std::string_view(line.data() + urlStart, urlEnd - urlStart)));
                         if (!url.empty() && url.front() == '<' && url.back() == '>')
                             url = url.substr(1, url.size() - 2);
                         span.attribute = url;
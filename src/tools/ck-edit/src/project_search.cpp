@@ -0,0 +1,389 @@
+#include "ck/edit/project_search.hpp"
+
+#include "ck/edit/atomic_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ck::edit
+{
+namespace
+{
+// Files with a NUL byte this close to the start are taken as binary.
+constexpr std::size_t kBinaryProbe = 4096;
+constexpr unsigned kMaxSearchThreads = 8;
+
+char foldAscii(char ch) noexcept
+{
+    return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch | 0x20) : ch;
+}
+
+// The bytes of a file, mapped read-only where possible.
+class FileBytes
+{
+public:
+    // Throws std::runtime_error when the file cannot be read.
+    explicit FileBytes(const std::filesystem::path &path)
+    {
+#if !defined(_WIN32)
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::runtime_error(path.string() + ": " + std::strerror(errno));
+        struct stat sb
+        {
+        };
+        if (::fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0)
+        {
+            void *mapping = ::mmap(nullptr, static_cast<std::size_t>(sb.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                data = static_cast<const char *>(mapping);
+                size = static_cast<std::size_t>(sb.st_size);
+                mapped = true;
+            }
+        }
+        ::close(fd);
+#endif
+        if (!mapped)
+        {
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+                throw std::runtime_error(path.string() + ": cannot open file");
+            std::ostringstream ss;
+            ss << in.rdbuf();
+            owned = std::move(ss).str();
+            data = owned.data();
+            size = owned.size();
+        }
+    }
+
+    ~FileBytes()
+    {
+#if !defined(_WIN32)
+        if (mapped)
+            ::munmap(const_cast<char *>(data), size);
+#endif
+    }
+
+    FileBytes(const FileBytes &) = delete;
+    FileBytes &operator=(const FileBytes &) = delete;
+
+    std::string_view text() const noexcept { return std::string_view(data, size); }
+
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::string owned;
+};
+
+// Replace the matches in one file, counting them into summary.
+void replaceInFile(const ProjectMatcher &matcher, const std::string &path, std::string_view replacement,
+                   ProjectReplaceSummary &summary)
+{
+    try
+    {
+        std::string text;
+        std::size_t count = 0;
+        {
+            FileBytes bytes(path);
+            text = matcher.replaceAll(bytes.text(), replacement, count);
+        }
+        if (count == 0)
+            return;
+        writeFileAtomically(path, {text});
+        ++summary.files;
+        summary.replacements += count;
+    }
+    catch (const std::exception &error)
+    {
+        summary.errors.push_back(error.what());
+    }
+}
+} // namespace
+
+ProjectMatcher::ProjectMatcher(const ProjectSearchQuery &query)
+    : pattern(query.pattern), useRegex(query.regex), caseSensitive(query.caseSensitive)
+{
+    if (useRegex)
+    {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (!caseSensitive)
+            flags |= std::regex::icase;
+        expression = std::regex(pattern, flags);
+    }
+    else if (!caseSensitive)
+        std::transform(pattern.begin(), pattern.end(), pattern.begin(), foldAscii);
+}
+
+void ProjectMatcher::forEachMatch(std::string_view text,
+                                  const std::function<void(std::size_t, std::size_t, const std::cmatch *)> &visit) const
+{
+    if (pattern.empty())
+        return;
+    if (!useRegex)
+    {
+        std::string folded;
+        if (!caseSensitive)
+        {
+            folded.resize(text.size());
+            std::transform(text.begin(), text.end(), folded.begin(), foldAscii);
+            text = folded;
+        }
+        std::boyer_moore_horspool_searcher searcher(pattern.begin(), pattern.end());
+        auto position = text.begin();
+        while (true)
+        {
+            position = std::search(position, text.end(), searcher);
+            if (position == text.end())
+                break;
+            visit(static_cast<std::size_t>(position - text.begin()), pattern.size(), nullptr);
+            position += static_cast<std::ptrdiff_t>(pattern.size());
+        }
+        return;
+    }
+
+    std::size_t lineStart = 0;
+    while (lineStart <= text.size())
+    {
+        const void *hit = std::memchr(text.data() + lineStart, '\n', text.size() - lineStart);
+        std::size_t next = hit ? static_cast<std::size_t>(static_cast<const char *>(hit) - text.data()) : text.size();
+        std::size_t lineEnd = next;
+        if (lineEnd > lineStart && text[lineEnd - 1] == '\r')
+            --lineEnd;
+        const char *first = text.data() + lineStart;
+        for (std::cregex_iterator it(first, text.data() + lineEnd, expression), end; it != end; ++it)
+        {
+            if (it->length(0) == 0)
+                continue;
+            visit(lineStart + static_cast<std::size_t>(it->position(0)), static_cast<std::size_t>(it->length(0)),
+                  &*it);
+        }
+        if (!hit)
+            break;
+        lineStart = next + 1;
+    }
+}
+
+std::vector<ProjectMatcher::Match> ProjectMatcher::findAll(std::string_view text) const
+{
+    std::vector<Match> matches;
+    forEachMatch(text, [&](std::size_t start, std::size_t length, const std::cmatch *) {
+        matches.push_back(Match{start, length});
+    });
+    return matches;
+}
+
+std::string ProjectMatcher::replaceAll(std::string_view text, std::string_view replacement, std::size_t &count) const
+{
+    std::string result;
+    std::string format(replacement);
+    std::size_t copied = 0;
+    count = 0;
+    forEachMatch(text, [&](std::size_t start, std::size_t length, const std::cmatch *match) {
+        result.append(text.substr(copied, start - copied));
+        if (match)
+            result.append(match->format(format));
+        else
+            result.append(replacement);
+        copied = start + length;
+        ++count;
+    });
+    if (count == 0)
+        return std::string(text);
+    result.append(text.substr(copied));
+    return result;
+}
+
+ProjectSearchJob::ProjectSearchJob(std::filesystem::path root, ProjectSearchQuery query, unsigned threads)
+    : rootPath(std::move(root)), searchQuery(std::move(query)), matcher(searchQuery)
+{
+    if (threads == 0)
+        threads = std::clamp(std::thread::hardware_concurrency(), 1u, kMaxSearchThreads);
+    runningWorkers = threads;
+    lister = std::thread([this]() { listFiles(); });
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        workers.emplace_back([this]() { work(); });
+}
+
+ProjectSearchJob::~ProjectSearchJob()
+{
+    cancel();
+    if (lister.joinable())
+        lister.join();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void ProjectSearchJob::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+    filesQueued.notify_all();
+}
+
+std::vector<ProjectMatch> ProjectSearchJob::takeResults(std::size_t limit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ProjectMatch> taken;
+    std::size_t count = std::min(limit, results.size());
+    taken.assign(std::make_move_iterator(results.begin()), std::make_move_iterator(results.begin() + count));
+    results.erase(results.begin(), results.begin() + count);
+    return taken;
+}
+
+bool ProjectSearchJob::finished() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return listingDone && pendingFiles.empty() && runningWorkers == 0 && results.empty();
+}
+
+void ProjectSearchJob::listFiles()
+{
+    std::error_code ec;
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (std::filesystem::recursive_directory_iterator it(rootPath, options, ec), end; !ec && it != end;
+         it.increment(ec))
+    {
+        if (cancelled.load(std::memory_order_relaxed))
+            break;
+        std::error_code typeError;
+        const std::filesystem::path &path = it->path();
+        if (it->is_directory(typeError))
+        {
+            std::string name = path.filename().string();
+            if (!name.empty() && name[0] == '.')
+                it.disable_recursion_pending();
+            continue;
+        }
+        if (!it->is_regular_file(typeError) || (searchQuery.fileFilter && !searchQuery.fileFilter(path)))
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pendingFiles.push_back(path);
+        }
+        filesQueued.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        listingDone = true;
+    }
+    filesQueued.notify_all();
+}
+
+void ProjectSearchJob::work()
+{
+    std::vector<ProjectMatch> found;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        filesQueued.wait(lock, [this]() {
+            return cancelled.load(std::memory_order_relaxed) || !pendingFiles.empty() || listingDone;
+        });
+        if (cancelled.load(std::memory_order_relaxed) || pendingFiles.empty())
+            break;
+        std::filesystem::path path = std::move(pendingFiles.front());
+        pendingFiles.pop_front();
+        lock.unlock();
+
+        found.clear();
+        searchFile(path, found);
+        searchedFiles.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+        results.insert(results.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    }
+    --runningWorkers;
+}
+
+void ProjectSearchJob::searchFile(const std::filesystem::path &path, std::vector<ProjectMatch> &found) const
+{
+    try
+    {
+        FileBytes bytes(path);
+        std::string_view text = bytes.text();
+        if (std::memchr(text.data(), '\0', std::min(text.size(), kBinaryProbe)))
+            return;
+        std::vector<ProjectMatcher::Match> matches = matcher.findAll(text);
+        std::string name = path.string();
+        std::size_t line = 0;
+        std::size_t lineStart = 0;
+        for (const ProjectMatcher::Match &match : matches)
+        {
+            // Matches come in order, so lines are counted once.
+            while (const void *hit = std::memchr(text.data() + lineStart, '\n', match.start - lineStart))
+            {
+                lineStart = static_cast<std::size_t>(static_cast<const char *>(hit) - text.data()) + 1;
+                ++line;
+            }
+            std::size_t lineEnd = text.find('\n', match.start);
+            if (lineEnd == std::string_view::npos)
+                lineEnd = text.size();
+            if (lineEnd > lineStart && text[lineEnd - 1] == '\r')
+                --lineEnd;
+            ProjectMatch result;
+            result.path = name;
+            result.line = line;
+            result.column = match.start - lineStart;
+            result.length = match.length;
+            result.lineText = text.substr(lineStart, std::min(lineEnd - lineStart, ProjectMatch::kLineTextLimit));
+            found.push_back(std::move(result));
+        }
+    }
+    catch (const std::exception &)
+    {
+        // Unreadable files are left out, as the walk leaves out
+        // unreadable directories.
+    }
+}
+
+ProjectReplaceSummary replaceInFiles(const std::vector<std::string> &paths, const ProjectSearchQuery &query,
+                                     std::string_view replacement)
+{
+    ProjectReplaceSummary summary;
+    ProjectMatcher matcher(query);
+    for (const std::string &path : paths)
+        replaceInFile(matcher, path, replacement, summary);
+    return summary;
+}
+
+ProjectReplaceJob::ProjectReplaceJob(std::vector<std::string> paths, const ProjectSearchQuery &query,
+                                     std::string replacement)
+    : filePaths(std::move(paths)), replacementText(std::move(replacement)), matcher(query)
+{
+    worker = std::thread([this]() { run(); });
+}
+
+ProjectReplaceJob::~ProjectReplaceJob()
+{
+    cancel();
+    worker.join();
+}
+
+void ProjectReplaceJob::run()
+{
+    for (const std::string &path : filePaths)
+    {
+        if (cancelled.load(std::memory_order_relaxed))
+            break;
+        replaceInFile(matcher, path, replacementText, replaceSummary);
+        doneFiles.fetch_add(1, std::memory_order_relaxed);
+    }
+    done.store(true, std::memory_order_release);
+}
+
+} // namespace ck::edit
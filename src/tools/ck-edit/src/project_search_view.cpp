@@ -0,0 +1,226 @@
+#include "ck/edit/markdown_editor.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace ck::edit
+{
+    namespace
+    {
+        // Columns reachable by horizontal scrolling.
+        constexpr int kResultColumns = 1024;
+    } // namespace
+
+    ProjectSearchView::ProjectSearchView(const TRect &bounds, TScrollBar *hScrollBar, TScrollBar *vScrollBar,
+                                         std::unique_ptr<ProjectSearchJob> job, std::string replacementText,
+                                         bool replace) noexcept
+        : TScroller(bounds, hScrollBar, vScrollBar), searchJob(std::move(job)),
+          replacement(std::move(replacementText)), replacing(replace)
+    {
+        growMode = gfGrowHiX | gfGrowHiY;
+        options |= ofSelectable;
+        setLimit(kResultColumns, 1);
+    }
+
+    bool ProjectSearchView::poll()
+    {
+        if (replaceJob)
+            return replaceJob->finished();
+        if (searchDone)
+            return false;
+        std::vector<ProjectMatch> found = searchJob->takeResults();
+        // Nothing can arrive between the two calls once finished() holds.
+        searchDone = searchJob->finished();
+        if (!found.empty())
+        {
+            items.insert(items.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+            setLimit(kResultColumns, static_cast<int>(std::min<std::size_t>(std::max<std::size_t>(items.size(), 1), INT_MAX)));
+            drawView();
+        }
+        return searchDone || !found.empty();
+    }
+
+    void ProjectSearchView::draw()
+    {
+        TColorAttr normal = getColor(1);
+        TColorAttr current = getColor(2);
+        for (int row = 0; row < size.y; ++row)
+        {
+            TDrawBuffer buffer;
+            auto item = static_cast<std::size_t>(delta.y) + static_cast<std::size_t>(row);
+            TColorAttr color = item == cursorItem && !items.empty() ? current : normal;
+            buffer.moveChar(0, ' ', color, size.x);
+            if (item < items.size())
+            {
+                const ProjectMatch &match = items[item];
+                std::string path = std::filesystem::path(match.path).lexically_relative(searchJob->root()).string();
+                std::string text = path + ":" + std::to_string(match.line + 1) + ": " + match.lineText;
+                std::replace(text.begin(), text.end(), '\t', ' ');
+                buffer.moveStr(0, text, color, size.x, delta.x);
+            }
+            writeLine(0, row, size.x, 1, buffer);
+        }
+    }
+
+    void ProjectSearchView::moveCursor(std::size_t item)
+    {
+        if (items.empty())
+            return;
+        cursorItem = std::min(item, items.size() - 1);
+        int top = delta.y;
+        auto cursor = static_cast<int>(std::min<std::size_t>(cursorItem, INT_MAX));
+        if (cursor < top)
+            top = cursor;
+        else if (cursor >= top + size.y)
+            top = cursor - size.y + 1;
+        if (top != delta.y)
+            scrollTo(delta.x, top);
+        drawView();
+    }
+
+    void ProjectSearchView::openCursorItem()
+    {
+        if (cursorItem >= items.size())
+            return;
+        if (auto *app = dynamic_cast<MarkdownEditorApp *>(TProgram::application))
+            app->openSearchResult(items[cursorItem]);
+    }
+
+    void ProjectSearchView::handleEvent(TEvent &event)
+    {
+        TScroller::handleEvent(event);
+        if (event.what == evMouseDown)
+        {
+            TPoint where = makeLocal(event.mouse.where);
+            moveCursor(static_cast<std::size_t>(delta.y + where.y));
+            if ((event.mouse.eventFlags & meDoubleClick) != 0)
+                openCursorItem();
+            clearEvent(event);
+        }
+        else if (event.what == evKeyDown)
+        {
+            std::size_t page = static_cast<std::size_t>(std::max(1, size.y - 1));
+            switch (event.keyDown.keyCode)
+            {
+            case kbUp:
+                moveCursor(cursorItem > 0 ? cursorItem - 1 : 0);
+                break;
+            case kbDown:
+                moveCursor(cursorItem + 1);
+                break;
+            case kbPgUp:
+                moveCursor(cursorItem > page ? cursorItem - page : 0);
+                break;
+            case kbPgDn:
+                moveCursor(cursorItem + page);
+                break;
+            case kbCtrlPgUp:
+            case kbCtrlHome:
+                moveCursor(0);
+                break;
+            case kbCtrlPgDn:
+            case kbCtrlEnd:
+                moveCursor(items.size());
+                break;
+            case kbEnter:
+                openCursorItem();
+                break;
+            default:
+                return;
+            }
+            clearEvent(event);
+        }
+    }
+
+    void ProjectSearchView::applyReplace()
+    {
+        if (replaceFinished())
+        {
+            const ProjectReplaceSummary &summary = replaceJob->summary();
+            std::ostringstream text;
+            text << "Replaced " << summary.replacements << " matches in " << summary.files << " files.";
+            if (!summary.errors.empty())
+                text << " " << summary.errors.size() << " files failed: " << summary.errors.front();
+            ushort kind = summary.errors.empty() ? mfInformation : mfError;
+            replaceJob.reset();
+            messageBox(text.str().c_str(), kind | mfOKButton);
+            return;
+        }
+        if (!replacePending())
+            return;
+        replacing = false;
+
+        // Files open in a window are left alone, so that no unsaved text is
+        // lost and no buffer goes stale.
+        auto *app = dynamic_cast<MarkdownEditorApp *>(TProgram::application);
+        std::vector<std::string> paths;
+        std::size_t skipped = 0;
+        std::string previous;
+        for (const ProjectMatch &match : items)
+        {
+            // A file's matches arrive together.
+            if (match.path == previous)
+                continue;
+            previous = match.path;
+            if (app && app->windowForFile(match.path))
+                ++skipped;
+            else
+                paths.push_back(match.path);
+        }
+        if (paths.empty())
+        {
+            messageBox(skipped ? "Every file with matches is open in a window; nothing was replaced."
+                               : "There is nothing to replace.",
+                       mfInformation | mfOKButton);
+            return;
+        }
+
+        std::ostringstream prompt;
+        prompt << "Replace the matches in " << paths.size() << " files?";
+        if (skipped)
+            prompt << " " << skipped << " files open in windows are left out.";
+        if (messageBox(prompt.str().c_str(), mfConfirmation | mfYesButton | mfNoButton) != cmYes)
+            return;
+
+        // The files are rewritten in the background; poll reports when the
+        // job is done and applyReplace shows its summary.
+        replaceJob = std::make_unique<ProjectReplaceJob>(std::move(paths), query(), replacement);
+        if (auto *window = dynamic_cast<ProjectSearchWindow *>(owner))
+            window->updateTitle();
+    }
+
+    ProjectSearchWindow::ProjectSearchWindow(const TRect &bounds, const std::string &rootName,
+                                             std::unique_ptr<ProjectSearchJob> job, std::string replacement,
+                                             bool replacing) noexcept
+        : TWindowInit(&TWindow::initFrame), TWindow(bounds, nullptr, wnNoNumber)
+    {
+        options |= ofTileable;
+        titlePrefix = std::string(replacing ? "Replace in Files: " : "Find in Files: ") + job->query().pattern +
+                      " in " + rootName;
+
+        TScrollBar *hScrollBar = standardScrollBar(sbHorizontal | sbHandleKeyboard);
+        TScrollBar *vScrollBar = standardScrollBar(sbVertical);
+        TRect viewRect = getExtent();
+        viewRect.grow(-1, -1);
+        searchView = new ProjectSearchView(viewRect, hScrollBar, vScrollBar, std::move(job), std::move(replacement),
+                                           replacing);
+        insert(searchView);
+        updateTitle();
+    }
+
+    void ProjectSearchWindow::updateTitle()
+    {
+        std::ostringstream text;
+        text << titlePrefix << " - " << searchView->matches().size() << " matches";
+        if (searchView->searching())
+            text << " (searching)";
+        else if (searchView->replaceRunning())
+            text << " (replacing)";
+        if (title)
+            delete[] const_cast<char *>(title);
+        title = newStr(text.str().c_str());
+        if (frame)
+            frame->drawView();
+    }
+
+} // namespace ck::edit
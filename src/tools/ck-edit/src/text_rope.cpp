@@ -0,0 +1,249 @@
+#include "ck/edit/text_rope.hpp"
+
+#include <algorithm>
+
+namespace ck::edit
+{
+namespace
+{
+// Edits re-chunk the chunks they touch, so a chunk that grows past this
+// size is split in two.
+constexpr std::size_t kChunkSize = 1024;
+} // namespace
+
+void TextRope::assign(std::string_view head, std::string_view tail)
+{
+    root = merge(build(head), build(tail));
+}
+
+void TextRope::replace(std::size_t start, std::size_t end, std::string_view text)
+{
+    std::size_t total = size();
+    start = std::min(start, total);
+    end = std::clamp(end, start, total);
+
+    // The chunks touching [start, end) become the part of the first one
+    // before start, the new text and the part of the last one from end on.
+    // A chunk ending right at start counts as touched, so that typing
+    // extends it instead of adding tiny chunks.
+    NodePtr before;
+    NodePtr rest;
+    NodePtr middle;
+    NodePtr after;
+    splitEndingBefore(root, start, before, rest);
+    std::size_t middleStart = bytesOf(before);
+    splitStartingBefore(rest, end - middleStart, middle, after);
+
+    std::string joined;
+    if (middle)
+    {
+        const Node *first = middle.get();
+        while (first->left)
+            first = first->left.get();
+        const Node *last = middle.get();
+        while (last->right)
+            last = last->right.get();
+        std::size_t middleEnd = middleStart + middle->bytes;
+        joined.reserve(start - middleStart + text.size() + (middleEnd - end));
+        joined.append(*first->text, 0, start - middleStart);
+        joined.append(text);
+        joined.append(*last->text, last->text->size() - (middleEnd - end), std::string::npos);
+    }
+    else
+        joined.assign(text);
+    root = merge(merge(before, build(joined)), after);
+}
+
+void TextRope::apply(std::vector<TextEdit> edits)
+{
+    // From the last edit back, so that the offsets of the others hold.
+    std::sort(edits.begin(), edits.end(), [](const TextEdit &a, const TextEdit &b) { return a.start > b.start; });
+    for (const TextEdit &edit : edits)
+        replace(edit.start, edit.end, edit.text);
+}
+
+std::size_t TextRope::size() const noexcept
+{
+    return bytesOf(root);
+}
+
+std::string TextRope::substr(std::size_t start, std::size_t length) const
+{
+    std::string result;
+    std::size_t total = size();
+    start = std::min(start, total);
+    length = std::min(length, total - start);
+    result.reserve(length);
+    // Visit only the subtrees overlapping the range.
+    std::function<void(const NodePtr &, std::size_t)> visit = [&](const NodePtr &node, std::size_t offset) {
+        if (!node || result.size() == length)
+            return;
+        std::size_t nodeStart = offset + bytesOf(node->left);
+        std::size_t nodeEnd = nodeStart + node->text->size();
+        if (start < nodeStart)
+            visit(node->left, offset);
+        if (start < nodeEnd && start + length > nodeStart)
+        {
+            std::size_t from = std::max(start, nodeStart) - nodeStart;
+            std::size_t to = std::min(start + length, nodeEnd) - nodeStart;
+            result.append(*node->text, from, to - from);
+        }
+        if (start + length > nodeEnd)
+            visit(node->right, nodeEnd);
+    };
+    visit(root, 0);
+    return result;
+}
+
+std::string TextRope::str() const
+{
+    std::string result;
+    result.reserve(size());
+    forEachChunk([&](std::string_view chunk) { result.append(chunk); });
+    return result;
+}
+
+void TextRope::forEachChunk(const std::function<void(std::string_view)> &visit) const
+{
+    std::function<void(const NodePtr &)> walk = [&](const NodePtr &node) {
+        if (!node)
+            return;
+        walk(node->left);
+        visit(*node->text);
+        walk(node->right);
+    };
+    walk(root);
+}
+
+void TextRope::forEachChunkFrom(std::size_t offset, const std::function<bool(std::string_view)> &visit) const
+{
+    // Returns false once visit has asked to stop.
+    std::function<bool(const NodePtr &, std::size_t)> walk = [&](const NodePtr &node, std::size_t base) {
+        if (!node)
+            return true;
+        std::size_t nodeStart = base + bytesOf(node->left);
+        std::size_t nodeEnd = nodeStart + node->text->size();
+        if (offset < nodeStart && !walk(node->left, base))
+            return false;
+        if (offset < nodeEnd)
+        {
+            std::string_view chunk = *node->text;
+            if (!visit(chunk.substr(std::max(offset, nodeStart) - nodeStart)))
+                return false;
+        }
+        return walk(node->right, nodeEnd);
+    };
+    walk(root, 0);
+}
+
+TextRope::NodePtr TextRope::make(const Node &from, NodePtr left, NodePtr right)
+{
+    auto node = std::make_shared<Node>();
+    node->text = from.text;
+    node->priority = from.priority;
+    node->bytes = bytesOf(left) + from.text->size() + bytesOf(right);
+    node->left = std::move(left);
+    node->right = std::move(right);
+    return node;
+}
+
+TextRope::NodePtr TextRope::build(std::string_view text)
+{
+    if (text.empty())
+        return nullptr;
+    // Chunks of even size, none larger than kChunkSize.
+    std::size_t count = (text.size() + kChunkSize - 1) / kChunkSize;
+    // Cartesian tree in one pass: the stack holds the right spine, whose
+    // sizes are filled in once it is complete.
+    std::vector<std::shared_ptr<Node>> spine;
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::size_t next = text.size() * (i + 1) / count;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        auto node = std::make_shared<Node>();
+        node->text = std::make_shared<const std::string>(text.substr(offset, next - offset));
+        node->priority = seed;
+        node->bytes = node->text->size();
+        offset = next;
+
+        std::shared_ptr<Node> last;
+        while (!spine.empty() && spine.back()->priority < node->priority)
+        {
+            last = spine.back();
+            spine.pop_back();
+            last->bytes = bytesOf(last->left) + last->text->size() + bytesOf(last->right);
+        }
+        node->left = last;
+        if (!spine.empty())
+            spine.back()->right = node;
+        spine.push_back(node);
+    }
+    for (auto it = spine.rbegin(); it != spine.rend(); ++it)
+        (*it)->bytes = bytesOf((*it)->left) + (*it)->text->size() + bytesOf((*it)->right);
+    return spine.front();
+}
+
+void TextRope::splitEndingBefore(const NodePtr &node, std::size_t offset, NodePtr &left, NodePtr &right)
+{
+    if (!node)
+    {
+        left = right = nullptr;
+        return;
+    }
+    std::size_t nodeEnd = bytesOf(node->left) + node->text->size();
+    NodePtr lower;
+    NodePtr upper;
+    if (nodeEnd < offset)
+    {
+        splitEndingBefore(node->right, offset - nodeEnd, lower, upper);
+        left = make(*node, node->left, std::move(lower));
+        right = std::move(upper);
+    }
+    else
+    {
+        splitEndingBefore(node->left, offset, lower, upper);
+        left = std::move(lower);
+        right = make(*node, std::move(upper), node->right);
+    }
+}
+
+void TextRope::splitStartingBefore(const NodePtr &node, std::size_t offset, NodePtr &left, NodePtr &right)
+{
+    if (!node)
+    {
+        left = right = nullptr;
+        return;
+    }
+    std::size_t nodeStart = bytesOf(node->left);
+    NodePtr lower;
+    NodePtr upper;
+    if (nodeStart < offset)
+    {
+        std::size_t nodeEnd = nodeStart + node->text->size();
+        splitStartingBefore(node->right, offset > nodeEnd ? offset - nodeEnd : 0, lower, upper);
+        left = make(*node, node->left, std::move(lower));
+        right = std::move(upper);
+    }
+    else
+    {
+        splitStartingBefore(node->left, offset, lower, upper);
+        left = std::move(lower);
+        right = make(*node, std::move(upper), node->right);
+    }
+}
+
+TextRope::NodePtr TextRope::merge(const NodePtr &left, const NodePtr &right)
+{
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    if (left->priority > right->priority)
+        return make(*left, left->left, merge(left->right, right));
+    return make(*right, merge(left, right->left), right->right);
+}
+
+} // namespace ck::edit
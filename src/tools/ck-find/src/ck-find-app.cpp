@@ -31,7 +31,10 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string>
@@ -57,11 +60,13 @@ using ck::find::copyToArray;
 using ck::find::bufferToString;
 using ck::find::configureSearchSpecification;
 using ck::find::executeSpecification;
+using ck::find::executeSpecifications;
 using ck::find::listSavedSpecifications;
 using ck::find::loadSpecification;
 using ck::find::makeDefaultSpecification;
 using ck::find::normaliseSpecificationName;
 using ck::find::saveSpecification;
+using ck::find::specificationSlug;
 
 class FindStatusLine : public ck::ui::CommandAwareStatusLine
 {
@@ -422,7 +427,10 @@ int main(int argc, char **argv)
     ck::hotkeys::applyCommandLineScheme(argc, argv);
 
     bool listSpecsOnly = false;
-    std::optional<std::string> searchName;
+    bool useResultCache = true;
+    bool searchAll = false;
+    std::vector<std::string> searchNames;
+    std::optional<std::filesystem::path> outputDirectory;
 
     for (int i = 1; i < argc; ++i)
     {
@@ -434,16 +442,35 @@ int main(int argc, char **argv)
                 std::fprintf(stderr, "--search requires a specification name.\n");
                 return EXIT_FAILURE;
             }
-            searchName = std::string(argv[++i]);
+            searchNames.emplace_back(argv[++i]);
+        }
+        else if (arg == "--search-all")
+        {
+            searchAll = true;
+        }
+        else if (arg == "--output-dir")
+        {
+            if (i + 1 >= argc)
+            {
+                std::fprintf(stderr, "--output-dir requires a directory.\n");
+                return EXIT_FAILURE;
+            }
+            outputDirectory = std::filesystem::path(argv[++i]);
         }
         else if (arg == "--list-specs")
         {
             listSpecsOnly = true;
         }
+        else if (arg == "--no-cache")
+        {
+            useResultCache = false;
+        }
         else if (arg == "--help" || arg == "-h")
         {
             const char *binaryName = (argc > 0 && argv[0]) ? argv[0] : "ck-find";
-            std::printf("Usage: %s [--search NAME] [--list-specs] [--hotkeys SCHEME]\n", binaryName);
+            std::printf("Usage: %s [--search NAME]... [--search-all] [--output-dir DIR] [--no-cache] [--list-specs] "
+                        "[--hotkeys SCHEME]\n",
+                        binaryName);
             return 0;
         }
     }
@@ -456,21 +483,88 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    if (searchName)
+    if (searchAll)
     {
-        auto loaded = loadSpecification(normaliseSpecificationName(*searchName));
-        if (!loaded)
+        for (const auto &saved : listSavedSpecifications())
+            searchNames.push_back(saved.name);
+        if (searchNames.empty())
         {
-            std::fprintf(stderr, "No saved specification named '%s'.\n", searchName->c_str());
+            std::fprintf(stderr, "No saved search specifications found.\n");
             return EXIT_FAILURE;
         }
+    }
+
+    if (!searchNames.empty())
+    {
+        std::vector<std::string> names;
+        std::vector<SearchSpecification> specs;
+        for (const auto &name : searchNames)
+        {
+            std::string normalised = normaliseSpecificationName(name);
+            if (std::find(names.begin(), names.end(), normalised) != names.end())
+                continue;
+            auto loaded = loadSpecification(normalised);
+            if (!loaded)
+            {
+                std::fprintf(stderr, "No saved specification named '%s'.\n", name.c_str());
+                return EXIT_FAILURE;
+            }
+            names.push_back(normalised);
+            specs.push_back(*loaded);
+        }
 
         SearchExecutionOptions options;
         options.includeActions = false;
         options.captureMatches = true;
         options.filterContent = true;
-        auto result = executeSpecification(*loaded, options, &std::cout, &std::cerr);
-        return result.exitCode;
+        options.useResultCache = useResultCache;
+
+        if (specs.size() == 1 && !outputDirectory)
+            return executeSpecification(specs.front(), options, &std::cout, &std::cerr).exitCode;
+
+        // Several specifications share one traversal. Matches go to one file
+        // per specification, or are printed as one section each.
+        std::vector<std::unique_ptr<std::ofstream>> files;
+        std::vector<std::ostream *> streams;
+        if (outputDirectory)
+        {
+            std::error_code ec;
+            std::filesystem::create_directories(*outputDirectory, ec);
+            if (ec)
+            {
+                std::fprintf(stderr, "ck-find: %s: %s\n", outputDirectory->c_str(), ec.message().c_str());
+                return EXIT_FAILURE;
+            }
+            options.captureMatches = false;
+            for (const auto &name : names)
+            {
+                std::filesystem::path target = *outputDirectory / (specificationSlug(name) + ".txt");
+                auto file = std::make_unique<std::ofstream>(target, std::ios::trunc);
+                if (!file->is_open())
+                {
+                    std::fprintf(stderr, "ck-find: unable to write %s\n", target.c_str());
+                    return EXIT_FAILURE;
+                }
+                streams.push_back(file.get());
+                files.push_back(std::move(file));
+            }
+        }
+
+        auto results = executeSpecifications(specs, options, streams, &std::cerr);
+        int exitCode = 0;
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            if (!outputDirectory)
+            {
+                std::cout << "== " << names[i] << " ==" << '\n';
+                for (const auto &match : results[i].matches)
+                    std::cout << match.string() << '\n';
+            }
+            if (results[i].exitCode != 0)
+                exitCode = results[i].exitCode;
+        }
+        std::cout.flush();
+        return exitCode;
     }
 
     FindApp app(argc, argv);
@@ -0,0 +1,268 @@
+#include "ck/find/content_detectors.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+namespace ck::find
+{
+namespace
+{
+
+using namespace std::string_view_literals;
+
+constexpr std::array<std::string_view, 38> kContentTags{{
+    "text", "binary",
+    "image", "archive", "executable", "document", "audio", "video", "database", "script",
+    "png", "jpeg", "gif", "bmp", "webp", "tiff", "ico",
+    "zip", "gzip", "bzip2", "xz", "zstd", "7z", "rar", "tar",
+    "elf", "macho", "pe",
+    "pdf", "sqlite",
+    "mp3", "flac", "ogg", "wav",
+    "mp4", "matroska", "avi",
+    "shebang",
+}};
+
+constexpr ContentTagMask tag(std::string_view name)
+{
+    for (std::size_t i = 0; i < kContentTags.size(); ++i)
+    {
+        if (kContentTags[i] == name)
+            return ContentTagMask{1} << i;
+    }
+    return 0;
+}
+
+std::uint32_t littleEndian32(std::span<const unsigned char> header, std::size_t offset)
+{
+    return static_cast<std::uint32_t>(header[offset]) | static_cast<std::uint32_t>(header[offset + 1]) << 8 |
+           static_cast<std::uint32_t>(header[offset + 2]) << 16 | static_cast<std::uint32_t>(header[offset + 3]) << 24;
+}
+
+// "BM" alone is too common a text prefix: also require the zero reserved
+// words, a known DIB header size and a pixel offset past both headers.
+bool isBitmapHeader(std::span<const unsigned char> header)
+{
+    if (header.size() < 18)
+        return false;
+    if (littleEndian32(header, 6) != 0)
+        return false;
+    std::uint32_t fileSize = littleEndian32(header, 2);
+    std::uint32_t pixelOffset = littleEndian32(header, 10);
+    std::uint32_t dibSize = littleEndian32(header, 14);
+    constexpr std::uint32_t kDibSizes[] = {12, 16, 40, 52, 56, 64, 108, 124};
+    if (std::find(std::begin(kDibSizes), std::end(kDibSizes), dibSize) == std::end(kDibSizes))
+        return false;
+    return pixelOffset >= 14 + dibSize && (fileSize == 0 || fileSize >= pixelOffset);
+}
+
+// Likewise "MZ": the DOS header's e_lfanew must point at a "PE\0\0"
+// signature within the header block.
+bool isPortableExecutableHeader(std::span<const unsigned char> header)
+{
+    if (header.size() < 0x40)
+        return false;
+    std::uint32_t peOffset = littleEndian32(header, 0x3C);
+    if (peOffset < 0x40 || peOffset > header.size() - 4)
+        return false;
+    return header[peOffset] == 'P' && header[peOffset + 1] == 'E' && header[peOffset + 2] == 0 &&
+           header[peOffset + 3] == 0;
+}
+
+struct Signature
+{
+    std::size_t offset;
+    std::string_view magic;
+    ContentTagMask tags;
+    std::size_t extraOffset = 0;
+    std::string_view extraMagic{};
+    // Structural check for magic numbers too short to trust on their own.
+    bool (*validate)(std::span<const unsigned char>) = nullptr;
+};
+
+constexpr ContentTagMask kImage = tag("image");
+constexpr ContentTagMask kArchive = tag("archive");
+constexpr ContentTagMask kExecutable = tag("executable");
+
+// Ordered roughly by how often each format shows up in real trees; every
+// matching row contributes its tags, so overlapping signatures are fine.
+constexpr std::array<Signature, 33> kSignatures{{
+    {0, "\x89PNG\r\n\x1a\n"sv, tag("png") | kImage},
+    {0, "\xFF\xD8\xFF"sv, tag("jpeg") | kImage},
+    {0, "GIF87a"sv, tag("gif") | kImage},
+    {0, "GIF89a"sv, tag("gif") | kImage},
+    {0, "BM"sv, tag("bmp") | kImage, 0, {}, isBitmapHeader},
+    {0, "RIFF"sv, tag("webp") | kImage, 8, "WEBP"sv},
+    {0, "II*\0"sv, tag("tiff") | kImage},
+    {0, "MM\0*"sv, tag("tiff") | kImage},
+    {0, "\0\0\1\0"sv, tag("ico") | kImage},
+    {0, "PK\x03\x04"sv, tag("zip") | kArchive},
+    {0, "PK\x05\x06"sv, tag("zip") | kArchive},
+    {0, "\x1F\x8B"sv, tag("gzip") | kArchive},
+    {0, "BZh"sv, tag("bzip2") | kArchive},
+    {0, "\xFD" "7zXZ\0"sv, tag("xz") | kArchive},
+    {0, "\x28\xB5\x2F\xFD"sv, tag("zstd") | kArchive},
+    {0, "7z\xBC\xAF\x27\x1C"sv, tag("7z") | kArchive},
+    {0, "Rar!\x1A\x07"sv, tag("rar") | kArchive},
+    {257, "ustar"sv, tag("tar") | kArchive},
+    {0, "\x7F" "ELF"sv, tag("elf") | kExecutable},
+    {0, "\xFE\xED\xFA\xCE"sv, tag("macho") | kExecutable},
+    {0, "\xFE\xED\xFA\xCF"sv, tag("macho") | kExecutable},
+    {0, "\xCE\xFA\xED\xFE"sv, tag("macho") | kExecutable},
+    {0, "\xCF\xFA\xED\xFE"sv, tag("macho") | kExecutable},
+    {0, "MZ"sv, tag("pe") | kExecutable, 0, {}, isPortableExecutableHeader},
+    {0, "%PDF-"sv, tag("pdf") | tag("document")},
+    {0, "SQLite format 3\0"sv, tag("sqlite") | tag("database")},
+    {0, "ID3"sv, tag("mp3") | tag("audio")},
+    {0, "fLaC"sv, tag("flac") | tag("audio")},
+    {0, "OggS"sv, tag("ogg") | tag("audio")},
+    {0, "RIFF"sv, tag("wav") | tag("audio"), 8, "WAVE"sv},
+    {4, "ftyp"sv, tag("mp4") | tag("video")},
+    {0, "\x1A\x45\xDF\xA3"sv, tag("matroska") | tag("video")},
+    {0, "RIFF"sv, tag("avi") | tag("video"), 8, "AVI "sv},
+}};
+
+static_assert(kContentTags.size() <= sizeof(ContentTagMask) * 8, "detector tags must fit the mask");
+
+bool bytesAt(std::span<const unsigned char> header, std::size_t offset, std::string_view magic)
+{
+    if (magic.empty())
+        return true;
+    if (offset > header.size() || header.size() - offset < magic.size())
+        return false;
+    return std::equal(magic.begin(), magic.end(), header.begin() + static_cast<std::ptrdiff_t>(offset),
+                      [](char expected, unsigned char actual) {
+                          return static_cast<unsigned char>(expected) == actual;
+                      });
+}
+
+#if !defined(_WIN32)
+std::int64_t modificationTimeNs(const struct stat &sb)
+{
+#if defined(__APPLE__)
+    const auto &ts = sb.st_mtimespec;
+#else
+    const auto &ts = sb.st_mtim;
+#endif
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000LL + static_cast<std::int64_t>(ts.tv_nsec);
+}
+#endif
+
+constexpr std::size_t kMaxCachedEntries = 1u << 16;
+
+} // namespace
+
+std::span<const std::string_view> knownContentTags()
+{
+    return kContentTags;
+}
+
+std::optional<ContentTagMask> contentTagMask(std::string_view name)
+{
+    std::string lowered(name);
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (lowered == "jpg")
+        lowered = "jpeg";
+    else if (lowered == "mach-o")
+        lowered = "macho";
+    else if (lowered == "mkv" || lowered == "webm")
+        lowered = "matroska";
+    ContentTagMask mask = tag(lowered);
+    if (mask == 0)
+        return std::nullopt;
+    return mask;
+}
+
+bool readContentHeader(const std::filesystem::path &path, ContentHeader &header)
+{
+    header.length = 0;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.read(reinterpret_cast<char *>(header.bytes.data()), static_cast<std::streamsize>(header.bytes.size()));
+    header.length = static_cast<std::size_t>(file.gcount());
+    return !file.bad();
+}
+
+DetectedContent classifyContentHeader(std::span<const unsigned char> header)
+{
+    DetectedContent result;
+    result.binary = std::find(header.begin(), header.end(), static_cast<unsigned char>('\0')) != header.end();
+    if (header.empty())
+        return result;
+
+    result.tags |= result.binary ? tag("binary") : tag("text");
+    for (const auto &signature : kSignatures)
+    {
+        if (bytesAt(header, signature.offset, signature.magic) &&
+            bytesAt(header, signature.extraOffset, signature.extraMagic) &&
+            (!signature.validate || signature.validate(header)))
+            result.tags |= signature.tags;
+    }
+    if (!result.binary && bytesAt(header, 0, "#!"sv))
+        result.tags |= tag("shebang") | tag("script");
+    return result;
+}
+
+std::optional<DetectedContent> ContentDetectorCache::detect(const std::filesystem::path &path)
+{
+#if !defined(_WIN32)
+    struct stat sb
+    {
+    };
+    if (::stat(path.c_str(), &sb) != 0)
+        return std::nullopt;
+
+    FileIdentity identity{static_cast<std::uintmax_t>(sb.st_dev), static_cast<std::uintmax_t>(sb.st_ino)};
+    std::int64_t mtimeNs = modificationTimeNs(sb);
+    auto size = static_cast<std::uintmax_t>(sb.st_size);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(identity);
+        if (it != m_entries.end() && it->second.mtimeNs == mtimeNs && it->second.size == size)
+            return it->second.content;
+    }
+#endif
+
+    ContentHeader header;
+    if (!readContentHeader(path, header))
+        return std::nullopt;
+    DetectedContent content = classifyContentHeader(header.view());
+
+#if !defined(_WIN32)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.size() >= kMaxCachedEntries)
+        m_entries.clear();
+    m_entries[identity] = Entry{mtimeNs, size, content};
+#endif
+    return content;
+}
+
+void ContentDetectorCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+std::size_t ContentDetectorCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+ContentDetectorCache &sharedContentDetectorCache()
+{
+    static ContentDetectorCache cache;
+    return cache;
+}
+
+} // namespace ck::find
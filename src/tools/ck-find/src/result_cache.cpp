@@ -0,0 +1,282 @@
+#include "result_cache.hpp"
+
+#include "ck/options.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <fstream>
+#include <system_error>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+namespace ck::find
+{
+namespace
+{
+
+constexpr int kCacheFormatVersion = 3;
+
+constexpr unsigned kEntryMatched = 0x1;
+constexpr unsigned kEntryDescended = 0x2;
+constexpr unsigned kEntryStamped = 0x4;
+
+std::string cacheFileName(std::uint64_t specHash)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%016llx.json", static_cast<unsigned long long>(specHash));
+    return buffer;
+}
+
+#if !defined(_WIN32)
+std::int64_t toNanoseconds(const struct timespec &ts)
+{
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000000LL + static_cast<std::int64_t>(ts.tv_nsec);
+}
+
+std::int64_t modificationTimeNs(const struct stat &sb)
+{
+#if defined(__APPLE__)
+    return toNanoseconds(sb.st_mtimespec);
+#else
+    return toNanoseconds(sb.st_mtim);
+#endif
+}
+
+std::int64_t changeTimeNs(const struct stat &sb)
+{
+#if defined(__APPLE__)
+    return toNanoseconds(sb.st_ctimespec);
+#else
+    return toNanoseconds(sb.st_ctim);
+#endif
+}
+#endif
+
+nlohmann::json toJson(const CachedDirectory &directory)
+{
+    nlohmann::json entries = nlohmann::json::array();
+    for (const auto &entry : directory.entries)
+    {
+        unsigned flags = 0;
+        if (entry.matched)
+            flags |= kEntryMatched;
+        if (entry.descended)
+            flags |= kEntryDescended;
+        if (entry.hasStamp)
+            flags |= kEntryStamped;
+        nlohmann::json row = nlohmann::json::array({entry.name, flags});
+        if (entry.hasStamp)
+        {
+            row.push_back(entry.stamp.mtimeNs);
+            row.push_back(entry.stamp.ctimeNs);
+            row.push_back(entry.stamp.size);
+            row.push_back(entry.stamp.inode);
+        }
+        entries.push_back(std::move(row));
+    }
+    return nlohmann::json{{"mtime", directory.mtimeNs}, {"entries", std::move(entries)}};
+}
+
+CachedDirectory fromJson(const nlohmann::json &j)
+{
+    CachedDirectory directory;
+    directory.mtimeNs = j.value("mtime", std::int64_t{0});
+    const auto &entries = j.at("entries");
+    directory.entries.reserve(entries.size());
+    for (const auto &row : entries)
+    {
+        CachedEntry entry;
+        entry.name = row.at(0).get<std::string>();
+        auto flags = row.at(1).get<unsigned>();
+        entry.matched = (flags & kEntryMatched) != 0;
+        entry.descended = (flags & kEntryDescended) != 0;
+        entry.hasStamp = (flags & kEntryStamped) != 0 && row.size() >= 6;
+        if (entry.hasStamp)
+        {
+            entry.stamp.mtimeNs = row.at(2).get<std::int64_t>();
+            entry.stamp.ctimeNs = row.at(3).get<std::int64_t>();
+            entry.stamp.size = row.at(4).get<std::uintmax_t>();
+            entry.stamp.inode = row.at(5).get<std::uintmax_t>();
+        }
+        directory.entries.push_back(std::move(entry));
+    }
+    return directory;
+}
+
+} // namespace
+
+const CachedEntry *CachedDirectory::find(std::string_view name) const
+{
+    if (m_byName.size() != entries.size())
+    {
+        m_byName.resize(entries.size());
+        std::iota(m_byName.begin(), m_byName.end(), 0u);
+        std::sort(m_byName.begin(), m_byName.end(), [this](std::uint32_t a, std::uint32_t b) {
+            return entries[a].name < entries[b].name;
+        });
+    }
+    auto it = std::lower_bound(m_byName.begin(), m_byName.end(), name, [this](std::uint32_t index, std::string_view key) {
+        return entries[index].name < key;
+    });
+    if (it == m_byName.end() || entries[*it].name != name)
+        return nullptr;
+    return &entries[*it];
+}
+
+std::uint64_t hashCacheKey(std::string_view canonical)
+{
+    // FNV-1a: stable across platforms and standard library versions, unlike
+    // std::hash, so cache files survive rebuilds.
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char ch : canonical)
+    {
+        hash ^= ch;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::filesystem::path defaultResultCacheDirectory()
+{
+    std::filesystem::path base = ck::config::OptionRegistry::configRoot();
+    base /= "ck-find";
+    base /= "cache";
+    return base;
+}
+
+std::optional<ResultCache> loadResultCache(const std::filesystem::path &directory, std::uint64_t specHash)
+{
+    std::ifstream stream(directory / cacheFileName(specHash));
+    if (!stream.is_open())
+        return std::nullopt;
+    try
+    {
+        nlohmann::json j;
+        stream >> j;
+        if (j.value("version", 0) != kCacheFormatVersion || j.value("specHash", std::uint64_t{0}) != specHash)
+            return std::nullopt;
+        ResultCache cache;
+        cache.specHash = specHash;
+        for (const auto &[root, directories] : j.at("roots").items())
+        {
+            CachedRoot &cachedRoot = cache.roots[root];
+            for (const auto &[path, value] : directories.items())
+                cachedRoot.directories.emplace(path, fromJson(value));
+        }
+        return cache;
+    }
+    catch (...)
+    {
+        return std::nullopt;
+    }
+}
+
+bool storeResultCache(const std::filesystem::path &directory, const ResultCache &cache)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+        return false;
+
+    std::string payload;
+    try
+    {
+        nlohmann::json j;
+        j["version"] = kCacheFormatVersion;
+        j["specHash"] = cache.specHash;
+        nlohmann::json roots = nlohmann::json::object();
+        for (const auto &[root, cachedRoot] : cache.roots)
+        {
+            nlohmann::json directories = nlohmann::json::object();
+            for (const auto &[path, record] : cachedRoot.directories)
+                directories[path] = toJson(record);
+            roots[root] = std::move(directories);
+        }
+        j["roots"] = std::move(roots);
+        payload = j.dump();
+    }
+    catch (...)
+    {
+        // Non UTF-8 file names cannot round-trip through JSON; skip caching
+        // rather than storing mangled names.
+        return false;
+    }
+
+    std::filesystem::path target = directory / cacheFileName(cache.specHash);
+    std::filesystem::path temp = target;
+    temp += ".tmp";
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        if (!stream.is_open())
+            return false;
+        stream << payload;
+        if (!stream.good())
+            return false;
+    }
+    std::filesystem::rename(temp, target, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+std::optional<std::int64_t> directoryModificationTime(const std::filesystem::path &path)
+{
+#if !defined(_WIN32)
+    struct stat sb
+    {
+    };
+    if (::stat(path.c_str(), &sb) != 0)
+        return std::nullopt;
+    return modificationTimeNs(sb);
+#else
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return std::nullopt;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+#endif
+}
+
+std::optional<CachedEntryStamp> entryStamp(const std::filesystem::path &path)
+{
+#if !defined(_WIN32)
+    struct stat sb
+    {
+    };
+    if (::stat(path.c_str(), &sb) != 0)
+        return std::nullopt;
+    CachedEntryStamp stamp;
+    stamp.mtimeNs = modificationTimeNs(sb);
+    stamp.ctimeNs = changeTimeNs(sb);
+    stamp.size = static_cast<std::uintmax_t>(sb.st_size);
+    stamp.inode = static_cast<std::uintmax_t>(sb.st_ino);
+    return stamp;
+#else
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return std::nullopt;
+    CachedEntryStamp stamp;
+    stamp.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    stamp.ctimeNs = stamp.mtimeNs;
+    stamp.size = std::filesystem::is_regular_file(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    return stamp;
+#endif
+}
+
+std::int64_t racyTimestampThreshold()
+{
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now - std::chrono::seconds(2)).count();
+}
+
+} // namespace ck::find
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ck::find
+{
+
+// Everything about a directory entry that can change without its parent
+// directory's mtime changing (content rewrites, chmod, retargeted links).
+struct CachedEntryStamp
+{
+    std::int64_t mtimeNs = 0;
+    std::int64_t ctimeNs = 0;
+    std::uintmax_t size = 0;
+    std::uintmax_t inode = 0;
+
+    bool operator==(const CachedEntryStamp &) const noexcept = default;
+};
+
+struct CachedEntry
+{
+    std::string name;
+    bool matched = false;
+    bool descended = false;
+    bool hasStamp = false;
+    CachedEntryStamp stamp{};
+};
+
+struct CachedDirectory
+{
+    // Zero marks a directory that must be rescanned on the next run, either
+    // because its listing failed or its mtime was too recent to trust.
+    std::int64_t mtimeNs = 0;
+    std::vector<CachedEntry> entries;
+
+    // Looks up an entry by name in O(log n); the name index is built on the
+    // first lookup, so `entries` must not change afterwards.
+    const CachedEntry *find(std::string_view name) const;
+
+private:
+    mutable std::vector<std::uint32_t> m_byName;
+};
+
+// Directories are recorded per search root so that overlapping roots of one
+// specification (e.g. "/src;/src/lib") keep independent listings.
+struct CachedRoot
+{
+    std::unordered_map<std::string, CachedDirectory> directories;
+};
+
+struct ResultCache
+{
+    std::uint64_t specHash = 0;
+    std::unordered_map<std::string, CachedRoot> roots;
+};
+
+std::uint64_t hashCacheKey(std::string_view canonical);
+
+std::filesystem::path defaultResultCacheDirectory();
+std::optional<ResultCache> loadResultCache(const std::filesystem::path &directory, std::uint64_t specHash);
+bool storeResultCache(const std::filesystem::path &directory, const ResultCache &cache);
+
+std::optional<std::int64_t> directoryModificationTime(const std::filesystem::path &path);
+std::optional<CachedEntryStamp> entryStamp(const std::filesystem::path &path);
+
+// Timestamps at or after this point are too close to "now" to prove that
+// nothing changed within the same filesystem tick.
+std::int64_t racyTimestampThreshold();
+
+} // namespace ck::find
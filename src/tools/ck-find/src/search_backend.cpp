@@ -1,8 +1,11 @@
 #include "ck/find/search_backend.hpp"
 
 #include "ck/find/cli_buffer_utils.hpp"
+#include "ck/find/content_detectors.hpp"
 #include "ck/options.hpp"
 
+#include "result_cache.hpp"
+
 #include <nlohmann/json.hpp>
 
 #include <algorithm>
@@ -10,18 +13,27 @@
 #include <cctype>
 #include <chrono>
 #include <cstdio>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <regex>
 #include <initializer_list>
 
+#if !defined(_WIN32)
+#include <cerrno>
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
 namespace ck::find
 {
 namespace
@@ -119,9 +131,9 @@ nlohmann::json toJson(const TextSearchOptions &options);
 nlohmann::json toJson(const NamePathOptions &options);
 nlohmann::json toJson(const TimeFilterOptions &options);
 
-bool matchContains(const std::string &haystack, const std::vector<std::string> &needles, bool caseInsensitive);
-bool matchWholeWord(const std::string &haystack, const std::vector<std::string> &needles, bool caseInsensitive);
-bool matchRegex(const std::string &haystack, const std::string &pattern, bool caseInsensitive);
+bool matchContains(std::string_view haystack, const std::vector<std::string> &needles, bool caseInsensitive);
+bool matchWholeWord(std::string_view haystack, const std::vector<std::string> &needles, bool caseInsensitive);
+bool matchRegex(std::string_view haystack, const std::string &pattern, bool caseInsensitive);
 nlohmann::json toJson(const SizeFilterOptions &options);
 nlohmann::json toJson(const TypeFilterOptions &options);
 nlohmann::json toJson(const PermissionOwnershipOptions &options);
@@ -858,7 +870,64 @@ std::string wildcardToRegex(const std::string &pattern)
     return regex;
 }
 
-std::optional<std::regex> compileWildcardPattern(const std::string &pattern, bool caseInsensitive)
+// Shell-style pattern where only '*' and '?' are special. Names are matched
+// directly so the traversal never enters std::regex for plain globs; the
+// compiled regex is kept for the rare name containing a line break, which
+// '.' in the equivalent regex refuses to match.
+struct WildcardPattern
+{
+    std::string glob;
+    bool caseInsensitive = false;
+    std::regex fallback;
+
+    bool matches(std::string_view text) const;
+};
+
+bool sameCharacter(char a, char b, bool caseInsensitive)
+{
+    if (a == b)
+        return true;
+    return caseInsensitive &&
+           std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+}
+
+bool WildcardPattern::matches(std::string_view text) const
+{
+    if (text.find_first_of("\n\r") != std::string_view::npos)
+        return std::regex_match(text.begin(), text.end(), fallback);
+
+    std::size_t p = 0;
+    std::size_t t = 0;
+    std::size_t starP = std::string::npos;
+    std::size_t starT = 0;
+    while (t < text.size())
+    {
+        if (p < glob.size() && glob[p] == '*')
+        {
+            starP = p++;
+            starT = t;
+        }
+        else if (p < glob.size() && (glob[p] == '?' || sameCharacter(glob[p], text[t], caseInsensitive)))
+        {
+            ++p;
+            ++t;
+        }
+        else if (starP != std::string::npos)
+        {
+            p = starP + 1;
+            t = ++starT;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < glob.size() && glob[p] == '*')
+        ++p;
+    return p == glob.size();
+}
+
+std::optional<WildcardPattern> compileWildcardPattern(const std::string &pattern, bool caseInsensitive)
 {
     std::string trimmed = trimCopy(pattern);
     if (trimmed.empty())
@@ -869,7 +938,7 @@ std::optional<std::regex> compileWildcardPattern(const std::string &pattern, boo
         flags = static_cast<std::regex::flag_type>(flags | std::regex::icase);
     try
     {
-        return std::regex(regexPattern, flags);
+        return WildcardPattern{trimmed, caseInsensitive, std::regex(regexPattern, flags)};
     }
     catch (...)
     {
@@ -895,25 +964,31 @@ std::optional<std::regex> compileRegexPattern(const std::string &pattern, bool c
     }
 }
 
-bool matchesAnyRegex(const std::string &value, const std::vector<std::regex> &patterns)
+bool matchesAnyWildcard(std::string_view value, const std::vector<WildcardPattern> &patterns)
 {
-    if (patterns.empty())
-        return false;
     for (const auto &pattern : patterns)
     {
-        if (std::regex_match(value, pattern))
+        if (pattern.matches(value))
             return true;
     }
     return false;
 }
 
-bool regexSearchAny(const std::string &value, const std::vector<std::regex> &patterns)
+bool matchesAnyRegex(std::string_view value, const std::vector<std::regex> &patterns)
 {
-    if (patterns.empty())
-        return false;
     for (const auto &pattern : patterns)
     {
-        if (std::regex_search(value, pattern))
+        if (std::regex_match(value.begin(), value.end(), pattern))
+            return true;
+    }
+    return false;
+}
+
+bool regexSearchAny(std::string_view value, const std::vector<std::regex> &patterns)
+{
+    for (const auto &pattern : patterns)
+    {
+        if (std::regex_search(value.begin(), value.end(), pattern))
             return true;
     }
     return false;
@@ -962,18 +1037,18 @@ struct PreparedSpecification
     bool followSymlinks = false;
     bool stayOnSameFilesystem = false;
 
-    std::vector<std::regex> includePatterns;
-    std::vector<std::regex> excludePatterns;
+    std::vector<WildcardPattern> includePatterns;
+    std::vector<WildcardPattern> excludePatterns;
 
     bool nameTestsEnabled = false;
-    std::vector<std::regex> namePatterns;
-    std::vector<std::regex> inamePatterns;
-    std::vector<std::regex> pathPatterns;
-    std::vector<std::regex> ipathPatterns;
+    std::vector<WildcardPattern> namePatterns;
+    std::vector<WildcardPattern> inamePatterns;
+    std::vector<WildcardPattern> pathPatterns;
+    std::vector<WildcardPattern> ipathPatterns;
     std::vector<std::regex> regexPatterns;
     std::vector<std::regex> iregexPatterns;
-    std::vector<std::regex> lnamePatterns;
-    std::vector<std::regex> ilnamePatterns;
+    std::vector<WildcardPattern> lnamePatterns;
+    std::vector<WildcardPattern> ilnamePatterns;
 
     struct PruneInfo
     {
@@ -986,6 +1061,7 @@ struct PreparedSpecification
         } mode = Mode::None;
         bool enabled = false;
         bool directoriesOnly = true;
+        std::vector<WildcardPattern> wildcards;
         std::vector<std::regex> patterns;
     } prune;
 
@@ -1015,7 +1091,10 @@ struct PreparedSpecification
     bool xtypeEnabled = false;
     std::vector<char> xtypeLetters;
     bool extensionFilterEnabled = false;
-    std::vector<std::regex> extensionPatterns;
+    std::vector<WildcardPattern> extensionPatterns;
+    bool detectorFilterEnabled = false;
+    ContentTagMask detectorMask = 0;
+    std::vector<std::string> unknownDetectorTags;
 
     bool traversalFiltersEnabled = false;
     bool maxDepthEnabled = false;
@@ -1031,19 +1110,21 @@ struct PreparedSpecification
     bool hasUnsupportedPermissionFilters = false;
 };
 
-template <std::size_t N>
-void appendPatternIfPresent(std::vector<std::regex> &target,
+template <typename Pattern, std::size_t N>
+void appendPatternIfPresent(std::vector<Pattern> &target,
                             const std::array<char, N> &buffer,
-                            bool caseInsensitive,
-                            bool treatAsRegex)
+                            bool caseInsensitive)
 {
     if (buffer[0] == '\0')
         return;
     auto value = arrayToString(buffer);
-    auto pattern = treatAsRegex ? compileRegexPattern(value, caseInsensitive)
-                                : compileWildcardPattern(value, caseInsensitive);
+    std::optional<Pattern> pattern;
+    if constexpr (std::is_same_v<Pattern, std::regex>)
+        pattern = compileRegexPattern(value, caseInsensitive);
+    else
+        pattern = compileWildcardPattern(value, caseInsensitive);
     if (pattern)
-        target.push_back(*pattern);
+        target.push_back(std::move(*pattern));
 }
 
 std::vector<char> parseTypeLetters(const std::string &value)
@@ -1132,25 +1213,25 @@ PreparedSpecification prepareSpecification(const SearchSpecification &spec)
     auto includePatterns = splitExtensions(arrayToString(spec.includePatterns));
     for (const auto &pattern : includePatterns)
         if (auto compiled = compileWildcardPattern(pattern, false))
-            prepared.includePatterns.push_back(*compiled);
+            prepared.includePatterns.push_back(std::move(*compiled));
 
     auto excludePatterns = splitExtensions(arrayToString(spec.excludePatterns));
     for (const auto &pattern : excludePatterns)
         if (auto compiled = compileWildcardPattern(pattern, false))
-            prepared.excludePatterns.push_back(*compiled);
+            prepared.excludePatterns.push_back(std::move(*compiled));
 
     prepared.nameTestsEnabled = spec.enableNamePathTests;
     if (prepared.nameTestsEnabled)
     {
         const auto &np = spec.namePathOptions;
-        appendPatternIfPresent(prepared.namePatterns, np.namePattern, false, false);
-        appendPatternIfPresent(prepared.inamePatterns, np.inamePattern, true, false);
-        appendPatternIfPresent(prepared.pathPatterns, np.pathPattern, false, false);
-        appendPatternIfPresent(prepared.ipathPatterns, np.ipathPattern, true, false);
-        appendPatternIfPresent(prepared.regexPatterns, np.regexPattern, false, true);
-        appendPatternIfPresent(prepared.iregexPatterns, np.iregexPattern, true, true);
-        appendPatternIfPresent(prepared.lnamePatterns, np.lnamePattern, false, false);
-        appendPatternIfPresent(prepared.ilnamePatterns, np.ilnamePattern, true, false);
+        appendPatternIfPresent(prepared.namePatterns, np.namePattern, false);
+        appendPatternIfPresent(prepared.inamePatterns, np.inamePattern, true);
+        appendPatternIfPresent(prepared.pathPatterns, np.pathPattern, false);
+        appendPatternIfPresent(prepared.ipathPatterns, np.ipathPattern, true);
+        appendPatternIfPresent(prepared.regexPatterns, np.regexPattern, false);
+        appendPatternIfPresent(prepared.iregexPatterns, np.iregexPattern, true);
+        appendPatternIfPresent(prepared.lnamePatterns, np.lnamePattern, false);
+        appendPatternIfPresent(prepared.ilnamePatterns, np.ilnamePattern, true);
 
         if (np.pruneEnabled && np.prunePattern[0] != '\0')
         {
@@ -1161,23 +1242,23 @@ PreparedSpecification prepareSpecification(const SearchSpecification &spec)
             {
             case NamePathOptions::PruneTest::Name:
                 prepared.prune.mode = PreparedSpecification::PruneInfo::Mode::Name;
-                if (auto re = compileWildcardPattern(pruneValue, false))
-                    prepared.prune.patterns.push_back(*re);
+                if (auto glob = compileWildcardPattern(pruneValue, false))
+                    prepared.prune.wildcards.push_back(std::move(*glob));
                 break;
             case NamePathOptions::PruneTest::Iname:
                 prepared.prune.mode = PreparedSpecification::PruneInfo::Mode::Name;
-                if (auto re = compileWildcardPattern(pruneValue, true))
-                    prepared.prune.patterns.push_back(*re);
+                if (auto glob = compileWildcardPattern(pruneValue, true))
+                    prepared.prune.wildcards.push_back(std::move(*glob));
                 break;
             case NamePathOptions::PruneTest::Path:
                 prepared.prune.mode = PreparedSpecification::PruneInfo::Mode::Path;
-                if (auto re = compileWildcardPattern(pruneValue, false))
-                    prepared.prune.patterns.push_back(*re);
+                if (auto glob = compileWildcardPattern(pruneValue, false))
+                    prepared.prune.wildcards.push_back(std::move(*glob));
                 break;
             case NamePathOptions::PruneTest::Ipath:
                 prepared.prune.mode = PreparedSpecification::PruneInfo::Mode::Path;
-                if (auto re = compileWildcardPattern(pruneValue, true))
-                    prepared.prune.patterns.push_back(*re);
+                if (auto glob = compileWildcardPattern(pruneValue, true))
+                    prepared.prune.wildcards.push_back(std::move(*glob));
                 break;
             case NamePathOptions::PruneTest::Regex:
                 prepared.prune.mode = PreparedSpecification::PruneInfo::Mode::Regex;
@@ -1190,7 +1271,7 @@ PreparedSpecification prepareSpecification(const SearchSpecification &spec)
                     prepared.prune.patterns.push_back(*re);
                 break;
             }
-            if (prepared.prune.patterns.empty())
+            if (prepared.prune.patterns.empty() && prepared.prune.wildcards.empty())
                 prepared.prune.enabled = false;
         }
     }
@@ -1267,11 +1348,22 @@ PreparedSpecification prepareSpecification(const SearchSpecification &spec)
                         pattern = "*." + pattern;
                 }
                 if (auto compiled = compileWildcardPattern(pattern, type.extensionCaseInsensitive))
-                    prepared.extensionPatterns.push_back(*compiled);
+                    prepared.extensionPatterns.push_back(std::move(*compiled));
             }
             if (prepared.extensionPatterns.empty())
                 prepared.extensionFilterEnabled = false;
         }
+        if (type.useDetectors && type.detectorTags[0] != '\0')
+        {
+            for (const auto &name : splitExtensions(arrayToString(type.detectorTags)))
+            {
+                if (auto mask = contentTagMask(name))
+                    prepared.detectorMask |= *mask;
+                else
+                    prepared.unknownDetectorTags.push_back(name);
+            }
+            prepared.detectorFilterEnabled = prepared.detectorMask != 0;
+        }
     }
 
     prepared.traversalFiltersEnabled = spec.enableTraversalFilters;
@@ -1321,36 +1413,32 @@ PreparedSpecification prepareSpecification(const SearchSpecification &spec)
     return prepared;
 }
 
-bool matchesIncludeExclude(const PreparedSpecification &prepared, const std::string &name)
+bool matchesIncludeExclude(const PreparedSpecification &prepared, std::string_view name)
 {
-    if (!prepared.includePatterns.empty() && !matchesAnyRegex(name, prepared.includePatterns))
+    if (!prepared.includePatterns.empty() && !matchesAnyWildcard(name, prepared.includePatterns))
         return false;
-    if (!prepared.excludePatterns.empty() && matchesAnyRegex(name, prepared.excludePatterns))
+    if (!prepared.excludePatterns.empty() && matchesAnyWildcard(name, prepared.excludePatterns))
         return false;
     return true;
 }
 
-bool matchesNameFilters(const PreparedSpecification &prepared,
-                        const std::filesystem::path &path,
-                        const std::string &name,
-                        const std::string &relativePath)
+bool matchesNameFilters(const PreparedSpecification &prepared, std::string_view name, std::string_view pathString)
 {
     if (!prepared.nameTestsEnabled)
         return true;
 
-    if (!prepared.namePatterns.empty() && !matchesAnyRegex(name, prepared.namePatterns))
+    if (!prepared.namePatterns.empty() && !matchesAnyWildcard(name, prepared.namePatterns))
         return false;
-    if (!prepared.inamePatterns.empty() && !matchesAnyRegex(name, prepared.inamePatterns))
+    if (!prepared.inamePatterns.empty() && !matchesAnyWildcard(name, prepared.inamePatterns))
         return false;
-    if (!prepared.lnamePatterns.empty() && !matchesAnyRegex(name, prepared.lnamePatterns))
+    if (!prepared.lnamePatterns.empty() && !matchesAnyWildcard(name, prepared.lnamePatterns))
         return false;
-    if (!prepared.ilnamePatterns.empty() && !matchesAnyRegex(name, prepared.ilnamePatterns))
+    if (!prepared.ilnamePatterns.empty() && !matchesAnyWildcard(name, prepared.ilnamePatterns))
         return false;
 
-    std::string pathString = relativePath.empty() ? pathToComparableString(path) : relativePath;
-    if (!prepared.pathPatterns.empty() && !matchesAnyRegex(pathString, prepared.pathPatterns))
+    if (!prepared.pathPatterns.empty() && !matchesAnyWildcard(pathString, prepared.pathPatterns))
         return false;
-    if (!prepared.ipathPatterns.empty() && !matchesAnyRegex(pathString, prepared.ipathPatterns))
+    if (!prepared.ipathPatterns.empty() && !matchesAnyWildcard(pathString, prepared.ipathPatterns))
         return false;
     if (!prepared.regexPatterns.empty() && !matchesAnyRegex(pathString, prepared.regexPatterns))
         return false;
@@ -1360,7 +1448,7 @@ bool matchesNameFilters(const PreparedSpecification &prepared,
     return true;
 }
 
-bool matchesTextInName(const PreparedSpecification &prepared, const std::string &name)
+bool matchesTextInName(const PreparedSpecification &prepared, std::string_view name)
 {
     if (!prepared.textSearchEnabled || !prepared.textSearchNames || prepared.textTerms.empty())
         return true;
@@ -1368,7 +1456,7 @@ bool matchesTextInName(const PreparedSpecification &prepared, const std::string
     switch (prepared.textOptions.mode)
     {
     case TextSearchOptions::Mode::RegularExpression:
-        return matchRegex(name, prepared.rawSearchText, !prepared.textOptions.matchCase);
+        return prepared.textRegex && std::regex_search(name.begin(), name.end(), *prepared.textRegex);
     case TextSearchOptions::Mode::WholeWord:
         return matchWholeWord(name, prepared.textTerms, !prepared.textOptions.matchCase);
     case TextSearchOptions::Mode::Contains:
@@ -1377,13 +1465,210 @@ bool matchesTextInName(const PreparedSpecification &prepared, const std::string
     }
 }
 
-bool matchesExtensionFilters(const PreparedSpecification &prepared, const std::string &name)
+bool matchesExtensionFilters(const PreparedSpecification &prepared, std::string_view name)
 {
     if (!prepared.extensionFilterEnabled || prepared.extensionPatterns.empty())
         return true;
-    return matchesAnyRegex(name, prepared.extensionPatterns);
+    return matchesAnyWildcard(name, prepared.extensionPatterns);
 }
 
+// The entry under test. Entries found by the traversal refer to the walker's
+// reusable path buffer and stat the file only when a filter asks for it, so
+// testing them does not allocate; entries from anywhere else wrap a
+// std::filesystem::directory_entry. The accessors mirror directory_entry.
+class WalkEntry
+{
+public:
+    explicit WalkEntry(const std::filesystem::directory_entry &entry)
+        : m_entry(&entry)
+    {
+    }
+
+#if !defined(_WIN32)
+    // `path` must stay unchanged while the entry is in use; `direntType` is
+    // the d_type reported by readdir().
+    WalkEntry(const std::string &path, unsigned char direntType)
+        : m_native(&path),
+          m_direntType(direntType)
+    {
+    }
+#endif
+
+    // Allocates; used for reporting matches and reading contents only.
+    std::filesystem::path path() const
+    {
+        if (m_entry)
+            return m_entry->path();
+        return std::filesystem::path(*m_native);
+    }
+
+    std::filesystem::file_status symlink_status(std::error_code &ec) const
+    {
+        if (m_entry)
+            return m_entry->symlink_status(ec);
+#if defined(_WIN32)
+        return {};
+#else
+        if (!m_haveLstat)
+        {
+            m_lstatError = ::lstat(m_native->c_str(), &m_lstat) == 0 ? 0 : errno;
+            m_haveLstat = true;
+        }
+        return toStatus(m_lstat, m_lstatError, ec);
+#endif
+    }
+
+    std::filesystem::file_status status(std::error_code &ec) const
+    {
+        if (m_entry)
+            return m_entry->status(ec);
+#if defined(_WIN32)
+        return {};
+#else
+        if (!m_haveStat)
+        {
+            symlink_status(ec);
+            if (m_lstatError == 0 && !S_ISLNK(m_lstat.st_mode))
+            {
+                m_stat = m_lstat;
+                m_statError = 0;
+            }
+            else
+            {
+                m_statError = ::stat(m_native->c_str(), &m_stat) == 0 ? 0 : errno;
+            }
+            m_haveStat = true;
+        }
+        return toStatus(m_stat, m_statError, ec);
+#endif
+    }
+
+    bool is_regular_file(std::error_code &ec) const
+    {
+        if (m_entry)
+            return m_entry->is_regular_file(ec);
+        return followedType(ec) == std::filesystem::file_type::regular;
+    }
+
+    bool is_directory(std::error_code &ec) const
+    {
+        if (m_entry)
+            return m_entry->is_directory(ec);
+        return followedType(ec) == std::filesystem::file_type::directory;
+    }
+
+    bool is_symlink(std::error_code &ec) const
+    {
+        if (m_entry)
+            return m_entry->is_symlink(ec);
+#if !defined(_WIN32)
+        ec.clear();
+        if (m_direntType != DT_UNKNOWN)
+            return m_direntType == DT_LNK;
+#endif
+        return symlink_status(ec).type() == std::filesystem::file_type::symlink;
+    }
+
+    std::uintmax_t file_size(std::error_code &ec) const
+    {
+        if (m_entry)
+            return m_entry->file_size(ec);
+#if defined(_WIN32)
+        return 0;
+#else
+        auto type = status(ec).type();
+        if (ec)
+            return static_cast<std::uintmax_t>(-1);
+        if (type == std::filesystem::file_type::regular)
+            return static_cast<std::uintmax_t>(m_stat.st_size);
+        ec = std::make_error_code(type == std::filesystem::file_type::directory ? std::errc::is_a_directory
+                                                                                 : std::errc::not_supported);
+        return static_cast<std::uintmax_t>(-1);
+#endif
+    }
+
+    std::chrono::system_clock::time_point modificationTime(std::error_code &ec) const
+    {
+        if (m_entry)
+        {
+            auto fileTime = m_entry->last_write_time(ec);
+            auto fileClockNow = decltype(fileTime)::clock::now();
+            return std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+                std::chrono::system_clock::now() + (fileTime - fileClockNow));
+        }
+#if defined(_WIN32)
+        return {};
+#else
+        status(ec);
+        if (ec)
+            return {};
+#if defined(__APPLE__)
+        const auto &ts = m_stat.st_mtimespec;
+#else
+        const auto &ts = m_stat.st_mtim;
+#endif
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+#endif
+    }
+
+private:
+    const std::filesystem::directory_entry *m_entry = nullptr;
+
+#if defined(_WIN32)
+    std::filesystem::file_type followedType(std::error_code &ec) const { return status(ec).type(); }
+#else
+    const std::string *m_native = nullptr;
+    unsigned char m_direntType = DT_UNKNOWN;
+    mutable struct stat m_lstat {};
+    mutable struct stat m_stat {};
+    mutable int m_lstatError = 0;
+    mutable int m_statError = 0;
+    mutable bool m_haveLstat = false;
+    mutable bool m_haveStat = false;
+
+    // Regular files and directories are known from readdir() alone; links
+    // and unknown types need a stat.
+    std::filesystem::file_type followedType(std::error_code &ec) const
+    {
+        ec.clear();
+        if (m_direntType == DT_REG)
+            return std::filesystem::file_type::regular;
+        if (m_direntType == DT_DIR)
+            return std::filesystem::file_type::directory;
+        return status(ec).type();
+    }
+
+    static std::filesystem::file_status toStatus(const struct stat &sb, int error, std::error_code &ec)
+    {
+        using std::filesystem::file_type;
+        if (error != 0)
+        {
+            ec.assign(error, std::generic_category());
+            return std::filesystem::file_status(error == ENOENT || error == ENOTDIR ? file_type::not_found
+                                                                                   : file_type::none);
+        }
+        ec.clear();
+        file_type type = file_type::unknown;
+        if (S_ISREG(sb.st_mode))
+            type = file_type::regular;
+        else if (S_ISDIR(sb.st_mode))
+            type = file_type::directory;
+        else if (S_ISLNK(sb.st_mode))
+            type = file_type::symlink;
+        else if (S_ISBLK(sb.st_mode))
+            type = file_type::block;
+        else if (S_ISCHR(sb.st_mode))
+            type = file_type::character;
+        else if (S_ISFIFO(sb.st_mode))
+            type = file_type::fifo;
+        else if (S_ISSOCK(sb.st_mode))
+            type = file_type::socket;
+        return std::filesystem::file_status(type, static_cast<std::filesystem::perms>(sb.st_mode & 07777));
+    }
+#endif
+};
+
 char fileTypeLetter(const std::filesystem::file_status &status)
 {
     using std::filesystem::file_type;
@@ -1410,7 +1695,9 @@ char fileTypeLetter(const std::filesystem::file_status &status)
     }
 }
 
-bool matchesTypeFilters(const PreparedSpecification &prepared, const std::filesystem::directory_entry &entry)
+bool matchesTypeFilters(const PreparedSpecification &prepared,
+                        const WalkEntry &entry,
+                        std::string_view name)
 {
     if (!prepared.typeFiltersEnabled)
         return true;
@@ -1436,13 +1723,13 @@ bool matchesTypeFilters(const PreparedSpecification &prepared, const std::filesy
             return false;
     }
 
-    if (!matchesExtensionFilters(prepared, entry.path().filename().string()))
+    if (!matchesExtensionFilters(prepared, name))
         return false;
 
     return true;
 }
 
-bool matchesSizeFilters(const PreparedSpecification &prepared, const std::filesystem::directory_entry &entry)
+bool matchesSizeFilters(const PreparedSpecification &prepared, const WalkEntry &entry)
 {
     if (!prepared.sizeFiltersEnabled)
         return true;
@@ -1524,7 +1811,7 @@ std::optional<std::filesystem::perms> parsePermissionBits(const std::string &spe
     }
 }
 
-bool matchesPermissionFilters(const PreparedSpecification &prepared, const std::filesystem::directory_entry &entry)
+bool matchesPermissionFilters(const PreparedSpecification &prepared, const WalkEntry &entry)
 {
     if (!prepared.permissionFiltersEnabled)
         return true;
@@ -1614,7 +1901,7 @@ int presetDays(TimeFilterOptions::Preset preset)
     }
 }
 
-bool matchesTimeFilters(const PreparedSpecification &prepared, const std::filesystem::directory_entry &entry)
+bool matchesTimeFilters(const PreparedSpecification &prepared, const WalkEntry &entry)
 {
     if (!prepared.timeFiltersEnabled)
         return true;
@@ -1625,14 +1912,11 @@ bool matchesTimeFilters(const PreparedSpecification &prepared, const std::filesy
         return true;
 
     std::error_code ec;
-    auto fileTime = entry.last_write_time(ec);
+    auto systemTime = entry.modificationTime(ec);
     if (ec)
         return false;
 
-    auto fileClockNow = decltype(fileTime)::clock::now();
     auto now = std::chrono::system_clock::now();
-    auto systemTime = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-        now + (fileTime - fileClockNow));
     auto threshold = now - std::chrono::hours(24 * days);
 
     bool considerModified = options.includeModified || (!options.includeCreated && !options.includeAccessed);
@@ -1643,10 +1927,26 @@ bool matchesTimeFilters(const PreparedSpecification &prepared, const std::filesy
     return systemTime >= threshold;
 }
 
+bool matchesDetectorFilters(const PreparedSpecification &prepared,
+                            const WalkEntry &entry,
+                            std::optional<DetectedContent> &detected)
+{
+    if (!prepared.detectorFilterEnabled)
+        return true;
+
+    std::error_code ec;
+    if (!entry.is_regular_file(ec) || ec)
+        return false;
+    detected = sharedContentDetectorCache().detect(entry.path());
+    if (!detected)
+        return false;
+    return (detected->tags & prepared.detectorMask) != 0;
+}
+
 bool shouldPruneEntry(const PreparedSpecification &prepared,
-                      const std::filesystem::directory_entry &entry,
-                      const std::string &name,
-                      const std::string &relativePath)
+                      const WalkEntry &entry,
+                      std::string_view name,
+                      std::string_view relativePath)
 {
     if (!prepared.prune.enabled)
         return false;
@@ -1660,9 +1960,9 @@ bool shouldPruneEntry(const PreparedSpecification &prepared,
     switch (prepared.prune.mode)
     {
     case PreparedSpecification::PruneInfo::Mode::Name:
-        return matchesAnyRegex(name, prepared.prune.patterns);
+        return matchesAnyWildcard(name, prepared.prune.wildcards);
     case PreparedSpecification::PruneInfo::Mode::Path:
-        return matchesAnyRegex(relativePath, prepared.prune.patterns);
+        return matchesAnyWildcard(relativePath, prepared.prune.wildcards);
     case PreparedSpecification::PruneInfo::Mode::Regex:
         return regexSearchAny(relativePath, prepared.prune.patterns);
     case PreparedSpecification::PruneInfo::Mode::None:
@@ -2073,8 +2373,6 @@ void addTraversalExpressions(std::vector<std::string> &args,
                              const TraversalFilesystemOptions &options,
                              bool includeSubdirectories)
 {
-    applySymlinkMode(options, args);
-
     switch (options.warningMode)
     {
     case TraversalFilesystemOptions::WarningMode::ForceWarn:
@@ -2223,61 +2521,45 @@ std::vector<std::string> buildTextNameExpressions(const SearchSpecification &spe
     return tests;
 }
 
-bool isBinaryFile(const std::filesystem::path &path)
-{
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open())
-        return false;
-    constexpr std::size_t kSample = 1024;
-    std::array<char, kSample> buffer{};
-    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-    std::streamsize count = file.gcount();
-    for (std::streamsize i = 0; i < count; ++i)
-    {
-        if (buffer[static_cast<std::size_t>(i)] == '\0')
-            return true;
-    }
-    return false;
-}
-
-bool matchContains(const std::string &haystack, const std::vector<std::string> &needles, bool caseInsensitive)
+bool matchContains(std::string_view haystack, const std::vector<std::string> &needles, bool caseInsensitive)
 {
-    auto toLower = [](std::string value) {
-        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-        return value;
-    };
-    std::string target = caseInsensitive ? toLower(haystack) : haystack;
     for (const auto &needle : needles)
     {
-        std::string n = caseInsensitive ? toLower(needle) : needle;
-        if (target.find(n) == std::string::npos)
+        auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                              [caseInsensitive](char a, char b) { return sameCharacter(a, b, caseInsensitive); });
+        if (it == haystack.end() && !needle.empty())
             return false;
     }
     return true;
 }
 
-bool matchWholeWord(const std::string &haystack, const std::vector<std::string> &needles, bool caseInsensitive)
+bool matchWholeWord(std::string_view haystack, const std::vector<std::string> &needles, bool caseInsensitive)
 {
-    std::istringstream stream(haystack);
-    std::vector<std::string> words;
-    std::string word;
-    while (stream >> word)
-    {
-        if (caseInsensitive)
-            std::transform(word.begin(), word.end(), word.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-        words.push_back(word);
-    }
-    for (auto needle : needles)
+    auto isSpace = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    for (const auto &needle : needles)
     {
-        if (caseInsensitive)
-            std::transform(needle.begin(), needle.end(), needle.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-        if (std::find(words.begin(), words.end(), needle) == words.end())
+        bool found = false;
+        std::size_t pos = 0;
+        while (!found && pos < haystack.size())
+        {
+            while (pos < haystack.size() && isSpace(haystack[pos]))
+                ++pos;
+            std::size_t end = pos;
+            while (end < haystack.size() && !isSpace(haystack[end]))
+                ++end;
+            std::string_view word = haystack.substr(pos, end - pos);
+            found = !word.empty() && word.size() == needle.size() &&
+                    std::equal(word.begin(), word.end(), needle.begin(),
+                               [caseInsensitive](char a, char b) { return sameCharacter(a, b, caseInsensitive); });
+            pos = end;
+        }
+        if (!found)
             return false;
     }
     return true;
 }
 
-bool matchRegex(const std::string &haystack, const std::string &pattern, bool caseInsensitive)
+bool matchRegex(std::string_view haystack, const std::string &pattern, bool caseInsensitive)
 {
     try
     {
@@ -2285,7 +2567,7 @@ bool matchRegex(const std::string &haystack, const std::string &pattern, bool ca
         if (caseInsensitive)
             flags = static_cast<std::regex::flag_type>(flags | std::regex::icase);
         std::regex re(pattern, flags);
-        return std::regex_search(haystack, re);
+        return std::regex_search(haystack.begin(), haystack.end(), re);
     }
     catch (...)
     {
@@ -2296,10 +2578,17 @@ bool matchRegex(const std::string &haystack, const std::string &pattern, bool ca
 bool fileMatchesContent(const std::filesystem::path &path,
                         const TextSearchOptions &options,
                         const std::vector<std::string> &terms,
-                        const std::string &rawPattern)
+                        const std::string &rawPattern,
+                        std::optional<DetectedContent> &detected)
 {
-    if (!options.treatBinaryAsText && isBinaryFile(path))
-        return false;
+    if (!options.treatBinaryAsText)
+    {
+        // Reuse the header block already classified by the detector filter.
+        if (!detected)
+            detected = sharedContentDetectorCache().detect(path);
+        if (!detected || detected->binary)
+            return false;
+    }
 
     std::ifstream file(path, std::ios::binary);
     if (!file.is_open())
@@ -2321,6 +2610,703 @@ bool fileMatchesContent(const std::filesystem::path &path,
     }
 }
 
+// The name and root-relative path of the entry under test. For entries below
+// a root both views point into the directory_entry's own path, so testing an
+// entry does not allocate.
+struct EntryNames
+{
+    std::string_view name;
+    std::string_view relative;
+    bool hidden = false;
+};
+
+// Owned names of a search root, computed once per root.
+struct RootNames
+{
+    std::string name;
+    std::string relative;
+    bool hidden = false;
+    // Offset of the first child name within a child's native path.
+    std::size_t childOffset = 0;
+
+    explicit RootNames(const std::filesystem::path &root)
+        : name(root.filename().string()),
+          relative(relativePathString(root, root)),
+          hidden(isHiddenPath(root))
+    {
+        if (name.empty())
+            name = root.string();
+        if (relative.empty())
+            relative = pathToComparableString(root);
+#if defined(_WIN32)
+        std::string base = root.generic_string();
+        constexpr char separator = '/';
+#else
+        const std::string &base = root.native();
+        constexpr char separator = std::filesystem::path::preferred_separator;
+#endif
+        childOffset = base.size();
+        if (base.empty() || base.back() != separator)
+            ++childOffset;
+    }
+
+    EntryNames view() const { return EntryNames{name, relative, false}; }
+};
+
+// Describes a child of `root` from its full path string: the native path on
+// POSIX, the generic form elsewhere. The views point into `full`.
+EntryNames childNames(std::string_view full, const RootNames &root)
+{
+#if defined(_WIN32)
+    constexpr char separator = '/';
+#else
+    constexpr char separator = std::filesystem::path::preferred_separator;
+#endif
+    EntryNames names;
+    std::size_t slash = full.find_last_of(separator);
+    names.name = slash == std::string_view::npos ? full : full.substr(slash + 1);
+    names.relative = root.childOffset < full.size() ? full.substr(root.childOffset) : names.name;
+    // Hidden directories are never descended into unless hidden entries are
+    // wanted, so only the root and the entry's own name need checking.
+    names.hidden = root.hidden || (!names.name.empty() && names.name.front() == '.');
+    return names;
+}
+
+// Describes a child of `root` without allocating on POSIX; elsewhere the
+// generic form is rebuilt in `scratch`, which keeps its capacity.
+EntryNames childNames(const std::filesystem::path &path, const RootNames &root, std::string &scratch)
+{
+#if defined(_WIN32)
+    scratch = path.generic_string();
+    return childNames(std::string_view(scratch), root);
+#else
+    (void)scratch;
+    return childNames(std::string_view(path.native()), root);
+#endif
+}
+
+bool entryMatchesSpecification(const PreparedSpecification &prepared,
+                               bool filterContent,
+                               const WalkEntry &entry,
+                               const EntryNames &names,
+                               int depth,
+                               bool isRoot)
+{
+    if (!prepared.includeHidden && !isRoot && names.hidden)
+        return false;
+
+    if (!matchesIncludeExclude(prepared, names.name))
+        return false;
+
+    if (!matchesNameFilters(prepared, names.name, names.relative))
+        return false;
+
+    if (!withinDepthLimits(prepared, depth))
+        return false;
+
+    if (!matchesTextInName(prepared, names.name))
+        return false;
+
+    if (!matchesTypeFilters(prepared, entry, names.name))
+        return false;
+
+    if (!matchesSizeFilters(prepared, entry))
+        return false;
+
+    if (!matchesPermissionFilters(prepared, entry))
+        return false;
+
+    if (!matchesTimeFilters(prepared, entry))
+        return false;
+
+    // Detectors read a header block, so they run only once every
+    // metadata test has passed.
+    std::optional<DetectedContent> detected;
+    if (!matchesDetectorFilters(prepared, entry, detected))
+        return false;
+
+    if (prepared.textSearchEnabled && prepared.textSearchContents && filterContent)
+    {
+        std::error_code ec;
+        if (!entry.is_regular_file(ec) || ec)
+            return false;
+        if (!fileMatchesContent(entry.path(), prepared.textOptions, prepared.textTerms, prepared.rawSearchText, detected))
+            return false;
+    }
+
+    return true;
+}
+
+bool resultCacheSupported(const PreparedSpecification &prepared)
+{
+    // Relative time presets move with the clock, so a match can expire
+    // without anything on disk changing.
+    return !(prepared.timeFiltersEnabled && presetDays(prepared.timeOptions.preset) > 0);
+}
+
+bool dependsOnEntryState(const PreparedSpecification &prepared, bool filterContent)
+{
+    return (prepared.textSearchEnabled && prepared.textSearchContents && filterContent) ||
+           prepared.sizeFiltersEnabled || prepared.permissionFiltersEnabled || prepared.detectorFilterEnabled ||
+           (prepared.typeFiltersEnabled && prepared.xtypeEnabled);
+}
+
+std::filesystem::path normaliseRoot(const std::filesystem::path &root)
+{
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(root, ec);
+    if (ec)
+        absolute = root;
+    std::filesystem::path normal = absolute.lexically_normal();
+    if (!normal.has_filename() && normal.has_relative_path())
+        normal = normal.parent_path();
+    return normal;
+}
+
+std::uint64_t specificationCacheHash(const SearchSpecification &spec, bool filterContent)
+{
+    nlohmann::json j = toJson(spec);
+    // Neither the name nor the action list changes which paths match.
+    j.erase("specName");
+    j.erase("enableActionOptions");
+    j.erase("actionOptions");
+    // "dir", "dir/" and "./dir" name the same tree.
+    std::string roots;
+    for (const auto &start : parseStartLocations(spec))
+    {
+        roots += normaliseRoot(start).generic_string();
+        roots += ';';
+    }
+    j["startLocation"] = roots;
+    std::string canonical = j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    canonical += filterContent ? "|content" : "|names";
+    return hashCacheKey(canonical);
+}
+
+void reportPreparationWarnings(const PreparedSpecification &prepared, std::ostream *forwardStderr)
+{
+    if (!forwardStderr)
+        return;
+    if (prepared.hasUnsupportedPermissionFilters)
+        (*forwardStderr) << "ck-find: owner/group permission filters are not yet supported in the builtin engine.\n";
+    for (const auto &tag : prepared.unknownDetectorTags)
+        (*forwardStderr) << "ck-find: unknown detector tag '" << tag << "' ignored.\n";
+}
+
+bool isStrictlyUnder(const std::filesystem::path &candidate, const std::filesystem::path &ancestor)
+{
+    auto [ancestorIt, candidateIt] = std::mismatch(ancestor.begin(), ancestor.end(), candidate.begin(), candidate.end());
+    return ancestorIt == ancestor.end() && candidateIt != candidate.end();
+}
+
+// Walks one directory level at a time for any number of prepared
+// specifications. Every directory is listed once; each entry is then
+// tested against every specification that is still active at that point,
+// so prune, hidden and depth rules stay per specification. Roots nested
+// inside another root are attached when the walk reaches them.
+//
+// With a single specification the walker can also use a result cache:
+// directories whose mtime is unchanged are replayed from the previous run
+// instead of being listed again.
+class SpecificationWalker
+{
+public:
+    using MatchCallback = std::function<void(const std::filesystem::path &)>;
+    using ErrorCallback = std::function<void(const std::filesystem::path &, const std::error_code &)>;
+
+    SpecificationWalker(bool filterContent, ErrorCallback onError)
+        : m_filterContent(filterContent),
+          m_onError(std::move(onError))
+    {
+    }
+
+    std::size_t addTarget(const PreparedSpecification &prepared, MatchCallback onMatch)
+    {
+        m_targets.push_back(Target{&prepared, std::move(onMatch), false});
+        return m_targets.size() - 1;
+    }
+
+    // Requires exactly one target; roots are then walked one by one so each
+    // root owns its own cache section.
+    void enableResultCache(const ResultCache *previous, ResultCache *next)
+    {
+        m_previous = previous;
+        m_next = next;
+        m_recordStamps = next && !m_targets.empty() && dependsOnEntryState(*m_targets.front().prepared, m_filterContent);
+        m_racyThreshold = racyTimestampThreshold();
+    }
+
+    void run()
+    {
+        if (m_next)
+        {
+            for (const auto &start : m_targets.front().prepared->roots)
+                walkCachedRoot(start);
+            return;
+        }
+
+        std::vector<RootAssignment> assignments;
+        for (std::size_t t = 0; t < m_targets.size(); ++t)
+        {
+            for (const auto &root : m_targets[t].prepared->roots)
+                assignments.push_back(RootAssignment{t, root, normaliseRoot(root), false});
+        }
+
+        for (std::size_t i = 0; i < assignments.size(); ++i)
+        {
+            if (assignments[i].consumed)
+                continue;
+            bool nested = std::any_of(assignments.begin(), assignments.end(), [&](const RootAssignment &other) {
+                return !other.consumed && isStrictlyUnder(assignments[i].normal, other.normal);
+            });
+            if (nested)
+                continue;
+            walkGroup(assignments, assignments[i].normal, assignments[i].root);
+        }
+
+        // Nested roots that the shared walk never reached (e.g. behind an
+        // unfollowed symlink) are walked on their own.
+        for (auto &assignment : assignments)
+        {
+            if (!assignment.consumed)
+                walkGroup(assignments, assignment.normal, assignment.root);
+        }
+    }
+
+    bool targetHadError(std::size_t target) const { return m_targets[target].hadError; }
+    std::size_t directoriesScanned() const { return m_scanned; }
+    std::size_t directoriesReused() const { return m_reused; }
+
+private:
+    struct Target
+    {
+        const PreparedSpecification *prepared = nullptr;
+        MatchCallback onMatch;
+        bool hadError = false;
+    };
+
+    struct RootAssignment
+    {
+        std::size_t target = 0;
+        std::filesystem::path root;
+        std::filesystem::path normal;
+        bool consumed = false;
+    };
+
+    struct Active
+    {
+        std::size_t target = 0;
+        int depth = 1;
+        const RootNames *root = nullptr;
+    };
+
+    // Scratch lists for one directory level, reused across siblings and
+    // across runs so that steady-state traversal does not allocate.
+    struct Frame
+    {
+        std::vector<Active> actives;
+        std::vector<RootAssignment *> pending;
+    };
+
+    bool m_filterContent = true;
+    ErrorCallback m_onError;
+    std::vector<Target> m_targets;
+    const ResultCache *m_previous = nullptr;
+    ResultCache *m_next = nullptr;
+    bool m_recordStamps = false;
+    std::int64_t m_racyThreshold = 0;
+    std::size_t m_scanned = 0;
+    std::size_t m_reused = 0;
+    std::deque<RootNames> m_roots;
+    std::deque<Frame> m_frames;
+    std::string m_scratch;
+#if !defined(_WIN32)
+    // Path of the entry being visited; see walkDirectory().
+    std::string m_path;
+#endif
+
+    bool isRacy(std::int64_t timestamp) const { return timestamp >= m_racyThreshold; }
+
+    void reportError(const std::filesystem::path &path, const std::error_code &ec, const std::vector<Active> &affected)
+    {
+        m_onError(path, ec);
+        for (const auto &active : affected)
+            m_targets[active.target].hadError = true;
+    }
+
+    static bool shouldDescend(const PreparedSpecification &prepared, const WalkEntry &entry)
+    {
+        if (!prepared.includeSubdirectories)
+            return false;
+        std::error_code ec;
+        if (!entry.is_directory(ec) || ec)
+            return false;
+        if (prepared.followSymlinks)
+            return true;
+        return !entry.is_symlink(ec) || ec;
+    }
+
+    static bool skippedByTraversal(const PreparedSpecification &prepared,
+                                   const WalkEntry &entry,
+                                   const EntryNames &names,
+                                   int depth)
+    {
+        if (prepared.maxDepthEnabled && depth > prepared.maxDepth)
+            return true;
+        if (shouldPruneEntry(prepared, entry, names.name, names.relative))
+            return true;
+        return !prepared.includeHidden && names.hidden;
+    }
+
+    Frame &frameAt(std::size_t level)
+    {
+        while (m_frames.size() <= level)
+            m_frames.emplace_back();
+        return m_frames[level];
+    }
+
+    // Evaluates a root entry for one target and returns the root's names
+    // when the walk should continue below it for that target.
+    const RootNames *startRoot(std::size_t target, const WalkEntry &entry)
+    {
+        const RootNames &root = m_roots.emplace_back(entry.path());
+        const auto &prepared = *m_targets[target].prepared;
+        if (entryMatchesSpecification(prepared, m_filterContent, entry, root.view(), 0, true))
+            m_targets[target].onMatch(entry.path());
+        std::error_code ec;
+        if (!entry.is_directory(ec) || ec)
+            return nullptr;
+        return &root;
+    }
+
+    void walkGroup(std::vector<RootAssignment> &assignments,
+                   const std::filesystem::path &normal,
+                   const std::filesystem::path &walkPath)
+    {
+        std::vector<Active> actives;
+        std::vector<RootAssignment *> pending;
+        std::optional<std::filesystem::directory_entry> rootEntry;
+        for (auto &assignment : assignments)
+        {
+            if (assignment.consumed)
+                continue;
+            if (assignment.normal == normal)
+            {
+                assignment.consumed = true;
+                if (!rootEntry)
+                {
+                    std::error_code ec;
+                    rootEntry.emplace(walkPath, ec);
+                    if (ec)
+                    {
+                        m_onError(walkPath, ec);
+                        m_targets[assignment.target].hadError = true;
+                        rootEntry.reset();
+                        continue;
+                    }
+                }
+                if (const RootNames *root = startRoot(assignment.target, WalkEntry(*rootEntry)))
+                    actives.push_back(Active{assignment.target, 1, root});
+            }
+            else if (isStrictlyUnder(assignment.normal, normal))
+            {
+                pending.push_back(&assignment);
+            }
+        }
+        if (rootEntry && (!actives.empty() || !pending.empty()))
+        {
+            std::error_code ec;
+            if (rootEntry->is_directory(ec) && !ec)
+            {
+#if defined(_WIN32)
+                walkDirectory(rootEntry->path(), normal, actives, pending, 0);
+#else
+                m_path = rootEntry->path().native();
+                walkDirectory(normal, actives, pending, 0);
+#endif
+            }
+        }
+    }
+
+    // Tests one listed entry against every active specification and the
+    // pending nested roots. Fills the level's frame and returns true when
+    // the walk should descend into the entry; `full` is the entry's path in
+    // the form childNames() expects.
+    bool visitEntry(const WalkEntry &entry,
+                    std::string_view full,
+                    std::string_view name,
+                    const std::filesystem::path &normal,
+                    const std::vector<Active> &actives,
+                    const std::vector<RootAssignment *> &pending,
+                    Frame &frame,
+                    std::filesystem::path &childNormal)
+    {
+        frame.actives.clear();
+        frame.pending.clear();
+
+        for (const auto &active : actives)
+        {
+            const auto &prepared = *m_targets[active.target].prepared;
+            EntryNames names = childNames(full, *active.root);
+            if (skippedByTraversal(prepared, entry, names, active.depth))
+                continue;
+            if (entryMatchesSpecification(prepared, m_filterContent, entry, names, active.depth, false))
+                m_targets[active.target].onMatch(entry.path());
+            if (shouldDescend(prepared, entry))
+                frame.actives.push_back(Active{active.target, active.depth + 1, active.root});
+        }
+
+        if (!pending.empty())
+        {
+            childNormal = normal / std::filesystem::path(name);
+            for (auto *assignment : pending)
+            {
+                if (assignment->consumed)
+                    continue;
+                if (assignment->normal == childNormal)
+                {
+                    assignment->consumed = true;
+                    if (const RootNames *root = startRoot(assignment->target, entry))
+                        frame.actives.push_back(Active{assignment->target, 1, root});
+                }
+                else if (isStrictlyUnder(assignment->normal, childNormal))
+                {
+                    frame.pending.push_back(assignment);
+                }
+            }
+            if (!frame.pending.empty())
+            {
+                std::error_code dirEc;
+                if (!entry.is_directory(dirEc) || dirEc)
+                    frame.pending.clear();
+            }
+        }
+
+        return !frame.actives.empty() || !frame.pending.empty();
+    }
+
+#if defined(_WIN32)
+    void walkDirectory(const std::filesystem::path &directory,
+                       const std::filesystem::path &normal,
+                       const std::vector<Active> &actives,
+                       const std::vector<RootAssignment *> &pending,
+                       std::size_t level)
+    {
+        ++m_scanned;
+        std::filesystem::directory_options opts = std::filesystem::directory_options::skip_permission_denied;
+
+        Frame &frame = frameAt(level);
+        std::error_code ec;
+        std::filesystem::directory_iterator it(directory, opts, ec);
+        std::filesystem::directory_iterator end;
+        for (; !ec && it != end; it.increment(ec))
+        {
+            const auto &entry = *it;
+            m_scratch = entry.path().generic_string();
+            std::string_view full = m_scratch;
+            std::string_view name = full.substr(full.find_last_of('/') + 1);
+            std::filesystem::path childNormal;
+            if (visitEntry(WalkEntry(entry), full, name, normal, actives, pending, frame, childNormal))
+                walkDirectory(entry.path(), childNormal, frame.actives, frame.pending, level + 1);
+        }
+
+        if (ec)
+            reportError(directory, ec, actives);
+    }
+#else
+    // Lists the directory whose path is in m_path. Each child's name is
+    // appended to that buffer and cut off again afterwards, so one string
+    // serves every depth and listing an entry does not build a path.
+    void walkDirectory(const std::filesystem::path &normal,
+                       const std::vector<Active> &actives,
+                       const std::vector<RootAssignment *> &pending,
+                       std::size_t level)
+    {
+        ++m_scanned;
+        Frame &frame = frameAt(level);
+
+        DIR *dir = ::opendir(m_path.c_str());
+        if (!dir)
+        {
+            int error = errno;
+            // Matches directory_options::skip_permission_denied.
+            if (error != EACCES)
+                reportError(m_path, std::error_code(error, std::generic_category()), actives);
+            return;
+        }
+
+        const std::size_t base = m_path.size();
+        if (m_path.empty() || m_path.back() != '/')
+            m_path.push_back('/');
+        const std::size_t nameOffset = m_path.size();
+
+        int error = 0;
+        for (;;)
+        {
+            errno = 0;
+            const dirent *child = ::readdir(dir);
+            if (!child)
+            {
+                error = errno;
+                break;
+            }
+            std::string_view name(child->d_name);
+            if (name == "." || name == "..")
+                continue;
+
+            m_path.resize(nameOffset);
+            m_path.append(name);
+            WalkEntry entry(m_path, child->d_type);
+            std::filesystem::path childNormal;
+            if (visitEntry(entry, m_path, name, normal, actives, pending, frame, childNormal))
+                walkDirectory(childNormal, frame.actives, frame.pending, level + 1);
+        }
+        ::closedir(dir);
+
+        m_path.resize(base);
+        if (error != 0)
+            reportError(m_path, std::error_code(error, std::generic_category()), actives);
+    }
+#endif
+
+    // Directories are keyed relative to their root so that the cache does
+    // not depend on how the root was spelled.
+    static std::string directoryKey(const std::filesystem::path &directory, const RootNames &root)
+    {
+        std::string full = directory.generic_string();
+        return root.childOffset < full.size() ? full.substr(root.childOffset) : std::string();
+    }
+
+    void walkCachedRoot(const std::filesystem::path &start)
+    {
+        std::error_code ec;
+        std::filesystem::directory_entry entry(start, ec);
+        if (ec)
+        {
+            m_onError(start, ec);
+            m_targets.front().hadError = true;
+            return;
+        }
+
+        const RootNames *root = startRoot(0, WalkEntry(entry));
+        if (!root)
+            return;
+
+        std::string rootKey = normaliseRoot(entry.path()).generic_string();
+        const CachedRoot *previous = nullptr;
+        if (m_previous)
+        {
+            auto it = m_previous->roots.find(rootKey);
+            if (it != m_previous->roots.end())
+                previous = &it->second;
+        }
+        walkCachedDirectory(entry.path(), *root, 1, previous, m_next->roots[rootKey]);
+    }
+
+    bool evaluateChild(const std::filesystem::directory_entry &entry,
+                       const EntryNames &names,
+                       int depth,
+                       const CachedEntry *previous,
+                       CachedEntry &record)
+    {
+        if (m_recordStamps)
+        {
+            if (auto stamp = entryStamp(entry.path()))
+            {
+                record.stamp = *stamp;
+                record.hasStamp = !isRacy(stamp->mtimeNs) && !isRacy(stamp->ctimeNs);
+                if (previous && previous->hasStamp && previous->stamp == *stamp)
+                    return previous->matched;
+            }
+        }
+        return entryMatchesSpecification(*m_targets.front().prepared, m_filterContent, WalkEntry(entry), names, depth,
+                                         false);
+    }
+
+    void walkCachedDirectory(const std::filesystem::path &directory,
+                             const RootNames &root,
+                             int depth,
+                             const CachedRoot *previousRoot,
+                             CachedRoot &nextRoot)
+    {
+        const auto &prepared = *m_targets.front().prepared;
+        const auto &onMatch = m_targets.front().onMatch;
+        std::string key = directoryKey(directory, root);
+        const CachedDirectory *previous = nullptr;
+        if (previousRoot)
+        {
+            auto it = previousRoot->directories.find(key);
+            if (it != previousRoot->directories.end())
+                previous = &it->second;
+        }
+        std::optional<std::int64_t> mtime = directoryModificationTime(directory);
+        CachedDirectory &record = nextRoot.directories[key];
+        record.mtimeNs = (mtime && !isRacy(*mtime)) ? *mtime : 0;
+        record.entries.clear();
+
+        if (previous && mtime && previous->mtimeNs != 0 && previous->mtimeNs == *mtime)
+        {
+            ++m_reused;
+            for (const auto &cached : previous->entries)
+            {
+                std::filesystem::path path = directory / cached.name;
+                CachedEntry child = cached;
+                if (m_recordStamps)
+                {
+                    auto stamp = entryStamp(path);
+                    if (!stamp || !cached.hasStamp || !(*stamp == cached.stamp))
+                    {
+                        std::error_code ec;
+                        std::filesystem::directory_entry entry(path, ec);
+                        if (ec)
+                            continue;
+                        child.hasStamp = false;
+                        EntryNames names = childNames(entry.path(), root, m_scratch);
+                        child.matched = evaluateChild(entry, names, depth, nullptr, child);
+                    }
+                }
+                if (child.matched)
+                    onMatch(path);
+                record.entries.push_back(child);
+                if (child.descended)
+                    walkCachedDirectory(path, root, depth + 1, previousRoot, nextRoot);
+            }
+            return;
+        }
+
+        ++m_scanned;
+        std::error_code ec;
+        std::filesystem::directory_iterator it(directory, std::filesystem::directory_options::skip_permission_denied, ec);
+        std::filesystem::directory_iterator end;
+        for (; !ec && it != end; it.increment(ec))
+        {
+            const auto &entry = *it;
+            WalkEntry walkEntry(entry);
+            EntryNames names = childNames(entry.path(), root, m_scratch);
+            if (skippedByTraversal(prepared, walkEntry, names, depth))
+                continue;
+
+            CachedEntry child;
+            child.name = std::string(names.name);
+            child.matched = evaluateChild(entry, names, depth, previous ? previous->find(child.name) : nullptr, child);
+            if (child.matched)
+                onMatch(entry.path());
+            child.descended = shouldDescend(prepared, walkEntry);
+            if (child.matched || child.descended || m_recordStamps)
+                record.entries.push_back(child);
+            if (child.descended)
+                walkCachedDirectory(entry.path(), root, depth + 1, previousRoot, nextRoot);
+        }
+
+        if (ec)
+        {
+            m_onError(directory, ec);
+            m_targets.front().hadError = true;
+            record.mtimeNs = 0;
+        }
+    }
+};
+
 } // namespace
 
 std::filesystem::path specificationStorageDirectory()
@@ -2434,6 +3420,9 @@ std::vector<std::string> buildFindCommand(const SearchSpecification &spec, bool
 {
     std::vector<std::string> args;
     args.emplace_back("find");
+    // -H/-L/-P are options, not expressions: find only accepts them ahead of
+    // the start locations.
+    applySymlinkMode(spec.traversalOptions, args);
 
     auto startLocations = parseStartLocations(spec);
     args.insert(args.end(), startLocations.begin(), startLocations.end());
@@ -2543,170 +3532,106 @@ SearchExecutionResult executeSpecification(const SearchSpecification &spec,
     result.exitCode = 0;
 
     PreparedSpecification prepared = prepareSpecification(execSpec);
+    reportPreparationWarnings(prepared, forwardStderr);
 
-    if (prepared.hasUnsupportedPermissionFilters && forwardStderr)
-        (*forwardStderr) << "ck-find: owner/group permission filters are not yet supported in the builtin engine.\n";
+    auto handleError = [&](const std::filesystem::path &path, const std::error_code &ec) {
+        if (forwardStderr)
+            (*forwardStderr) << "ck-find: " << path << ": " << ec.message() << '\n';
+    };
 
-    auto recordMatch = [&](const std::filesystem::path &path) {
+    SpecificationWalker walker(options.filterContent, handleError);
+    walker.addTarget(prepared, [&](const std::filesystem::path &path) {
         if (options.captureMatches)
             result.matches.push_back(path);
         if (forwardStdout)
             (*forwardStdout) << path.string() << '\n';
-    };
-
-    auto evaluateEntry = [&](const std::filesystem::directory_entry &entry,
-                             const std::filesystem::path &root,
-                             int depth,
-                             bool isRoot) {
-        if (!prepared.includeHidden && !isRoot && isHiddenPath(entry.path()))
-            return;
-
-        std::string name = entry.path().filename().string();
-        if (name.empty())
-            name = entry.path().string();
-        if (!matchesIncludeExclude(prepared, name))
-            return;
-
-        std::string relative = relativePathString(root, entry.path());
-
-        if (!matchesNameFilters(prepared, entry.path(), name, relative))
-            return;
+    });
 
-        if (!withinDepthLimits(prepared, depth))
-            return;
+    bool useCache = options.useResultCache && resultCacheSupported(prepared);
+    std::filesystem::path cacheDirectory = options.resultCacheDirectory.empty() ? defaultResultCacheDirectory()
+                                                                                : options.resultCacheDirectory;
+    std::optional<ResultCache> previousCache;
+    ResultCache nextCache;
+    if (useCache)
+    {
+        nextCache.specHash = specificationCacheHash(execSpec, options.filterContent);
+        previousCache = loadResultCache(cacheDirectory, nextCache.specHash);
+        walker.enableResultCache(previousCache ? &*previousCache : nullptr, &nextCache);
+    }
 
-        if (!matchesTextInName(prepared, name))
-            return;
+    walker.run();
 
-        if (!matchesTypeFilters(prepared, entry))
-            return;
+    if (useCache)
+        storeResultCache(cacheDirectory, nextCache);
 
-        if (!matchesSizeFilters(prepared, entry))
-            return;
+    result.directoriesScanned = walker.directoriesScanned();
+    result.directoriesReused = walker.directoriesReused();
 
-        if (!matchesPermissionFilters(prepared, entry))
-            return;
+    if (forwardStdout)
+        forwardStdout->flush();
 
-        if (!matchesTimeFilters(prepared, entry))
-            return;
+    if (walker.targetHadError(0))
+        result.exitCode = 1;
 
-        if (prepared.textSearchEnabled && prepared.textSearchContents && options.filterContent)
-        {
-            std::error_code ec;
-            if (!entry.is_regular_file(ec) || ec)
-                return;
-            if (!fileMatchesContent(entry.path(), prepared.textOptions, prepared.textTerms, prepared.rawSearchText))
-                return;
-        }
+    return result;
+}
 
-        recordMatch(entry.path());
-    };
+std::vector<SearchExecutionResult> executeSpecifications(const std::vector<SearchSpecification> &specs,
+                                                         const SearchExecutionOptions &options,
+                                                         const std::vector<std::ostream *> &forwardStdout,
+                                                         std::ostream *forwardStderr)
+{
+    std::vector<SearchExecutionResult> results(specs.size());
+    std::vector<PreparedSpecification> prepared;
+    prepared.reserve(specs.size());
+    for (std::size_t i = 0; i < specs.size(); ++i)
+    {
+        SearchSpecification execSpec = specs[i];
+        if (!options.includeActions)
+            execSpec.enableActionOptions = false;
+        results[i].command = buildFindCommand(execSpec, options.includeActions);
+        results[i].exitCode = 0;
+        prepared.push_back(prepareSpecification(execSpec));
+        reportPreparationWarnings(prepared.back(), forwardStderr);
+    }
 
-    bool hadError = false;
+    // A failing listing is reported once even when several specifications
+    // were walking it; every affected result still gets a non-zero exit code.
     auto handleError = [&](const std::filesystem::path &path, const std::error_code &ec) {
         if (forwardStderr)
             (*forwardStderr) << "ck-find: " << path << ": " << ec.message() << '\n';
-        hadError = true;
-    };
-
-    auto traverseDirectory = [&](const std::filesystem::directory_entry &dirEntry,
-                                 const std::filesystem::path &root) {
-        std::filesystem::directory_options opts = std::filesystem::directory_options::skip_permission_denied;
-        if (prepared.followSymlinks)
-            opts |= std::filesystem::directory_options::follow_directory_symlink;
-
-        if (prepared.includeSubdirectories)
-        {
-            std::error_code ec;
-            std::filesystem::recursive_directory_iterator it(dirEntry.path(), opts, ec);
-            if (ec)
-            {
-                handleError(dirEntry.path(), ec);
-                return;
-            }
-            std::filesystem::recursive_directory_iterator end;
-            for (; it != end; ++it)
-            {
-                const auto &entry = *it;
-                int depth = it.depth() + 1;
-                std::string name = entry.path().filename().string();
-                std::string relative = relativePathString(root, entry.path());
-
-                if (prepared.maxDepthEnabled && depth > prepared.maxDepth)
-                {
-                    it.disable_recursion_pending();
-                    continue;
-                }
-
-                if (shouldPruneEntry(prepared, entry, name, relative))
-                {
-                    it.disable_recursion_pending();
-                    continue;
-                }
-
-                bool entryHidden = !prepared.includeHidden && isHiddenPath(entry.path());
-                if (entryHidden)
-                {
-                    std::error_code hiddenEc;
-                    if (entry.is_directory(hiddenEc) && !hiddenEc)
-                        it.disable_recursion_pending();
-                    continue;
-                }
-
-                evaluateEntry(entry, root, depth, false);
-            }
-        }
-        else
-        {
-            std::error_code ec;
-            std::filesystem::directory_iterator it(dirEntry.path(), opts, ec);
-            if (ec)
-            {
-                handleError(dirEntry.path(), ec);
-                return;
-            }
-            std::filesystem::directory_iterator end;
-            for (; it != end; ++it)
-            {
-                const auto &entry = *it;
-                std::string name = entry.path().filename().string();
-                std::string relative = relativePathString(root, entry.path());
-
-                if (shouldPruneEntry(prepared, entry, name, relative))
-                    continue;
-
-                if (!prepared.includeHidden && isHiddenPath(entry.path()))
-                    continue;
-
-                evaluateEntry(entry, root, 1, false);
-            }
-        }
     };
 
-    for (const auto &start : prepared.roots)
+    SpecificationWalker walker(options.filterContent, handleError);
+    for (std::size_t i = 0; i < specs.size(); ++i)
     {
-        std::error_code ec;
-        std::filesystem::directory_entry entry(start, ec);
-        if (ec)
-        {
-            handleError(start, ec);
-            continue;
-        }
+        std::ostream *out = i < forwardStdout.size() ? forwardStdout[i] : nullptr;
+        walker.addTarget(prepared[i], [&results, &options, out, i](const std::filesystem::path &path) {
+            if (options.captureMatches)
+                results[i].matches.push_back(path);
+            if (out)
+                (*out) << path.string() << '\n';
+        });
+    }
 
-        evaluateEntry(entry, entry.path(), 0, true);
+    walker.run();
 
-        ec.clear();
-        if (entry.is_directory(ec) && !ec)
-            traverseDirectory(entry, entry.path());
+    for (std::size_t i = 0; i < specs.size(); ++i)
+    {
+        if (i < forwardStdout.size() && forwardStdout[i])
+            forwardStdout[i]->flush();
+        if (walker.targetHadError(i))
+            results[i].exitCode = 1;
+        // The shared walk cannot attribute listings to one specification.
+        results[i].directoriesScanned = walker.directoriesScanned();
     }
 
-    if (forwardStdout)
-        forwardStdout->flush();
-
-    if (hadError)
-        result.exitCode = 1;
+    return results;
+}
 
-    return result;
+std::string specificationSlug(const std::string &name)
+{
+    return slugify(trimCopy(name));
 }
 
 } // namespace ck::find
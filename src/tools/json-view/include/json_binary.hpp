@@ -0,0 +1,48 @@
+#pragma once
+
+#include "json_document.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Decoding of one binary encoding for JsonDocument.  Offsets index the
+// encoded bytes.  A value's type field carries a type stored apart from
+// its content: the element type of BSON values, and the element type of
+// UBJSON strongly typed containers.  CBOR tags are skipped, so values
+// start at the tagged item.  Byte strings and other opaque payloads are
+// presented as strings of lowercase hex digits.
+class JsonBinaryCodec
+{
+public:
+    virtual ~JsonBinaryCodec() = default;
+
+    // Validate the whole input in one pass, reporting containers, keys and
+    // scalars in document order; endContainer receives the container's
+    // last byte.  Returns the root.  Throws JsonParseError.
+    virtual JsonValue scan(std::string_view data, JsonEventHandler &handler) const = 0;
+
+    virtual JsonKind kind(std::string_view data, JsonValue value) const = 0;
+    // Position of the first member of a container.
+    virtual std::uint64_t firstMember(std::string_view data, JsonValue container) const = 0;
+    // Read the member starting at pos, skipping padding; sets the key
+    // offset (objects only) and the value's offset and type.
+    virtual void readMember(std::string_view data, JsonValue container, std::uint64_t pos,
+                            JsonMember &member) const = 0;
+    // One past the last byte of a scalar.
+    virtual std::uint64_t scalarEnd(std::string_view data, JsonValue value) const = 0;
+
+    virtual std::string key(std::string_view data, std::uint64_t keyOffset) const = 0;
+    virtual std::string stringValue(std::string_view data, JsonValue value) const = 0;
+    virtual bool booleanValue(std::string_view data, JsonValue value) const = 0;
+    // Integers exactly, floats in shortest round-trip form.
+    virtual std::string numberText(std::string_view data, JsonValue value) const = 0;
+};
+
+// Codec for a binary format; must not be called with JsonFormat::Text.
+const JsonBinaryCodec &jsonBinaryCodec(JsonFormat format);
+
+// Format implied by a file name's extension; Text when there is none.
+JsonFormat jsonFormatForPath(const std::string &path);
+
+const char *jsonFormatName(JsonFormat format);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "json_document.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Node;
+
+enum class JsonDiffKind : std::uint8_t
+{
+    None,
+    Added,
+    Removed,
+    Changed,
+};
+
+// Hash of every value of a document.  Container hashes are computed
+// bottom-up in one pass and looked up in O(1); scalars are hashed on
+// demand.  Equal values hash equally regardless of member order,
+// whitespace, string escapes, number spelling and encoding.
+class JsonSubtreeHashes
+{
+public:
+    explicit JsonSubtreeHashes(const JsonDocument &document);
+
+    std::uint64_t hash(JsonValue value) const;
+
+private:
+    const JsonDocument &m_document;
+    // By container slot.
+    std::vector<std::uint64_t> m_containers;
+};
+
+struct JsonDiffOptions
+{
+    // Match array items that are objects with this member by its value
+    // instead of by position.  Items without it are matched by position.
+    std::string idKey;
+};
+
+// One difference, in pre-order: an entry's parent is the closest earlier
+// entry one level up.  Changed containers of the same kind are followed by
+// the differences inside them; any other Changed entry replaces the value
+// as a whole.
+struct JsonDiffEntry
+{
+    JsonDiffKind kind = JsonDiffKind::Changed;
+    // 0 for the roots.
+    std::uint32_t depth = 0;
+    // Member name, or "[index]" with the right index (left for Removed).
+    std::string key;
+    // left is unset for Added, right for Removed.
+    JsonValue left;
+    JsonValue right;
+};
+
+// Align two documents structurally, by member name and by array index or
+// options.idKey.  Both documents are hashed concurrently and identical
+// subtrees are skipped without being visited.  Empty when they are equal.
+std::vector<JsonDiffEntry> diffDocuments(const JsonDocument &left, const JsonDocument &right,
+                                         const JsonDiffOptions &options = {});
+
+// Tree with only the changed paths of the right document, plus removed
+// values of the left one.  The root is labelled with key.
+std::unique_ptr<Node> buildDiffTree(std::shared_ptr<const JsonDocument> left,
+                                    std::shared_ptr<const JsonDocument> right,
+                                    const std::vector<JsonDiffEntry> &entries, const std::string &key);
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only bytes behind a JsonDocument: a private mapping of a file, or an
+// owned copy when the input did not come from disk.
+class JsonBytes
+{
+public:
+    static std::shared_ptr<const JsonBytes> mapFile(const std::string &path);
+    static std::shared_ptr<const JsonBytes> fromString(std::string text);
+
+    JsonBytes(const JsonBytes &) = delete;
+    JsonBytes &operator=(const JsonBytes &) = delete;
+    ~JsonBytes();
+
+    const char *data() const noexcept { return m_data; }
+    std::size_t size() const noexcept { return m_size; }
+    std::string_view view() const noexcept { return {m_data, m_size}; }
+
+    // Hint the kernel about the upcoming access pattern of a mapping; a
+    // no-op for owned buffers.
+    void adviseSequential(bool sequential) const noexcept;
+
+private:
+    JsonBytes() = default;
+
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;
+    std::string m_owned;
+};
+
+class JsonParseError : public std::runtime_error
+{
+public:
+    JsonParseError(const std::string &message, std::uint64_t offset)
+        : std::runtime_error(message), m_offset(offset) {}
+
+    std::uint64_t offset() const noexcept { return m_offset; }
+
+private:
+    std::uint64_t m_offset;
+};
+
+// Encodings a JsonDocument can index.
+enum class JsonFormat : std::uint8_t
+{
+    Text,
+    Cbor,
+    MessagePack,
+    Bson,
+    Ubjson,
+};
+
+enum class JsonKind : std::uint8_t
+{
+    Null,
+    Boolean,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+// Handle to one value of a JsonDocument.  Offsets are relative to the first
+// byte of the indexed range; containers also carry their index slot so that
+// sizes and extents are O(1).
+struct JsonValue
+{
+    static constexpr std::uint32_t kNoContainer = 0xFFFFFFFFu;
+
+    std::uint64_t offset = 0;
+    std::uint32_t container = kNoContainer;
+    // Binary encodings that store a value's type apart from it; see
+    // JsonBinaryCodec.  Zero for text.
+    std::uint8_t type = 0;
+};
+
+struct JsonMember
+{
+    static constexpr std::uint64_t kNoKey = ~std::uint64_t{0};
+
+    // Offset of the member name's opening quote; kNoKey for array items.
+    std::uint64_t keyOffset = kNoKey;
+    JsonValue value;
+};
+
+// A JSON text indexed by a single structural pass.  Only containers are
+// recorded (begin, end, child count, subtree skip), so the index is a small
+// fraction of the input; keys, strings and numbers are decoded from the
+// source bytes on demand.  NaN, Infinity and -Infinity are accepted as
+// numbers.  CBOR, MessagePack, BSON and UBJSON inputs are indexed the same
+// way directly over their encoding.  All accessors are const and safe to
+// call from several threads.
+class JsonMemberCursor;
+class JsonBinaryCodec;
+
+class JsonDocument
+{
+public:
+    // Throw JsonParseError for malformed input and std::runtime_error when
+    // the file cannot be read.  open() picks the encoding from the file's
+    // extension, and tries the binary ones when the file is not JSON text.
+    static std::shared_ptr<const JsonDocument> open(const std::string &path);
+    static std::shared_ptr<const JsonDocument> fromString(std::string text,
+                                                          JsonFormat format = JsonFormat::Text);
+
+    // Index the JSON text in the byte range [begin, end) of bytes.
+    JsonDocument(std::shared_ptr<const JsonBytes> bytes, std::uint64_t begin, std::uint64_t end);
+    // Index all of bytes in the given encoding.
+    JsonDocument(std::shared_ptr<const JsonBytes> bytes, JsonFormat format);
+
+    JsonValue root() const noexcept { return m_root; }
+    JsonFormat format() const noexcept { return m_format; }
+    // The indexed bytes; encoded bytes for binary formats.
+    std::string_view text() const noexcept { return m_text; }
+    std::uint64_t byteSize() const noexcept { return m_text.size(); }
+    std::size_t containerCount() const noexcept { return m_containers.size(); }
+    const std::shared_ptr<const JsonBytes> &bytes() const noexcept { return m_bytes; }
+
+    JsonKind kind(JsonValue value) const;
+    bool isContainer(JsonValue value) const;
+    // Number of items or members; zero for scalars.
+    std::size_t size(JsonValue value) const;
+    std::vector<JsonMember> members(JsonValue value) const;
+
+    // One past the last byte of the value, and the value's source text
+    // (its encoded bytes for binary formats).
+    std::uint64_t end(JsonValue value) const;
+    std::string_view source(JsonValue value) const;
+
+    std::string key(const JsonMember &member) const;
+    std::string stringValue(JsonValue value) const;
+    bool booleanValue(JsonValue value) const;
+    double numberValue(JsonValue value) const;
+    // A number as written in a text document; binary numbers are spelled
+    // exactly for integers and in shortest round-trip form for floats.
+    std::string numberText(JsonValue value) const;
+
+private:
+    friend class JsonMemberCursor;
+
+    struct Container
+    {
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        std::uint32_t count = 0;
+        // Index of the first container after this subtree.
+        std::uint32_t next = 0;
+    };
+
+    const Container &containerOf(JsonValue value) const;
+    void indexText();
+    void indexBinary();
+
+    std::shared_ptr<const JsonBytes> m_bytes;
+    std::string_view m_text;
+    JsonFormat m_format = JsonFormat::Text;
+    // Null for text.
+    const JsonBinaryCodec *m_codec = nullptr;
+    JsonValue m_root;
+    std::vector<Container> m_containers;
+};
+
+// Steps through the members of a container one at a time, for callers that
+// may stop early and should not build the whole members() vector.
+class JsonMemberCursor
+{
+public:
+    JsonMemberCursor() = default;
+    JsonMemberCursor(const JsonDocument &document, JsonValue container);
+
+    // False once every member has been returned.
+    bool next(JsonMember &member);
+
+private:
+    const JsonDocument *m_document = nullptr;
+    JsonValue m_container;
+    std::uint64_t m_pos = 0;
+    std::uint32_t m_nested = 0;
+    std::uint32_t m_remaining = 0;
+    bool m_object = false;
+};
+
+// Receives the tokens of scanJsonText in document order.  Offsets index the
+// scanned text; a key's range includes its quotes.
+class JsonEventHandler
+{
+public:
+    virtual ~JsonEventHandler() = default;
+
+    virtual void beginContainer(std::uint64_t offset, bool object) = 0;
+    virtual void endContainer(std::uint64_t offset) = 0;
+    virtual void key(std::uint64_t begin, std::uint64_t end) = 0;
+    virtual void scalar(std::uint64_t begin, std::uint64_t end, JsonKind kind) = 0;
+};
+
+// Validate a JSON text in one pass over the caller's buffer, accepting NaN,
+// Infinity and -Infinity as numbers; throws JsonParseError.
+void scanJsonText(std::string_view text, JsonEventHandler &handler);
+
+// Decode a quoted JSON string (including its quotes) into UTF-8.
+std::string decodeJsonString(std::string_view quoted);
+
+// Value of a number token, including NaN and the infinities.
+double decodeJsonNumber(std::string_view token);
+
+// Kind of the JSON value whose text starts with the given byte.
+JsonKind jsonKindOfFirstByte(char first);
+
+// The text after a leading UTF-8 byte order mark, if it has one.
+std::string_view skipByteOrderMark(std::string_view text);
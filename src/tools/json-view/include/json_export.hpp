@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+struct Node;
+
+enum class JsonWriteStyle
+{
+    // The value's bytes exactly as they appear in the source.
+    Raw,
+    Pretty,
+    Minified,
+};
+
+// Receives output in chunks; a chunk may point straight into the source.
+using JsonSink = std::function<void(std::string_view)>;
+
+// Stream a JSON text to sink token by token in the given style, without
+// decoding it.  Keys keep their order and numbers their spelling, except
+// that NaN and the infinities become null unless the style is Raw.
+void writeJsonText(std::string_view text, JsonWriteStyle style, const JsonSink &sink, int indent = 2);
+
+// Stream the value behind a tree node from the source buffer.  A JSON Lines
+// root is written one record per line.  Binary documents are converted to
+// JSON text, with Raw written minified.
+void writeNodeJson(const Node *node, JsonWriteStyle style, const JsonSink &sink);
+
+std::string nodeJsonText(const Node *node, JsonWriteStyle style);
+
+// Write the value behind a node to a file; throws std::runtime_error.
+void exportNodeJson(const Node *node, JsonWriteStyle style, const std::string &path);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "json_document.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A JSON Lines / NDJSON file: one JSON value per line.  Opening it only
+// records where each non-blank line starts; a record is parsed when the
+// caller asks for it.  refresh() indexes bytes appended since the last
+// call so a growing log can be followed.
+class JsonLines
+{
+public:
+    enum class RefreshResult
+    {
+        Unchanged,
+        Appended,
+        // The file shrank or was replaced; the record list was rebuilt.
+        Reset,
+    };
+
+    // Throws std::runtime_error when the file cannot be read.
+    static std::shared_ptr<JsonLines> open(const std::string &path);
+    static std::shared_ptr<JsonLines> fromString(std::string text);
+
+    const std::string &path() const noexcept { return m_path; }
+    std::uint64_t byteSize() const noexcept { return m_bytes->size(); }
+    std::size_t recordCount() const noexcept { return m_starts.size(); }
+
+    // Raw text of a record without its line terminator.  The view is
+    // invalidated by refresh().
+    std::string_view recordText(std::size_t index) const;
+    // Parse a record as a standalone document; throws JsonParseError.
+    std::shared_ptr<const JsonDocument> parseRecord(std::size_t index) const;
+
+    RefreshResult refresh();
+
+private:
+    explicit JsonLines(std::shared_ptr<const JsonBytes> bytes, std::string path);
+
+    void indexFrom(std::uint64_t begin);
+
+    std::shared_ptr<const JsonBytes> m_bytes;
+    std::string m_path;
+    std::vector<std::uint64_t> m_starts;
+    // Bytes before this offset end in a newline and never need rescanning.
+    std::uint64_t m_indexedEnd = 0;
+    // Whether the last record has no line terminator yet.
+    bool m_partialTail = false;
+};
+
+// Start offsets of the non-blank lines beginning in [begin, text.size()),
+// found by several threads for large inputs.  begin must be 0 or follow a
+// newline.
+std::vector<std::uint64_t> findRecordStarts(std::string_view text, std::uint64_t begin);
+
+// True for the .jsonl, .ndjson and .jsonlines extensions.
+bool isJsonLinesPath(const std::string &path);
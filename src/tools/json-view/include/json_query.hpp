@@ -0,0 +1,131 @@
+#pragma once
+
+#include "json_document.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class JsonLines;
+struct Node;
+
+// A compiled JSONPath expression.  Supported: '$', '.name', "['name']",
+// '[n]' (negative from the end), '*', unions '[0,2]', slices
+// '[start:end:step]', recursive descent '..', and filters such as
+// "[?(@.price < 10 && @.tag == 'x')]" with ==, !=, <, <=, >, >=, !, && and
+// ||.  The jq spellings '.a.b', '.[0]' and '.[]' are accepted too.
+class JsonQuery
+{
+public:
+    struct Key
+    {
+        std::string name;
+        std::int64_t index = 0;
+        bool isIndex = false;
+    };
+
+    struct Operand
+    {
+        // '@' followed by keys, or a literal.
+        bool relative = false;
+        std::vector<Key> path;
+        JsonKind kind = JsonKind::Null;
+        double number = 0.0;
+        std::string string;
+        bool boolean = false;
+    };
+
+    struct Predicate
+    {
+        enum class Kind
+        {
+            Or,
+            And,
+            Not,
+            Exists,
+            Compare,
+        };
+
+        Kind kind = Kind::Exists;
+        // Comparison operator: "==", "!=", "<", "<=", ">" or ">=".
+        std::string op;
+        // Child predicates of Or, And and Not.
+        int left = -1;
+        int right = -1;
+        Operand lhs;
+        Operand rhs;
+    };
+
+    struct Step
+    {
+        enum class Kind
+        {
+            Name,
+            Wildcard,
+            Union,
+            Slice,
+            Filter,
+            // Zero or more levels; always followed by another step.
+            Descend,
+        };
+
+        Kind kind = Kind::Wildcard;
+        // Name: one key; Union: names and indices in order.
+        std::vector<Key> keys;
+        std::int64_t start = 0;
+        std::int64_t end = 0;
+        std::int64_t stride = 1;
+        bool hasStart = false;
+        bool hasEnd = false;
+        // Filter: root predicate.
+        int predicate = -1;
+    };
+
+    // Throws std::invalid_argument naming the offending position.
+    explicit JsonQuery(std::string_view text);
+
+    const std::string &text() const noexcept { return m_text; }
+    const std::vector<Step> &steps() const noexcept { return m_steps; }
+    const std::vector<Predicate> &predicates() const noexcept { return m_predicates; }
+
+private:
+    std::string m_text;
+    std::vector<Step> m_steps;
+    std::vector<Predicate> m_predicates;
+};
+
+// Lazy evaluation of a query over the document behind a tree root (for a
+// JSON Lines root, over its records).  Values are read from the source
+// bytes in place, and work stops whenever a batch is full, so the first
+// results are available before the document has been fully scanned.
+class JsonQueryCursor
+{
+public:
+    JsonQueryCursor(std::shared_ptr<const JsonQuery> query, const Node *root);
+    JsonQueryCursor(const JsonQueryCursor &) = delete;
+    JsonQueryCursor &operator=(const JsonQueryCursor &) = delete;
+    ~JsonQueryCursor();
+
+    // Paths of up to maxResults further results, as taken by
+    // materializePath, after visiting at most about maxVisits values.
+    std::vector<std::vector<std::uint32_t>> next(std::size_t maxResults, std::size_t maxVisits = SIZE_MAX);
+    bool done() const;
+
+    struct Frame;
+
+private:
+    void expand(Frame frame, std::vector<std::vector<std::uint32_t>> &out);
+    void advance();
+    bool test(const JsonDocument &document, JsonValue value, int predicate) const;
+
+    std::shared_ptr<const JsonQuery> m_query;
+    std::shared_ptr<const JsonDocument> m_document;
+    std::shared_ptr<const JsonLines> m_lines;
+    std::vector<Frame> m_frames;
+};
+
+// Evaluate a query to completion.
+std::vector<std::vector<std::uint32_t>> evaluateQuery(const std::string &query, const Node *root);
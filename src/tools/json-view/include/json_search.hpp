@@ -0,0 +1,148 @@
+#pragma once
+
+#include "json_document.hpp"
+#include "json_lines.hpp"
+#include "json_query.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Keys as written and lowercased values of every value in a document,
+// laid out flat so that queries can scan them from several threads.  The
+// index is built on a background thread; queries wait for it without
+// blocking the caller.
+class JsonSearchIndex
+{
+public:
+    static constexpr std::uint32_t kNoParent = 0xFFFFFFFFu;
+    static constexpr std::uint32_t kNoKey = 0xFFFFFFFFu;
+
+    // One value in document order; entry 0 is the root.
+    struct Entry
+    {
+        // Offset in the text arena of the key, followed by the value text.
+        std::uint64_t text = 0;
+        std::uint32_t parent = kNoParent;
+        // Position among the parent's children.
+        std::uint32_t index = 0;
+        // kNoKey for the root and for array items.
+        std::uint32_t keyLength = kNoKey;
+        std::uint32_t valueLength = 0;
+    };
+
+    // Start indexing the document on a background thread.
+    static std::shared_ptr<JsonSearchIndex> build(std::shared_ptr<const JsonDocument> document);
+    // Index the records of a JSON Lines file as the items of a list, the
+    // way the outline shows them.  Records that do not parse are left out.
+    static std::shared_ptr<JsonSearchIndex> build(const JsonLines &lines);
+
+    JsonSearchIndex(const JsonSearchIndex &) = delete;
+    JsonSearchIndex &operator=(const JsonSearchIndex &) = delete;
+    ~JsonSearchIndex();
+
+    bool ready() const noexcept { return m_ready.load(std::memory_order_acquire); }
+    // Wait up to timeoutMs for the build; true once it has finished.
+    bool waitFor(int timeoutMs) const;
+
+    // The accessors below are valid once ready() is true.
+    std::size_t entryCount() const noexcept { return m_entries.size(); }
+    const Entry &entry(std::uint32_t id) const { return m_entries[id]; }
+    std::string_view key(const Entry &entry) const;
+    std::string_view value(const Entry &entry) const;
+    // Child positions leading from the root to the entry, as taken by
+    // materializePath.
+    std::vector<std::uint32_t> pathOf(std::uint32_t id) const;
+
+private:
+    JsonSearchIndex() = default;
+
+    // Exactly one of document and lines is set.
+    void run(std::shared_ptr<const JsonDocument> document, std::shared_ptr<const JsonLines> lines);
+
+    std::vector<Entry> m_entries;
+    std::string m_text;
+    std::atomic<bool> m_ready{false};
+    std::atomic<bool> m_cancelled{false};
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_builtCondition;
+    std::thread m_thread;
+};
+
+struct JsonSearchQuery
+{
+    // Substring, or ECMAScript regular expression when regex is set;
+    // matched case-insensitively.  May be empty when path is given.
+    std::string term;
+    bool searchKeys = true;
+    bool searchValues = false;
+    bool regex = false;
+    // Optional filter on where matches may sit, in the syntax of JsonQuery
+    // and with its case-sensitive names, e.g. "$.users[*].name" or
+    // "$..id".  Since a match is judged by its own path, the subset without
+    // filters and negative positions is understood: names, '*', '..',
+    // unions of names and indices, and slices.
+    std::string path;
+};
+
+// A query running over an index on worker threads.  Matches are handed
+// out in document order as soon as every match before them is known, so
+// the first results arrive long before a big document is fully scanned.
+class JsonSearchJob
+{
+public:
+    // Throws std::regex_error or std::invalid_argument for a malformed
+    // regular expression or path filter.
+    JsonSearchJob(std::shared_ptr<const JsonSearchIndex> index, JsonSearchQuery query);
+    JsonSearchJob(const JsonSearchJob &) = delete;
+    JsonSearchJob &operator=(const JsonSearchJob &) = delete;
+    // Cancels and waits for the workers.
+    ~JsonSearchJob();
+
+    // Paths (see JsonSearchIndex::pathOf) of up to limit matches not
+    // handed out yet.
+    std::vector<std::vector<std::uint32_t>> takeResults(std::size_t limit = SIZE_MAX);
+    // True once every match has been handed out by takeResults.
+    bool finished() const;
+
+    void cancel() noexcept { m_cancelled.store(true, std::memory_order_relaxed); }
+
+private:
+    void run();
+    void scanChunk(std::size_t chunk);
+    bool matches(std::uint32_t id) const;
+    // Keys keep their case and are folded here; values come lowercased.
+    bool matchesText(std::string_view text, bool lowercased) const;
+    bool matchesPath(std::uint32_t id) const;
+
+    std::shared_ptr<const JsonSearchIndex> m_index;
+    JsonSearchQuery m_query;
+    std::regex m_regex;
+    // Set when path is not blank; no steps then select the root alone.
+    bool m_filterByPath = false;
+    std::vector<JsonQuery::Step> m_path;
+
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<std::size_t> m_nextChunk{0};
+    mutable std::mutex m_mutex;
+    std::vector<std::vector<std::uint32_t>> m_chunkMatches;
+    std::vector<char> m_chunkDone;
+    // Chunks fully handed out, and matches taken from the next one.
+    std::size_t m_delivered = 0;
+    std::size_t m_deliveredInChunk = 0;
+    bool m_scanned = false;
+    std::thread m_thread;
+};
+
+// Compile a filter for JsonSearchQuery::path with JsonQuery's parser.
+// Throws std::invalid_argument for malformed paths and for steps outside
+// the subset searches understand.
+std::vector<JsonQuery::Step> parseSearchPath(std::string_view path);
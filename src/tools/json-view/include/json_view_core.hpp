@@ -1,6 +1,11 @@
 #pragma once
 
+#include "json_diff.hpp"
+#include "json_document.hpp"
+#include "json_lines.hpp"
+
 #include <nlohmann/json.hpp>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -10,13 +15,40 @@ using json = nlohmann::json;
 
 struct Node
 {
-    const json *value = nullptr;
+    // Null for a JSON Lines root and for records that were not parsed yet.
+    const JsonDocument *document = nullptr;
+    JsonValue value;
     Node *parent = nullptr;
-    std::vector<std::unique_ptr<Node>> children;
+    // Children created so far, by position; see childAt.
+    std::map<std::uint32_t, std::unique_ptr<Node>> children;
+    // Where the members of an object or array start, read once by
+    // ensureChildren so that childAt can create any child directly.
+    std::vector<JsonMember> members;
     std::string key;
     bool expanded = false;
     bool isDummyRoot = false;
     bool isLastChild = false;
+    // Position among the parent's children.
+    std::uint32_t index = 0;
+    // Children are counted on first use; see ensureChildren.
+    bool childrenLoaded = false;
+    std::uint32_t childCount = 0;
+    // Set on roots and parsed JSON Lines records; keeps the document alive
+    // as long as the tree.
+    std::shared_ptr<const JsonDocument> ownedDocument;
+    // JSON Lines: set on the file root and on every record row.
+    const JsonLines *lines = nullptr;
+    std::shared_ptr<const JsonLines> ownedLines;
+    // Why a JSON Lines record could not be parsed.
+    std::string error;
+    // Diff trees: how the value differs between the compared documents.
+    // document/value is the right side except for removed values; changed
+    // values also keep the left side.
+    JsonDiffKind diff = JsonDiffKind::None;
+    const JsonDocument *leftDocument = nullptr;
+    JsonValue leftValue;
+    // Set on diff roots.
+    std::shared_ptr<const JsonDocument> ownedLeftDocument;
 };
 
 struct SearchState
@@ -24,15 +56,28 @@ struct SearchState
     std::string term;
     bool searchKeys = true;
     bool searchValues = false;
+    bool regex = false;
+    // JSONPath-style filter; see JsonSearchQuery::path.
+    std::string path;
     std::vector<const Node *> matches;
     int currentIndex = 0;
+    // More matches may still arrive from a background query.
+    bool running = false;
+    // term is a JSONPath query rather than search text.
+    bool isQuery = false;
 };
 
 extern std::map<std::string, size_t> fileSizes;
 
 int getDisplayWidth(const std::string &str);
-std::unique_ptr<Node> buildTree(const json *j, const std::string &key, Node *parent, bool dummy);
-void collectVisible(const Node *node, std::vector<const Node *> &out);
+std::unique_ptr<Node> buildTree(std::shared_ptr<const JsonDocument> document, const std::string &key);
+std::unique_ptr<Node> buildLinesTree(std::shared_ptr<const JsonLines> lines, const std::string &key);
+size_t appendNewRecords(Node *root);
+void ensureChildren(Node *node);
+Node *childAt(Node *node, size_t index);
+bool hasChildren(const Node *node);
+Node *materializePath(Node *node, const std::vector<std::uint32_t> &path);
+void collectVisible(Node *node, std::vector<const Node *> &out);
 std::string buildPrefix(const Node *node);
 std::string shortenPath(const std::string &path, int maxWidth);
 std::string getTypeIcon(const Node *node);
@@ -42,12 +87,12 @@ void expandAll(Node *node);
 void collapseAll(Node *node, bool keepRoot);
 void expandToLevel(Node *node, int targetLevel, int currentLevel = 0);
 void expandPath(Node *node);
-void searchTree(const Node *node, const std::string &term, bool searchKeys, bool searchValues, std::vector<const Node *> &out);
+void searchTree(Node *node, const std::string &term, bool searchKeys, bool searchValues, std::vector<const Node *> &out);
 bool osc52Likely();
 std::string getClipboardStatusMessage();
 void copyToClipboard(const std::string &text);
 json reconstructJson(const Node *node);
+json documentToJson(const JsonDocument &document, JsonValue value);
 std::string formatFileSize(size_t size);
 void printFormattedJson(const json &j, int indent = 0);
-json parseJsonWithSpecialNumbers(const std::string &contents);
 
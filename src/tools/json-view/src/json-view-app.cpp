@@ -1,3 +1,7 @@
+#include "json_diff.hpp"
+#include "json_export.hpp"
+#include "json_query.hpp"
+#include "json_search.hpp"
 #include "json_view_core.hpp"
 
 #define Uses_TApplication
@@ -13,6 +17,7 @@
 #define Uses_TOutline
 #define Uses_TScrollBar
 #define Uses_TRadioButtons
+#define Uses_TCheckBoxes
 #define Uses_TButton
 #define Uses_TLabel
 #define Uses_TSItem
@@ -22,6 +27,7 @@
 #define Uses_TDeskTop
 #define Uses_MsgBox
 #define Uses_TClipboard
+#define Uses_TDrawBuffer
 #include <tvision/tv.h>
 
 #include "ck/about_dialog.hpp"
@@ -33,9 +39,13 @@
 #include "ck/ui/clock_view.hpp"
 #include "ck/ui/status_line.hpp"
 
-#include <fstream>
-#include <sstream>
-#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
 #include <string>
 #include <cstdlib>
 
@@ -49,76 +59,217 @@ static const ck::appinfo::ToolInfo &toolInfo()
 class JsonTNode : public TNode
 {
 public:
-    const Node *jsonNode;
+    Node *jsonNode;
     JsonTNode *parent = nullptr;
-    JsonTNode(const Node *n, TStringView text, JsonTNode *children = nullptr,
-              JsonTNode *next = nullptr, Boolean exp = True)
-        : TNode(text, children, next, exp), jsonNode(n) {}
+    // Outline nodes created so far, by position, for rows that were drawn,
+    // focused or expanded.  childList and next stay null so TOutline
+    // neither walks nor frees these itself.
+    std::map<std::uint32_t, std::unique_ptr<JsonTNode>> children;
+    // While expanded: the rows below this node, and its expanded children
+    // in order; see JsonOutline::countRows.
+    struct OpenChild
+    {
+        std::uint32_t index;
+        // Rows the earlier expanded children add below themselves.
+        std::size_t rowsBefore;
+        JsonTNode *node;
+    };
+    std::size_t rowsBelow = 0;
+    std::vector<OpenChild> openChildren;
+    // Label as last drawn; see JsonOutline::labelFor.
+    std::string label;
+    unsigned labelGeneration = 0;
+    int labelWidth = 0;
+
+    JsonTNode(Node *n, JsonTNode *p)
+        : TNode(TStringView()), jsonNode(n), parent(p)
+    {
+        expanded = n->expanded ? True : False;
+    }
+
+    // Null past the last child.  Also reaches records appended to a
+    // followed JSON Lines file.
+    JsonTNode *childAt(size_t index)
+    {
+        Node *child = ::childAt(jsonNode, index);
+        if (!child)
+            return nullptr;
+        std::unique_ptr<JsonTNode> &slot = children[static_cast<std::uint32_t>(index)];
+        if (!slot)
+            slot = std::make_unique<JsonTNode>(child, this);
+        return slot.get();
+    }
 };
 
+// Rows are never listed: their number and the node on any row are worked
+// out from the expanded nodes alone, so only the rows on screen need an
+// outline node even when a list has millions of items.
 class JsonOutline : public TOutline
 {
 public:
     JsonOutline(TRect r, TScrollBar *h, TScrollBar *v, JsonTNode *aRoot)
-        : TOutline(r, h, v, aRoot), root(aRoot) {}
+        : TOutline(r, h, v, collapsedWhileConstructed(aRoot)), root(aRoot)
+    {
+        update();
+    }
 
     JsonTNode *root;
 
     JsonTNode *focusedNode()
     {
-        return static_cast<JsonTNode *>(getNode(foc));
+        return foc >= 0 && static_cast<size_t>(foc) < rowCount() ? rowAt(static_cast<size_t>(foc)).node : nullptr;
     }
 
-    void focusNode(JsonTNode *target)
+    // Recount the rows after the tree changed; labels are rendered again.
+    // Stands in for TOutlineViewer::update, which visits every row.
+    void update()
     {
-        struct Finder
+        rowsDirty = true;
+        ++labelGeneration;
+        size_t rows = rowCount();
+        size_t first = static_cast<size_t>(std::max(delta.y, 0));
+        for (size_t idx = first; idx < rows && idx < first + static_cast<size_t>(size.y); ++idx)
         {
-            JsonTNode *target;
-            int index = 0;
-            int found = -1;
-        } finder{target};
+            Row row = rowAt(idx);
+            widest = std::max(widest, row.depth * 3 + 3 + estimatedLabelWidth(row.node->jsonNode));
+        }
+        int limitY = static_cast<int>(std::min<size_t>(rows, INT_MAX));
+        setLimit(static_cast<int>(std::min<size_t>(widest, INT_MAX)), limitY);
+        if (foc >= limitY)
+            focused(std::max(limitY - 1, 0));
+    }
 
-        forEach([](TOutlineViewer *, TNode *node, int, int pos, long, ushort, void *arg) -> Boolean
-                {
-            auto &f = *static_cast<Finder *>(arg);
-            if (node == f.target)
+    // Outline node for a document node, building the outline path to it.
+    JsonTNode *outlineNodeFor(const Node *target)
+    {
+        if (!target->parent)
+            return root->jsonNode == target ? root : nullptr;
+        JsonTNode *parent = outlineNodeFor(target->parent);
+        return parent ? parent->childAt(target->index) : nullptr;
+    }
+
+    virtual Boolean hasChildren(TNode *node) override
+    {
+        return ::hasChildren(static_cast<JsonTNode *>(node)->jsonNode) ? True : False;
+    }
+
+    virtual int getNumChildren(TNode *node) override
+    {
+        Node *n = static_cast<JsonTNode *>(node)->jsonNode;
+        ensureChildren(n);
+        return static_cast<int>(n->childCount);
+    }
+
+    virtual TNode *getChild(TNode *node, int i) override
+    {
+        return static_cast<JsonTNode *>(node)->childAt(static_cast<size_t>(i));
+    }
+
+    virtual void adjust(TNode *node, Boolean expand) override
+    {
+        auto *n = static_cast<JsonTNode *>(node);
+        rowsDirty = true;
+        n->expanded = expand;
+        n->jsonNode->expanded = expand == True;
+    }
+
+    // Rows are drawn by draw() below; TOutline only asks for this text
+    // while it is being constructed.
+    virtual char *getText(TNode *node) override
+    {
+        estimate.assign(estimatedLabelWidth(static_cast<JsonTNode *>(node)->jsonNode), ' ');
+        return estimate.data();
+    }
+
+    // Draws only the rows on screen, straight into the draw buffer, in the
+    // style of TOutlineViewer's graph.  The branch fragments of the first
+    // row's ancestors are looked up once; every following row reuses them,
+    // as its ancestors are that row or ones already seen.
+    virtual void draw() override
+    {
+        size_t rows = rowCount();
+        TColorAttr normalColor = getColor(1);
+        TColorAttr focusColor = getColor(2);
+        TColorAttr selectColor = getColor(3);
+        TColorAttr collapsedColor = getColor(4);
+        TDrawBuffer b;
+        size_t first = static_cast<size_t>(std::max(delta.y, 0));
+        if (first < rows)
+        {
+            Row row = rowAt(first);
+            bars.assign(row.depth + 1, false);
+            size_t depth = row.depth;
+            for (const JsonTNode *p = row.node->parent; p; p = p->parent)
+                bars[--depth] = p->parent && !p->jsonNode->isLastChild;
+        }
+        for (int y = 0; y < size.y; ++y)
+        {
+            size_t idx = first + static_cast<size_t>(y);
+            if (idx >= rows)
             {
-                f.found = f.index;
-                return True;
+                b.moveChar(0, ' ', normalColor, size.x);
+                writeLine(0, y, size.x, size.y - y, b);
+                break;
             }
-            ++f.index;
-            return False; }, &finder);
+            Row row = rowAt(idx);
+            TColorAttr color = normalColor;
+            bool plain = false;
+            if (static_cast<int>(idx) == foc && (state & sfFocused))
+                color = focusColor;
+            else if (isSelected(static_cast<int>(idx)))
+                color = selectColor;
+            else
+                plain = true;
+            b.moveChar(0, ' ', color, size.x);
 
-        if (finder.found >= 0)
-        {
-            foc = finder.found;
-            scrollTo(0, finder.found);
-            drawView();
-            focused(finder.found);
+            int col = -delta.x;
+            for (size_t d = 0; d < row.depth; ++d)
+                col = put(b, col, bars[d] ? "│  " : "   ", 3, color);
+            bool last = !row.node->parent || row.node->jsonNode->isLastChild;
+            bool collapsed = !row.node->jsonNode->expanded && ::hasChildren(row.node->jsonNode);
+            col = put(b, col, last ? "└─" : "├─", 2, color);
+            col = put(b, col, collapsed ? "+" : "─", 1, color);
+            const std::string &text = labelFor(row.node, size.x - col);
+            put(b, col, text, static_cast<int>(text.size()), plain && collapsed ? collapsedColor : color);
+            writeLine(0, y, size.x, 1, b);
+
+            if (bars.size() <= row.depth)
+                bars.resize(row.depth + 1);
+            bars[row.depth] = !last;
         }
     }
 
+    void focusNode(JsonTNode *target)
+    {
+        size_t row = 0;
+        if (!rowOf(target, row))
+            return;
+        int found = static_cast<int>(row);
+        foc = found;
+        scrollTo(0, found);
+        drawView();
+        focused(found);
+    }
+
     virtual void handleEvent(TEvent &event) override
     {
+        // TOutlineViewer handles clicks and '+', '-' and '*' by walking
+        // the rows from the top, so they are handled here instead.
         if (event.what == evMouseDown && (event.mouse.buttons & mbLeftButton))
         {
-            int clickX = event.mouse.where.x;
-            TOutline::handleEvent(event);
-            JsonTNode *node = focusedNode();
-            if (node)
+            if (!(state & sfSelected))
+                select();
+            TPoint mouse = makeLocal(event.mouse.where);
+            size_t idx = static_cast<size_t>(std::max(delta.y, 0) + mouse.y);
+            if (mouse.y >= 0 && idx < rowCount())
             {
-                int depth = 0;
-                for (const Node *p = node->jsonNode; p && p->parent; p = p->parent)
-                    ++depth;
-                int prefixWidth = depth * 2 + 2;
-                if (clickX < prefixWidth)
-                {
-                    node->expanded = node->expanded ? False : True;
-                    const_cast<Node *>(node->jsonNode)->expanded = node->expanded;
-                    update();
-                    drawView();
-                }
+                Row row = rowAt(idx);
+                focusRow(static_cast<int>(idx));
+                int prefixWidth = static_cast<int>(row.depth) * 3 + 3 - delta.x;
+                if (mouse.x < prefixWidth && ::hasChildren(row.node->jsonNode))
+                    toggle(row.node, !row.node->jsonNode->expanded);
             }
+            clearEvent(event);
         }
         else if (event.what == evKeyDown)
         {
@@ -128,56 +279,226 @@ public:
             case kbLeft:
                 if (node)
                 {
-                    if (node->expanded && node->childList)
-                    {
-                        node->expanded = False;
-                        const_cast<Node *>(node->jsonNode)->expanded = false;
-                        update();
-                        drawView();
-                    }
+                    if (node->jsonNode->expanded && ::hasChildren(node->jsonNode))
+                        toggle(node, false);
                     else if (node->parent)
                         focusNode(node->parent);
                 }
                 clearEvent(event);
                 break;
             case kbRight:
-                if (node)
+                if (node && ::hasChildren(node->jsonNode))
                 {
-                    if (!node->expanded && node->childList)
-                    {
-                        node->expanded = True;
-                        const_cast<Node *>(node->jsonNode)->expanded = true;
-                        update();
-                        drawView();
-                    }
-                    else if (node->childList)
-                        focusNode(static_cast<JsonTNode *>(node->childList));
+                    if (!node->jsonNode->expanded)
+                        toggle(node, true);
+                    else
+                        focusNode(node->childAt(0));
                 }
                 clearEvent(event);
                 break;
             case kbHome:
-                focusNode(static_cast<JsonTNode *>(getNode(0)));
+                focusRow(0);
                 clearEvent(event);
                 break;
             case kbEnd:
-            {
-                JsonTNode *last = nullptr;
-                forEach([](TOutlineViewer *, TNode *n, int, int, long, ushort, void *arg) -> Boolean
-                        {
-                    *static_cast<JsonTNode **>(arg) = static_cast<JsonTNode *>(n);
-                    return False; }, &last);
-                if (last)
-                    focusNode(last);
+                if (rowCount() > 0)
+                    focusRow(static_cast<int>(std::min<size_t>(rowCount() - 1, INT_MAX)));
                 clearEvent(event);
                 break;
-            }
             default:
-                TOutline::handleEvent(event);
+                switch (event.keyDown.charScan.charCode)
+                {
+                case '+':
+                case '-':
+                    if (node && ::hasChildren(node->jsonNode))
+                        toggle(node, event.keyDown.charScan.charCode == '+');
+                    clearEvent(event);
+                    break;
+                case '*':
+                    if (node)
+                    {
+                        expandAll(node->jsonNode);
+                        update();
+                        drawView();
+                    }
+                    clearEvent(event);
+                    break;
+                default:
+                    TOutline::handleEvent(event);
+                }
             }
         }
         else
             TOutline::handleEvent(event);
     }
+
+private:
+    struct Row
+    {
+        JsonTNode *node;
+        size_t depth;
+    };
+
+    // TOutline's constructor counts the rows the slow way; an outline that
+    // is collapsed then has only one.
+    static JsonTNode *collapsedWhileConstructed(JsonTNode *node)
+    {
+        node->expanded = False;
+        return node;
+    }
+
+    void toggle(JsonTNode *node, bool expand)
+    {
+        adjust(node, expand ? True : False);
+        update();
+        drawView();
+    }
+
+    // Move the focus to a row, scrolling only as far as needed to show it.
+    void focusRow(int row)
+    {
+        if (row < delta.y)
+            scrollTo(delta.x, row);
+        else if (row >= delta.y + size.y)
+            scrollTo(delta.x, row - size.y + 1);
+        focused(row);
+        drawView();
+    }
+
+    size_t rowCount()
+    {
+        if (rowsDirty)
+        {
+            rowsDirty = false;
+            countRows(root);
+        }
+        return 1 + (root->jsonNode->expanded ? root->rowsBelow : 0);
+    }
+
+    // Count the rows below an expanded node.  Only children that exist and
+    // are expanded add more than their own row, so the work follows what
+    // the user has opened rather than how long the lists are.
+    void countRows(JsonTNode *node)
+    {
+        node->expanded = node->jsonNode->expanded ? True : False;
+        node->openChildren.clear();
+        node->rowsBelow = 0;
+        if (!node->expanded)
+            return;
+        Node *n = node->jsonNode;
+        ensureChildren(n);
+        size_t extra = 0;
+        for (const auto &child : n->children)
+        {
+            if (!child.second->expanded || !::hasChildren(child.second.get()))
+                continue;
+            JsonTNode *open = node->childAt(child.first);
+            countRows(open);
+            node->openChildren.push_back(JsonTNode::OpenChild{child.first, extra, open});
+            extra += open->rowsBelow;
+        }
+        node->rowsBelow = n->childCount + extra;
+    }
+
+    // The node shown on a row, found by skipping over whole subtrees.
+    Row rowAt(size_t idx)
+    {
+        Row row{root, 0};
+        while (idx > 0)
+        {
+            // Rows below row.node, counted from its first child.
+            size_t below = idx - 1;
+            const auto &open = row.node->openChildren;
+            // The last expanded child starting at or before that row.
+            auto it = std::upper_bound(open.begin(), open.end(), below,
+                                       [](size_t r, const JsonTNode::OpenChild &c) { return r < c.index + c.rowsBefore; });
+            size_t extra = 0;
+            if (it != open.begin())
+            {
+                const JsonTNode::OpenChild &c = *std::prev(it);
+                size_t start = c.index + c.rowsBefore;
+                if (below <= start + c.node->rowsBelow)
+                {
+                    row = Row{c.node, row.depth + 1};
+                    idx = below - start;
+                    continue;
+                }
+                extra = c.rowsBefore + c.node->rowsBelow;
+            }
+            return Row{row.node->childAt(below - extra), row.depth + 1};
+        }
+        return row;
+    }
+
+    // The row a node is shown on; false when an ancestor is collapsed.
+    bool rowOf(const JsonTNode *target, size_t &idx)
+    {
+        if (target == root)
+        {
+            idx = 0;
+            return true;
+        }
+        if (!target || !target->parent || !rowOf(target->parent, idx) || !target->parent->jsonNode->expanded)
+            return false;
+        rowCount();
+        const auto &open = target->parent->openChildren;
+        std::uint32_t index = target->jsonNode->index;
+        auto it = std::lower_bound(open.begin(), open.end(), index,
+                                   [](const JsonTNode::OpenChild &c, std::uint32_t i) { return c.index < i; });
+        size_t extra = it != open.end() ? it->rowsBefore
+                       : open.empty()   ? 0
+                                        : open.back().rowsBefore + open.back().node->rowsBelow;
+        idx += 1 + index + extra;
+        return true;
+    }
+
+    // A node's label for the given room, rendered again only when the tree
+    // or the room changed since it was last drawn.
+    const std::string &labelFor(JsonTNode *node, int room)
+    {
+        int width = std::max(room, 20);
+        if (node->labelGeneration != labelGeneration || node->labelWidth != width)
+        {
+            node->label = getContentLabel(node->jsonNode, width);
+            node->labelGeneration = labelGeneration;
+            node->labelWidth = width;
+        }
+        return node->label;
+    }
+
+    // Write text of the given display width at column col of the row,
+    // clipped to the view; returns the column after it.
+    int put(TDrawBuffer &b, int col, TStringView text, int width, TColorAttr color)
+    {
+        if (col < size.x && col + width > 0)
+        {
+            if (col >= 0)
+                b.moveStr(static_cast<ushort>(col), text, color, static_cast<ushort>(size.x - col));
+            else
+                b.moveStr(0, text, color, static_cast<ushort>(size.x), static_cast<ushort>(-col));
+        }
+        return col + width;
+    }
+
+    static std::size_t estimatedLabelWidth(const Node *n)
+    {
+        constexpr std::size_t kMaxEstimate = 1024;
+        std::size_t width = n->key.size() + 4;
+        if (!n->document)
+            return width + (n->lines && !n->isDummyRoot ? kMaxEstimate / 8 : 24);
+        if (n->isDummyRoot || n->document->isContainer(n->value))
+            return width + 24;
+        return std::min(width + n->document->source(n->value).size(), kMaxEstimate);
+    }
+
+    std::string estimate;
+    bool rowsDirty = true;
+    // Horizontal scroll range: the widest row estimated so far.
+    size_t widest = 0;
+    // Bumped by update(); labels drawn before are rendered again.
+    unsigned labelGeneration = 1;
+    // Whether the ancestor at each depth has siblings below it.
+    std::vector<bool> bars;
 };
 
 class JsonViewApp : public ck::ui::ClockAwareApplication
@@ -189,20 +510,46 @@ public:
     static TMenuBar *initMenuBar(TRect r);
     static TStatusLine *initStatusLine(TRect r);
 
+protected:
+    void idle() override;
+
 private:
-    bool loadFile(const std::string &name);
+    bool loadFile(const std::string &name, bool asLines = false);
     std::unique_ptr<Node> root;
-    std::unordered_map<const Node *, JsonTNode *> nodeMap;
+    // The file shown, or the right side of the diff shown.
+    std::string documentName;
     JsonOutline *outline = nullptr;
     SearchState search;
+    // Set while a JSON Lines file is shown; refreshed when following.
+    std::shared_ptr<JsonLines> lines;
+    bool follow = false;
+    std::chrono::steady_clock::time_point lastPoll;
+    // Built in the background, for JSON documents when they are opened and
+    // for JSON Lines files on the first search; searches run over it.
+    std::shared_ptr<JsonSearchIndex> searchIndex;
+    // Records of the JSON Lines file that searchIndex covers.
+    std::size_t searchIndexRecords = 0;
+    std::unique_ptr<JsonSearchJob> searchJob;
+    // A JSONPath query being evaluated a slice at a time from idle().
+    std::unique_ptr<JsonQueryCursor> queryCursor;
 
     void openFile();
     void closeFile();
     void rebuildOutline();
     void doSearch(bool newTerm);
     void copySelection();
+    void exportSelection();
     void updateStatusBar();
     void syncOutlineExpansion();
+    void revealMatch(const Node *match);
+    void toggleFollow();
+    void pollFollowedFile();
+    void endSearch();
+    void pollSearch();
+    void runQuery();
+    void compareWith();
+    bool showDiff(const std::string &name, const std::string &idKey);
+    bool searchAvailable();
 };
 
 static constexpr ushort cmFind = ck::commands::json_view::Find;
@@ -220,6 +567,10 @@ static constexpr ushort cmLevel6 = ck::commands::json_view::Level6;
 static constexpr ushort cmLevel7 = ck::commands::json_view::Level7;
 static constexpr ushort cmLevel8 = ck::commands::json_view::Level8;
 static constexpr ushort cmLevel9 = ck::commands::json_view::Level9;
+static constexpr ushort cmFollow = ck::commands::json_view::Follow;
+static constexpr ushort cmQuery = ck::commands::json_view::Query;
+static constexpr ushort cmExportSelection = ck::commands::json_view::ExportSelection;
+static constexpr ushort cmCompare = ck::commands::json_view::Compare;
 static constexpr ushort cmReturnToLauncher = ck::commands::json_view::ReturnToLauncher;
 
 class JsonStatusLine : public ck::ui::CommandAwareStatusLine
@@ -234,7 +585,7 @@ public:
     {
         disposeItems(items);
         TStatusItem *chain = nullptr;
-        if (s.matches.empty())
+        if (s.matches.empty() && !s.running)
         {
             auto *i1 = new TStatusItem("Open", kbNoKey, cmOpen);
             ck::hotkeys::configureStatusItem(*i1, "Open");
@@ -262,9 +613,9 @@ public:
         }
         else
         {
-            std::string info = "search '" + s.term + "' " +
-                               std::to_string(s.currentIndex + 1) + "/" +
-                               std::to_string(s.matches.size());
+            std::string info = std::string(s.isQuery ? "query '" : "search '") + s.term + "' " +
+                               std::to_string(s.matches.empty() ? 0 : s.currentIndex + 1) + "/" +
+                               std::to_string(s.matches.size()) + (s.running ? "+" : "");
             auto *i1 = new TStatusItem(info.c_str(), kbNoKey, 0);
             auto *i2 = new TStatusItem("Next", kbNoKey, cmFindNext);
             ck::hotkeys::configureStatusItem(*i2, "Next");
@@ -302,23 +653,37 @@ private:
     }
 };
 
-static void syncExpanded(JsonTNode *n)
-{
-    if (!n)
-        return;
-    n->expanded = n->jsonNode->expanded ? True : False;
-    for (JsonTNode *c = static_cast<JsonTNode *>(n->childList); c; c = static_cast<JsonTNode *>(c->next))
-        syncExpanded(c);
-}
-
 JsonViewApp::JsonViewApp(int argc, char **argv)
     : TProgInit(&JsonViewApp::initStatusLine, &JsonViewApp::initMenuBar, &TApplication::initDeskTop),
       ck::ui::ClockAwareApplication()
 {
     insertMenuClock();
 
+    bool asLines = false;
+    std::string compareTo;
+    std::string idKey;
     for (int i = 1; i < argc; ++i)
-        loadFile(argv[i]);
+    {
+        if (std::strcmp(argv[i], "--lines") == 0)
+            asLines = true;
+        else if (std::strcmp(argv[i], "--follow") == 0)
+            asLines = follow = true;
+        else if (std::strcmp(argv[i], "--diff") == 0 && i + 1 < argc)
+            compareTo = argv[++i];
+        else if (std::strcmp(argv[i], "--id-key") == 0 && i + 1 < argc)
+            idKey = argv[++i];
+        else
+            loadFile(argv[i], asLines);
+    }
+    if (!compareTo.empty())
+        showDiff(compareTo, idKey);
+}
+
+void JsonViewApp::idle()
+{
+    ck::ui::ClockAwareApplication::idle();
+    pollFollowedFile();
+    pollSearch();
 }
 
 void JsonViewApp::handleEvent(TEvent &event)
@@ -338,12 +703,9 @@ void JsonViewApp::handleEvent(TEvent &event)
             clearEvent(event);
             return;
         }
-        if (event.keyDown.keyCode == kbEsc && !search.matches.empty())
+        if (event.keyDown.keyCode == kbEsc && (!search.matches.empty() || search.running))
         {
-            search = SearchState();
-            updateStatusBar();
-            if (outline)
-                outline->drawView();
+            endSearch();
             clearEvent(event);
             return;
         }
@@ -361,6 +723,9 @@ void JsonViewApp::handleEvent(TEvent &event)
         case cmCopy:
             copySelection();
             break;
+        case cmExportSelection:
+            exportSelection();
+            break;
         case cmFind:
             doSearch(true);
             break;
@@ -371,18 +736,13 @@ void JsonViewApp::handleEvent(TEvent &event)
             if (!search.matches.empty())
             {
                 search.currentIndex = (search.currentIndex - 1 + search.matches.size()) % search.matches.size();
-                outline->focusNode(nodeMap[search.matches[search.currentIndex]]);
+                revealMatch(search.matches[search.currentIndex]);
                 updateStatusBar();
             }
             break;
         case cmEndSearch:
-            if (!search.matches.empty())
-            {
-                search = SearchState();
-                updateStatusBar();
-                if (outline)
-                    outline->drawView();
-            }
+            if (!search.matches.empty() || search.running)
+                endSearch();
             break;
         case cmLevel0:
         case cmLevel1:
@@ -401,6 +761,15 @@ void JsonViewApp::handleEvent(TEvent &event)
                 syncOutlineExpansion();
             }
             break;
+        case cmFollow:
+            toggleFollow();
+            break;
+        case cmQuery:
+            runQuery();
+            break;
+        case cmCompare:
+            compareWith();
+            break;
         case cmReturnToLauncher:
             std::exit(ck::launcher::kReturnToLauncherExitCode);
             break;
@@ -426,20 +795,64 @@ void JsonViewApp::openFile()
         loadFile(name);
 }
 
-bool JsonViewApp::loadFile(const std::string &name)
+// Whether a file that is not a single JSON text reads as JSON Lines: more
+// than one record and the first one parses.
+static std::shared_ptr<JsonLines> openAsJsonLines(const std::string &name)
+{
+    try
+    {
+        auto candidate = JsonLines::open(name);
+        if (candidate->recordCount() < 2)
+            return nullptr;
+        candidate->parseRecord(0);
+        return candidate;
+    }
+    catch (const std::exception &)
+    {
+        return nullptr;
+    }
+}
+
+bool JsonViewApp::loadFile(const std::string &name, bool asLines)
 {
-    std::ifstream in(name);
-    if (!in)
+    std::shared_ptr<const JsonDocument> document;
+    std::shared_ptr<JsonLines> records;
+    try
+    {
+        if (asLines || isJsonLinesPath(name))
+            records = JsonLines::open(name);
+        else
+            document = JsonDocument::open(name);
+    }
+    catch (const JsonParseError &e)
+    {
+        records = openAsJsonLines(name);
+        if (!records)
+        {
+            messageBox(("Invalid JSON: " + std::string(e.what())).c_str(), mfError | mfOKButton);
+            return false;
+        }
+    }
+    catch (const std::exception &)
     {
         messageBox("Could not open file", mfError | mfOKButton);
         return false;
     }
-    std::ostringstream ss;
-    ss << in.rdbuf();
-    json j = parseJsonWithSpecialNumbers(ss.str());
     fileSizes.clear();
-    fileSizes[name] = ss.str().size();
-    root = buildTree(&j, name, nullptr, true);
+    documentName = name;
+    searchJob.reset();
+    queryCursor.reset();
+    searchIndex.reset();
+    lines = records;
+    if (lines)
+        root = buildLinesTree(lines, name);
+    else
+    {
+        fileSizes[name] = document->byteSize();
+        searchIndex = JsonSearchIndex::build(document);
+        root = buildTree(std::move(document), name);
+        follow = false;
+    }
     search = SearchState();
     rebuildOutline();
     updateStatusBar();
@@ -453,15 +866,128 @@ void JsonViewApp::closeFile()
         deskTop->remove(outline->owner);
         outline = nullptr;
     }
+    searchJob.reset();
+    queryCursor.reset();
+    searchIndex.reset();
     root.reset();
-    nodeMap.clear();
+    lines.reset();
+    follow = false;
     search = SearchState();
     updateStatusBar();
 }
 
+void JsonViewApp::endSearch()
+{
+    searchJob.reset();
+    queryCursor.reset();
+    search = SearchState();
+    updateStatusBar();
+    if (outline)
+        outline->drawView();
+}
+
+// Move matches found by the background search or the running query into
+// the tree.  The first one is revealed as soon as it arrives.
+void JsonViewApp::pollSearch()
+{
+    if ((!searchJob && !queryCursor) || !root)
+        return;
+    // Bounded per tick so that a query matching most of a huge document
+    // cannot stall the UI while the rows are created.
+    constexpr std::size_t kMatchesPerPoll = 4096;
+    constexpr std::size_t kQueryVisitsPerPoll = 200000;
+    std::vector<std::vector<std::uint32_t>> paths;
+    bool done = false;
+    if (searchJob)
+    {
+        paths = searchJob->takeResults(kMatchesPerPoll);
+        done = searchJob->finished();
+    }
+    else
+    {
+        paths = queryCursor->next(kMatchesPerPoll, kQueryVisitsPerPoll);
+        done = queryCursor->done();
+    }
+    bool hadMatches = !search.matches.empty();
+    for (const auto &path : paths)
+    {
+        if (Node *match = materializePath(root.get(), path))
+            search.matches.push_back(match);
+    }
+    if (!done && paths.empty())
+        return;
+
+    if (done)
+    {
+        searchJob.reset();
+        queryCursor.reset();
+        search.running = false;
+    }
+    if (!hadMatches && !search.matches.empty())
+        revealMatch(search.matches[search.currentIndex]);
+    else if (outline)
+        outline->drawView();
+    updateStatusBar();
+    if (done && search.matches.empty())
+        messageBox("No matches", mfOKButton);
+}
+
+void JsonViewApp::toggleFollow()
+{
+    if (!lines)
+    {
+        messageBox("Follow is only available for JSON Lines files", mfInformation | mfOKButton);
+        return;
+    }
+    follow = !follow;
+    if (follow)
+        pollFollowedFile();
+}
+
+// Index records appended to the followed file, like tail -f.  The file is
+// checked at most twice a second.
+void JsonViewApp::pollFollowedFile()
+{
+    if (!follow || !lines || !root)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < std::chrono::milliseconds(500))
+        return;
+    lastPoll = now;
+
+    switch (lines->refresh())
+    {
+    case JsonLines::RefreshResult::Unchanged:
+        return;
+    case JsonLines::RefreshResult::Reset:
+        searchJob.reset();
+        queryCursor.reset();
+        searchIndex.reset();
+        root = buildLinesTree(lines, root->key);
+        search = SearchState();
+        rebuildOutline();
+        updateStatusBar();
+        return;
+    case JsonLines::RefreshResult::Appended:
+        break;
+    }
+
+    if (!outline)
+        return;
+    // Stay at the end when the last record was focused, like a pager in
+    // follow mode; otherwise keep the user's place.
+    JsonTNode *focused = outline->focusedNode();
+    bool atTail = focused && focused->parent == outline->root && focused->jsonNode->isLastChild;
+    appendNewRecords(root.get());
+    outline->update();
+    if (atTail && root->childCount > 0)
+        outline->focusNode(outline->root->childAt(root->childCount - 1));
+    else
+        outline->drawView();
+}
+
 void JsonViewApp::rebuildOutline()
 {
-    nodeMap.clear();
     if (outline)
     {
         deskTop->remove(outline->owner);
@@ -470,34 +996,9 @@ void JsonViewApp::rebuildOutline()
     if (!root)
         return;
 
-    struct Builder
-    {
-        std::unordered_map<const Node *, JsonTNode *> &map;
-        JsonTNode *operator()(const Node *n)
-        {
-            JsonTNode *firstChild = nullptr;
-            JsonTNode *prev = nullptr;
-            std::vector<JsonTNode *> createdChildren;
-            for (const auto &c : n->children)
-            {
-                JsonTNode *child = (*this)(c.get());
-                createdChildren.push_back(child);
-                if (!firstChild)
-                    firstChild = child;
-                else
-                    prev->next = child;
-                prev = child;
-            }
-            std::string label = getContentLabel(n);
-            auto node = new JsonTNode(n, label, firstChild, nullptr, n->expanded ? True : False);
-            for (auto *child : createdChildren)
-                child->parent = node;
-            map[n] = node;
-            return node;
-        }
-    } builder{nodeMap};
-
-    JsonTNode *tvRoot = builder(root.get());
+    // The outline mirrors the Node tree lazily: beyond the root, outline
+    // nodes are only made for rows that are drawn, focused or expanded.
+    auto *tvRoot = new JsonTNode(root.get(), nullptr);
 
     TRect r = deskTop->getExtent();
     r.grow(-2, -2);
@@ -520,7 +1021,6 @@ void JsonViewApp::rebuildOutline()
     win->insert(sbV);
     win->insert(view);
     outline = view;
-    outline->update();
     sbH->drawView();
     sbV->drawView();
     outline->drawView();
@@ -530,11 +1030,144 @@ void JsonViewApp::syncOutlineExpansion()
 {
     if (!outline)
         return;
-    syncExpanded(outline->root);
     outline->update();
     outline->drawView();
 }
 
+void JsonViewApp::revealMatch(const Node *match)
+{
+    if (!outline)
+        return;
+    expandPath(const_cast<Node *>(match));
+    JsonTNode *target = outline->outlineNodeFor(match);
+    if (!target)
+        return;
+    outline->update();
+    outline->focusNode(target);
+}
+
+void JsonViewApp::runQuery()
+{
+    if (!outline || !root || !searchAvailable())
+        return;
+    struct QueryDialogData
+    {
+        char query[256];
+    } data{{""}};
+    TDialog *d = new TDialog(TRect(0, 0, 64, 9), "Query");
+    d->options |= ofCentered;
+    auto *il = new TInputLine(TRect(3, 3, 61, 4), 255);
+    d->insert(il);
+    d->insert(new TLabel(TRect(2, 2, 30, 3), "~J~SONPath or jq path:", il));
+    d->insert(new TButton(TRect(20, 6, 30, 8), "O~K~", cmOK, bfDefault));
+    d->insert(new TButton(TRect(32, 6, 42, 8), "Cancel", cmCancel, bfNormal));
+    if (executeDialog(d, &data) == cmCancel)
+        return;
+
+    std::shared_ptr<const JsonQuery> query;
+    try
+    {
+        query = std::make_shared<const JsonQuery>(data.query);
+    }
+    catch (const std::invalid_argument &e)
+    {
+        messageBox(("Invalid query: " + std::string(e.what())).c_str(), mfError | mfOKButton);
+        return;
+    }
+    endSearch();
+    search.term = data.query;
+    search.isQuery = true;
+    search.running = true;
+    // Results are evaluated and revealed from idle(), so the first ones
+    // show up before a large document has been walked.
+    queryCursor = std::make_unique<JsonQueryCursor>(std::move(query), root.get());
+    pollSearch();
+    updateStatusBar();
+}
+
+// Searches and queries address values by their position in the document,
+// which the merged tree of a diff does not follow.
+bool JsonViewApp::searchAvailable()
+{
+    if (!root || !root->leftDocument)
+        return true;
+    messageBox("Search is not available while comparing files", mfInformation | mfOKButton);
+    return false;
+}
+
+void JsonViewApp::compareWith()
+{
+    if (!root || !root->document)
+    {
+        messageBox("Open a JSON document to compare first", mfInformation | mfOKButton);
+        return;
+    }
+    struct CompareDialogData
+    {
+        char path[1024];
+        char idKey[256];
+    } data{{""}, {""}};
+    TDialog *d = new TDialog(TRect(0, 0, 50, 11), "Compare With");
+    d->options |= ofCentered;
+    auto *fileLine = new TInputLine(TRect(3, 3, 47, 4), sizeof(data.path) - 1);
+    d->insert(fileLine);
+    d->insert(new TLabel(TRect(2, 2, 12, 3), "~F~ile:", fileLine));
+    auto *keyLine = new TInputLine(TRect(3, 6, 47, 7), sizeof(data.idKey) - 1);
+    d->insert(keyLine);
+    d->insert(new TLabel(TRect(2, 5, 40, 6), "Match list items by ~k~ey:", keyLine));
+    d->insert(new TButton(TRect(14, 8, 24, 10), "O~K~", cmOK, bfDefault));
+    d->insert(new TButton(TRect(26, 8, 36, 10), "Cancel", cmCancel, bfNormal));
+    if (executeDialog(d, &data) == cmCancel || data.path[0] == '\0')
+        return;
+    showDiff(data.path, data.idKey);
+}
+
+static std::string baseName(const std::string &path)
+{
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+// Replace the tree with the differences between the document shown (the
+// right side of a diff already shown) and another file.
+bool JsonViewApp::showDiff(const std::string &name, const std::string &idKey)
+{
+    if (!root || !root->ownedDocument)
+    {
+        messageBox("Open a JSON document to compare first", mfInformation | mfOKButton);
+        return false;
+    }
+    std::shared_ptr<const JsonDocument> left = root->ownedDocument;
+    std::shared_ptr<const JsonDocument> right;
+    std::vector<JsonDiffEntry> entries;
+    try
+    {
+        right = JsonDocument::open(name);
+        entries = diffDocuments(*left, *right, JsonDiffOptions{idKey});
+    }
+    catch (const JsonParseError &e)
+    {
+        messageBox(("Invalid JSON: " + std::string(e.what())).c_str(), mfError | mfOKButton);
+        return false;
+    }
+    catch (const std::exception &)
+    {
+        messageBox("Could not open file", mfError | mfOKButton);
+        return false;
+    }
+    std::string title = baseName(documentName) + " → " + baseName(name);
+    documentName = name;
+    searchJob.reset();
+    queryCursor.reset();
+    searchIndex.reset();
+    follow = false;
+    root = buildDiffTree(std::move(left), std::move(right), entries, title);
+    search = SearchState();
+    rebuildOutline();
+    updateStatusBar();
+    return true;
+}
+
 void JsonViewApp::updateStatusBar()
 {
     static_cast<JsonStatusLine *>(statusLine)->setSearchState(search);
@@ -546,53 +1179,74 @@ void JsonViewApp::doSearch(bool newTerm)
         return;
     if (newTerm)
     {
+        if (!searchAvailable())
+            return;
         struct SearchDialogData
         {
             char term[256];
+            char path[256];
             ushort mode;
-        } data{{""}, 0};
-        TDialog *d = new TDialog(TRect(0, 0, 40, 12), "Search");
+            ushort options;
+        } data{{""}, {""}, 0, 0};
+        TDialog *d = new TDialog(TRect(0, 0, 40, 17), "Search");
         d->options |= ofCentered;
         auto *il = new TInputLine(TRect(3, 3, 35, 4), 255);
         d->insert(il);
         d->insert(new TLabel(TRect(2, 2, 12, 3), "~T~erm:", il));
-        auto *rb = new TRadioButtons(TRect(3, 5, 35, 8),
+        auto *pathLine = new TInputLine(TRect(3, 5, 35, 6), 255);
+        d->insert(pathLine);
+        d->insert(new TLabel(TRect(2, 4, 20, 5), "~P~ath filter:", pathLine));
+        auto *rb = new TRadioButtons(TRect(3, 7, 35, 10),
                                      new TSItem("~K~eys",
                                                 new TSItem("~V~alues",
                                                            new TSItem("~B~oth", nullptr))));
         d->insert(rb);
-        d->insert(new TButton(TRect(9, 9, 19, 11), "O~K~", cmOK, bfDefault));
-        d->insert(new TButton(TRect(21, 9, 31, 11), "Cancel", cmCancel, bfNormal));
-        if (executeDialog(d, &data) != cmCancel)
+        d->insert(new TCheckBoxes(TRect(3, 11, 35, 12), new TSItem("~R~egular expression", nullptr)));
+        d->insert(new TButton(TRect(9, 14, 19, 16), "O~K~", cmOK, bfDefault));
+        d->insert(new TButton(TRect(21, 14, 31, 16), "Cancel", cmCancel, bfNormal));
+        if (executeDialog(d, &data) == cmCancel)
+            return;
+
+        searchJob.reset();
+        search = SearchState();
+        search.term = data.term;
+        search.path = data.path;
+        search.searchKeys = (data.mode != 1);
+        search.searchValues = (data.mode != 0);
+        search.regex = (data.options & 1) != 0;
+        JsonSearchQuery query{search.term, search.searchKeys, search.searchValues, search.regex, search.path};
+        if (query.term.empty() && query.path.empty())
+            return;
+        // A followed file may have grown since its records were indexed.
+        if (lines && (!searchIndex || searchIndexRecords != lines->recordCount()))
         {
-            search.matches.clear();
-            search.term = data.term;
-            search.searchKeys = (data.mode != 1);
-            search.searchValues = (data.mode != 0);
-            searchTree(root.get(), search.term, search.searchKeys, search.searchValues, search.matches);
-            search.currentIndex = 0;
+            searchIndex = JsonSearchIndex::build(*lines);
+            searchIndexRecords = lines->recordCount();
         }
-        else
+        if (!searchIndex)
             return;
+        try
+        {
+            searchJob = std::make_unique<JsonSearchJob>(searchIndex, std::move(query));
+        }
+        catch (const std::exception &e)
+        {
+            messageBox(("Invalid search: " + std::string(e.what())).c_str(), mfError | mfOKButton);
+            return;
+        }
+        // Matches are picked up from idle() while the query runs.
+        search.running = true;
+        updateStatusBar();
+        return;
     }
     if (search.matches.empty())
     {
-        messageBox("No matches", mfOKButton);
+        if (!search.running)
+            messageBox("No matches", mfOKButton);
         updateStatusBar();
         return;
     }
-    const Node *n = search.matches[search.currentIndex];
-    for (const Node *p = n; p; p = p->parent)
-    {
-        auto it = nodeMap.find(p);
-        if (it != nodeMap.end())
-        {
-            it->second->expanded = True;
-            const_cast<Node *>(p)->expanded = true;
-        }
-    }
-    outline->update();
-    outline->focusNode(nodeMap[n]);
+    revealMatch(search.matches[search.currentIndex]);
     if (!newTerm)
         search.currentIndex = (search.currentIndex + 1) % search.matches.size();
     updateStatusBar();
@@ -605,26 +1259,65 @@ void JsonViewApp::copySelection()
     JsonTNode *n = outline->focusedNode();
     if (!n)
         return;
-    json j = reconstructJson(n->jsonNode);
+    // Streamed from the source bytes rather than rebuilt as a DOM.
+    std::string text = nodeJsonText(n->jsonNode, JsonWriteStyle::Minified);
 
     bool useLibrary = true;
     if (useLibrary)
     {
-        TClipboard::setText(j.dump().c_str());
+        TClipboard::setText(TStringView(text.data(), text.size()));
     }
     else
     {
-        copyToClipboard(j.dump());
+        copyToClipboard(text);
     }
     messageBox(getClipboardStatusMessage().c_str(), mfOKButton);
 }
 
+void JsonViewApp::exportSelection()
+{
+    if (!outline)
+        return;
+    JsonTNode *n = outline->focusedNode();
+    if (!n)
+        return;
+    struct ExportDialogData
+    {
+        char path[1024];
+        ushort style;
+    } data{{""}, static_cast<ushort>(JsonWriteStyle::Pretty)};
+    TDialog *d = new TDialog(TRect(0, 0, 50, 13), "Export Selection");
+    d->options |= ofCentered;
+    auto *il = new TInputLine(TRect(3, 3, 47, 4), sizeof(data.path) - 1);
+    d->insert(il);
+    d->insert(new TLabel(TRect(2, 2, 12, 3), "~F~ile:", il));
+    auto *rb = new TRadioButtons(TRect(3, 5, 35, 8),
+                                 new TSItem("~R~aw source",
+                                            new TSItem("~P~retty",
+                                                       new TSItem("~M~inified", nullptr))));
+    d->insert(rb);
+    d->insert(new TButton(TRect(14, 10, 24, 12), "O~K~", cmOK, bfDefault));
+    d->insert(new TButton(TRect(26, 10, 36, 12), "Cancel", cmCancel, bfNormal));
+    if (executeDialog(d, &data) == cmCancel || data.path[0] == '\0')
+        return;
+    try
+    {
+        exportNodeJson(n->jsonNode, static_cast<JsonWriteStyle>(data.style), data.path);
+    }
+    catch (const std::exception &e)
+    {
+        messageBox(e.what(), mfError | mfOKButton);
+    }
+}
+
 TMenuBar *JsonViewApp::initMenuBar(TRect r)
 {
     r.b.y = r.a.y + 1;
     TSubMenu &fileMenu = *new TSubMenu("~F~ile", hcNoContext) +
                          *new TMenuItem("~O~pen", cmOpen, kbNoKey, hcNoContext) +
                          *new TMenuItem("~C~lose", cmClose, kbNoKey, hcNoContext) +
+                         newLine() +
+                         *new TMenuItem("Co~m~pare With...", cmCompare, kbNoKey, hcNoContext) +
                          newLine();
     if (ck::launcher::launchedFromCkLauncher())
         fileMenu + *new TMenuItem("Return to ~L~auncher", cmReturnToLauncher, kbNoKey, hcNoContext);
@@ -633,11 +1326,14 @@ TMenuBar *JsonViewApp::initMenuBar(TRect r)
     TMenuItem &menuChain = fileMenu +
                            *new TSubMenu("~E~dit", hcNoContext) +
                            *new TMenuItem("~C~opy", cmCopy, kbNoKey, hcNoContext) +
+                           *new TMenuItem("~E~xport Selection...", cmExportSelection, kbNoKey, hcNoContext) +
                            *new TSubMenu("~S~earch", hcNoContext) +
                            *new TMenuItem("~F~ind", cmFind, kbNoKey, hcNoContext) +
                            *new TMenuItem("Find ~N~ext", cmFindNext, kbNoKey, hcNoContext) +
                            *new TMenuItem("Find ~P~rev", cmFindPrev, kbNoKey, hcNoContext) +
                            *new TMenuItem("~E~nd Search", cmEndSearch, kbNoKey, hcNoContext) +
+                           newLine() +
+                           *new TMenuItem("~Q~uery...", cmQuery, kbNoKey, hcNoContext) +
                            *new TSubMenu("~V~iew", hcNoContext) +
                            *new TMenuItem("Level ~0~", cmLevel0, kbNoKey, hcNoContext) +
                            *new TMenuItem("Level ~1~", cmLevel1, kbNoKey, hcNoContext) +
@@ -649,6 +1345,8 @@ TMenuBar *JsonViewApp::initMenuBar(TRect r)
                            *new TMenuItem("Level ~7~", cmLevel7, kbNoKey, hcNoContext) +
                            *new TMenuItem("Level ~8~", cmLevel8, kbNoKey, hcNoContext) +
                            *new TMenuItem("Level ~9~", cmLevel9, kbNoKey, hcNoContext) +
+                           newLine() +
+                           *new TMenuItem("~F~ollow File", cmFollow, kbNoKey, hcNoContext) +
                            *new TSubMenu("~H~elp", hcNoContext) +
                            *new TMenuItem("~A~bout", cmAbout, kbNoKey, hcNoContext);
 
@@ -0,0 +1,1229 @@
+// CBOR, MessagePack, BSON and UBJSON decoding for json-view documents
+#include "json_binary.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+constexpr std::uint64_t kIndefinite = ~std::uint64_t{0};
+
+[[noreturn]] void fail(std::uint64_t offset, const std::string &message)
+{
+    throw JsonParseError("byte " + std::to_string(offset) + ": " + message, offset);
+}
+
+// Throw unless n bytes are available at pos.
+void need(std::string_view data, std::uint64_t pos, std::uint64_t n)
+{
+    if (pos > data.size() || n > data.size() - pos)
+        fail(std::min<std::uint64_t>(pos, data.size()), "unexpected end of input");
+}
+
+std::uint64_t readBig(std::string_view data, std::uint64_t pos, unsigned bytes)
+{
+    std::uint64_t value = 0;
+    for (unsigned i = 0; i < bytes; ++i)
+        value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+    return value;
+}
+
+std::uint64_t readLittle(std::string_view data, std::uint64_t pos, unsigned bytes)
+{
+    std::uint64_t value = 0;
+    for (unsigned i = bytes; i-- > 0;)
+        value = (value << 8) | static_cast<unsigned char>(data[pos + i]);
+    return value;
+}
+
+std::int64_t signExtend(std::uint64_t value, unsigned bytes)
+{
+    unsigned shift = 64 - 8 * bytes;
+    return static_cast<std::int64_t>(value << shift) >> shift;
+}
+
+double halfToDouble(std::uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+    double value;
+    if (exponent == 0)
+        value = std::ldexp(mantissa, -24);
+    else if (exponent == 31)
+        value = mantissa ? std::nan("") : INFINITY;
+    else
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    return (half & 0x8000) ? -value : value;
+}
+
+// Shortest round-trip text, spelled the way the text tokenizer accepts.
+template <typename Float>
+std::string formatFloat(Float value)
+{
+    if (std::isnan(value))
+        return "NaN";
+    if (std::isinf(value))
+        return value < 0 ? "-Infinity" : "Infinity";
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    std::string text(buffer, result.ptr);
+    if (text.find_first_of(".e") == std::string::npos)
+        text += ".0";
+    return text;
+}
+
+std::string hexText(std::string_view bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(bytes.size() * 2);
+    for (char c : bytes)
+    {
+        out.push_back(digits[static_cast<unsigned char>(c) >> 4]);
+        out.push_back(digits[static_cast<unsigned char>(c) & 0x0F]);
+    }
+    return out;
+}
+
+// Text of a scalar used as a map key.
+std::string scalarKey(const JsonBinaryCodec &codec, std::string_view data, JsonValue value)
+{
+    switch (codec.kind(data, value))
+    {
+    case JsonKind::String:
+        return codec.stringValue(data, value);
+    case JsonKind::Number:
+        return codec.numberText(data, value);
+    case JsonKind::Boolean:
+        return codec.booleanValue(data, value) ? "true" : "false";
+    default:
+        return "null";
+    }
+}
+
+// Open containers while scanning a counted encoding.
+struct OpenContainer
+{
+    // Members left, or kIndefinite until a terminator.
+    std::uint64_t remaining;
+    bool object;
+    bool atKey;
+    // UBJSON: element type of a strongly typed container.
+    std::uint8_t type;
+};
+
+// Reject member counts the remaining input could not hold.
+void checkCount(std::string_view data, std::uint64_t pos, std::uint64_t count, std::uint64_t minBytes)
+{
+    std::uint64_t available = pos <= data.size() ? data.size() - pos : 0;
+    if (count > JsonValue::kNoContainer || (minBytes && count > available / minBytes) ||
+        (!minBytes && count > data.size()))
+        fail(pos, "container is larger than the input");
+}
+
+// ---------------------------------------------------------------------------
+// MessagePack
+
+struct MsgHead
+{
+    JsonKind kind = JsonKind::Number;
+    // Scalars: content bytes; containers: members.
+    std::uint64_t content = 0;
+    std::uint64_t length = 0;
+    bool blob = false;
+    unsigned char code = 0;
+};
+
+MsgHead msgHead(std::string_view data, std::uint64_t pos)
+{
+    need(data, pos, 1);
+    unsigned char b = static_cast<unsigned char>(data[pos]);
+    MsgHead h;
+    h.code = b;
+    h.content = pos + 1;
+    auto sized = [&](JsonKind kind, unsigned lengthBytes, bool blob)
+    {
+        need(data, pos + 1, lengthBytes);
+        h.kind = kind;
+        h.length = readBig(data, pos + 1, lengthBytes);
+        h.content = pos + 1 + lengthBytes;
+        h.blob = blob;
+    };
+    if (b <= 0x7F || b >= 0xE0)
+    {
+        // Fixints hold their value in the marker.
+        h.content = pos;
+        h.length = 1;
+    }
+    else if (b <= 0x8F)
+    {
+        h.kind = JsonKind::Object;
+        h.length = b & 0x0F;
+    }
+    else if (b <= 0x9F)
+    {
+        h.kind = JsonKind::Array;
+        h.length = b & 0x0F;
+    }
+    else if (b <= 0xBF)
+    {
+        h.kind = JsonKind::String;
+        h.length = b & 0x1F;
+    }
+    else
+    {
+        switch (b)
+        {
+        case 0xC0:
+            h.kind = JsonKind::Null;
+            break;
+        case 0xC2:
+        case 0xC3:
+            h.kind = JsonKind::Boolean;
+            break;
+        case 0xC4:
+        case 0xC5:
+        case 0xC6:
+            sized(JsonKind::String, 1u << (b - 0xC4), true);
+            break;
+        case 0xC7:
+        case 0xC8:
+        case 0xC9:
+            // Extension: length, type byte, data.
+            sized(JsonKind::String, 1u << (b - 0xC7), true);
+            ++h.content;
+            break;
+        case 0xCA:
+            h.length = 4;
+            break;
+        case 0xCB:
+            h.length = 8;
+            break;
+        case 0xCC:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            h.length = 1u << (b - 0xCC);
+            break;
+        case 0xD0:
+        case 0xD1:
+        case 0xD2:
+        case 0xD3:
+            h.length = 1u << (b - 0xD0);
+            break;
+        case 0xD4:
+        case 0xD5:
+        case 0xD6:
+        case 0xD7:
+        case 0xD8:
+            h.kind = JsonKind::String;
+            h.blob = true;
+            h.length = 1u << (b - 0xD4);
+            h.content = pos + 2;
+            break;
+        case 0xD9:
+        case 0xDA:
+        case 0xDB:
+            sized(JsonKind::String, 1u << (b - 0xD9), false);
+            break;
+        case 0xDC:
+        case 0xDD:
+            sized(JsonKind::Array, 2u << (b - 0xDC), false);
+            break;
+        case 0xDE:
+        case 0xDF:
+            sized(JsonKind::Object, 2u << (b - 0xDE), false);
+            break;
+        default:
+            fail(pos, "invalid MessagePack type byte");
+        }
+    }
+    return h;
+}
+
+class MessagePackCodec : public JsonBinaryCodec
+{
+public:
+    JsonValue scan(std::string_view data, JsonEventHandler &handler) const override
+    {
+        std::vector<OpenContainer> open;
+        std::uint64_t pos = 0;
+        auto item = [&](bool isKey)
+        {
+            MsgHead h = msgHead(data, pos);
+            if (h.kind == JsonKind::Array || h.kind == JsonKind::Object)
+            {
+                if (isKey)
+                    fail(pos, "map keys must be scalars");
+                bool object = h.kind == JsonKind::Object;
+                checkCount(data, h.content, h.length, object ? 2 : 1);
+                handler.beginContainer(pos, object);
+                open.push_back(OpenContainer{h.length, object, true, 0});
+                pos = h.content;
+                return;
+            }
+            need(data, h.content, h.length);
+            std::uint64_t end = h.content + h.length;
+            if (isKey)
+                handler.key(pos, end);
+            else
+                handler.scalar(pos, end, h.kind);
+            pos = end;
+        };
+
+        item(false);
+        while (!open.empty())
+        {
+            OpenContainer &top = open.back();
+            if (top.remaining == 0)
+            {
+                handler.endContainer(pos - 1);
+                open.pop_back();
+            }
+            else if (top.object && top.atKey)
+            {
+                top.atKey = false;
+                item(true);
+            }
+            else
+            {
+                --top.remaining;
+                top.atKey = true;
+                item(false);
+            }
+        }
+        if (pos != data.size())
+            fail(pos, "unexpected data after the document");
+        return JsonValue{};
+    }
+
+    JsonKind kind(std::string_view data, JsonValue value) const override
+    {
+        return msgHead(data, value.offset).kind;
+    }
+
+    std::uint64_t firstMember(std::string_view data, JsonValue container) const override
+    {
+        return msgHead(data, container.offset).content;
+    }
+
+    void readMember(std::string_view data, JsonValue container, std::uint64_t pos, JsonMember &member) const override
+    {
+        member = JsonMember();
+        if (kind(data, container) == JsonKind::Object)
+        {
+            member.keyOffset = pos;
+            MsgHead key = msgHead(data, pos);
+            pos = key.content + key.length;
+        }
+        member.value.offset = pos;
+    }
+
+    std::uint64_t scalarEnd(std::string_view data, JsonValue value) const override
+    {
+        MsgHead h = msgHead(data, value.offset);
+        return h.content + h.length;
+    }
+
+    std::string key(std::string_view data, std::uint64_t keyOffset) const override
+    {
+        return scalarKey(*this, data, JsonValue{keyOffset});
+    }
+
+    std::string stringValue(std::string_view data, JsonValue value) const override
+    {
+        MsgHead h = msgHead(data, value.offset);
+        std::string_view bytes = data.substr(h.content, h.length);
+        return h.blob ? hexText(bytes) : std::string(bytes);
+    }
+
+    bool booleanValue(std::string_view data, JsonValue value) const override
+    {
+        return static_cast<unsigned char>(data[value.offset]) == 0xC3;
+    }
+
+    std::string numberText(std::string_view data, JsonValue value) const override
+    {
+        MsgHead h = msgHead(data, value.offset);
+        unsigned char b = h.code;
+        if (b <= 0x7F)
+            return std::to_string(b);
+        if (b >= 0xE0)
+            return std::to_string(static_cast<int>(static_cast<signed char>(b)));
+        auto bytes = static_cast<unsigned>(h.length);
+        std::uint64_t raw = readBig(data, h.content, bytes);
+        if (b == 0xCA)
+            return formatFloat(std::bit_cast<float>(static_cast<std::uint32_t>(raw)));
+        if (b == 0xCB)
+            return formatFloat(std::bit_cast<double>(raw));
+        if (b >= 0xD0)
+            return std::to_string(signExtend(raw, bytes));
+        return std::to_string(raw);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// CBOR
+
+struct CborHead
+{
+    unsigned major = 0;
+    unsigned info = 0;
+    std::uint64_t argument = 0;
+    std::uint64_t content = 0;
+    bool indefinite = false;
+};
+
+CborHead cborHead(std::string_view data, std::uint64_t pos)
+{
+    need(data, pos, 1);
+    unsigned char b = static_cast<unsigned char>(data[pos]);
+    CborHead h;
+    h.major = b >> 5;
+    h.info = b & 0x1F;
+    h.content = pos + 1;
+    if (h.info < 24)
+        h.argument = h.info;
+    else if (h.info <= 27)
+    {
+        unsigned bytes = 1u << (h.info - 24);
+        need(data, pos + 1, bytes);
+        h.argument = readBig(data, pos + 1, bytes);
+        h.content += bytes;
+    }
+    else if (h.info == 31 && h.major >= 2 && h.major != 6)
+        h.indefinite = true;
+    else
+        fail(pos, "invalid CBOR initial byte");
+    return h;
+}
+
+bool isBreak(std::string_view data, std::uint64_t pos)
+{
+    need(data, pos, 1);
+    return static_cast<unsigned char>(data[pos]) == 0xFF;
+}
+
+// Tags only annotate the item that follows them.
+std::uint64_t skipTags(std::string_view data, std::uint64_t pos)
+{
+    for (;;)
+    {
+        need(data, pos, 1);
+        if ((static_cast<unsigned char>(data[pos]) >> 5) != 6)
+            return pos;
+        pos = cborHead(data, pos).content;
+    }
+}
+
+JsonKind cborKind(const CborHead &h)
+{
+    switch (h.major)
+    {
+    case 0:
+    case 1:
+        return JsonKind::Number;
+    case 2:
+    case 3:
+        return JsonKind::String;
+    case 4:
+        return JsonKind::Array;
+    case 5:
+        return JsonKind::Object;
+    default:
+        if (h.info == 20 || h.info == 21)
+            return JsonKind::Boolean;
+        if (h.info >= 25 && h.info <= 27)
+            return JsonKind::Number;
+        return JsonKind::Null;
+    }
+}
+
+// Visit the content of a byte or text string, chunk by chunk when it has
+// an indefinite length; returns one past its end.
+template <typename Visit>
+std::uint64_t cborStringChunks(std::string_view data, std::uint64_t pos, Visit &&visit)
+{
+    CborHead h = cborHead(data, pos);
+    if (!h.indefinite)
+    {
+        need(data, h.content, h.argument);
+        visit(data.substr(h.content, h.argument));
+        return h.content + h.argument;
+    }
+    pos = h.content;
+    while (!isBreak(data, pos))
+    {
+        CborHead chunk = cborHead(data, pos);
+        if (chunk.major != h.major || chunk.indefinite)
+            fail(pos, "invalid chunk in an indefinite-length string");
+        need(data, chunk.content, chunk.argument);
+        visit(data.substr(chunk.content, chunk.argument));
+        pos = chunk.content + chunk.argument;
+    }
+    return pos + 1;
+}
+
+class CborCodec : public JsonBinaryCodec
+{
+public:
+    JsonValue scan(std::string_view data, JsonEventHandler &handler) const override
+    {
+        std::vector<OpenContainer> open;
+        std::uint64_t pos = 0;
+        JsonValue root;
+        auto item = [&](bool isKey)
+        {
+            pos = skipTags(data, pos);
+            CborHead h = cborHead(data, pos);
+            if (h.major == 7 && h.indefinite)
+                fail(pos, "unexpected break");
+            JsonKind kind = cborKind(h);
+            if (kind == JsonKind::Array || kind == JsonKind::Object)
+            {
+                if (isKey)
+                    fail(pos, "map keys must be scalars");
+                bool object = kind == JsonKind::Object;
+                if (!h.indefinite)
+                    checkCount(data, h.content, h.argument, object ? 2 : 1);
+                handler.beginContainer(pos, object);
+                open.push_back(OpenContainer{h.indefinite ? kIndefinite : h.argument, object, true, 0});
+                pos = h.content;
+                return;
+            }
+            std::uint64_t end = scalarEnd(data, JsonValue{pos});
+            if (isKey)
+                handler.key(pos, end);
+            else
+                handler.scalar(pos, end, kind);
+            pos = end;
+        };
+
+        root.offset = skipTags(data, 0);
+        item(false);
+        while (!open.empty())
+        {
+            OpenContainer &top = open.back();
+            if (top.remaining == kIndefinite ? isBreak(data, pos) : top.remaining == 0)
+            {
+                if (top.object && !top.atKey)
+                    fail(pos, "map key without a value");
+                if (top.remaining == kIndefinite)
+                    ++pos;
+                handler.endContainer(pos - 1);
+                open.pop_back();
+            }
+            else if (top.object && top.atKey)
+            {
+                top.atKey = false;
+                item(true);
+            }
+            else
+            {
+                if (top.remaining != kIndefinite)
+                    --top.remaining;
+                top.atKey = true;
+                item(false);
+            }
+        }
+        if (pos != data.size())
+            fail(pos, "unexpected data after the document");
+        return root;
+    }
+
+    JsonKind kind(std::string_view data, JsonValue value) const override
+    {
+        return cborKind(cborHead(data, value.offset));
+    }
+
+    std::uint64_t firstMember(std::string_view data, JsonValue container) const override
+    {
+        return cborHead(data, container.offset).content;
+    }
+
+    void readMember(std::string_view data, JsonValue container, std::uint64_t pos, JsonMember &member) const override
+    {
+        member = JsonMember();
+        if (kind(data, container) == JsonKind::Object)
+        {
+            member.keyOffset = skipTags(data, pos);
+            pos = scalarEnd(data, JsonValue{member.keyOffset});
+        }
+        member.value.offset = skipTags(data, pos);
+    }
+
+    std::uint64_t scalarEnd(std::string_view data, JsonValue value) const override
+    {
+        CborHead h = cborHead(data, value.offset);
+        if (h.major == 2 || h.major == 3)
+            return cborStringChunks(data, value.offset, [](std::string_view) {});
+        return h.content;
+    }
+
+    std::string key(std::string_view data, std::uint64_t keyOffset) const override
+    {
+        return scalarKey(*this, data, JsonValue{keyOffset});
+    }
+
+    std::string stringValue(std::string_view data, JsonValue value) const override
+    {
+        std::string out;
+        cborStringChunks(data, value.offset, [&](std::string_view chunk) { out.append(chunk); });
+        if (cborHead(data, value.offset).major == 2)
+            return hexText(out);
+        return out;
+    }
+
+    bool booleanValue(std::string_view data, JsonValue value) const override
+    {
+        return cborHead(data, value.offset).info == 21;
+    }
+
+    std::string numberText(std::string_view data, JsonValue value) const override
+    {
+        CborHead h = cborHead(data, value.offset);
+        if (h.major == 0)
+            return std::to_string(h.argument);
+        if (h.major == 1)
+        {
+            // -1 - argument, which may lie below the int64 range.
+            if (h.argument == ~std::uint64_t{0})
+                return "-18446744073709551616";
+            return "-" + std::to_string(h.argument + 1);
+        }
+        if (h.info == 25)
+            return formatFloat(halfToDouble(static_cast<std::uint16_t>(h.argument)));
+        if (h.info == 26)
+            return formatFloat(std::bit_cast<float>(static_cast<std::uint32_t>(h.argument)));
+        return formatFloat(std::bit_cast<double>(h.argument));
+    }
+};
+
+// ---------------------------------------------------------------------------
+// BSON
+
+constexpr std::uint8_t kBsonDocument = 0x03;
+constexpr std::uint8_t kBsonArray = 0x04;
+
+JsonKind bsonKind(std::uint8_t type)
+{
+    switch (type)
+    {
+    case 0x01: // double
+    case 0x09: // UTC datetime, milliseconds
+    case 0x10: // int32
+    case 0x11: // timestamp
+    case 0x12: // int64
+        return JsonKind::Number;
+    case 0x02: // string
+    case 0x05: // binary
+    case 0x07: // ObjectId
+    case 0x0B: // regular expression
+    case 0x0C: // DBPointer
+    case 0x0D: // JavaScript code
+    case 0x0E: // symbol
+    case 0x0F: // code with scope
+    case 0x13: // decimal128
+        return JsonKind::String;
+    case kBsonDocument:
+        return JsonKind::Object;
+    case kBsonArray:
+        return JsonKind::Array;
+    case 0x08:
+        return JsonKind::Boolean;
+    default:
+        return JsonKind::Null;
+    }
+}
+
+std::int64_t bsonInt32(std::string_view data, std::uint64_t pos)
+{
+    need(data, pos, 4);
+    return signExtend(readLittle(data, pos, 4), 4);
+}
+
+// One past the NUL ending the C string at pos.
+std::uint64_t bsonCStringEnd(std::string_view data, std::uint64_t pos, std::uint64_t limit)
+{
+    need(data, pos, 0);
+    const void *nul = std::memchr(data.data() + pos, 0, static_cast<std::size_t>(std::min<std::uint64_t>(limit, data.size()) - pos));
+    if (!nul)
+        fail(pos, "unterminated name");
+    return static_cast<const char *>(nul) - data.data() + 1;
+}
+
+// One past a length-prefixed, NUL-terminated string.
+std::uint64_t bsonStringEnd(std::string_view data, std::uint64_t pos)
+{
+    std::int64_t length = bsonInt32(data, pos);
+    if (length < 1)
+        fail(pos, "invalid string length");
+    need(data, pos + 4, static_cast<std::uint64_t>(length));
+    if (data[pos + 4 + length - 1] != '\0')
+        fail(pos, "string is not terminated");
+    return pos + 4 + static_cast<std::uint64_t>(length);
+}
+
+std::uint64_t bsonScalarEnd(std::string_view data, std::uint8_t type, std::uint64_t pos)
+{
+    std::uint64_t size = 0;
+    switch (type)
+    {
+    case 0x01:
+    case 0x09:
+    case 0x11:
+    case 0x12:
+        size = 8;
+        break;
+    case 0x02:
+    case 0x0D:
+    case 0x0E:
+        return bsonStringEnd(data, pos);
+    case 0x05:
+    {
+        std::int64_t length = bsonInt32(data, pos);
+        if (length < 0)
+            fail(pos, "invalid binary length");
+        size = 5 + static_cast<std::uint64_t>(length);
+        break;
+    }
+    case 0x06:
+    case 0x0A:
+    case 0x7F:
+    case 0xFF:
+        return pos;
+    case 0x07:
+        size = 12;
+        break;
+    case 0x08:
+        size = 1;
+        break;
+    case 0x0B:
+        return bsonCStringEnd(data, bsonCStringEnd(data, pos, data.size()), data.size());
+    case 0x0C:
+        size = bsonStringEnd(data, pos) - pos + 12;
+        break;
+    case 0x0F:
+    {
+        std::int64_t length = bsonInt32(data, pos);
+        if (length < 4)
+            fail(pos, "invalid code length");
+        size = static_cast<std::uint64_t>(length);
+        break;
+    }
+    case 0x10:
+        size = 4;
+        break;
+    case 0x13:
+        size = 16;
+        break;
+    default:
+        fail(pos, "unknown BSON element type");
+    }
+    need(data, pos, size);
+    return pos + size;
+}
+
+class BsonCodec : public JsonBinaryCodec
+{
+public:
+    JsonValue scan(std::string_view data, JsonEventHandler &handler) const override
+    {
+        // Documents and arrays end at their terminating NUL.
+        struct Open
+        {
+            std::uint64_t end;
+            bool array;
+        };
+        std::int64_t size = bsonInt32(data, 0);
+        if (size < 5 || static_cast<std::uint64_t>(size) != data.size())
+            fail(0, "document size does not match the input");
+        std::vector<Open> open{Open{data.size() - 1, false}};
+        handler.beginContainer(0, true);
+        std::uint64_t pos = 4;
+        while (!open.empty())
+        {
+            Open top = open.back();
+            if (pos == top.end)
+            {
+                if (data[pos] != '\0')
+                    fail(pos, "document is not terminated");
+                handler.endContainer(pos);
+                ++pos;
+                open.pop_back();
+                continue;
+            }
+            auto type = static_cast<std::uint8_t>(data[pos]);
+            std::uint64_t keyEnd = bsonCStringEnd(data, pos + 1, top.end);
+            if (!top.array)
+                handler.key(pos + 1, keyEnd);
+            pos = keyEnd;
+            if (type == kBsonDocument || type == kBsonArray)
+            {
+                std::int64_t length = bsonInt32(data, pos);
+                if (length < 5 || static_cast<std::uint64_t>(length) > top.end - pos)
+                    fail(pos, "invalid document length");
+                handler.beginContainer(pos, type == kBsonDocument);
+                open.push_back(Open{pos + static_cast<std::uint64_t>(length) - 1, type == kBsonArray});
+                pos += 4;
+                continue;
+            }
+            std::uint64_t end = bsonScalarEnd(data, type, pos);
+            if (end > top.end)
+                fail(pos, "element overruns its document");
+            handler.scalar(pos, end, bsonKind(type));
+            pos = end;
+        }
+        JsonValue root;
+        root.type = kBsonDocument;
+        return root;
+    }
+
+    JsonKind kind(std::string_view, JsonValue value) const override
+    {
+        return bsonKind(value.type);
+    }
+
+    std::uint64_t firstMember(std::string_view, JsonValue container) const override
+    {
+        return container.offset + 4;
+    }
+
+    void readMember(std::string_view data, JsonValue container, std::uint64_t pos, JsonMember &member) const override
+    {
+        member = JsonMember();
+        if (container.type == kBsonDocument)
+            member.keyOffset = pos + 1;
+        member.value.type = static_cast<std::uint8_t>(data[pos]);
+        member.value.offset = bsonCStringEnd(data, pos + 1, data.size());
+    }
+
+    std::uint64_t scalarEnd(std::string_view data, JsonValue value) const override
+    {
+        return bsonScalarEnd(data, value.type, value.offset);
+    }
+
+    std::string key(std::string_view data, std::uint64_t keyOffset) const override
+    {
+        return std::string(data.data() + keyOffset);
+    }
+
+    std::string stringValue(std::string_view data, JsonValue value) const override
+    {
+        std::uint64_t pos = value.offset;
+        auto lengthPrefixed = [&](std::uint64_t at)
+        { return std::string(data.substr(at + 4, static_cast<std::uint64_t>(bsonInt32(data, at)) - 1)); };
+        switch (value.type)
+        {
+        case 0x02:
+        case 0x0C:
+        case 0x0D:
+        case 0x0E:
+            return lengthPrefixed(pos);
+        case 0x0F:
+            return lengthPrefixed(pos + 4);
+        case 0x05:
+            return hexText(data.substr(pos + 5, static_cast<std::uint64_t>(bsonInt32(data, pos))));
+        case 0x07:
+            return hexText(data.substr(pos, 12));
+        case 0x13:
+            return hexText(data.substr(pos, 16));
+        case 0x0B:
+        {
+            std::string pattern(data.data() + pos);
+            std::string flags(data.data() + pos + pattern.size() + 1);
+            return "/" + pattern + "/" + flags;
+        }
+        default:
+            return {};
+        }
+    }
+
+    bool booleanValue(std::string_view data, JsonValue value) const override
+    {
+        return data[value.offset] != '\0';
+    }
+
+    std::string numberText(std::string_view data, JsonValue value) const override
+    {
+        switch (value.type)
+        {
+        case 0x01:
+            return formatFloat(std::bit_cast<double>(readLittle(data, value.offset, 8)));
+        case 0x10:
+            return std::to_string(bsonInt32(data, value.offset));
+        case 0x11:
+            return std::to_string(readLittle(data, value.offset, 8));
+        default:
+            return std::to_string(static_cast<std::int64_t>(readLittle(data, value.offset, 8)));
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// UBJSON
+
+struct UbHead
+{
+    char marker = 0;
+    std::uint64_t content = 0;
+};
+
+// A value's marker, which strongly typed containers store once for all.
+UbHead ubHead(std::string_view data, JsonValue value)
+{
+    if (value.type)
+        return UbHead{static_cast<char>(value.type), value.offset};
+    need(data, value.offset, 1);
+    return UbHead{data[value.offset], value.offset + 1};
+}
+
+int ubIntegerSize(char marker)
+{
+    switch (marker)
+    {
+    case 'i':
+    case 'U':
+        return 1;
+    case 'I':
+        return 2;
+    case 'l':
+        return 4;
+    case 'L':
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+std::int64_t ubInteger(std::string_view data, char marker, std::uint64_t pos)
+{
+    auto bytes = static_cast<unsigned>(ubIntegerSize(marker));
+    need(data, pos, bytes);
+    std::uint64_t raw = readBig(data, pos, bytes);
+    return marker == 'U' ? static_cast<std::int64_t>(raw) : signExtend(raw, bytes);
+}
+
+// A length: an integer with its marker.  Sets next to the following byte.
+std::uint64_t ubLength(std::string_view data, std::uint64_t pos, std::uint64_t &next)
+{
+    need(data, pos, 1);
+    char marker = data[pos];
+    if (!ubIntegerSize(marker))
+        fail(pos, "expected a length");
+    std::int64_t length = ubInteger(data, marker, pos + 1);
+    if (length < 0)
+        fail(pos, "negative length");
+    next = pos + 1 + ubIntegerSize(marker);
+    return static_cast<std::uint64_t>(length);
+}
+
+JsonKind ubKind(char marker)
+{
+    switch (marker)
+    {
+    case 'Z':
+        return JsonKind::Null;
+    case 'T':
+    case 'F':
+        return JsonKind::Boolean;
+    case 'C':
+    case 'S':
+        return JsonKind::String;
+    case '[':
+        return JsonKind::Array;
+    case '{':
+        return JsonKind::Object;
+    default:
+        return JsonKind::Number;
+    }
+}
+
+bool ubIsValueMarker(char marker)
+{
+    return std::strchr("ZTFiUIlLdDHCS[{", marker) != nullptr && marker != '\0';
+}
+
+struct UbContainer
+{
+    std::uint8_t type = 0;
+    // kIndefinite until the closing marker.
+    std::uint64_t count = kIndefinite;
+    std::uint64_t first = 0;
+};
+
+// The optional "$type" and "#count" after a container's marker.
+UbContainer ubContainer(std::string_view data, std::uint64_t content)
+{
+    UbContainer c;
+    c.first = content;
+    need(data, content, 1);
+    if (data[content] == '$')
+    {
+        need(data, content + 1, 2);
+        char type = data[content + 1];
+        if (!ubIsValueMarker(type))
+            fail(content + 1, "invalid container type");
+        if (data[content + 2] != '#')
+            fail(content + 2, "expected '#' after a container type");
+        c.type = static_cast<std::uint8_t>(type);
+        c.count = ubLength(data, content + 3, c.first);
+    }
+    else if (data[content] == '#')
+        c.count = ubLength(data, content + 1, c.first);
+    return c;
+}
+
+std::uint64_t ubSkipNoOps(std::string_view data, std::uint64_t pos)
+{
+    while (pos < data.size() && data[pos] == 'N')
+        ++pos;
+    return pos;
+}
+
+class UbjsonCodec : public JsonBinaryCodec
+{
+public:
+    JsonValue scan(std::string_view data, JsonEventHandler &handler) const override
+    {
+        std::vector<OpenContainer> open;
+        std::uint64_t pos = ubSkipNoOps(data, 0);
+        JsonValue root{pos};
+        auto item = [&](std::uint8_t type)
+        {
+            if (!type)
+                pos = ubSkipNoOps(data, pos);
+            JsonValue value{pos};
+            value.type = type;
+            UbHead h = ubHead(data, value);
+            if (h.marker == '[' || h.marker == '{')
+            {
+                bool object = h.marker == '{';
+                UbContainer c = ubContainer(data, h.content);
+                if (c.count != kIndefinite)
+                    checkCount(data, c.first, c.count, c.type ? 0 : (object ? 2 : 1));
+                handler.beginContainer(pos, object);
+                open.push_back(OpenContainer{c.count, object, true, c.type});
+                pos = c.first;
+                return;
+            }
+            if (!ubIsValueMarker(h.marker))
+                fail(pos, "invalid UBJSON marker");
+            std::uint64_t end = scalarEnd(data, value);
+            handler.scalar(pos, end, ubKind(h.marker));
+            pos = end;
+        };
+
+        item(0);
+        while (!open.empty())
+        {
+            OpenContainer &top = open.back();
+            bool closed = false;
+            if (top.remaining == kIndefinite)
+            {
+                pos = ubSkipNoOps(data, pos);
+                need(data, pos, 1);
+                if (data[pos] == (top.object ? '}' : ']'))
+                {
+                    if (!top.atKey)
+                        fail(pos, "object key without a value");
+                    ++pos;
+                    closed = true;
+                }
+            }
+            else
+                closed = top.remaining == 0;
+            if (closed)
+            {
+                handler.endContainer(pos - 1);
+                open.pop_back();
+            }
+            else if (top.object && top.atKey)
+            {
+                top.atKey = false;
+                std::uint64_t begin = ubSkipNoOps(data, pos);
+                std::uint64_t next = 0;
+                std::uint64_t length = ubLength(data, begin, next);
+                need(data, next, length);
+                handler.key(begin, next + length);
+                pos = next + length;
+            }
+            else
+            {
+                if (top.remaining != kIndefinite)
+                    --top.remaining;
+                top.atKey = true;
+                item(top.type);
+            }
+        }
+        if (ubSkipNoOps(data, pos) != data.size())
+            fail(pos, "unexpected data after the document");
+        return root;
+    }
+
+    JsonKind kind(std::string_view data, JsonValue value) const override
+    {
+        return ubKind(ubHead(data, value).marker);
+    }
+
+    std::uint64_t firstMember(std::string_view data, JsonValue container) const override
+    {
+        return ubContainer(data, ubHead(data, container).content).first;
+    }
+
+    void readMember(std::string_view data, JsonValue container, std::uint64_t pos, JsonMember &member) const override
+    {
+        member = JsonMember();
+        UbHead head = ubHead(data, container);
+        std::uint8_t type = ubContainer(data, head.content).type;
+        if (head.marker == '{')
+        {
+            member.keyOffset = ubSkipNoOps(data, pos);
+            std::uint64_t next = 0;
+            std::uint64_t length = ubLength(data, member.keyOffset, next);
+            pos = next + length;
+        }
+        member.value.offset = type ? pos : ubSkipNoOps(data, pos);
+        member.value.type = type;
+    }
+
+    std::uint64_t scalarEnd(std::string_view data, JsonValue value) const override
+    {
+        UbHead h = ubHead(data, value);
+        std::uint64_t size = 0;
+        switch (h.marker)
+        {
+        case 'Z':
+        case 'T':
+        case 'F':
+            break;
+        case 'C':
+            size = 1;
+            break;
+        case 'd':
+            size = 4;
+            break;
+        case 'D':
+            size = 8;
+            break;
+        case 'S':
+        case 'H':
+        {
+            std::uint64_t next = 0;
+            std::uint64_t length = ubLength(data, h.content, next);
+            need(data, next, length);
+            return next + length;
+        }
+        default:
+            size = static_cast<std::uint64_t>(ubIntegerSize(h.marker));
+            break;
+        }
+        need(data, h.content, size);
+        return h.content + size;
+    }
+
+    std::string key(std::string_view data, std::uint64_t keyOffset) const override
+    {
+        std::uint64_t next = 0;
+        std::uint64_t length = ubLength(data, keyOffset, next);
+        return std::string(data.substr(next, length));
+    }
+
+    std::string stringValue(std::string_view data, JsonValue value) const override
+    {
+        UbHead h = ubHead(data, value);
+        if (h.marker == 'C')
+            return std::string(1, data[h.content]);
+        std::uint64_t next = 0;
+        std::uint64_t length = ubLength(data, h.content, next);
+        return std::string(data.substr(next, length));
+    }
+
+    bool booleanValue(std::string_view data, JsonValue value) const override
+    {
+        return ubHead(data, value).marker == 'T';
+    }
+
+    std::string numberText(std::string_view data, JsonValue value) const override
+    {
+        UbHead h = ubHead(data, value);
+        switch (h.marker)
+        {
+        case 'd':
+            return formatFloat(std::bit_cast<float>(static_cast<std::uint32_t>(readBig(data, h.content, 4))));
+        case 'D':
+            return formatFloat(std::bit_cast<double>(readBig(data, h.content, 8)));
+        case 'H':
+            // High-precision numbers are stored as their digits.
+            return stringValue(data, value);
+        default:
+            return std::to_string(ubInteger(data, h.marker, h.content));
+        }
+    }
+};
+
+} // namespace
+
+const JsonBinaryCodec &jsonBinaryCodec(JsonFormat format)
+{
+    static const CborCodec cbor;
+    static const MessagePackCodec messagePack;
+    static const BsonCodec bson;
+    static const UbjsonCodec ubjson;
+    switch (format)
+    {
+    case JsonFormat::Cbor:
+        return cbor;
+    case JsonFormat::MessagePack:
+        return messagePack;
+    case JsonFormat::Bson:
+        return bson;
+    case JsonFormat::Ubjson:
+        return ubjson;
+    default:
+        throw std::invalid_argument("not a binary JSON format");
+    }
+}
+
+JsonFormat jsonFormatForPath(const std::string &path)
+{
+    std::size_t dot = path.find_last_of("./");
+    if (dot == std::string::npos || path[dot] != '.')
+        return JsonFormat::Text;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == "cbor")
+        return JsonFormat::Cbor;
+    if (extension == "msgpack" || extension == "mpk" || extension == "mp")
+        return JsonFormat::MessagePack;
+    if (extension == "bson")
+        return JsonFormat::Bson;
+    if (extension == "ubj" || extension == "ubjson")
+        return JsonFormat::Ubjson;
+    return JsonFormat::Text;
+}
+
+const char *jsonFormatName(JsonFormat format)
+{
+    switch (format)
+    {
+    case JsonFormat::Cbor:
+        return "CBOR";
+    case JsonFormat::MessagePack:
+        return "MessagePack";
+    case JsonFormat::Bson:
+        return "BSON";
+    case JsonFormat::Ubjson:
+        return "UBJSON";
+    default:
+        return "JSON";
+    }
+}
@@ -0,0 +1,614 @@
+// Structural diff of two json-view documents
+#include "json_diff.hpp"
+
+#include "json_view_core.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+
+constexpr std::uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+
+// Seeds keep values of different kinds apart.
+constexpr std::uint64_t kStringSeed = 0x243F6A8885A308D3ull;
+constexpr std::uint64_t kKeySeed = 0x13198A2E03707344ull;
+constexpr std::uint64_t kIntegerSeed = 0xA4093822299F31D0ull;
+constexpr std::uint64_t kUnsignedSeed = 0x082EFA98EC4E6C89ull;
+constexpr std::uint64_t kDoubleSeed = 0x452821E638D01377ull;
+constexpr std::uint64_t kObjectSeed = 0xBE5466CF34E90C6Cull;
+constexpr std::uint64_t kArraySeed = 0xC0AC29B7C97C50DDull;
+constexpr std::uint64_t kTrueHash = 0x3F84D5B5B5470917ull;
+constexpr std::uint64_t kFalseHash = 0x9216D5D98979FB1Bull;
+constexpr std::uint64_t kNullHash = 0xD1310BA698DFB5ACull;
+constexpr std::uint64_t kNanHash = 0x2FFD72DBD01ADFB7ull;
+
+std::uint64_t mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Hash of a byte string, eight bytes per step.
+std::uint64_t hashBytes(std::string_view bytes, std::uint64_t seed)
+{
+    std::uint64_t h = seed ^ (bytes.size() * kMultiplier);
+    const char *p = bytes.data();
+    std::size_t n = bytes.size();
+    for (; n >= 8; p += 8, n -= 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, p, 8);
+        h = std::rotl((h ^ word) * kMultiplier, 29);
+    }
+    if (n > 0)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, p, n);
+        h = std::rotl((h ^ word) * kMultiplier, 29);
+    }
+    return mix(h);
+}
+
+// Numbers hash by value: 1, 1.0 and 1e0 are equal, and integers too large
+// for a double keep every digit.
+std::uint64_t doubleHash(double d)
+{
+    if (std::isnan(d))
+        return kNanHash;
+    if (d == std::trunc(d))
+    {
+        if (d >= -9223372036854775808.0 && d < 9223372036854775808.0)
+            return mix(kIntegerSeed ^ static_cast<std::uint64_t>(static_cast<std::int64_t>(d)));
+        if (d >= 0 && d < 18446744073709551616.0)
+            return mix(kUnsignedSeed ^ static_cast<std::uint64_t>(d));
+    }
+    return mix(kDoubleSeed ^ std::bit_cast<std::uint64_t>(d));
+}
+
+std::uint64_t numberHash(std::string_view token)
+{
+    const char *end = token.data() + token.size();
+    std::int64_t integer = 0;
+    auto parsed = std::from_chars(token.data(), end, integer);
+    if (parsed.ec == std::errc() && parsed.ptr == end)
+        return mix(kIntegerSeed ^ static_cast<std::uint64_t>(integer));
+    std::uint64_t whole = 0;
+    parsed = std::from_chars(token.data(), end, whole);
+    if (parsed.ec == std::errc() && parsed.ptr == end)
+        return mix(kUnsignedSeed ^ whole);
+    return doubleHash(decodeJsonNumber(token));
+}
+
+// Hash of a scalar token of a JSON text; strings include their quotes.
+std::uint64_t tokenHash(std::string_view token, JsonKind kind)
+{
+    switch (kind)
+    {
+    case JsonKind::String:
+    {
+        std::string_view inner = token.substr(1, token.size() - 2);
+        if (inner.find('\\') == std::string_view::npos)
+            return hashBytes(inner, kStringSeed);
+        return hashBytes(decodeJsonString(token), kStringSeed);
+    }
+    case JsonKind::Number:
+        return numberHash(token);
+    case JsonKind::Boolean:
+        return token.front() == 't' ? kTrueHash : kFalseHash;
+    default:
+        return kNullHash;
+    }
+}
+
+// A member name, decoded only when a text key has escapes.
+std::string_view memberName(const JsonDocument &document, const JsonMember &member, std::string &scratch)
+{
+    if (document.format() == JsonFormat::Text)
+    {
+        std::string_view text = document.text().substr(member.keyOffset + 1);
+        std::size_t close = text.find_first_of("\"\\");
+        if (close != std::string_view::npos && text[close] == '"')
+            return text.substr(0, close);
+    }
+    scratch = document.key(member);
+    return scratch;
+}
+
+// Folds values into their containers' hashes as a document is visited in
+// order.  Objects sum their members so that member order does not matter;
+// arrays chain their items.
+class HashBuilder
+{
+public:
+    explicit HashBuilder(std::vector<std::uint64_t> &containers) : m_containers(containers) {}
+
+    void open(bool object)
+    {
+        m_open.push_back(Open{object ? 0 : kArraySeed, 0, m_next++, 0, object});
+    }
+
+    void close()
+    {
+        Open top = m_open.back();
+        m_open.pop_back();
+        std::uint64_t h = top.object ? mix(top.hash ^ mix(kObjectSeed + top.count)) : mix(top.hash + top.count);
+        m_containers[top.slot] = h;
+        add(h);
+    }
+
+    void setKey(std::string_view name) { m_open.back().key = hashBytes(name, kKeySeed); }
+
+    void add(std::uint64_t h)
+    {
+        if (m_open.empty())
+            return;
+        Open &parent = m_open.back();
+        ++parent.count;
+        if (parent.object)
+            parent.hash += mix(parent.key + h * kMultiplier);
+        else
+            parent.hash = mix(parent.hash ^ h);
+    }
+
+private:
+    struct Open
+    {
+        std::uint64_t hash;
+        std::uint64_t key;
+        std::uint32_t slot;
+        std::uint32_t count;
+        bool object;
+    };
+
+    std::vector<std::uint64_t> &m_containers;
+    std::vector<Open> m_open;
+    // Containers are opened in the order the document indexed them.
+    std::uint32_t m_next = 0;
+};
+
+class TextHasher : public JsonEventHandler
+{
+public:
+    TextHasher(std::string_view text, HashBuilder &builder) : m_text(text), m_builder(builder) {}
+
+    void beginContainer(std::uint64_t, bool object) override { m_builder.open(object); }
+    void endContainer(std::uint64_t) override { m_builder.close(); }
+
+    void key(std::uint64_t begin, std::uint64_t end) override
+    {
+        std::string_view quoted = m_text.substr(begin, end - begin);
+        std::string_view inner = quoted.substr(1, quoted.size() - 2);
+        if (inner.find('\\') == std::string_view::npos)
+            m_builder.setKey(inner);
+        else
+            m_builder.setKey(decodeJsonString(quoted));
+    }
+
+    void scalar(std::uint64_t begin, std::uint64_t end, JsonKind kind) override
+    {
+        m_builder.add(tokenHash(m_text.substr(begin, end - begin), kind));
+    }
+
+private:
+    std::string_view m_text;
+    HashBuilder &m_builder;
+};
+
+std::uint64_t binaryScalarHash(const JsonDocument &document, JsonValue value, JsonKind kind)
+{
+    switch (kind)
+    {
+    case JsonKind::String:
+        return hashBytes(document.stringValue(value), kStringSeed);
+    case JsonKind::Number:
+        return numberHash(document.numberText(value));
+    case JsonKind::Boolean:
+        return document.booleanValue(value) ? kTrueHash : kFalseHash;
+    default:
+        return kNullHash;
+    }
+}
+
+// Binary encodings have no text tokens to scan; walk their values instead.
+void hashBinary(const JsonDocument &document, HashBuilder &builder)
+{
+    std::vector<JsonMemberCursor> open;
+    auto visit = [&](JsonValue value)
+    {
+        JsonKind kind = document.kind(value);
+        if (kind == JsonKind::Object || kind == JsonKind::Array)
+        {
+            builder.open(kind == JsonKind::Object);
+            open.emplace_back(document, value);
+        }
+        else
+            builder.add(binaryScalarHash(document, value, kind));
+    };
+
+    visit(document.root());
+    JsonMember member;
+    while (!open.empty())
+    {
+        if (!open.back().next(member))
+        {
+            builder.close();
+            open.pop_back();
+            continue;
+        }
+        if (member.keyOffset != JsonMember::kNoKey)
+            builder.setKey(document.key(member));
+        visit(member.value);
+    }
+}
+
+std::string itemKey(std::size_t index)
+{
+    return "[" + std::to_string(index) + "]";
+}
+
+bool isContainerKind(JsonKind kind)
+{
+    return kind == JsonKind::Object || kind == JsonKind::Array;
+}
+
+// Walks both documents from the roots, descending only into containers
+// whose hashes differ.  Pending comparisons are kept on an explicit stack
+// so that deeply nested documents cannot overflow the call stack.
+class Differ
+{
+public:
+    Differ(const JsonDocument &left, const JsonDocument &right, const JsonSubtreeHashes &leftHashes,
+           const JsonSubtreeHashes &rightHashes, const JsonDiffOptions &options)
+        : m_left(left), m_right(right), m_leftHashes(leftHashes), m_rightHashes(rightHashes), m_options(options) {}
+
+    std::vector<JsonDiffEntry> run()
+    {
+        std::vector<JsonDiffEntry> out;
+        JsonValue leftRoot = m_left.root();
+        JsonValue rightRoot = m_right.root();
+        if (m_leftHashes.hash(leftRoot) == m_rightHashes.hash(rightRoot))
+            return out;
+        m_pending.push_back(JsonDiffEntry{JsonDiffKind::Changed, 0, "", leftRoot, rightRoot});
+        while (!m_pending.empty())
+        {
+            JsonDiffEntry entry = std::move(m_pending.back());
+            m_pending.pop_back();
+            JsonKind kind = m_left.kind(entry.left);
+            bool descend = entry.kind == JsonDiffKind::Changed && isContainerKind(kind) &&
+                           kind == m_right.kind(entry.right);
+            std::uint32_t depth = entry.depth + 1;
+            JsonValue left = entry.left;
+            JsonValue right = entry.right;
+            out.push_back(std::move(entry));
+            if (!descend)
+                continue;
+            m_children.clear();
+            if (kind == JsonKind::Object)
+                alignMembers(left, right, depth);
+            else if (m_options.idKey.empty())
+                alignItemsByIndex(left, right, depth);
+            else
+                alignItemsById(left, right, depth);
+            // Reversed so that children come off the stack in order.
+            for (auto it = m_children.rbegin(); it != m_children.rend(); ++it)
+                m_pending.push_back(std::move(*it));
+        }
+        return out;
+    }
+
+private:
+    void compare(std::string key, JsonValue left, JsonValue right, std::uint32_t depth)
+    {
+        if (m_leftHashes.hash(left) != m_rightHashes.hash(right))
+            m_children.push_back(JsonDiffEntry{JsonDiffKind::Changed, depth, std::move(key), left, right});
+    }
+
+    void added(std::string key, JsonValue right, std::uint32_t depth)
+    {
+        m_children.push_back(JsonDiffEntry{JsonDiffKind::Added, depth, std::move(key), {}, right});
+    }
+
+    void removed(std::string key, JsonValue left, std::uint32_t depth)
+    {
+        m_children.push_back(JsonDiffEntry{JsonDiffKind::Removed, depth, std::move(key), left, {}});
+    }
+
+    // Members are paired in order while both sides agree, which is the
+    // common case, and by name from the first difference on.  Members only
+    // on the left are reported last.
+    void alignMembers(JsonValue left, JsonValue right, std::uint32_t depth)
+    {
+        JsonMemberCursor leftCursor(m_left, left);
+        JsonMemberCursor rightCursor(m_right, right);
+        JsonMember leftMember, rightMember;
+        std::string leftScratch, rightScratch;
+        bool moreLeft = leftCursor.next(leftMember);
+        bool moreRight = rightCursor.next(rightMember);
+        while (moreLeft && moreRight)
+        {
+            std::string_view name = memberName(m_left, leftMember, leftScratch);
+            if (name != memberName(m_right, rightMember, rightScratch))
+                break;
+            compare(std::string(name), leftMember.value, rightMember.value, depth);
+            moreLeft = leftCursor.next(leftMember);
+            moreRight = rightCursor.next(rightMember);
+        }
+        if (!moreLeft && !moreRight)
+            return;
+
+        std::vector<std::pair<std::string, JsonValue>> rest;
+        std::unordered_map<std::string_view, std::size_t> byName;
+        for (; moreLeft; moreLeft = leftCursor.next(leftMember))
+            rest.emplace_back(m_left.key(leftMember), leftMember.value);
+        byName.reserve(rest.size());
+        for (std::size_t i = 0; i < rest.size(); ++i)
+            byName.emplace(rest[i].first, i);
+        std::vector<bool> matched(rest.size());
+        for (; moreRight; moreRight = rightCursor.next(rightMember))
+        {
+            std::string name(memberName(m_right, rightMember, rightScratch));
+            auto it = byName.find(name);
+            if (it == byName.end() || matched[it->second])
+            {
+                added(std::move(name), rightMember.value, depth);
+                continue;
+            }
+            matched[it->second] = true;
+            compare(std::move(name), rest[it->second].second, rightMember.value, depth);
+        }
+        for (std::size_t i = 0; i < rest.size(); ++i)
+        {
+            if (!matched[i])
+                removed(std::move(rest[i].first), rest[i].second, depth);
+        }
+    }
+
+    void alignItemsByIndex(JsonValue left, JsonValue right, std::uint32_t depth)
+    {
+        JsonMemberCursor leftCursor(m_left, left);
+        JsonMemberCursor rightCursor(m_right, right);
+        JsonMember leftItem, rightItem;
+        std::size_t index = 0;
+        bool moreLeft = leftCursor.next(leftItem);
+        bool moreRight = rightCursor.next(rightItem);
+        for (; moreLeft && moreRight; ++index)
+        {
+            compare(itemKey(index), leftItem.value, rightItem.value, depth);
+            moreLeft = leftCursor.next(leftItem);
+            moreRight = rightCursor.next(rightItem);
+        }
+        for (; moreRight; ++index, moreRight = rightCursor.next(rightItem))
+            added(itemKey(index), rightItem.value, depth);
+        for (; moreLeft; ++index, moreLeft = leftCursor.next(leftItem))
+            removed(itemKey(index), leftItem.value, depth);
+    }
+
+    // Hash of the id member of an array item, if it has one.
+    bool itemId(const JsonDocument &document, const JsonSubtreeHashes &hashes, JsonValue item,
+                std::uint64_t &id) const
+    {
+        if (document.kind(item) != JsonKind::Object)
+            return false;
+        JsonMemberCursor cursor(document, item);
+        JsonMember member;
+        std::string scratch;
+        while (cursor.next(member))
+        {
+            if (memberName(document, member, scratch) == m_options.idKey)
+            {
+                id = hashes.hash(member.value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Items with an id are paired with the left item of the same id, in
+    // order for repeated ids; the others with the left item at the same
+    // position when that one has no id either.
+    void alignItemsById(JsonValue left, JsonValue right, std::uint32_t depth)
+    {
+        std::vector<JsonValue> leftItems;
+        leftItems.reserve(m_left.size(left));
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> leftIds;
+        std::vector<bool> hasId;
+        hasId.reserve(m_left.size(left));
+        JsonMemberCursor leftCursor(m_left, left);
+        JsonMember item;
+        while (leftCursor.next(item))
+        {
+            std::uint64_t id = 0;
+            bool found = itemId(m_left, m_leftHashes, item.value, id);
+            if (found)
+                leftIds.emplace_back(id, static_cast<std::uint32_t>(leftItems.size()));
+            hasId.push_back(found);
+            leftItems.push_back(item.value);
+        }
+        std::sort(leftIds.begin(), leftIds.end());
+        // Next unmatched entry of leftIds for each id seen so far.
+        std::unordered_map<std::uint64_t, std::size_t> nextOfId;
+        std::vector<bool> matched(leftItems.size());
+
+        JsonMemberCursor rightCursor(m_right, right);
+        for (std::size_t index = 0; rightCursor.next(item); ++index)
+        {
+            std::uint64_t id = 0;
+            std::size_t pair = leftItems.size();
+            if (itemId(m_right, m_rightHashes, item.value, id))
+            {
+                auto [it, inserted] = nextOfId.try_emplace(id, 0);
+                if (inserted)
+                    it->second = static_cast<std::size_t>(
+                        std::lower_bound(leftIds.begin(), leftIds.end(), std::make_pair(id, std::uint32_t{0})) -
+                        leftIds.begin());
+                if (it->second < leftIds.size() && leftIds[it->second].first == id)
+                    pair = leftIds[it->second++].second;
+            }
+            else if (index < leftItems.size() && !hasId[index] && !matched[index])
+                pair = index;
+
+            if (pair == leftItems.size())
+            {
+                added(itemKey(index), item.value, depth);
+                continue;
+            }
+            matched[pair] = true;
+            compare(itemKey(index), leftItems[pair], item.value, depth);
+        }
+        for (std::size_t i = 0; i < leftItems.size(); ++i)
+        {
+            if (!matched[i])
+                removed(itemKey(i), leftItems[i], depth);
+        }
+    }
+
+    const JsonDocument &m_left;
+    const JsonDocument &m_right;
+    const JsonSubtreeHashes &m_leftHashes;
+    const JsonSubtreeHashes &m_rightHashes;
+    const JsonDiffOptions &m_options;
+    std::vector<JsonDiffEntry> m_pending;
+    std::vector<JsonDiffEntry> m_children;
+};
+
+std::unique_ptr<Node> makeDiffNode(const JsonDiffEntry &entry, const JsonDocument &left,
+                                   const JsonDocument &right, Node *parent)
+{
+    auto node = std::make_unique<Node>();
+    node->parent = parent;
+    node->key = entry.key;
+    node->diff = entry.kind;
+    if (entry.kind == JsonDiffKind::Removed)
+    {
+        node->document = &left;
+        node->value = entry.left;
+        return node;
+    }
+    node->document = &right;
+    node->value = entry.right;
+    if (entry.kind == JsonDiffKind::Changed)
+    {
+        node->leftDocument = &left;
+        node->leftValue = entry.left;
+        // Children of a changed container are its differences, which
+        // follow it in the entries.
+        JsonKind kind = right.kind(entry.right);
+        node->childrenLoaded = isContainerKind(kind) && kind == left.kind(entry.left);
+    }
+    return node;
+}
+
+} // namespace
+
+JsonSubtreeHashes::JsonSubtreeHashes(const JsonDocument &document)
+    : m_document(document), m_containers(document.containerCount())
+{
+    HashBuilder builder(m_containers);
+    if (document.format() == JsonFormat::Text)
+    {
+        TextHasher hasher(document.text(), builder);
+        scanJsonText(document.text(), hasher);
+    }
+    else
+        hashBinary(document, builder);
+}
+
+std::uint64_t JsonSubtreeHashes::hash(JsonValue value) const
+{
+    JsonKind kind = m_document.kind(value);
+    if (isContainerKind(kind))
+        return m_containers[value.container];
+    if (m_document.format() == JsonFormat::Text)
+        return tokenHash(m_document.source(value), kind);
+    return binaryScalarHash(m_document, value, kind);
+}
+
+std::vector<JsonDiffEntry> diffDocuments(const JsonDocument &left, const JsonDocument &right,
+                                         const JsonDiffOptions &options)
+{
+    // Each document is hashed on its own thread; the walk that follows
+    // only touches what differs.
+    std::unique_ptr<JsonSubtreeHashes> leftHashes;
+    std::exception_ptr leftError;
+    std::thread worker([&]
+                       {
+        try
+        {
+            leftHashes = std::make_unique<JsonSubtreeHashes>(left);
+        }
+        catch (...)
+        {
+            leftError = std::current_exception();
+        } });
+    std::unique_ptr<JsonSubtreeHashes> rightHashes;
+    try
+    {
+        rightHashes = std::make_unique<JsonSubtreeHashes>(right);
+    }
+    catch (...)
+    {
+        worker.join();
+        throw;
+    }
+    worker.join();
+    if (leftError)
+        std::rethrow_exception(leftError);
+    return Differ(left, right, *leftHashes, *rightHashes, options).run();
+}
+
+std::unique_ptr<Node> buildDiffTree(std::shared_ptr<const JsonDocument> left,
+                                    std::shared_ptr<const JsonDocument> right,
+                                    const std::vector<JsonDiffEntry> &entries, const std::string &key)
+{
+    auto root = std::make_unique<Node>();
+    root->document = right.get();
+    root->value = right->root();
+    root->leftDocument = left.get();
+    root->leftValue = left->root();
+    root->key = key;
+    root->isDummyRoot = true;
+    root->expanded = true;
+    root->childrenLoaded = true;
+    root->diff = entries.empty() ? JsonDiffKind::None : JsonDiffKind::Changed;
+
+    // Open nodes by depth; the root stands for the entry at depth 0.
+    std::vector<Node *> open{root.get()};
+    for (const JsonDiffEntry &entry : entries)
+    {
+        if (entry.depth == 0)
+        {
+            if (!root->childrenLoaded || entry.kind != JsonDiffKind::Changed)
+                continue;
+            // Roots of different kinds are not aligned any further.
+            JsonKind kind = right->kind(entry.right);
+            root->childrenLoaded = isContainerKind(kind) && kind == left->kind(entry.left);
+            continue;
+        }
+        Node *parent = open[entry.depth - 1];
+        auto node = makeDiffNode(entry, *left, *right, parent);
+        node->index = parent->childCount;
+        node->isLastChild = true;
+        if (!parent->children.empty())
+            parent->children.rbegin()->second->isLastChild = false;
+        open.resize(entry.depth);
+        open.push_back(node.get());
+        parent->children.emplace(parent->childCount++, std::move(node));
+    }
+    root->ownedDocument = std::move(right);
+    root->ownedLeftDocument = std::move(left);
+    return root;
+}
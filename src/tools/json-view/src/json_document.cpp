@@ -0,0 +1,940 @@
+// Structural indexing and lazy decoding for json-view documents
+#include "json_document.hpp"
+
+#include "json_binary.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+// Word-at-a-time (SWAR) helpers.  Each mask has the high bit set in the
+// lowest matching byte; bits above it may be false positives, so callers
+// only ever look at the lowest set bit.
+constexpr std::uint64_t kOnes = 0x0101010101010101ULL;
+constexpr std::uint64_t kHighs = 0x8080808080808080ULL;
+
+inline std::uint64_t loadWord(const char *p)
+{
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline std::uint64_t zeroBytes(std::uint64_t word)
+{
+    return (word - kOnes) & ~word & kHighs;
+}
+
+inline std::uint64_t bytesEqual(std::uint64_t word, unsigned char byte)
+{
+    return zeroBytes(word ^ (kOnes * byte));
+}
+
+inline std::uint64_t bytesBelow(std::uint64_t word, unsigned char bound)
+{
+    return (word - kOnes * bound) & ~word & kHighs;
+}
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool isHexDigit(char c)
+{
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+std::size_t skipSpace(const char *data, std::size_t pos, std::size_t size)
+{
+    while (pos < size)
+    {
+        // Indentation in pretty-printed files comes in long runs of spaces.
+        if (pos + 8 <= size && loadWord(data + pos) == kOnes * ' ')
+        {
+            pos += 8;
+            continue;
+        }
+        if (!isSpace(data[pos]))
+            break;
+        ++pos;
+    }
+    return pos;
+}
+
+// First '"', '\\' or control byte at or after pos, or size.
+std::size_t findStringSpecial(const char *data, std::size_t pos, std::size_t size)
+{
+    if constexpr (std::endian::native == std::endian::little)
+    {
+        while (pos + 8 <= size)
+        {
+            std::uint64_t word = loadWord(data + pos);
+            std::uint64_t mask = bytesEqual(word, '"') | bytesEqual(word, '\\') | bytesBelow(word, 0x20);
+            if (mask != 0)
+                return pos + static_cast<std::size_t>(std::countr_zero(mask)) / 8;
+            pos += 8;
+        }
+    }
+    while (pos < size)
+    {
+        auto c = static_cast<unsigned char>(data[pos]);
+        if (c == '"' || c == '\\' || c < 0x20)
+            return pos;
+        ++pos;
+    }
+    return size;
+}
+
+[[noreturn]] void fail(std::string_view text, std::size_t offset, const char *message)
+{
+    std::size_t line = 1;
+    std::size_t lineStart = 0;
+    for (std::size_t i = 0; i < offset && i < text.size(); ++i)
+    {
+        if (text[i] == '\n')
+        {
+            ++line;
+            lineStart = i + 1;
+        }
+    }
+    throw JsonParseError("line " + std::to_string(line) + ", column " + std::to_string(offset - lineStart + 1) +
+                             ": " + message,
+                         offset);
+}
+
+// Validate the string starting at the opening quote and return the offset
+// past its closing quote.
+std::size_t scanString(std::string_view text, std::size_t pos)
+{
+    const char *data = text.data();
+    std::size_t size = text.size();
+    std::size_t p = pos + 1;
+    for (;;)
+    {
+        p = findStringSpecial(data, p, size);
+        if (p >= size)
+            fail(text, pos, "unterminated string");
+        char c = data[p];
+        if (c == '"')
+            return p + 1;
+        if (c != '\\')
+            fail(text, p, "control character in string");
+        if (p + 1 >= size)
+            fail(text, pos, "unterminated string");
+        switch (data[p + 1])
+        {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            p += 2;
+            break;
+        case 'u':
+            if (p + 6 > size || !isHexDigit(data[p + 2]) || !isHexDigit(data[p + 3]) ||
+                !isHexDigit(data[p + 4]) || !isHexDigit(data[p + 5]))
+                fail(text, p, "invalid \\u escape");
+            p += 6;
+            break;
+        default:
+            fail(text, p, "invalid escape sequence");
+        }
+    }
+}
+
+// Skip a string that has already been validated.
+std::size_t skipString(const char *data, std::size_t pos, std::size_t size)
+{
+    std::size_t p = pos + 1;
+    for (;;)
+    {
+        p = findStringSpecial(data, p, size);
+        if (p >= size || data[p] == '"')
+            return std::min(p + 1, size);
+        p += 2;
+    }
+}
+
+std::size_t scanNumber(std::string_view text, std::size_t pos)
+{
+    const char *data = text.data();
+    std::size_t size = text.size();
+    std::size_t p = pos;
+    if (data[p] == '-')
+        ++p;
+    if (p < size && data[p] == '0')
+        ++p;
+    else if (p < size && isDigit(data[p]))
+    {
+        while (p < size && isDigit(data[p]))
+            ++p;
+    }
+    else
+        fail(text, pos, "invalid number");
+    if (p < size && data[p] == '.')
+    {
+        ++p;
+        if (p >= size || !isDigit(data[p]))
+            fail(text, pos, "invalid number");
+        while (p < size && isDigit(data[p]))
+            ++p;
+    }
+    if (p < size && (data[p] == 'e' || data[p] == 'E'))
+    {
+        ++p;
+        if (p < size && (data[p] == '+' || data[p] == '-'))
+            ++p;
+        if (p >= size || !isDigit(data[p]))
+            fail(text, pos, "invalid number");
+        while (p < size && isDigit(data[p]))
+            ++p;
+    }
+    return p;
+}
+
+bool literalAt(std::string_view text, std::size_t pos, std::string_view literal)
+{
+    return text.compare(pos, literal.size(), literal) == 0;
+}
+
+std::size_t scanScalar(std::string_view text, std::size_t pos, JsonKind &kind)
+{
+    auto literal = [&](std::string_view word, JsonKind literalKind) {
+        if (!literalAt(text, pos, word))
+            fail(text, pos, "invalid literal");
+        kind = literalKind;
+        return pos + word.size();
+    };
+
+    switch (text[pos])
+    {
+    case '"':
+        kind = JsonKind::String;
+        return scanString(text, pos);
+    case 't':
+        return literal("true", JsonKind::Boolean);
+    case 'f':
+        return literal("false", JsonKind::Boolean);
+    case 'n':
+        return literal("null", JsonKind::Null);
+    case 'N':
+        return literal("NaN", JsonKind::Number);
+    case 'I':
+        return literal("Infinity", JsonKind::Number);
+    case '-':
+        if (literalAt(text, pos, "-Infinity"))
+        {
+            kind = JsonKind::Number;
+            return pos + 9;
+        }
+        [[fallthrough]];
+    default:
+        if (text[pos] != '-' && !isDigit(text[pos]))
+            fail(text, pos, "unexpected character");
+        kind = JsonKind::Number;
+        return scanNumber(text, pos);
+    }
+}
+
+// End of a scalar that has already been validated.
+std::size_t skipScalar(const char *data, std::size_t pos, std::size_t size)
+{
+    if (data[pos] == '"')
+        return skipString(data, pos, size);
+    while (pos < size && !isSpace(data[pos]) && data[pos] != ',' && data[pos] != ']' && data[pos] != '}')
+        ++pos;
+    return pos;
+}
+
+// Single validating pass over a JSON text.  The handler sees containers,
+// member names and scalars in document order; nesting is tracked with an
+// explicit stack so deep documents cannot overflow the call stack.
+template <typename Handler>
+void scanJson(std::string_view text, Handler &handler)
+{
+    enum class Expect
+    {
+        Value,
+        ValueOrClose,
+        Key,
+        KeyOrClose,
+        Colon,
+        CommaOrClose,
+    };
+
+    const char *data = text.data();
+    std::size_t size = text.size();
+    std::vector<char> open;
+    Expect expect = Expect::Value;
+    std::size_t pos = 0;
+
+    auto close = [&] {
+        handler.endContainer(pos);
+        open.pop_back();
+        ++pos;
+        expect = Expect::CommaOrClose;
+    };
+
+    for (;;)
+    {
+        pos = skipSpace(data, pos, size);
+        if (pos == size)
+        {
+            if (open.empty() && expect == Expect::CommaOrClose)
+                return;
+            fail(text, pos, "unexpected end of input");
+        }
+        char c = data[pos];
+        switch (expect)
+        {
+        case Expect::ValueOrClose:
+            if (c == ']')
+            {
+                close();
+                break;
+            }
+            [[fallthrough]];
+        case Expect::Value:
+            if (c == '{' || c == '[')
+            {
+                handler.beginContainer(pos, c == '{');
+                open.push_back(c);
+                ++pos;
+                expect = c == '{' ? Expect::KeyOrClose : Expect::ValueOrClose;
+            }
+            else
+            {
+                JsonKind kind = JsonKind::Null;
+                std::size_t end = scanScalar(text, pos, kind);
+                handler.scalar(pos, end, kind);
+                pos = end;
+                expect = Expect::CommaOrClose;
+            }
+            break;
+        case Expect::KeyOrClose:
+            if (c == '}')
+            {
+                close();
+                break;
+            }
+            [[fallthrough]];
+        case Expect::Key:
+        {
+            if (c != '"')
+                fail(text, pos, "expected a member name");
+            std::size_t end = scanString(text, pos);
+            handler.key(pos, end);
+            pos = end;
+            expect = Expect::Colon;
+            break;
+        }
+        case Expect::Colon:
+            if (c != ':')
+                fail(text, pos, "expected ':'");
+            ++pos;
+            expect = Expect::Value;
+            break;
+        case Expect::CommaOrClose:
+            if (open.empty())
+                fail(text, pos, "unexpected data after the document");
+            if (c == ',')
+            {
+                ++pos;
+                expect = open.back() == '{' ? Expect::Key : Expect::Value;
+            }
+            else if (c == (open.back() == '{' ? '}' : ']'))
+                close();
+            else
+                fail(text, pos, open.back() == '{' ? "expected ',' or '}'" : "expected ',' or ']'");
+            break;
+        }
+    }
+}
+
+void appendUtf8(std::string &out, std::uint32_t cp)
+{
+    if (cp < 0x80)
+        out.push_back(static_cast<char>(cp));
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+std::uint32_t parseHex4(const char *p)
+{
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char c = p[i];
+        value <<= 4;
+        if (isDigit(c))
+            value |= static_cast<std::uint32_t>(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            value |= static_cast<std::uint32_t>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            value |= static_cast<std::uint32_t>(c - 'A' + 10);
+    }
+    return value;
+}
+
+template <typename Slot>
+struct ContainerIndexer
+{
+    std::vector<Slot> &slots;
+    std::vector<std::uint32_t> open;
+
+    void countValue()
+    {
+        if (!open.empty())
+            ++slots[open.back()].count;
+    }
+
+    void beginContainer(std::size_t offset, bool)
+    {
+        countValue();
+        if (slots.size() >= JsonValue::kNoContainer)
+            throw JsonParseError("document has too many containers", offset);
+        open.push_back(static_cast<std::uint32_t>(slots.size()));
+        slots.push_back(Slot{offset, 0, 0, 0});
+    }
+
+    void endContainer(std::size_t offset)
+    {
+        Slot &slot = slots[open.back()];
+        slot.end = offset + 1;
+        slot.next = static_cast<std::uint32_t>(slots.size());
+        open.pop_back();
+    }
+
+    void key(std::size_t, std::size_t) {}
+
+    void scalar(std::size_t, std::size_t, JsonKind)
+    {
+        countValue();
+    }
+};
+
+// Binary scans report through JsonEventHandler, with the last byte of
+// each container.
+template <typename Slot>
+struct BinaryContainerIndexer : JsonEventHandler
+{
+    explicit BinaryContainerIndexer(std::vector<Slot> &slots) : indexer{slots, {}} {}
+
+    void beginContainer(std::uint64_t offset, bool object) override { indexer.beginContainer(offset, object); }
+    void endContainer(std::uint64_t offset) override { indexer.endContainer(offset); }
+    void key(std::uint64_t, std::uint64_t) override {}
+    void scalar(std::uint64_t, std::uint64_t, JsonKind) override { indexer.countValue(); }
+
+    ContainerIndexer<Slot> indexer;
+};
+
+bool namedAsJsonText(const std::string &path)
+{
+    std::size_t dot = path.find_last_of("./");
+    if (dot == std::string::npos || path[dot] != '.')
+        return false;
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == "json" || extension == "jsonl" || extension == "ndjson";
+}
+
+// Whether text starts, after any byte order mark and space, with a byte a
+// JSON value can start with.  Empty text counts, so that it reports the
+// text parse error.
+bool mayStartJsonValue(std::string_view text)
+{
+    text = skipByteOrderMark(text);
+    std::size_t pos = skipSpace(text.data(), 0, text.size());
+    if (pos == text.size())
+        return true;
+    char c = text[pos];
+    return c == '{' || c == '[' || c == '"' || c == '-' || isDigit(c) || c == 't' || c == 'f' || c == 'n' ||
+           c == 'N' || c == 'I';
+}
+
+} // namespace
+
+std::shared_ptr<const JsonBytes> JsonBytes::mapFile(const std::string &path)
+{
+    std::shared_ptr<JsonBytes> bytes(new JsonBytes());
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error(path + ": " + std::strerror(errno));
+    struct stat sb
+    {
+    };
+    if (::fstat(fd, &sb) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error(path + ": " + std::strerror(error));
+    }
+    // Pipes and other special files cannot be mapped; read them instead.
+    if (S_ISREG(sb.st_mode) && sb.st_size > 0)
+    {
+        void *mapping = ::mmap(nullptr, static_cast<std::size_t>(sb.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            ::close(fd);
+            bytes->m_data = static_cast<const char *>(mapping);
+            bytes->m_size = static_cast<std::size_t>(sb.st_size);
+            bytes->m_mapped = true;
+            return bytes;
+        }
+    }
+    ::close(fd);
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error(path + ": cannot open file");
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    bytes->m_owned = std::move(ss).str();
+    bytes->m_data = bytes->m_owned.data();
+    bytes->m_size = bytes->m_owned.size();
+    return bytes;
+}
+
+std::shared_ptr<const JsonBytes> JsonBytes::fromString(std::string text)
+{
+    std::shared_ptr<JsonBytes> bytes(new JsonBytes());
+    bytes->m_owned = std::move(text);
+    bytes->m_data = bytes->m_owned.data();
+    bytes->m_size = bytes->m_owned.size();
+    return bytes;
+}
+
+JsonBytes::~JsonBytes()
+{
+#if !defined(_WIN32)
+    if (m_mapped)
+        ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+}
+
+void JsonBytes::adviseSequential(bool sequential) const noexcept
+{
+#if !defined(_WIN32)
+    if (m_mapped)
+        ::madvise(const_cast<char *>(m_data), m_size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+#else
+    (void)sequential;
+#endif
+}
+
+std::shared_ptr<const JsonDocument> JsonDocument::open(const std::string &path)
+{
+    auto bytes = JsonBytes::mapFile(path);
+    JsonFormat format = jsonFormatForPath(path);
+    if (format != JsonFormat::Text)
+        return std::make_shared<const JsonDocument>(std::move(bytes), format);
+    try
+    {
+        return std::make_shared<const JsonDocument>(bytes, JsonFormat::Text);
+    }
+    catch (const JsonParseError &)
+    {
+        // A file named as JSON that starts like JSON is broken JSON, and
+        // its syntax error is the one to report.
+        if (namedAsJsonText(path) && mayStartJsonValue(bytes->view()))
+            throw;
+        // Binary inputs fail the text scan within a few bytes; so do the
+        // other encodings on text, so trying them all is cheap.
+        for (JsonFormat candidate : {JsonFormat::Bson, JsonFormat::Cbor, JsonFormat::MessagePack, JsonFormat::Ubjson})
+        {
+            try
+            {
+                return std::make_shared<const JsonDocument>(bytes, candidate);
+            }
+            catch (const JsonParseError &)
+            {
+            }
+        }
+        throw;
+    }
+}
+
+std::shared_ptr<const JsonDocument> JsonDocument::fromString(std::string text, JsonFormat format)
+{
+    return std::make_shared<const JsonDocument>(JsonBytes::fromString(std::move(text)), format);
+}
+
+JsonDocument::JsonDocument(std::shared_ptr<const JsonBytes> bytes, std::uint64_t begin, std::uint64_t end)
+    : m_bytes(std::move(bytes))
+{
+    m_text = skipByteOrderMark(m_bytes->view().substr(begin, end - begin));
+    indexText();
+}
+
+JsonDocument::JsonDocument(std::shared_ptr<const JsonBytes> bytes, JsonFormat format)
+    : m_bytes(std::move(bytes)), m_format(format)
+{
+    m_text = m_bytes->view();
+    if (format == JsonFormat::Text)
+    {
+        // Editors on Windows often start UTF-8 files with one.
+        m_text = skipByteOrderMark(m_text);
+        indexText();
+    }
+    else
+        indexBinary();
+}
+
+void JsonDocument::indexBinary()
+{
+    m_codec = &jsonBinaryCodec(m_format);
+    BinaryContainerIndexer<Container> indexer(m_containers);
+    m_bytes->adviseSequential(true);
+    m_root = m_codec->scan(m_text, indexer);
+    m_bytes->adviseSequential(false);
+    m_containers.shrink_to_fit();
+    if (!m_containers.empty() && m_containers.front().begin == m_root.offset)
+        m_root.container = 0;
+}
+
+void JsonDocument::indexText()
+{
+    ContainerIndexer<Container> indexer{m_containers, {}};
+    m_bytes->adviseSequential(true);
+    scanJson(m_text, indexer);
+    m_bytes->adviseSequential(false);
+    m_containers.shrink_to_fit();
+
+    m_root.offset = skipSpace(m_text.data(), 0, m_text.size());
+    if (!m_containers.empty() && m_containers.front().begin == m_root.offset)
+        m_root.container = 0;
+}
+
+const JsonDocument::Container &JsonDocument::containerOf(JsonValue value) const
+{
+    if (value.container != JsonValue::kNoContainer)
+        return m_containers[value.container];
+    // Containers are recorded in document order, so begin offsets are sorted.
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), value.offset,
+                               [](const Container &c, std::uint64_t offset) { return c.begin < offset; });
+    if (it == m_containers.end() || it->begin != value.offset)
+        throw std::out_of_range("JSON value is not a container");
+    return *it;
+}
+
+JsonKind JsonDocument::kind(JsonValue value) const
+{
+    if (m_codec)
+        return m_codec->kind(m_text, value);
+    return jsonKindOfFirstByte(m_text[value.offset]);
+}
+
+JsonKind jsonKindOfFirstByte(char first)
+{
+    switch (first)
+    {
+    case '{':
+        return JsonKind::Object;
+    case '[':
+        return JsonKind::Array;
+    case '"':
+        return JsonKind::String;
+    case 't':
+    case 'f':
+        return JsonKind::Boolean;
+    case 'n':
+        return JsonKind::Null;
+    default:
+        return JsonKind::Number;
+    }
+}
+
+std::string_view skipByteOrderMark(std::string_view text)
+{
+    constexpr std::string_view kByteOrderMark = "\xEF\xBB\xBF";
+    return text.substr(0, kByteOrderMark.size()) == kByteOrderMark ? text.substr(kByteOrderMark.size()) : text;
+}
+
+bool JsonDocument::isContainer(JsonValue value) const
+{
+    if (m_codec)
+    {
+        JsonKind k = m_codec->kind(m_text, value);
+        return k == JsonKind::Array || k == JsonKind::Object;
+    }
+    char c = m_text[value.offset];
+    return c == '{' || c == '[';
+}
+
+std::size_t JsonDocument::size(JsonValue value) const
+{
+    if (!isContainer(value))
+        return 0;
+    return containerOf(value).count;
+}
+
+std::vector<JsonMember> JsonDocument::members(JsonValue value) const
+{
+    std::vector<JsonMember> out;
+    out.reserve(size(value));
+    JsonMemberCursor cursor(*this, value);
+    JsonMember member;
+    while (cursor.next(member))
+        out.push_back(member);
+    return out;
+}
+
+JsonMemberCursor::JsonMemberCursor(const JsonDocument &document, JsonValue container)
+    : m_document(&document), m_container(container)
+{
+    if (!document.isContainer(container))
+        return;
+    const JsonDocument::Container &slot = document.containerOf(container);
+    m_pos = document.m_codec ? document.m_codec->firstMember(document.m_text, container) : slot.begin + 1;
+    m_nested = static_cast<std::uint32_t>(&slot - document.m_containers.data()) + 1;
+    m_remaining = slot.count;
+    m_object = document.kind(container) == JsonKind::Object;
+}
+
+bool JsonMemberCursor::next(JsonMember &member)
+{
+    if (m_remaining == 0)
+        return false;
+    --m_remaining;
+
+    if (const JsonBinaryCodec *codec = m_document->m_codec)
+    {
+        codec->readMember(m_document->m_text, m_container, m_pos, member);
+        if (m_document->isContainer(member.value))
+        {
+            const auto &nested = m_document->m_containers[m_nested];
+            member.value.container = m_nested;
+            m_pos = nested.end;
+            m_nested = nested.next;
+        }
+        else
+            m_pos = codec->scalarEnd(m_document->m_text, member.value);
+        return true;
+    }
+
+    // The text was validated while indexing, so only delimiters need to be
+    // stepped over here; nested containers are skipped via the index.
+    const char *data = m_document->m_text.data();
+    std::size_t size = m_document->m_text.size();
+    std::size_t pos = skipSpace(data, m_pos, size);
+    member = JsonMember();
+    if (m_object)
+    {
+        member.keyOffset = pos;
+        pos = skipString(data, pos, size);
+        pos = skipSpace(data, pos, size) + 1;
+        pos = skipSpace(data, pos, size);
+    }
+    member.value.offset = pos;
+    if (data[pos] == '{' || data[pos] == '[')
+    {
+        const auto &nested = m_document->m_containers[m_nested];
+        member.value.container = m_nested;
+        pos = nested.end;
+        m_nested = nested.next;
+    }
+    else
+        pos = skipScalar(data, pos, size);
+    m_pos = skipSpace(data, pos, size) + 1;
+    return true;
+}
+
+std::uint64_t JsonDocument::end(JsonValue value) const
+{
+    if (isContainer(value))
+        return containerOf(value).end;
+    if (m_codec)
+        return m_codec->scalarEnd(m_text, value);
+    return skipScalar(m_text.data(), value.offset, m_text.size());
+}
+
+std::string_view JsonDocument::source(JsonValue value) const
+{
+    return m_text.substr(value.offset, end(value) - value.offset);
+}
+
+std::string JsonDocument::key(const JsonMember &member) const
+{
+    if (member.keyOffset == JsonMember::kNoKey)
+        return {};
+    if (m_codec)
+        return m_codec->key(m_text, member.keyOffset);
+    std::size_t end = skipString(m_text.data(), member.keyOffset, m_text.size());
+    return decodeJsonString(m_text.substr(member.keyOffset, end - member.keyOffset));
+}
+
+std::string JsonDocument::stringValue(JsonValue value) const
+{
+    if (kind(value) != JsonKind::String)
+        return {};
+    if (m_codec)
+        return m_codec->stringValue(m_text, value);
+    return decodeJsonString(source(value));
+}
+
+bool JsonDocument::booleanValue(JsonValue value) const
+{
+    if (m_codec)
+        return m_codec->booleanValue(m_text, value);
+    return m_text[value.offset] == 't';
+}
+
+double JsonDocument::numberValue(JsonValue value) const
+{
+    if (m_codec)
+        return decodeJsonNumber(m_codec->numberText(m_text, value));
+    return decodeJsonNumber(source(value));
+}
+
+std::string JsonDocument::numberText(JsonValue value) const
+{
+    if (m_codec)
+        return m_codec->numberText(m_text, value);
+    return std::string(source(value));
+}
+
+void scanJsonText(std::string_view text, JsonEventHandler &handler)
+{
+    scanJson(text, handler);
+}
+
+double decodeJsonNumber(std::string_view token)
+{
+    if (token == "NaN")
+        return std::numeric_limits<double>::quiet_NaN();
+    if (token == "Infinity")
+        return std::numeric_limits<double>::infinity();
+    if (token == "-Infinity")
+        return -std::numeric_limits<double>::infinity();
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    double result = 0.0;
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), result);
+    if (ec == std::errc::result_out_of_range)
+    {
+        // Tiny exponents underflow to zero, large ones overflow to infinity.
+        std::size_t exponent = token.find_first_of("eE");
+        bool underflow = exponent != std::string_view::npos && exponent + 1 < token.size() && token[exponent + 1] == '-';
+        double magnitude = underflow ? 0.0 : std::numeric_limits<double>::infinity();
+        return token.front() == '-' ? -magnitude : magnitude;
+    }
+    return result;
+#else
+    std::istringstream in{std::string(token)};
+    in.imbue(std::locale::classic());
+    double result = 0.0;
+    in >> result;
+    return result;
+#endif
+}
+
+std::string decodeJsonString(std::string_view quoted)
+{
+    std::string out;
+    if (quoted.size() < 2)
+        return out;
+    std::string_view body = quoted.substr(1, quoted.size() - 2);
+    out.reserve(body.size());
+    std::size_t i = 0;
+    while (i < body.size())
+    {
+        std::size_t slash = body.find('\\', i);
+        if (slash == std::string_view::npos)
+        {
+            out.append(body.substr(i));
+            break;
+        }
+        out.append(body.substr(i, slash - i));
+        if (slash + 1 >= body.size())
+            break;
+        char escape = body[slash + 1];
+        i = slash + 2;
+        switch (escape)
+        {
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'u':
+        {
+            if (i + 4 > body.size())
+                return out;
+            std::uint32_t cp = parseHex4(body.data() + i);
+            i += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF && i + 6 <= body.size() && body[i] == '\\' && body[i + 1] == 'u')
+            {
+                std::uint32_t low = parseHex4(body.data() + i + 2);
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+            }
+            // Unpaired surrogates cannot be encoded; show a replacement.
+            if (cp >= 0xD800 && cp <= 0xDFFF)
+                cp = 0xFFFD;
+            appendUtf8(out, cp);
+            break;
+        }
+        default:
+            out.push_back(escape);
+            break;
+        }
+    }
+    return out;
+}
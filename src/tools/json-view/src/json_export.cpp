@@ -0,0 +1,377 @@
+// Streaming copy and export of json-view subtrees
+#include "json_export.hpp"
+
+#include "json_lines.hpp"
+#include "json_view_core.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+constexpr std::size_t kChunkSize = 64 * 1024;
+
+// Batches small tokens into chunks; long runs go to the sink directly.
+class ChunkWriter
+{
+public:
+    explicit ChunkWriter(const JsonSink &sink) : m_sink(sink) { m_buffer.reserve(kChunkSize); }
+
+    void put(std::string_view text)
+    {
+        if (text.size() >= kChunkSize)
+        {
+            flush();
+            m_sink(text);
+            return;
+        }
+        m_buffer.append(text);
+        if (m_buffer.size() >= kChunkSize)
+            flush();
+    }
+
+    void put(char c)
+    {
+        m_buffer.push_back(c);
+        if (m_buffer.size() >= kChunkSize)
+            flush();
+    }
+
+    void newline(int depth, int indent)
+    {
+        m_buffer.push_back('\n');
+        if (depth > 0)
+            m_buffer.append(static_cast<std::size_t>(depth) * indent, ' ');
+        if (m_buffer.size() >= kChunkSize)
+            flush();
+    }
+
+    void flush()
+    {
+        if (m_buffer.empty())
+            return;
+        m_sink(m_buffer);
+        m_buffer.clear();
+    }
+
+private:
+    const JsonSink &m_sink;
+    std::string m_buffer;
+};
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDelimiter(char c)
+{
+    switch (c)
+    {
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ',':
+    case ':':
+    case '"':
+        return true;
+    default:
+        return isSpace(c);
+    }
+}
+
+std::size_t skipSpace(std::string_view text, std::size_t pos)
+{
+    while (pos < text.size() && isSpace(text[pos]))
+        ++pos;
+    return pos;
+}
+
+// One past the closing quote of the string opening at pos.
+std::size_t stringEnd(std::string_view text, std::size_t pos)
+{
+    for (std::size_t i = pos + 1; i < text.size();)
+    {
+        i = text.find_first_of("\"\\", i);
+        if (i == std::string_view::npos)
+            break;
+        if (text[i] == '"')
+            return i + 1;
+        i += 2;
+    }
+    return text.size();
+}
+
+std::string_view trimmed(std::string_view text)
+{
+    std::size_t begin = skipSpace(text, 0);
+    std::size_t end = text.size();
+    while (end > begin && isSpace(text[end - 1]))
+        --end;
+    return text.substr(begin, end - begin);
+}
+
+// NaN and the infinities are read as numbers but cannot be written as
+// JSON; like nlohmann::json, they are written as null.
+std::string_view numberToken(std::string_view token)
+{
+    std::size_t letter = token.front() == '-' || token.front() == '+' ? 1 : 0;
+    if (letter < token.size() && (token[letter] == 'N' || token[letter] == 'I'))
+        return "null";
+    return token;
+}
+
+bool isLinesRoot(const Node *node)
+{
+    return !node->document && node->lines && node->isDummyRoot;
+}
+
+void putQuoted(ChunkWriter &out, std::string_view text)
+{
+    static const char digits[] = "0123456789abcdef";
+    out.put('"');
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out.put(text.substr(run, i - run));
+        run = i + 1;
+        switch (c)
+        {
+        case '"':
+            out.put("\\\"");
+            break;
+        case '\\':
+            out.put("\\\\");
+            break;
+        case '\n':
+            out.put("\\n");
+            break;
+        case '\r':
+            out.put("\\r");
+            break;
+        case '\t':
+            out.put("\\t");
+            break;
+        default:
+        {
+            char escape[] = {'\\', 'u', '0', '0', digits[c >> 4], digits[c & 0x0F]};
+            out.put(std::string_view(escape, sizeof(escape)));
+            break;
+        }
+        }
+    }
+    out.put(text.substr(run));
+    out.put('"');
+}
+
+// Binary encodings have no JSON text to reformat, so their values are
+// written out one by one; Raw is written minified.
+void writeDocumentValue(const JsonDocument &document, JsonValue value, JsonWriteStyle style, const JsonSink &sink,
+                        int indent)
+{
+    struct Level
+    {
+        JsonMemberCursor cursor;
+        bool object;
+        bool first;
+    };
+
+    const bool pretty = style == JsonWriteStyle::Pretty;
+    ChunkWriter out(sink);
+    std::vector<Level> open;
+    auto visit = [&](JsonValue v)
+    {
+        JsonKind kind = document.kind(v);
+        switch (kind)
+        {
+        case JsonKind::Object:
+        case JsonKind::Array:
+            if (document.size(v) == 0)
+            {
+                out.put(kind == JsonKind::Object ? "{}" : "[]");
+                break;
+            }
+            out.put(kind == JsonKind::Object ? '{' : '[');
+            open.push_back(Level{JsonMemberCursor(document, v), kind == JsonKind::Object, true});
+            break;
+        case JsonKind::String:
+            putQuoted(out, document.stringValue(v));
+            break;
+        case JsonKind::Number:
+            out.put(numberToken(document.numberText(v)));
+            break;
+        case JsonKind::Boolean:
+            out.put(document.booleanValue(v) ? "true" : "false");
+            break;
+        case JsonKind::Null:
+            out.put("null");
+            break;
+        }
+    };
+
+    visit(value);
+    JsonMember member;
+    while (!open.empty())
+    {
+        Level &top = open.back();
+        if (!top.cursor.next(member))
+        {
+            bool object = top.object;
+            open.pop_back();
+            if (pretty)
+                out.newline(static_cast<int>(open.size()), indent);
+            out.put(object ? '}' : ']');
+            continue;
+        }
+        if (!top.first)
+            out.put(',');
+        top.first = false;
+        if (pretty)
+            out.newline(static_cast<int>(open.size()), indent);
+        if (top.object)
+        {
+            putQuoted(out, document.key(member));
+            out.put(pretty ? std::string_view(": ") : std::string_view(":"));
+        }
+        visit(member.value);
+    }
+    out.flush();
+}
+
+} // namespace
+
+void writeJsonText(std::string_view text, JsonWriteStyle style, const JsonSink &sink, int indent)
+{
+    if (style == JsonWriteStyle::Raw)
+    {
+        text = trimmed(text);
+        if (!text.empty())
+            sink(text);
+        return;
+    }
+
+    const bool pretty = style == JsonWriteStyle::Pretty;
+    ChunkWriter out(sink);
+    int depth = 0;
+    std::size_t pos = 0;
+    while (pos < text.size())
+    {
+        char c = text[pos];
+        switch (c)
+        {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            ++pos;
+            break;
+        case '{':
+        case '[':
+        {
+            char close = c == '{' ? '}' : ']';
+            std::size_t next = skipSpace(text, pos + 1);
+            out.put(c);
+            if (next < text.size() && text[next] == close)
+            {
+                out.put(close);
+                pos = next + 1;
+                break;
+            }
+            ++depth;
+            if (pretty)
+                out.newline(depth, indent);
+            ++pos;
+            break;
+        }
+        case '}':
+        case ']':
+            if (depth > 0)
+                --depth;
+            if (pretty)
+                out.newline(depth, indent);
+            out.put(c);
+            ++pos;
+            break;
+        case ',':
+            out.put(',');
+            if (pretty)
+                out.newline(depth, indent);
+            ++pos;
+            break;
+        case ':':
+            out.put(pretty ? std::string_view(": ") : std::string_view(":"));
+            ++pos;
+            break;
+        case '"':
+        {
+            std::size_t end = stringEnd(text, pos);
+            out.put(text.substr(pos, end - pos));
+            pos = end;
+            break;
+        }
+        default:
+        {
+            std::size_t end = pos + 1;
+            while (end < text.size() && !isDelimiter(text[end]))
+                ++end;
+            out.put(numberToken(text.substr(pos, end - pos)));
+            pos = end;
+            break;
+        }
+        }
+    }
+    out.flush();
+}
+
+void writeNodeJson(const Node *node, JsonWriteStyle style, const JsonSink &sink)
+{
+    if (node->document)
+    {
+        if (node->document->format() == JsonFormat::Text)
+            writeJsonText(node->document->source(node->value), style, sink);
+        else
+            writeDocumentValue(*node->document, node->value, style, sink, 2);
+        return;
+    }
+    if (!node->lines)
+        return;
+    if (node->isDummyRoot)
+    {
+        for (std::size_t idx = 0; idx < node->lines->recordCount(); ++idx)
+        {
+            writeJsonText(node->lines->recordText(idx), style, sink);
+            sink("\n");
+        }
+        return;
+    }
+    // Records that were never expanded are copied from their line as is.
+    writeJsonText(node->lines->recordText(node->index), style, sink);
+}
+
+std::string nodeJsonText(const Node *node, JsonWriteStyle style)
+{
+    std::string out;
+    if (style == JsonWriteStyle::Raw && node->document && node->document->format() == JsonFormat::Text)
+        out.reserve(node->document->source(node->value).size());
+    writeNodeJson(node, style, [&](std::string_view chunk) { out.append(chunk); });
+    return out;
+}
+
+void exportNodeJson(const Node *node, JsonWriteStyle style, const std::string &path)
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open())
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    writeNodeJson(node, style, [&](std::string_view chunk) { stream.write(chunk.data(), chunk.size()); });
+    if (!isLinesRoot(node))
+        stream.put('\n');
+    stream.flush();
+    if (!stream.good())
+        throw std::runtime_error("Error writing " + path);
+}
@@ -0,0 +1,194 @@
+// Line index and incremental follow for JSON Lines documents
+#include "json_lines.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+
+// Below this size a single thread finishes before others could start.
+constexpr std::size_t kParallelThreshold = 16u << 20;
+constexpr std::size_t kMinChunk = 4u << 20;
+
+bool isBlankFrom(std::string_view text, std::size_t pos)
+{
+    for (; pos < text.size(); ++pos)
+    {
+        char c = text[pos];
+        if (c == '\n')
+            return true;
+        if (c != ' ' && c != '\t' && c != '\r')
+            return false;
+    }
+    return true;
+}
+
+// Record starts that fall inside [begin, end).  A line belongs to the chunk
+// containing its first byte, so chunks can be scanned independently.
+void scanChunk(std::string_view text, std::size_t begin, std::size_t end, std::vector<std::uint64_t> &out)
+{
+    if ((begin == 0 || text[begin - 1] == '\n') && begin < end && !isBlankFrom(text, begin))
+        out.push_back(begin);
+    const char *data = text.data();
+    std::size_t pos = begin;
+    while (pos < end)
+    {
+        const void *hit = std::memchr(data + pos, '\n', end - pos);
+        if (!hit)
+            break;
+        std::size_t start = static_cast<std::size_t>(static_cast<const char *>(hit) - data) + 1;
+        if (start < end && !isBlankFrom(text, start))
+            out.push_back(start);
+        pos = start;
+    }
+}
+
+} // namespace
+
+std::vector<std::uint64_t> findRecordStarts(std::string_view text, std::uint64_t begin)
+{
+    std::vector<std::uint64_t> starts;
+    std::size_t length = text.size() - begin;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    if (length < kParallelThreshold || threads == 1)
+    {
+        scanChunk(text, begin, text.size(), starts);
+        return starts;
+    }
+
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, length / kMinChunk));
+    std::size_t chunk = length / threads;
+    std::vector<std::vector<std::uint64_t>> parts(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        std::size_t from = begin + i * chunk;
+        std::size_t to = i + 1 == threads ? text.size() : from + chunk;
+        workers.emplace_back([&text, &parts, i, from, to] { scanChunk(text, from, to, parts[i]); });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    std::size_t total = 0;
+    for (const auto &part : parts)
+        total += part.size();
+    starts.reserve(total);
+    for (const auto &part : parts)
+        starts.insert(starts.end(), part.begin(), part.end());
+    return starts;
+}
+
+bool isJsonLinesPath(const std::string &path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".jsonl" || extension == ".ndjson" || extension == ".jsonlines";
+}
+
+JsonLines::JsonLines(std::shared_ptr<const JsonBytes> bytes, std::string path)
+    : m_bytes(std::move(bytes)), m_path(std::move(path))
+{
+    indexFrom(0);
+}
+
+std::shared_ptr<JsonLines> JsonLines::open(const std::string &path)
+{
+    return std::shared_ptr<JsonLines>(new JsonLines(JsonBytes::mapFile(path), path));
+}
+
+std::shared_ptr<JsonLines> JsonLines::fromString(std::string text)
+{
+    return std::shared_ptr<JsonLines>(new JsonLines(JsonBytes::fromString(std::move(text)), std::string()));
+}
+
+void JsonLines::indexFrom(std::uint64_t begin)
+{
+    std::string_view text = m_bytes->view();
+    m_bytes->adviseSequential(true);
+    std::vector<std::uint64_t> starts = findRecordStarts(text, begin);
+    m_bytes->adviseSequential(false);
+    // The first record starts after a byte order mark.
+    std::uint64_t bom = text.size() - skipByteOrderMark(text).size();
+    if (begin == 0 && bom > 0 && !starts.empty() && starts.front() == 0)
+    {
+        if (isBlankFrom(text, bom))
+            starts.erase(starts.begin());
+        else
+            starts.front() = bom;
+    }
+    m_starts.insert(m_starts.end(), starts.begin(), starts.end());
+
+    // Only the appended range can hold a newer line terminator.
+    for (std::size_t pos = text.size(); pos > begin; --pos)
+    {
+        if (text[pos - 1] == '\n')
+        {
+            m_indexedEnd = pos;
+            break;
+        }
+    }
+    m_partialTail = !m_starts.empty() && m_starts.back() >= m_indexedEnd;
+}
+
+std::string_view JsonLines::recordText(std::size_t index) const
+{
+    std::string_view text = m_bytes->view();
+    std::size_t begin = m_starts[index];
+    std::size_t end = text.find('\n', begin);
+    if (end == std::string_view::npos)
+        end = text.size();
+    if (end > begin && text[end - 1] == '\r')
+        --end;
+    return text.substr(begin, end - begin);
+}
+
+std::shared_ptr<const JsonDocument> JsonLines::parseRecord(std::size_t index) const
+{
+    std::string_view record = recordText(index);
+    std::uint64_t begin = m_starts[index];
+    // The document keeps this mapping alive even if refresh() replaces it.
+    return std::make_shared<const JsonDocument>(m_bytes, begin, begin + record.size());
+}
+
+JsonLines::RefreshResult JsonLines::refresh()
+{
+    if (m_path.empty())
+        return RefreshResult::Unchanged;
+    std::error_code ec;
+    auto size = std::filesystem::file_size(m_path, ec);
+    if (ec || size == m_bytes->size())
+        return RefreshResult::Unchanged;
+
+    std::shared_ptr<const JsonBytes> bytes;
+    try
+    {
+        bytes = JsonBytes::mapFile(m_path);
+    }
+    catch (const std::exception &)
+    {
+        return RefreshResult::Unchanged;
+    }
+
+    if (bytes->size() < m_bytes->size())
+    {
+        // Truncated or rotated: start over.
+        m_bytes = std::move(bytes);
+        m_starts.clear();
+        m_indexedEnd = 0;
+        indexFrom(0);
+        return RefreshResult::Reset;
+    }
+
+    m_bytes = std::move(bytes);
+    // A line that was still being written is indexed again with its tail.
+    if (m_partialTail)
+        m_starts.pop_back();
+    indexFrom(m_indexedEnd);
+    return RefreshResult::Appended;
+}
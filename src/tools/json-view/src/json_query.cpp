@@ -0,0 +1,837 @@
+// JSONPath subset parser and lazy evaluator for json-view
+#include "json_query.hpp"
+
+#include "json_lines.hpp"
+#include "json_view_core.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+
+using Key = JsonQuery::Key;
+using Operand = JsonQuery::Operand;
+using Predicate = JsonQuery::Predicate;
+using Step = JsonQuery::Step;
+
+Step makeStep(Step::Kind kind, std::vector<Key> keys = {})
+{
+    Step step;
+    step.kind = kind;
+    step.keys = std::move(keys);
+    return step;
+}
+
+Predicate makePredicate(Predicate::Kind kind)
+{
+    Predicate predicate;
+    predicate.kind = kind;
+    return predicate;
+}
+
+bool isNameChar(char c)
+{
+    return c != '.' && c != '[' && c != ']' && c != '(' && c != ')' && c != ' ' && c != '\t' && c != '=' &&
+           c != '!' && c != '<' && c != '>' && c != '&' && c != '|' && c != ',' && c != '\'' && c != '"';
+}
+
+class QueryParser
+{
+public:
+    explicit QueryParser(std::string_view text) : m_text(text) {}
+
+    void parse(std::vector<Step> &steps, std::vector<Predicate> &predicates)
+    {
+        m_steps = &steps;
+        m_predicates = &predicates;
+        skipSpace();
+        if (peek() == '$')
+            ++m_pos;
+        else if (m_pos < m_text.size() && peek() != '.' && peek() != '[')
+            step(makeStep(Step::Kind::Name, {readName()}));
+        for (skipSpace(); m_pos < m_text.size(); skipSpace())
+            segment();
+    }
+
+private:
+    [[noreturn]] void fail(const std::string &message) const
+    {
+        throw std::invalid_argument(message + " at position " + std::to_string(m_pos + 1));
+    }
+
+    char peek() const { return m_pos < m_text.size() ? m_text[m_pos] : '\0'; }
+
+    void skipSpace()
+    {
+        while (m_pos < m_text.size() && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t'))
+            ++m_pos;
+    }
+
+    bool eat(std::string_view token)
+    {
+        skipSpace();
+        if (m_text.substr(m_pos, token.size()) != token)
+            return false;
+        m_pos += token.size();
+        return true;
+    }
+
+    void expect(char c)
+    {
+        if (!eat(std::string_view(&c, 1)))
+            fail(std::string("expected '") + c + "'");
+    }
+
+    void step(Step s) { m_steps->push_back(std::move(s)); }
+
+    void segment()
+    {
+        if (eat(".."))
+        {
+            step(makeStep(Step::Kind::Descend));
+            if (peek() == '[')
+                bracket();
+            else if (eat("*"))
+                step(makeStep(Step::Kind::Wildcard));
+            else
+                step(makeStep(Step::Kind::Name, {readName()}));
+        }
+        else if (eat("."))
+        {
+            // jq: a lone '.' is the identity, '.[...]' a subscript
+            if (m_pos == m_text.size())
+                return;
+            if (peek() == '[')
+                bracket();
+            else if (eat("*"))
+                step(makeStep(Step::Kind::Wildcard));
+            else
+                step(makeStep(Step::Kind::Name, {readName()}));
+        }
+        else if (peek() == '[')
+            bracket();
+        else
+            fail("expected '.', '..' or '['");
+    }
+
+    Key readName()
+    {
+        std::size_t begin = m_pos;
+        while (m_pos < m_text.size() && isNameChar(m_text[m_pos]))
+            ++m_pos;
+        if (m_pos == begin)
+            fail("expected a member name");
+        return Key{std::string(m_text.substr(begin, m_pos - begin))};
+    }
+
+    std::string readQuoted()
+    {
+        char quote = m_text[m_pos++];
+        std::string out;
+        while (m_pos < m_text.size() && m_text[m_pos] != quote)
+        {
+            if (m_text[m_pos] == '\\' && m_pos + 1 < m_text.size())
+                ++m_pos;
+            out.push_back(m_text[m_pos++]);
+        }
+        if (m_pos == m_text.size())
+            fail("unterminated string");
+        ++m_pos;
+        return out;
+    }
+
+    bool readInteger(std::int64_t &value)
+    {
+        skipSpace();
+        std::size_t begin = m_pos;
+        if (peek() == '-')
+            ++m_pos;
+        while (m_pos < m_text.size() && m_text[m_pos] >= '0' && m_text[m_pos] <= '9')
+            ++m_pos;
+        if (m_pos == begin || (m_pos == begin + 1 && m_text[begin] == '-'))
+        {
+            m_pos = begin;
+            return false;
+        }
+        value = std::strtoll(std::string(m_text.substr(begin, m_pos - begin)).c_str(), nullptr, 10);
+        return true;
+    }
+
+    void bracket()
+    {
+        expect('[');
+        if (eat("]"))
+        {
+            step(makeStep(Step::Kind::Wildcard)); // jq '.[]'
+            return;
+        }
+        if (eat("*"))
+        {
+            expect(']');
+            step(makeStep(Step::Kind::Wildcard));
+            return;
+        }
+        if (eat("?"))
+        {
+            Step filter = makeStep(Step::Kind::Filter);
+            filter.predicate = orExpression();
+            expect(']');
+            step(std::move(filter));
+            return;
+        }
+
+        Step s = makeStep(Step::Kind::Union);
+        std::int64_t number = 0;
+        skipSpace();
+        bool first = readInteger(number);
+        skipSpace();
+        if (peek() == ':')
+        {
+            s.kind = Step::Kind::Slice;
+            s.hasStart = first;
+            s.start = number;
+            ++m_pos;
+            s.hasEnd = readInteger(s.end);
+            if (eat(":") && !readInteger(s.stride))
+                s.stride = 1;
+            if (s.stride == 0)
+                fail("slice step cannot be zero");
+            expect(']');
+            step(std::move(s));
+            return;
+        }
+        for (bool have = first;;)
+        {
+            skipSpace();
+            if (have)
+                s.keys.push_back(Key{{}, number, true});
+            else if (peek() == '\'' || peek() == '"')
+                s.keys.push_back(Key{readQuoted()});
+            else
+                fail("expected an index, a quoted name, '*' or a filter");
+            if (eat("]"))
+                break;
+            expect(',');
+            skipSpace();
+            have = readInteger(number);
+        }
+        step(std::move(s));
+    }
+
+    int add(Predicate predicate)
+    {
+        m_predicates->push_back(std::move(predicate));
+        return static_cast<int>(m_predicates->size() - 1);
+    }
+
+    int orExpression()
+    {
+        int left = andExpression();
+        while (eat("||"))
+        {
+            Predicate p = makePredicate(Predicate::Kind::Or);
+            p.left = left;
+            p.right = andExpression();
+            left = add(std::move(p));
+        }
+        return left;
+    }
+
+    int andExpression()
+    {
+        int left = unary();
+        while (eat("&&"))
+        {
+            Predicate p = makePredicate(Predicate::Kind::And);
+            p.left = left;
+            p.right = unary();
+            left = add(std::move(p));
+        }
+        return left;
+    }
+
+    int unary()
+    {
+        if (eat("!"))
+        {
+            Predicate p = makePredicate(Predicate::Kind::Not);
+            p.left = unary();
+            return add(std::move(p));
+        }
+        if (eat("("))
+        {
+            int inner = orExpression();
+            expect(')');
+            return inner;
+        }
+        Predicate p = makePredicate(Predicate::Kind::Exists);
+        p.lhs = operand();
+        for (const char *op : {"==", "!=", "<=", ">=", "<", ">"})
+        {
+            if (eat(op))
+            {
+                p.kind = Predicate::Kind::Compare;
+                p.op = op;
+                p.rhs = operand();
+                break;
+            }
+        }
+        return add(std::move(p));
+    }
+
+    Operand operand()
+    {
+        skipSpace();
+        Operand o;
+        char c = peek();
+        if (c == '@')
+        {
+            ++m_pos;
+            o.relative = true;
+            for (;;)
+            {
+                if (peek() == '.' && m_text.substr(m_pos, 2) != "..")
+                {
+                    ++m_pos;
+                    o.path.push_back(readName());
+                }
+                else if (peek() == '[')
+                {
+                    ++m_pos;
+                    skipSpace();
+                    std::int64_t index = 0;
+                    if (peek() == '\'' || peek() == '"')
+                        o.path.push_back(Key{readQuoted()});
+                    else if (readInteger(index))
+                        o.path.push_back(Key{{}, index, true});
+                    else
+                        fail("expected an index or a quoted name");
+                    expect(']');
+                }
+                else
+                    break;
+            }
+        }
+        else if (c == '\'' || c == '"')
+        {
+            o.kind = JsonKind::String;
+            o.string = readQuoted();
+        }
+        else if (eat("true"))
+        {
+            o.kind = JsonKind::Boolean;
+            o.boolean = true;
+        }
+        else if (eat("false"))
+            o.kind = JsonKind::Boolean;
+        else if (eat("null"))
+            o.kind = JsonKind::Null;
+        else
+        {
+            const char *begin = m_text.data() + m_pos;
+            std::string token;
+            while (m_pos < m_text.size() && std::string_view("+-.0123456789eE").find(m_text[m_pos]) != std::string_view::npos)
+                token.push_back(m_text[m_pos++]);
+            char *end = nullptr;
+            o.number = std::strtod(token.c_str(), &end);
+            if (token.empty() || end != token.c_str() + token.size())
+            {
+                m_pos = static_cast<std::size_t>(begin - m_text.data());
+                fail("expected '@' or a literal");
+            }
+            o.kind = JsonKind::Number;
+        }
+        return o;
+    }
+
+    std::string_view m_text;
+    std::size_t m_pos = 0;
+    std::vector<Step> *m_steps = nullptr;
+    std::vector<Predicate> *m_predicates = nullptr;
+};
+
+bool keyEquals(const JsonDocument &document, const JsonMember &member, const std::string &name)
+{
+    if (member.keyOffset == JsonMember::kNoKey)
+        return false;
+    if (document.format() != JsonFormat::Text)
+        return document.key(member) == name;
+    // Compare the raw text unless escapes need decoding.
+    std::string_view text = document.text().substr(member.keyOffset + 1);
+    std::size_t close = text.find_first_of("\"\\");
+    if (close != std::string_view::npos && text[close] == '"')
+        return text.substr(0, close) == name;
+    return document.key(member) == name;
+}
+
+// Position of index (negative counts from the end) among count items.
+bool normalizeIndex(std::int64_t index, std::uint64_t count, std::uint64_t &position)
+{
+    if (index < 0)
+        index += static_cast<std::int64_t>(count);
+    if (index < 0 || static_cast<std::uint64_t>(index) >= count)
+        return false;
+    position = static_cast<std::uint64_t>(index);
+    return true;
+}
+
+// Member at a key of a container, for '@' paths in filters.
+bool childAt(const JsonDocument &document, JsonValue value, const Key &key, JsonValue &child)
+{
+    JsonKind kind = document.kind(value);
+    JsonMemberCursor cursor(document, value);
+    JsonMember member;
+    if (key.isIndex)
+    {
+        std::uint64_t position = 0;
+        if (kind != JsonKind::Array || !normalizeIndex(key.index, document.size(value), position))
+            return false;
+        for (std::uint64_t i = 0; i <= position; ++i)
+            cursor.next(member);
+        child = member.value;
+        return true;
+    }
+    if (kind != JsonKind::Object)
+        return false;
+    while (cursor.next(member))
+    {
+        if (keyEquals(document, member, key.name))
+        {
+            child = member.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Resolved
+{
+    bool found = false;
+    JsonKind kind = JsonKind::Null;
+    double number = 0.0;
+    std::string string;
+    bool boolean = false;
+};
+
+Resolved resolve(const Operand &operand, const JsonDocument &document, JsonValue value)
+{
+    Resolved r;
+    if (!operand.relative)
+    {
+        r.found = true;
+        r.kind = operand.kind;
+        r.number = operand.number;
+        r.string = operand.string;
+        r.boolean = operand.boolean;
+        return r;
+    }
+    for (const Key &key : operand.path)
+    {
+        if (!childAt(document, value, key, value))
+            return r;
+    }
+    r.found = true;
+    r.kind = document.kind(value);
+    switch (r.kind)
+    {
+    case JsonKind::Number:
+        r.number = document.numberValue(value);
+        break;
+    case JsonKind::String:
+        r.string = document.stringValue(value);
+        break;
+    case JsonKind::Boolean:
+        r.boolean = document.booleanValue(value);
+        break;
+    default:
+        break;
+    }
+    return r;
+}
+
+bool compare(const Resolved &a, const std::string &op, const Resolved &b)
+{
+    if (!a.found || !b.found)
+        return op == "!=" && a.found != b.found;
+    bool equalOnly = op == "==" || op == "!=";
+    int order = 0;
+    if (a.kind != b.kind)
+        return op == "!=";
+    switch (a.kind)
+    {
+    case JsonKind::Number:
+        if (std::isnan(a.number) || std::isnan(b.number))
+            return op == "!=";
+        order = a.number < b.number ? -1 : (a.number > b.number ? 1 : 0);
+        break;
+    case JsonKind::String:
+        order = a.string.compare(b.string);
+        break;
+    case JsonKind::Boolean:
+        if (!equalOnly)
+            return false;
+        order = a.boolean == b.boolean ? 0 : 1;
+        break;
+    case JsonKind::Null:
+        if (!equalOnly)
+            return false;
+        break;
+    default:
+        // Containers are only ever equal to themselves; not compared.
+        return op == "!=";
+    }
+    if (op == "==")
+        return order == 0;
+    if (op == "!=")
+        return order != 0;
+    if (op == "<")
+        return order < 0;
+    if (op == "<=")
+        return order <= 0;
+    if (op == ">")
+        return order > 0;
+    return order >= 0;
+}
+
+} // namespace
+
+JsonQuery::JsonQuery(std::string_view text) : m_text(text)
+{
+    QueryParser(text).parse(m_steps, m_predicates);
+}
+
+// A value still to be visited, or a container whose children are being
+// walked one at a time for steps[step].
+struct JsonQueryCursor::Frame
+{
+    // Null for the record list of a JSON Lines root.
+    const JsonDocument *document = nullptr;
+    // Keeps a parsed JSON Lines record alive while its values are visited.
+    std::shared_ptr<const JsonDocument> record;
+    JsonValue value;
+    std::vector<std::uint32_t> path;
+    std::uint32_t step = 0;
+
+    bool scanning = false;
+    // Children keep the same step instead of advancing ('..').
+    bool descend = false;
+    JsonMemberCursor members;
+    std::uint64_t position = 0;
+    std::uint64_t count = 0;
+    // Slices with a positive stride: next selected position and bound.
+    bool slice = false;
+    std::uint64_t selected = 0;
+    std::uint64_t stop = 0;
+    std::uint64_t stride = 1;
+};
+
+JsonQueryCursor::JsonQueryCursor(std::shared_ptr<const JsonQuery> query, const Node *root)
+    : m_query(std::move(query))
+{
+    Frame start;
+    if (root->lines && root->isDummyRoot)
+    {
+        m_lines = root->ownedLines;
+        start.count = m_lines->recordCount();
+    }
+    else
+    {
+        m_document = root->ownedDocument;
+        start.document = root->document;
+        start.value = root->value;
+    }
+    m_frames.push_back(std::move(start));
+}
+
+JsonQueryCursor::~JsonQueryCursor() = default;
+
+bool JsonQueryCursor::done() const
+{
+    return m_frames.empty();
+}
+
+std::vector<std::vector<std::uint32_t>> JsonQueryCursor::next(std::size_t maxResults, std::size_t maxVisits)
+{
+    std::vector<std::vector<std::uint32_t>> out;
+    for (std::size_t visits = 0; !m_frames.empty() && out.size() < maxResults && visits < maxVisits; ++visits)
+    {
+        if (m_frames.back().scanning)
+            advance();
+        else
+        {
+            Frame frame = std::move(m_frames.back());
+            m_frames.pop_back();
+            expand(std::move(frame), out);
+        }
+    }
+    return out;
+}
+
+// Apply steps[frame.step] to a value: emit it when no steps are left,
+// otherwise queue the children it selects.
+void JsonQueryCursor::expand(Frame frame, std::vector<std::vector<std::uint32_t>> &out)
+{
+    const auto &steps = m_query->steps();
+    if (frame.step == steps.size())
+    {
+        out.push_back(std::move(frame.path));
+        return;
+    }
+    const Step &step = steps[frame.step];
+    bool records = frame.document == nullptr;
+    if (!records)
+    {
+        if (!frame.document->isContainer(frame.value))
+        {
+            if (step.kind == Step::Kind::Descend)
+            {
+                ++frame.step;
+                m_frames.push_back(std::move(frame));
+            }
+            return;
+        }
+        frame.count = frame.document->size(frame.value);
+    }
+    JsonKind kind = records ? JsonKind::Array : frame.document->kind(frame.value);
+
+    // Queue the child at a position; JSON Lines records are parsed here
+    // and skipped when they do not parse.
+    std::vector<Frame> children;
+    auto addChild = [&](std::uint64_t position, JsonValue value) {
+        Frame child;
+        if (records)
+        {
+            try
+            {
+                child.record = m_lines->parseRecord(position);
+            }
+            catch (const JsonParseError &)
+            {
+                return;
+            }
+            child.document = child.record.get();
+            child.value = child.record->root();
+        }
+        else
+        {
+            child.document = frame.document;
+            child.record = frame.record;
+            child.value = value;
+        }
+        child.path = frame.path;
+        child.path.push_back(static_cast<std::uint32_t>(position));
+        child.step = frame.step + 1;
+        children.push_back(std::move(child));
+    };
+
+    Frame scan = frame;
+    scan.scanning = true;
+    if (!records)
+        scan.members = JsonMemberCursor(*frame.document, frame.value);
+
+    switch (step.kind)
+    {
+    case Step::Kind::Descend:
+    {
+        // Children first on the stack so that this value's own matches
+        // come out before those of its descendants.
+        scan.descend = true;
+        m_frames.push_back(std::move(scan));
+        ++frame.step;
+        m_frames.push_back(std::move(frame));
+        return;
+    }
+    case Step::Kind::Name:
+        if (kind == JsonKind::Object)
+            m_frames.push_back(std::move(scan));
+        return;
+    case Step::Kind::Wildcard:
+    case Step::Kind::Filter:
+        m_frames.push_back(std::move(scan));
+        return;
+    case Step::Kind::Slice:
+    {
+        if (kind != JsonKind::Array)
+            return;
+        auto count = static_cast<std::int64_t>(frame.count);
+        auto clamp = [count](std::int64_t v, std::int64_t low, std::int64_t high) {
+            if (v < 0)
+                v += count;
+            return std::clamp(v, low, high);
+        };
+        if (step.stride > 0)
+        {
+            std::int64_t from = step.hasStart ? clamp(step.start, 0, count) : 0;
+            std::int64_t to = step.hasEnd ? clamp(step.end, 0, count) : count;
+            scan.slice = true;
+            scan.selected = static_cast<std::uint64_t>(from);
+            scan.stop = static_cast<std::uint64_t>(std::max(from, to));
+            scan.stride = static_cast<std::uint64_t>(step.stride);
+            m_frames.push_back(std::move(scan));
+            return;
+        }
+        // Backwards: collect the selection, then queue it so the highest
+        // position is visited first.
+        std::int64_t from = step.hasStart ? clamp(step.start, -1, count - 1) : count - 1;
+        std::int64_t to = step.hasEnd ? clamp(step.end, -1, count - 1) : -1;
+        std::vector<std::uint64_t> wanted;
+        for (std::int64_t i = from; i > to; i += step.stride)
+            wanted.push_back(static_cast<std::uint64_t>(i));
+        std::reverse(wanted.begin(), wanted.end());
+        if (records)
+        {
+            for (std::uint64_t position : wanted)
+                addChild(position, JsonValue());
+        }
+        else
+        {
+            JsonMember member;
+            std::size_t next = 0;
+            for (std::uint64_t position = 0; next < wanted.size() && scan.members.next(member); ++position)
+            {
+                if (position == wanted[next])
+                {
+                    addChild(position, member.value);
+                    ++next;
+                }
+            }
+        }
+        for (auto &child : children)
+            m_frames.push_back(std::move(child));
+        return;
+    }
+    case Step::Kind::Union:
+    {
+        for (const Key &key : step.keys)
+        {
+            std::uint64_t position = 0;
+            if (key.isIndex)
+            {
+                if (kind != JsonKind::Array || !normalizeIndex(key.index, frame.count, position))
+                    continue;
+                JsonValue value;
+                if (!records)
+                    childAt(*frame.document, frame.value, key, value);
+                addChild(position, value);
+            }
+            else if (kind == JsonKind::Object)
+            {
+                JsonMemberCursor cursor(*frame.document, frame.value);
+                JsonMember member;
+                for (; cursor.next(member); ++position)
+                {
+                    if (keyEquals(*frame.document, member, key.name))
+                        addChild(position, member.value);
+                }
+            }
+        }
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+            m_frames.push_back(std::move(*it));
+        return;
+    }
+    }
+}
+
+// Take the next child of the scanning frame on top of the stack.
+void JsonQueryCursor::advance()
+{
+    Frame &scan = m_frames.back();
+    const Step &step = m_query->steps()[scan.step];
+    Frame child;
+    child.step = scan.descend ? scan.step : scan.step + 1;
+    std::uint64_t position = 0;
+
+    if (scan.slice)
+    {
+        if (scan.selected >= scan.stop)
+        {
+            m_frames.pop_back();
+            return;
+        }
+        if (scan.document && scan.position < scan.selected)
+        {
+            // Step over the members between two selected positions.
+            JsonMember skipped;
+            scan.members.next(skipped);
+            ++scan.position;
+            return;
+        }
+        scan.position = scan.selected;
+        scan.selected += scan.stride;
+    }
+    else if (scan.position >= scan.count)
+    {
+        m_frames.pop_back();
+        return;
+    }
+    position = scan.position++;
+
+    if (!scan.document)
+    {
+        // A JSON Lines record: parse it now; unparsable lines are skipped.
+        try
+        {
+            child.record = m_lines->parseRecord(position);
+        }
+        catch (const JsonParseError &)
+        {
+            return;
+        }
+        child.document = child.record.get();
+        child.value = child.record->root();
+    }
+    else
+    {
+        JsonMember member;
+        if (!scan.members.next(member))
+        {
+            m_frames.pop_back();
+            return;
+        }
+        if (step.kind == Step::Kind::Name && !keyEquals(*scan.document, member, step.keys.front().name))
+            return;
+        child.document = scan.document;
+        child.record = scan.record;
+        child.value = member.value;
+    }
+    if (step.kind == Step::Kind::Filter && !test(*child.document, child.value, step.predicate))
+        return;
+
+    child.path = scan.path;
+    child.path.push_back(static_cast<std::uint32_t>(position));
+    m_frames.push_back(std::move(child));
+}
+
+bool JsonQueryCursor::test(const JsonDocument &document, JsonValue value, int predicate) const
+{
+    const Predicate &p = m_query->predicates()[predicate];
+    switch (p.kind)
+    {
+    case Predicate::Kind::Or:
+        return test(document, value, p.left) || test(document, value, p.right);
+    case Predicate::Kind::And:
+        return test(document, value, p.left) && test(document, value, p.right);
+    case Predicate::Kind::Not:
+        return !test(document, value, p.left);
+    case Predicate::Kind::Exists:
+    {
+        // '@.key' tests for presence; a bare literal for truthiness.
+        Resolved r = resolve(p.lhs, document, value);
+        if (p.lhs.relative)
+            return r.found;
+        return r.kind != JsonKind::Null && !(r.kind == JsonKind::Boolean && !r.boolean);
+    }
+    case Predicate::Kind::Compare:
+        return compare(resolve(p.lhs, document, value), p.op, resolve(p.rhs, document, value));
+    }
+    return false;
+}
+
+std::vector<std::vector<std::uint32_t>> evaluateQuery(const std::string &query, const Node *root)
+{
+    JsonQueryCursor cursor(std::make_shared<const JsonQuery>(query), root);
+    return cursor.next(SIZE_MAX);
+}
@@ -0,0 +1,513 @@
+// Background search index and parallel queries for json-view
+#include "json_search.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
+
+namespace
+{
+
+// Entries per unit of work handed to a query thread.
+constexpr std::size_t kChunkEntries = 1u << 15;
+
+void lowerAscii(char *begin, char *end)
+{
+    for (; begin != end; ++begin)
+    {
+        if (*begin >= 'A' && *begin <= 'Z')
+            *begin = static_cast<char>(*begin - 'A' + 'a');
+    }
+}
+
+std::string lowerAscii(std::string_view text)
+{
+    std::string out(text);
+    lowerAscii(out.data(), out.data() + out.size());
+    return out;
+}
+
+struct BuildCancelled
+{
+};
+
+// Records one entry per value while the document is scanned once more.
+class IndexBuilder : public JsonEventHandler
+{
+public:
+    IndexBuilder(std::string_view source, std::vector<JsonSearchIndex::Entry> &entries, std::string &text,
+                 const std::atomic<bool> &cancelled)
+        : m_source(source), m_entries(entries), m_text(text), m_cancelled(cancelled) {}
+
+    void beginContainer(std::uint64_t, bool object) override
+    {
+        std::uint32_t id = add(object ? "dictionary" : "list");
+        m_open.push_back(Open{id, 0, object});
+    }
+
+    void endContainer(std::uint64_t) override
+    {
+        m_open.pop_back();
+    }
+
+    void key(std::uint64_t begin, std::uint64_t end) override
+    {
+        m_key = decodeJsonString(m_source.substr(begin, end - begin));
+    }
+
+    void scalar(std::uint64_t begin, std::uint64_t end, JsonKind kind) override
+    {
+        std::string_view token = m_source.substr(begin, end - begin);
+        if (kind == JsonKind::String)
+            add(decodeJsonString(token));
+        else
+            add(token);
+    }
+
+    // For documents that are walked rather than scanned: the name of the
+    // next member, and a scalar's searchable text.
+    void setKey(std::string name) { m_key = std::move(name); }
+    void value(std::string_view text) { add(text); }
+
+    // For JSON Lines: scan one record as the item at the given position of
+    // the open root list, or leave it out if it does not parse.
+    void record(std::string_view text, std::uint32_t index)
+    {
+        std::size_t entries = m_entries.size();
+        std::size_t textSize = m_text.size();
+        m_source = text;
+        m_open.resize(1);
+        m_open.back().children = index;
+        try
+        {
+            scanJsonText(text, *this);
+        }
+        catch (const JsonParseError &)
+        {
+            m_entries.resize(entries);
+            m_text.resize(textSize);
+        }
+    }
+
+private:
+    struct Open
+    {
+        std::uint32_t entry;
+        std::uint32_t children;
+        bool object;
+    };
+
+    std::uint32_t add(std::string_view value)
+    {
+        if ((m_entries.size() & 0xFFFF) == 0 && m_cancelled.load(std::memory_order_relaxed))
+            throw BuildCancelled{};
+        if (m_entries.size() >= JsonSearchIndex::kNoParent)
+            throw std::length_error("too many values to index");
+
+        JsonSearchIndex::Entry entry;
+        entry.text = m_text.size();
+        if (!m_open.empty())
+        {
+            Open &parent = m_open.back();
+            entry.parent = parent.entry;
+            entry.index = parent.children++;
+            if (parent.object)
+            {
+                entry.keyLength = static_cast<std::uint32_t>(m_key.size());
+                m_text += m_key;
+            }
+        }
+        entry.valueLength = static_cast<std::uint32_t>(value.size());
+        std::size_t valueStart = m_text.size();
+        m_text += value;
+        // Keys keep their case for path filters, which compare it.
+        lowerAscii(m_text.data() + valueStart, m_text.data() + m_text.size());
+        m_entries.push_back(entry);
+        return static_cast<std::uint32_t>(m_entries.size() - 1);
+    }
+
+    std::string_view m_source;
+    std::vector<JsonSearchIndex::Entry> &m_entries;
+    std::string &m_text;
+    const std::atomic<bool> &m_cancelled;
+    std::vector<Open> m_open;
+    std::string m_key;
+};
+
+// Binary encodings have no text tokens to scan; walk their values instead.
+void walkDocument(const JsonDocument &document, IndexBuilder &builder)
+{
+    std::vector<JsonMemberCursor> open;
+    auto visit = [&](JsonValue value)
+    {
+        switch (document.kind(value))
+        {
+        case JsonKind::Object:
+        case JsonKind::Array:
+            builder.beginContainer(value.offset, document.kind(value) == JsonKind::Object);
+            open.emplace_back(document, value);
+            break;
+        case JsonKind::String:
+            builder.value(document.stringValue(value));
+            break;
+        case JsonKind::Number:
+            builder.value(document.numberText(value));
+            break;
+        case JsonKind::Boolean:
+            builder.value(document.booleanValue(value) ? "true" : "false");
+            break;
+        case JsonKind::Null:
+            builder.value("null");
+            break;
+        }
+    };
+
+    visit(document.root());
+    JsonMember member;
+    while (!open.empty())
+    {
+        if (!open.back().next(member))
+        {
+            builder.endContainer(0);
+            open.pop_back();
+            continue;
+        }
+        if (member.keyOffset != JsonMember::kNoKey)
+            builder.setKey(document.key(member));
+        visit(member.value);
+    }
+}
+
+std::string_view trimSpaces(std::string_view text)
+{
+    std::size_t begin = text.find_first_not_of(' ');
+    if (begin == std::string_view::npos)
+        return {};
+    std::size_t end = text.find_last_not_of(' ');
+    return text.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+std::shared_ptr<JsonSearchIndex> JsonSearchIndex::build(std::shared_ptr<const JsonDocument> document)
+{
+    std::shared_ptr<JsonSearchIndex> index(new JsonSearchIndex());
+    index->m_thread = std::thread([raw = index.get(), document = std::move(document)]() mutable
+                                  { raw->run(std::move(document), nullptr); });
+    return index;
+}
+
+std::shared_ptr<JsonSearchIndex> JsonSearchIndex::build(const JsonLines &lines)
+{
+    std::shared_ptr<JsonSearchIndex> index(new JsonSearchIndex());
+    // A copy, so that refresh() on the caller's side cannot move the
+    // records while they are read.
+    auto snapshot = std::make_shared<const JsonLines>(lines);
+    index->m_thread = std::thread([raw = index.get(), snapshot = std::move(snapshot)]() mutable
+                                  { raw->run(nullptr, std::move(snapshot)); });
+    return index;
+}
+
+JsonSearchIndex::~JsonSearchIndex()
+{
+    m_cancelled.store(true, std::memory_order_relaxed);
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void JsonSearchIndex::run(std::shared_ptr<const JsonDocument> document, std::shared_ptr<const JsonLines> lines)
+{
+    try
+    {
+        // Keys and values decode to at most their source size.
+        m_text.reserve(document ? document->byteSize() : lines->byteSize());
+        IndexBuilder builder(document ? document->text() : std::string_view(), m_entries, m_text, m_cancelled);
+        if (lines)
+        {
+            builder.beginContainer(0, false);
+            for (std::size_t idx = 0; idx < lines->recordCount(); ++idx)
+                builder.record(lines->recordText(idx), static_cast<std::uint32_t>(idx));
+        }
+        else if (document->format() == JsonFormat::Text)
+            scanJsonText(document->text(), builder);
+        else
+            walkDocument(*document, builder);
+        m_text.shrink_to_fit();
+    }
+    catch (...)
+    {
+        // Cancelled or out of memory: searches simply find nothing.
+        m_entries.clear();
+        m_text.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.store(true, std::memory_order_release);
+    }
+    m_builtCondition.notify_all();
+}
+
+bool JsonSearchIndex::waitFor(int timeoutMs) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_builtCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return ready(); });
+}
+
+std::string_view JsonSearchIndex::key(const Entry &entry) const
+{
+    if (entry.keyLength == kNoKey)
+        return {};
+    return std::string_view(m_text).substr(entry.text, entry.keyLength);
+}
+
+std::string_view JsonSearchIndex::value(const Entry &entry) const
+{
+    std::uint64_t begin = entry.text + (entry.keyLength == kNoKey ? 0 : entry.keyLength);
+    return std::string_view(m_text).substr(begin, entry.valueLength);
+}
+
+std::vector<std::uint32_t> JsonSearchIndex::pathOf(std::uint32_t id) const
+{
+    std::vector<std::uint32_t> path;
+    for (const Entry *e = &m_entries[id]; e->parent != kNoParent; e = &m_entries[e->parent])
+        path.push_back(e->index);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+std::vector<JsonQuery::Step> parseSearchPath(std::string_view path)
+{
+    using Step = JsonQuery::Step;
+    JsonQuery query(path);
+    auto unsupported = [](const char *what) {
+        throw std::invalid_argument(std::string(what) + " cannot be used in a search path");
+    };
+    for (const Step &step : query.steps())
+    {
+        switch (step.kind)
+        {
+        case Step::Kind::Filter:
+            unsupported("filters");
+            break;
+        case Step::Kind::Union:
+            for (const JsonQuery::Key &key : step.keys)
+            {
+                if (key.isIndex && key.index < 0)
+                    unsupported("negative indices");
+            }
+            break;
+        case Step::Kind::Slice:
+            if (step.stride < 0 || (step.hasStart && step.start < 0) || (step.hasEnd && step.end < 0))
+                unsupported("negative slice bounds and steps");
+            break;
+        default:
+            break;
+        }
+    }
+    return query.steps();
+}
+
+JsonSearchJob::JsonSearchJob(std::shared_ptr<const JsonSearchIndex> index, JsonSearchQuery query)
+    : m_index(std::move(index)), m_query(std::move(query))
+{
+    if (m_query.regex)
+        m_regex = std::regex(m_query.term, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+    else
+        m_query.term = lowerAscii(m_query.term);
+    m_filterByPath = !trimSpaces(m_query.path).empty();
+    if (m_filterByPath)
+        m_path = parseSearchPath(m_query.path);
+    m_thread = std::thread([this] { run(); });
+}
+
+JsonSearchJob::~JsonSearchJob()
+{
+    cancel();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void JsonSearchJob::run()
+{
+    while (!m_index->waitFor(50))
+    {
+        if (m_cancelled.load(std::memory_order_relaxed))
+            break;
+    }
+
+    std::size_t chunks = 0;
+    if (m_index->ready() && !m_cancelled.load(std::memory_order_relaxed))
+        chunks = (m_index->entryCount() + kChunkEntries - 1) / kChunkEntries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_chunkMatches.resize(chunks);
+        m_chunkDone.assign(chunks, 0);
+    }
+
+    auto work = [this, chunks] {
+        for (;;)
+        {
+            std::size_t chunk = m_nextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (chunk >= chunks || m_cancelled.load(std::memory_order_relaxed))
+                return;
+            scanChunk(chunk);
+        }
+    };
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunks));
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+    work();
+    for (auto &worker : workers)
+        worker.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scanned = true;
+}
+
+void JsonSearchJob::scanChunk(std::size_t chunk)
+{
+    std::size_t begin = chunk * kChunkEntries;
+    std::size_t end = std::min(begin + kChunkEntries, m_index->entryCount());
+    std::vector<std::uint32_t> found;
+    for (std::size_t id = begin; id < end; ++id)
+    {
+        if (matches(static_cast<std::uint32_t>(id)))
+            found.push_back(static_cast<std::uint32_t>(id));
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chunkMatches[chunk] = std::move(found);
+    m_chunkDone[chunk] = 1;
+}
+
+bool JsonSearchJob::matchesText(std::string_view text, bool lowercased) const
+{
+    if (m_query.regex)
+        return std::regex_search(text.begin(), text.end(), m_regex);
+    if (lowercased)
+        return text.find(m_query.term) != std::string_view::npos;
+    const std::string &term = m_query.term;
+    return std::search(text.begin(), text.end(), term.begin(), term.end(), [](char c, char lower) {
+               return (c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c) == lower;
+           }) != text.end();
+}
+
+bool JsonSearchJob::matches(std::uint32_t id) const
+{
+    const JsonSearchIndex::Entry &entry = m_index->entry(id);
+    bool hit = m_query.term.empty();
+    if (!hit && m_query.searchKeys)
+    {
+        if (entry.keyLength != JsonSearchIndex::kNoKey)
+            hit = matchesText(m_index->key(entry), false);
+        else if (entry.parent != JsonSearchIndex::kNoParent)
+        {
+            // Array items are labelled "[i]" in the outline.
+            char label[16] = "[";
+            char *end = std::to_chars(label + 1, label + sizeof(label) - 1, entry.index).ptr;
+            *end++ = ']';
+            hit = matchesText(std::string_view(label, static_cast<std::size_t>(end - label)), true);
+        }
+    }
+    if (!hit && m_query.searchValues)
+        hit = matchesText(m_index->value(entry), true);
+    // The path is only checked for candidates; it needs a walk to the root.
+    return hit && (!m_filterByPath || matchesPath(id));
+}
+
+bool JsonSearchJob::matchesPath(std::uint32_t id) const
+{
+    std::vector<const JsonSearchIndex::Entry *> chain;
+    for (const auto *e = &m_index->entry(id); e->parent != JsonSearchIndex::kNoParent; e = &m_index->entry(e->parent))
+        chain.push_back(e);
+    std::reverse(chain.begin(), chain.end());
+
+    // Glob-style match with Descend as the star; remembers only the most
+    // recent Descend, which is enough for this pattern language.
+    std::size_t step = 0, level = 0;
+    std::size_t starStep = std::string::npos, starLevel = 0;
+    // Names select object members, indices and slices array items, as in
+    // JsonQueryCursor.
+    using Step = JsonQuery::Step;
+    auto keyMatches = [&](const JsonQuery::Key &key, const JsonSearchIndex::Entry &e) {
+        if (key.isIndex)
+            return e.keyLength == JsonSearchIndex::kNoKey && static_cast<std::int64_t>(e.index) == key.index;
+        return e.keyLength != JsonSearchIndex::kNoKey && m_index->key(e) == key.name;
+    };
+    auto stepMatches = [&](const Step &s, const JsonSearchIndex::Entry &e) {
+        switch (s.kind)
+        {
+        case Step::Kind::Name:
+        case Step::Kind::Union:
+            return std::any_of(s.keys.begin(), s.keys.end(),
+                               [&](const JsonQuery::Key &key) { return keyMatches(key, e); });
+        case Step::Kind::Slice:
+        {
+            if (e.keyLength != JsonSearchIndex::kNoKey)
+                return false;
+            auto position = static_cast<std::int64_t>(e.index);
+            std::int64_t start = s.hasStart ? s.start : 0;
+            return position >= start && (!s.hasEnd || position < s.end) && (position - start) % s.stride == 0;
+        }
+        default:
+            return true;
+        }
+    };
+    while (level < chain.size())
+    {
+        if (step < m_path.size() && m_path[step].kind == Step::Kind::Descend)
+        {
+            starStep = step++;
+            starLevel = level;
+        }
+        else if (step < m_path.size() && stepMatches(m_path[step], *chain[level]))
+        {
+            ++step;
+            ++level;
+        }
+        else if (starStep != std::string::npos)
+        {
+            step = starStep + 1;
+            level = ++starLevel;
+        }
+        else
+            return false;
+    }
+    while (step < m_path.size() && m_path[step].kind == Step::Kind::Descend)
+        ++step;
+    return step == m_path.size();
+}
+
+std::vector<std::vector<std::uint32_t>> JsonSearchJob::takeResults(std::size_t limit)
+{
+    std::vector<std::uint32_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (ids.size() < limit && m_delivered < m_chunkDone.size() && m_chunkDone[m_delivered])
+        {
+            auto &chunk = m_chunkMatches[m_delivered];
+            std::size_t take = std::min(limit - ids.size(), chunk.size() - m_deliveredInChunk);
+            ids.insert(ids.end(), chunk.begin() + m_deliveredInChunk, chunk.begin() + m_deliveredInChunk + take);
+            m_deliveredInChunk += take;
+            if (m_deliveredInChunk == chunk.size())
+            {
+                std::vector<std::uint32_t>().swap(chunk);
+                ++m_delivered;
+                m_deliveredInChunk = 0;
+            }
+        }
+    }
+    std::vector<std::vector<std::uint32_t>> paths;
+    paths.reserve(ids.size());
+    for (std::uint32_t id : ids)
+        paths.push_back(m_index->pathOf(id));
+    return paths;
+}
+
+bool JsonSearchJob::finished() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_scanned && m_delivered == m_chunkDone.size();
+}
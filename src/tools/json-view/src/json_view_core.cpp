@@ -1,14 +1,16 @@
 // Core functionality for json-view shared between different frontends
 #include "json_view_core.hpp"
 
+#include "json_binary.hpp"
+
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <limits>
 #include <map>
 #include <memory>
 #include <deque>
@@ -46,61 +48,204 @@ int getDisplayWidth(const std::string &str)
     return (width >= 0) ? width : str.length();
 }
 
-// Build a tree of Node objects mirroring the structure of a JSON
-// document.  Each Node stores a pointer to the original JSON value.
-std::unique_ptr<Node> buildTree(const json *j, const std::string &key,
-                                Node *parent, bool dummy)
+// Create a Node for one value of an indexed document.  Children are not
+// created here; see childAt.
+static std::unique_ptr<Node> makeNode(const JsonDocument &document, JsonValue value,
+                                      std::string key, Node *parent, bool dummy)
 {
     auto node = std::make_unique<Node>();
-    node->value = j;
+    node->document = &document;
+    node->value = value;
     node->parent = parent;
-    node->key = key;
+    node->key = std::move(key);
     node->isDummyRoot = dummy;
     // Root nodes are expanded by default so the top‑level structure is visible.
     node->expanded = dummy;
-    // Recursively create children for objects and arrays.  Primitive
-    // values have no children.
-    if (j->is_object())
+    return node;
+}
+
+std::unique_ptr<Node> buildTree(std::shared_ptr<const JsonDocument> document, const std::string &key)
+{
+    auto root = makeNode(*document, document->root(), key, nullptr, true);
+    root->ownedDocument = std::move(document);
+    return root;
+}
+
+static std::unique_ptr<Node> makeRecordNode(const JsonLines &lines, size_t idx, Node *root)
+{
+    auto node = std::make_unique<Node>();
+    node->lines = &lines;
+    node->parent = root;
+    node->key = "[" + std::to_string(idx) + "]";
+    node->index = static_cast<std::uint32_t>(idx);
+    return node;
+}
+
+std::unique_ptr<Node> buildLinesTree(std::shared_ptr<const JsonLines> lines, const std::string &key)
+{
+    auto root = std::make_unique<Node>();
+    root->lines = lines.get();
+    root->ownedLines = std::move(lines);
+    root->key = key;
+    root->isDummyRoot = true;
+    root->expanded = true;
+    ensureChildren(root.get());
+    return root;
+}
+
+// Add rows for records indexed by JsonLines::refresh since the last call.
+size_t appendNewRecords(Node *root)
+{
+    if (!root->lines || !root->childrenLoaded)
+        return 0;
+    size_t before = root->childCount;
+    size_t count = root->lines->recordCount();
+    auto last = before > 0 ? root->children.find(static_cast<std::uint32_t>(before - 1)) : root->children.end();
+    if (last != root->children.end() && !last->second->error.empty())
     {
-        node->children.reserve(j->size());
-        for (auto it = j->begin(); it != j->end(); ++it)
-        {
-            const std::string &childKey = it.key();
-            const json &childVal = it.value();
-            auto child = buildTree(&childVal, childKey, node.get(), false);
-            node->children.push_back(std::move(child));
-        }
+        // The previous last line may have been incomplete when it failed
+        // to parse; let it try again now that more bytes arrived.
+        last->second->error.clear();
+        last->second->childrenLoaded = false;
     }
-    else if (j->is_array())
+    if (count <= before)
+        return 0;
+    if (last != root->children.end())
+        last->second->isLastChild = false;
+    root->childCount = static_cast<std::uint32_t>(count);
+    return count - before;
+}
+
+static bool isRecord(const Node *node)
+{
+    return node->lines && !node->isDummyRoot;
+}
+
+// Raw record text without leading blanks; never empty for indexed records.
+static std::string_view recordHead(const Node *node)
+{
+    std::string_view text = node->lines->recordText(node->index);
+    return text.substr(std::min(text.find_first_not_of(" \t"), text.size()));
+}
+
+// Parse a JSON Lines record the first time its contents are needed.
+static bool loadRecord(Node *node)
+{
+    if (node->document)
+        return true;
+    if (!isRecord(node) || !node->error.empty())
+        return false;
+    try
     {
-        node->children.reserve(j->size());
-        int idx = 0;
-        for (auto it = j->begin(); it != j->end(); ++it, ++idx)
-        {
-            std::string childKey = "[" + std::to_string(idx) + "]";
-            auto child = buildTree(&(*it), childKey, node.get(), false);
-            node->children.push_back(std::move(child));
-        }
+        node->ownedDocument = node->lines->parseRecord(node->index);
+        node->document = node->ownedDocument.get();
+        node->value = node->document->root();
+        return true;
     }
-    // Mark last child in the list.  This information is used to draw
-    // the tree branches correctly.
-    for (size_t i = 0; i < node->children.size(); ++i)
+    catch (const JsonParseError &e)
+    {
+        node->error = e.what();
+        return false;
+    }
+}
+
+// Kind of a node's value without parsing an unparsed record.
+static JsonKind nodeKind(const Node *node)
+{
+    if (node->document)
+        return node->document->kind(node->value);
+    if (node->lines && node->isDummyRoot)
+        return JsonKind::Array;
+    return jsonKindOfFirstByte(recordHead(node).front());
+}
+
+// Count the direct children of an object or array the first time they
+// are needed.  Only where each member starts is kept, and JSON Lines
+// records are found through the line index alone; the Nodes are made by
+// childAt for the rows the user actually reaches, so memory follows what
+// was explored rather than the size of the document.
+void ensureChildren(Node *node)
+{
+    if (node->childrenLoaded)
+        return;
+    node->childrenLoaded = true;
+    if (node->lines && node->isDummyRoot)
     {
-        node->children[i]->isLastChild = (i == node->children.size() - 1);
+        node->childCount = static_cast<std::uint32_t>(node->lines->recordCount());
+        return;
+    }
+    if (!loadRecord(node))
+        return;
+    node->members = node->document->members(node->value);
+    node->childCount = static_cast<std::uint32_t>(node->members.size());
+}
+
+// The child at a position, created on first use; null past the end.
+Node *childAt(Node *node, size_t index)
+{
+    ensureChildren(node);
+    if (index >= node->childCount)
+        return nullptr;
+    std::unique_ptr<Node> &child = node->children[static_cast<std::uint32_t>(index)];
+    if (child)
+        return child.get();
+    if (node->lines && node->isDummyRoot)
+        child = makeRecordNode(*node->lines, index, node);
+    else
+    {
+        const JsonDocument &document = *node->document;
+        const JsonMember &member = node->members[index];
+        std::string key = member.keyOffset != JsonMember::kNoKey ? document.key(member)
+                                                                  : "[" + std::to_string(index) + "]";
+        child = makeNode(document, member.value, std::move(key), node, false);
+        child->index = static_cast<std::uint32_t>(index);
+    }
+    // Used to draw the tree branches correctly.
+    child->isLastChild = index + 1 == node->childCount;
+    return child.get();
+}
+
+bool hasChildren(const Node *node)
+{
+    if (node->childrenLoaded)
+        return node->childCount > 0;
+    if (node->document)
+        return node->document->size(node->value) > 0;
+    if (!node->lines)
+        return false;
+    if (node->isDummyRoot)
+        return node->lines->recordCount() > 0;
+    if (!node->error.empty())
+        return false;
+    // Guess from the raw line so that listing records never parses them.
+    std::string_view text = recordHead(node);
+    if (text.front() != '{' && text.front() != '[')
+        return false;
+    size_t next = text.find_first_not_of(" \t", 1);
+    return next != std::string_view::npos && text[next] != '}' && text[next] != ']';
+}
+
+Node *materializePath(Node *node, const std::vector<std::uint32_t> &path)
+{
+    for (std::uint32_t idx : path)
+    {
+        node = childAt(node, idx);
+        if (!node)
+            return nullptr;
     }
     return node;
 }
 
 // Recursively collect all nodes that are currently visible.  A node is
 // visible if it is a root or its parent is expanded.
-void collectVisible(const Node *node, std::vector<const Node *> &out)
+void collectVisible(Node *node, std::vector<const Node *> &out)
 {
     out.push_back(node);
     if (node->expanded)
     {
-        for (const auto &child : node->children)
+        for (size_t idx = 0; Node *child = childAt(node, idx); ++idx)
         {
-            collectVisible(child.get(), out);
+            collectVisible(child, out);
         }
     }
 }
@@ -109,26 +254,16 @@ void collectVisible(const Node *node, std::vector<const Node *> &out)
 // vertical bar and branch characters needed to draw a proper tree.
 std::string buildPrefix(const Node *node)
 {
+    // One fragment per ancestor below the dummy root (its isLastChild flag
+    // doesn't affect vertical lines for deeper levels), collected bottom-up
+    // and appended top-down so deep rows cost linear time.
+    std::vector<bool> bars;
+    for (const Node *cur = node->parent; cur && cur->parent; cur = cur->parent)
+        bars.push_back(!cur->isLastChild);
     std::string prefix;
-    const Node *cur = node;
-    while (cur->parent != nullptr)
-    {
-        const Node *parent = cur->parent;
-        // skip the dummy root (it has no parent) so its isLastChild flag
-        // doesn’t affect vertical lines for deeper levels
-        if (parent->parent != nullptr)
-        {
-            if (!parent->isLastChild)
-            {
-                prefix = std::string("│   ") + prefix;
-            }
-            else
-            {
-                prefix = std::string("    ") + prefix;
-            }
-        }
-        cur = parent;
-    }
+    prefix.reserve((bars.size() + 1) * std::strlen("│   "));
+    for (auto it = bars.rbegin(); it != bars.rend(); ++it)
+        prefix += *it ? "│   " : "    ";
     if (node->parent != nullptr)
     {
         prefix += node->isLastChild ? "└── " : "├── ";
@@ -188,57 +323,176 @@ std::string shortenPath(const std::string &path, int maxWidth)
 // Get the type icon for a node
 std::string getTypeIcon(const Node *node)
 {
-    const json *v = node->value;
     if (node->isDummyRoot)
     {
         return ""; // No icons for dummy roots
     }
 
-    if (v->is_string())
+    if (!node->document)
+    {
+        // Unparsed JSON Lines record: decide from its first byte
+        switch (nodeKind(node))
+        {
+        case JsonKind::String:
+            return "℀ ";
+        case JsonKind::Boolean:
+            return recordHead(node).front() == 't' ? "☒ " : "☐ ";
+        case JsonKind::Number:
+            return "⅑ ";
+        case JsonKind::Null:
+            return "⊘ ";
+        default:
+            return "";
+        }
+    }
+
+    const JsonDocument &doc = *node->document;
+    switch (doc.kind(node->value))
+    {
+    case JsonKind::String:
         return "℀ ";
-    else if (v->is_boolean())
-        return v->get<bool>() ? "☒ " : "☐ ";
-    else if (v->is_number())
+    case JsonKind::Boolean:
+        return doc.booleanValue(node->value) ? "☒ " : "☐ ";
+    case JsonKind::Number:
         return "⅑ ";
-    else if (v->is_null())
+    case JsonKind::Null:
         return "⊘ ";
-    else if (v->is_object() && v->empty())
-        return "⁞ "; // Only for empty dictionaries
-    else if (v->is_array())
+    case JsonKind::Object:
+        return doc.size(node->value) == 0 ? "⁞ " : ""; // Only for empty dictionaries
+    case JsonKind::Array:
         return ""; // No icon for arrays
-    else if (v->is_object())
-        return ""; // No icon for non-empty objects
+    }
     return "";
 }
 
-// Get the content without type icon
-std::string getContentLabel(const Node *node, int maxWidth)
+// Escape control characters and quotes so a string fits on one row
+static std::string escapeForLabel(const std::string &s)
+{
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s)
+    {
+        if (c == '\\')
+            out += "\\\\";
+        else if (c == '\"')
+            out += "\\\"";
+        else if (c == '\n')
+            out += "\\n";
+        else if (c == '\r')
+            out += "\\r";
+        else if (c == '\t')
+            out += "\\t";
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char buf[7];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+            out += buf;
+        }
+        else
+            out += c;
+    }
+    return out;
+}
+
+// One-row preview of a raw JSON Lines record, cut at a character boundary
+static std::string recordPreview(std::string_view text, int maxWidth)
+{
+    size_t limit = static_cast<size_t>(std::max(maxWidth, 8));
+    std::string out;
+    size_t i = 0;
+    for (; i < text.size() && out.size() < limit; ++i)
+    {
+        char c = text[i];
+        out += (c == '\t') ? ' ' : c;
+    }
+    if (i < text.size())
+    {
+        while (!out.empty() && (static_cast<unsigned char>(out.back()) & 0xC0) == 0x80)
+            out.pop_back();
+        if (!out.empty() && (static_cast<unsigned char>(out.back()) & 0x80))
+            out.pop_back();
+        out += "…";
+    }
+    return out;
+}
+
+// Text of a scalar, or the kind and size of a container
+static std::string valueSummary(const JsonDocument &doc, JsonValue v)
 {
-    const json *v = node->value;
+    switch (doc.kind(v))
+    {
+    case JsonKind::Object:
+    {
+        size_t count = doc.size(v);
+        return "dictionary, " + std::to_string(count) + (count == 1 ? " key" : " keys");
+    }
+    case JsonKind::Array:
+    {
+        size_t count = doc.size(v);
+        return "list, " + std::to_string(count) + (count == 1 ? " item" : " items");
+    }
+    case JsonKind::String:
+        return "\"" + escapeForLabel(doc.stringValue(v)) + "\"";
+    case JsonKind::Boolean:
+        return doc.booleanValue(v) ? "true" : "false";
+    case JsonKind::Number:
+        // Numbers are shown exactly as written in the source
+        return doc.numberText(v);
+    case JsonKind::Null:
+        return "null";
+    }
+    return "";
+}
+
+static std::string valueLabel(const Node *node, int maxWidth)
+{
+    if (isRecord(node))
+    {
+        // Records show their raw line, so listing them never parses them
+        if (!node->error.empty())
+            return node->key + " ⚠ " + node->error;
+        return node->key + " " + recordPreview(recordHead(node), maxWidth);
+    }
+
+    if (node->lines)
+    {
+        size_t count = node->lines->recordCount();
+        std::string type = "📜 JSON Lines, " + std::to_string(count) + (count == 1 ? " record" : " records");
+        type += ", " + formatFileSize(node->lines->byteSize());
+        std::string shortKey = shortenPath(node->key, maxWidth - getDisplayWidth(type) - 4); // -4 for " ()"
+        return shortKey + " (" + type + ")";
+    }
+
+    const JsonDocument &doc = *node->document;
+    JsonValue v = node->value;
+    JsonKind kind = doc.kind(v);
     if (node->isDummyRoot)
     {
         std::string type;
-        if (v->is_object())
+        if (kind == JsonKind::Object)
         {
-            size_t count = v->size();
+            size_t count = doc.size(v);
             type = "📦 dictionary, " + std::to_string(count) + (count == 1 ? " key" : " keys");
         }
-        else if (v->is_array())
+        else if (kind == JsonKind::Array)
         {
-            size_t count = v->size();
+            size_t count = doc.size(v);
             type = "🗂️ list, " + std::to_string(count) + (count == 1 ? " item" : " items");
         }
-        else if (v->is_string())
+        else if (kind == JsonKind::String)
             type = "℀ string";
-        else if (v->is_number())
+        else if (kind == JsonKind::Number)
             type = "⅑ number";
-        else if (v->is_boolean())
+        else if (kind == JsonKind::Boolean)
             type = "☒ boolean";
-        else if (v->is_null())
+        else if (kind == JsonKind::Null)
             type = "⊘ null";
         else
             type = "📄 value";
 
+        if (doc.format() != JsonFormat::Text)
+            type += std::string(", ") + jsonFormatName(doc.format());
+
         // Add file size information from stored file sizes
         auto it = fileSizes.find(node->key);
         if (it != fileSizes.end())
@@ -252,66 +506,53 @@ std::string getContentLabel(const Node *node, int maxWidth)
         return shortKey + " (" + type + ")";
     }
 
-    // For objects and arrays, no icons for expandable items
-    if (v->is_object())
-    {
-        size_t count = v->size();
-        return node->key + " (dictionary, " + std::to_string(count) + (count == 1 ? " key)" : " keys)");
-    }
-    else if (v->is_array())
-    {
-        size_t count = v->size();
-        std::string baseLabel = node->key + " (list, " + std::to_string(count) + (count == 1 ? " item)" : " items)");
+    // For objects and arrays, no icons for expandable items.  Array previews
+    // are rendered directly in drawLine; return the base label only.
+    if (kind == JsonKind::Object || kind == JsonKind::Array)
+        return node->key + " (" + valueSummary(doc, v) + ")";
+    return node->key + ": " + valueSummary(doc, v);
+}
 
-        // Array previews are rendered directly in drawLine; return base label only
-        return baseLabel;
-    }
-    else if (v->is_string())
+// Whether a changed value's children are its differences rather than the
+// new value's contents: both sides are containers of the same kind.
+static bool diffDescends(const Node *node)
+{
+    JsonKind kind = node->document->kind(node->value);
+    return (kind == JsonKind::Object || kind == JsonKind::Array) &&
+           kind == node->leftDocument->kind(node->leftValue);
+}
+
+// Get the content without type icon.  Diff trees mark added, removed and
+// changed values, and show what a replaced value was.
+std::string getContentLabel(const Node *node, int maxWidth)
+{
+    if (node->isDummyRoot && node->leftDocument)
     {
-        // Escape quotes in string for readability
-        std::string s = v->get<std::string>();
-        // Replace control characters with escapes
-        std::string out;
-        for (char c : s)
+        std::string type = "± identical";
+        if (node->diff != JsonDiffKind::None)
         {
-            if (c == '\\')
-                out += "\\\\";
-            else if (c == '\"')
-                out += "\\\"";
-            else if (c == '\n')
-                out += "\\n";
-            else if (c == '\r')
-                out += "\\r";
-            else if (c == '\t')
-                out += "\\t";
-            else if (static_cast<unsigned char>(c) < 0x20)
-            {
-                char buf[7];
-                std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
-                out += buf;
-            }
-            else
-                out += c;
+            size_t count = node->childCount;
+            type = diffDescends(node)
+                       ? "± diff, " + std::to_string(count) + (count == 1 ? " change" : " changes") + " at the top"
+                       : "± diff, was " + valueSummary(*node->leftDocument, node->leftValue);
         }
-        return node->key + ": \"" + out + "\"";
-    }
-    else if (v->is_boolean())
-    {
-        return node->key + ": " + std::string(v->get<bool>() ? "true" : "false");
-    }
-    else if (v->is_number())
-    {
-        return node->key + ": " + v->dump();
+        return shortenPath(node->key, maxWidth - getDisplayWidth(type) - 4) + " (" + type + ")";
     }
-    else if (v->is_null())
+    std::string label = valueLabel(node, maxWidth);
+    switch (node->diff)
     {
-        return node->key + ": null";
-    }
-    else
-    {
-        // Fallback for other types
-        return node->key;
+    case JsonDiffKind::None:
+        return label;
+    case JsonDiffKind::Added:
+        return "+ " + label;
+    case JsonDiffKind::Removed:
+        return "- " + label;
+    case JsonDiffKind::Changed:
+        if (!diffDescends(node))
+            label += " (was " + valueSummary(*node->leftDocument, node->leftValue) + ")";
+        return "~ " + label;
     }
+    return label;
 }
 
 // Get the content label with search match information
@@ -368,15 +609,15 @@ std::string getContentLabelWithSearch(const Node *node, const SearchState &searc
 void expandAll(Node *node)
 {
     node->expanded = true;
-    for (auto &child : node->children)
+    for (size_t idx = 0; Node *child = childAt(node, idx); ++idx)
     {
-        expandAll(child.get());
+        expandAll(child);
     }
 }
 
 // Collapse every branch of the given node.  When keepRoot is true the
 // top‑level node remains expanded so the structure of the document is
-// still visible.
+// still visible.  Children that were never created are already collapsed.
 void collapseAll(Node *node, bool keepRoot)
 {
     if (!node->isDummyRoot || !keepRoot)
@@ -385,7 +626,7 @@ void collapseAll(Node *node, bool keepRoot)
     }
     for (auto &child : node->children)
     {
-        collapseAll(child.get(), false);
+        collapseAll(child.second.get(), false);
     }
 }
 
@@ -400,7 +641,7 @@ void expandToLevel(Node *node, int targetLevel, int currentLevel)
         node->expanded = false;
         for (auto &child : node->children)
         {
-            collapseAll(child.get(), false);
+            collapseAll(child.second.get(), false);
         }
         return;
     }
@@ -409,9 +650,9 @@ void expandToLevel(Node *node, int targetLevel, int currentLevel)
     if (node->isDummyRoot)
     {
         node->expanded = true; // Always expand dummy roots when target > 0
-        for (auto &child : node->children)
+        for (size_t idx = 0; Node *child = childAt(node, idx); ++idx)
         {
-            expandToLevel(child.get(), targetLevel, 1); // Children of dummy root are at level 1
+            expandToLevel(child, targetLevel, 1); // Children of dummy root are at level 1
         }
         return;
     }
@@ -421,9 +662,9 @@ void expandToLevel(Node *node, int targetLevel, int currentLevel)
     {
         // We haven't reached the target depth yet - expand and recurse
         node->expanded = true;
-        for (auto &child : node->children)
+        for (size_t idx = 0; Node *child = childAt(node, idx); ++idx)
         {
-            expandToLevel(child.get(), targetLevel, currentLevel + 1);
+            expandToLevel(child, targetLevel, currentLevel + 1);
         }
     }
     else
@@ -432,68 +673,123 @@ void expandToLevel(Node *node, int targetLevel, int currentLevel)
         node->expanded = false;
         for (auto &child : node->children)
         {
-            collapseAll(child.get(), false);
+            collapseAll(child.second.get(), false);
         }
     }
 }
 
-// Recursively search for nodes matching the given search term.  Both
-// keys and values can be searched.  The search term and the
-// candidates are compared in lowercase to achieve case‑insensitive
-// matching.  When searching values, primitive values are converted to
-// their JSON string representation.
-void searchTree(const Node *node, const std::string &term,
-                bool searchKeys, bool searchValues,
-                std::vector<const Node *> &out)
+// Text a value is matched against when searching values
+static std::string searchableValue(const JsonDocument &doc, JsonValue value)
 {
-    // Convert the node's key and value to lowercase strings
-    if (!term.empty())
+    switch (doc.kind(value))
     {
-        bool matched = false;
-        if (searchKeys)
+    case JsonKind::String:
+        return doc.stringValue(value);
+    case JsonKind::Boolean:
+        return doc.booleanValue(value) ? "true" : "false";
+    case JsonKind::Number:
+        return doc.numberText(value);
+    case JsonKind::Null:
+        return "null";
+    case JsonKind::Object:
+        return "dictionary";
+    case JsonKind::Array:
+        return "list";
+    }
+    return {};
+}
+
+static bool containsLower(std::string text, const std::string &term)
+{
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text.find(term) != std::string::npos;
+}
+
+struct SearchWalk
+{
+    const JsonDocument *doc;
+    const std::string &term;
+    bool searchKeys;
+    bool searchValues;
+    std::vector<std::uint32_t> path;
+    std::vector<std::vector<std::uint32_t>> found;
+
+    bool matches(const std::string &key, JsonValue value) const
+    {
+        return (searchKeys && containsLower(key, term)) ||
+               (searchValues && containsLower(searchableValue(*doc, value), term));
+    }
+
+    void visitChildren(JsonValue value)
+    {
+        std::vector<JsonMember> members = doc->members(value);
+        bool isObject = doc->kind(value) == JsonKind::Object;
+        for (size_t idx = 0; idx < members.size(); ++idx)
         {
-            std::string keyLower = node->key;
-            std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(), ::tolower);
-            if (keyLower.find(term) != std::string::npos)
-            {
-                matched = true;
-            }
+            path.push_back(static_cast<std::uint32_t>(idx));
+            std::string key = isObject ? doc->key(members[idx]) : "[" + std::to_string(idx) + "]";
+            if (matches(key, members[idx].value))
+                found.push_back(path);
+            visitChildren(members[idx].value);
+            path.pop_back();
         }
-        if (searchValues)
+    }
+};
+
+// Search for nodes matching the given search term.  Both keys and
+// values can be searched.  The candidates are lowercased to achieve
+// case‑insensitive matching.  When searching values, primitive values
+// are compared using their JSON source text.  The document is walked
+// directly and Nodes are only created along the paths to matches.
+void searchTree(Node *node, const std::string &term,
+                bool searchKeys, bool searchValues,
+                std::vector<const Node *> &out)
+{
+    if (term.empty())
+        return;
+    std::string lowered = term;
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+    SearchWalk walk{node->document, lowered, searchKeys, searchValues, {}, {}};
+    if (node->lines && node->isDummyRoot)
+    {
+        if (searchKeys && containsLower(node->key, lowered))
+            out.push_back(node);
+        // Records are parsed one at a time and dropped again unless the
+        // user already opened them; only matches get a Node.
+        for (size_t idx = 0; idx < node->lines->recordCount(); ++idx)
         {
-            // Convert value to a displayable string
-            std::string val;
-            const json *v = node->value;
-            if (v->is_string())
-                val = v->get<std::string>();
-            else if (v->is_boolean())
-                val = (v->get<bool>() ? "true" : "false");
-            else if (v->is_number())
-                val = v->dump();
-            else if (v->is_null())
-                val = "null";
-            else if (v->is_object())
-                val = "dictionary";
-            else if (v->is_array())
-                val = "list";
-            else
-                val = v->dump();
-            std::string valLower = val;
-            std::transform(valLower.begin(), valLower.end(), valLower.begin(), ::tolower);
-            if (valLower.find(term) != std::string::npos)
+            auto record = node->children.find(static_cast<std::uint32_t>(idx));
+            std::shared_ptr<const JsonDocument> parsed;
+            if (record != node->children.end())
+                parsed = record->second->ownedDocument;
+            if (!parsed)
             {
-                matched = true;
+                try
+                {
+                    parsed = node->lines->parseRecord(idx);
+                }
+                catch (const JsonParseError &)
+                {
+                    continue;
+                }
             }
+            walk.doc = parsed.get();
+            walk.path.assign(1, static_cast<std::uint32_t>(idx));
+            if (walk.matches("[" + std::to_string(idx) + "]", parsed->root()))
+                walk.found.push_back(walk.path);
+            walk.visitChildren(parsed->root());
         }
-        if (matched)
-        {
+    }
+    else
+    {
+        if (walk.matches(node->key, node->value))
             out.push_back(node);
-        }
+        walk.visitChildren(node->value);
     }
-    // Continue search through children
-    for (const auto &child : node->children)
+    for (const auto &path : walk.found)
     {
-        searchTree(child.get(), term, searchKeys, searchValues, out);
+        if (Node *match = materializePath(node, path))
+            out.push_back(match);
     }
 }
 
@@ -615,14 +911,74 @@ void copyToClipboard(const std::string &text)
 // Reconstruct JSON from a node and its children
 json reconstructJson(const Node *node)
 {
-    if (node->isDummyRoot)
+    if (node->document)
+        return documentToJson(*node->document, node->value);
+    if (node->lines && node->isDummyRoot)
     {
-        // For dummy root, return the actual JSON value
-        return *node->value;
+        json out = json::array();
+        for (size_t idx = 0; idx < node->lines->recordCount(); ++idx)
+        {
+            auto record = node->lines->parseRecord(idx);
+            out.push_back(documentToJson(*record, record->root()));
+        }
+        return out;
     }
+    auto record = node->lines->parseRecord(node->index);
+    return documentToJson(*record, record->root());
+}
 
-    // Return the JSON value of this node
-    return *node->value;
+// Decode a number token the way nlohmann::json would have stored it
+static json numberToJson(std::string_view token)
+{
+    if (token.find_first_of(".eEIN") == std::string_view::npos)
+    {
+        if (token.front() == '-')
+        {
+            std::int64_t integer = 0;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), integer);
+            if (ec == std::errc() && ptr == token.data() + token.size())
+                return integer;
+        }
+        else
+        {
+            std::uint64_t integer = 0;
+            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), integer);
+            if (ec == std::errc() && ptr == token.data() + token.size())
+                return integer;
+        }
+    }
+    return decodeJsonNumber(token);
+}
+
+// Materialize a value of the document as a nlohmann::json DOM
+json documentToJson(const JsonDocument &document, JsonValue value)
+{
+    switch (document.kind(value))
+    {
+    case JsonKind::Object:
+    {
+        json out = json::object();
+        for (const JsonMember &member : document.members(value))
+            out[document.key(member)] = documentToJson(document, member.value);
+        return out;
+    }
+    case JsonKind::Array:
+    {
+        json out = json::array();
+        for (const JsonMember &member : document.members(value))
+            out.push_back(documentToJson(document, member.value));
+        return out;
+    }
+    case JsonKind::String:
+        return document.stringValue(value);
+    case JsonKind::Boolean:
+        return document.booleanValue(value);
+    case JsonKind::Number:
+        return numberToJson(document.numberText(value));
+    case JsonKind::Null:
+        return nullptr;
+    }
+    return nullptr;
 }
 
 // Format file size in human-readable units
@@ -730,93 +1086,3 @@ void printFormattedJson(const json &j, int indent)
         break;
     }
 }
-
-// Replace placeholder strings with special floating-point values
-static void replaceSpecialStrings(json &j)
-{
-    if (j.is_string())
-    {
-        auto &s = j.get_ref<json::string_t &>();
-        if (s == "__JSON_VIEW_NaN__")
-            j = std::numeric_limits<double>::quiet_NaN();
-        else if (s == "__JSON_VIEW_INF__")
-            j = std::numeric_limits<double>::infinity();
-        else if (s == "__JSON_VIEW_NEG_INF__")
-            j = -std::numeric_limits<double>::infinity();
-    }
-    else if (j.is_object())
-    {
-        for (auto &el : j.items())
-            replaceSpecialStrings(el.value());
-    }
-    else if (j.is_array())
-    {
-        for (auto &el : j)
-            replaceSpecialStrings(el);
-    }
-}
-
-// Parse JSON while preserving NaN/Infinity literals by using placeholders
-json parseJsonWithSpecialNumbers(const std::string &contents)
-{
-    std::string processed;
-    processed.reserve(contents.size());
-    bool inString = false;
-    for (size_t i = 0; i < contents.size();)
-    {
-        char c = contents[i];
-        if (inString)
-        {
-            processed.push_back(c);
-            if (c == '\\')
-            {
-                ++i;
-                if (i < contents.size())
-                    processed.push_back(contents[i]);
-                ++i;
-            }
-            else if (c == '"')
-            {
-                inString = false;
-                ++i;
-            }
-            else
-            {
-                ++i;
-            }
-        }
-        else
-        {
-            if (c == '"')
-            {
-                inString = true;
-                processed.push_back(c);
-                ++i;
-            }
-            else if (contents.compare(i, 3, "NaN") == 0)
-            {
-                processed += "\"__JSON_VIEW_NaN__\"";
-                i += 3;
-            }
-            else if (contents.compare(i, 8, "Infinity") == 0)
-            {
-                processed += "\"__JSON_VIEW_INF__\"";
-                i += 8;
-            }
-            else if (contents.compare(i, 9, "-Infinity") == 0)
-            {
-                processed += "\"__JSON_VIEW_NEG_INF__\"";
-                i += 9;
-            }
-            else
-            {
-                processed.push_back(c);
-                ++i;
-            }
-        }
-    }
-
-    json j = json::parse(processed);
-    replaceSpecialStrings(j);
-    return j;
-}
@@ -0,0 +1,131 @@
+// Latency benchmark for ck-edit's incremental Markdown analysis.
+//
+// Builds a synthetic document of headings, reference definitions and
+// links, analyzes it in full once, then applies single-line edits at
+// random positions and analyzes each version against the one before, the
+// way the editor's background worker does. Reports the full analysis time
+// and the mean and worst time and lines analyzed per edit.
+
+#include "ck/edit/markdown_analysis.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using ck::edit::analyzeDocument;
+using ck::edit::MarkdownDocumentAnalysis;
+using ck::edit::MarkdownTextChange;
+using ck::edit::TextRope;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    std::size_t lines = 200000;
+    std::size_t edits = 500;
+    unsigned seed = 1;
+};
+
+void printUsage(const char *program)
+{
+    std::fprintf(stderr, "usage: %s [--lines N] [--edits N] [--seed N]\n", program);
+}
+
+bool parseArguments(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 >= argc)
+            return false;
+        unsigned long long value = std::strtoull(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--lines") == 0 && value > 0)
+            options.lines = value;
+        else if (std::strcmp(argv[i], "--edits") == 0)
+            options.edits = value;
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            options.seed = static_cast<unsigned>(value);
+        else
+            return false;
+        ++i;
+    }
+    return true;
+}
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options))
+    {
+        printUsage(argc > 0 ? argv[0] : "ck_edit_markdown_benchmark");
+        return EXIT_FAILURE;
+    }
+
+    std::string text;
+    std::vector<std::size_t> lineStarts;
+    for (std::size_t i = 0; i < options.lines; ++i)
+    {
+        lineStarts.push_back(text.size());
+        if (i % 100 == 0)
+            text += "## Part " + std::to_string(i) + "\n";
+        else if (i % 100 == 1)
+            text += "[p" + std::to_string(i - 1) + "]: https://example.com\n";
+        else
+            text += "line [link][p" + std::to_string(i - i % 100) + "] and `code`\n";
+    }
+
+    auto start = Clock::now();
+    auto analysis = std::make_shared<MarkdownDocumentAnalysis>(analyzeDocument(text, 1));
+    double fullMs = millisecondsSince(start);
+    std::printf("document: %zu lines, %.1f MiB\nfull analysis: %.2f ms\n", options.lines,
+                static_cast<double>(text.size()) / (1024.0 * 1024.0), fullMs);
+
+    // Edits insert a word inside a line, so the line count is unchanged
+    // and the line starts before the edit stay valid.
+    std::mt19937 random(options.seed);
+    TextRope rope(text);
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    std::size_t totalLines = 0;
+    std::size_t worstLines = 0;
+    for (std::size_t edit = 0; edit < options.edits; ++edit)
+    {
+        std::size_t line = random() % options.lines;
+        std::size_t offset = lineStarts[line];
+        rope.replace(offset, offset, "word ");
+        for (std::size_t i = line + 1; i < lineStarts.size(); ++i)
+            lineStarts[i] += 5;
+        MarkdownTextChange change;
+        change.addEdit(line, line, options.lines);
+        change.lineCount = options.lines;
+
+        start = Clock::now();
+        auto next = std::make_shared<MarkdownDocumentAnalysis>(
+            analyzeDocument(rope, edit + 2, analysis.get(), change));
+        double ms = millisecondsSince(start);
+        std::size_t analyzed = next->endChangedLine - next->firstChangedLine;
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+        totalLines += analyzed;
+        worstLines = std::max(worstLines, analyzed);
+        analysis = std::move(next);
+    }
+    if (options.edits > 0)
+        std::printf("per edit: %.3f ms mean, %.3f ms worst; %.1f lines mean, %zu worst\n",
+                    totalMs / static_cast<double>(options.edits), worstMs,
+                    static_cast<double>(totalLines) / static_cast<double>(options.edits), worstLines);
+    return EXIT_SUCCESS;
+}
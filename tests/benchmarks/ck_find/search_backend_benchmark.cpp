@@ -0,0 +1,570 @@
+// Throughput benchmark for the ck-find builtin engine.
+//
+// Builds a reproducible synthetic tree, runs a fixed set of representative
+// specifications through executeSpecification(), and runs the same
+// specifications through buildFindCommand() + GNU find (piped into grep for
+// content searches) as a baseline. Reports wall time, entries/sec, bytes/sec
+// and heap allocations per run.
+
+#include "ck/find/cli_buffer_utils.hpp"
+#include "ck/find/search_backend.hpp"
+#include "ck/find/search_model.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+namespace fs = std::filesystem;
+using ck::find::SearchSpecification;
+
+struct TreeOptions
+{
+    fs::path root;
+    std::size_t files = 5000;
+    int depth = 4;
+    int fanout = 4;
+    std::uint64_t minSize = 64;
+    std::uint64_t maxSize = 256 * 1024;
+    double binaryRatio = 0.05;
+    std::uint32_t seed = 1;
+    fs::path corpus;
+};
+
+struct TreeStats
+{
+    std::size_t entries = 0;
+    std::size_t files = 0;
+    std::uint64_t bytes = 0;
+};
+
+struct BenchOptions
+{
+    TreeOptions tree;
+    int iterations = 3;
+    bool runFind = true;
+    bool keepTree = false;
+};
+
+const char *const kDefaultWords[] = {
+    "alpha",   "beta",    "gamma",  "delta",   "epsilon", "zeta",    "theta",   "lambda",
+    "kernel",  "buffer",  "socket", "thread",  "vector",  "matrix",  "render",  "parser",
+    "config",  "editor",  "window", "search",  "filter",  "cursor",  "layout",  "widget",
+    "network", "storage", "packet", "session", "stream",  "module",  "symbol",  "token",
+    "report",  "summary", "ledger", "invoice", "orbit",   "planet",  "comet",   "nebula",
+    "river",   "valley",  "summit", "harbor",  "meadow",  "forest",  "canyon",  "glacier",
+};
+
+const char *const kExtensions[] = {".txt", ".md", ".cpp", ".hpp", ".json", ".log"};
+
+std::vector<std::string> loadCorpus(const fs::path &path)
+{
+    std::vector<std::string> words;
+    if (!path.empty())
+    {
+        std::ifstream stream(path);
+        std::string word;
+        while (stream >> word)
+            words.push_back(word);
+    }
+    if (words.empty())
+        words.assign(std::begin(kDefaultWords), std::end(kDefaultWords));
+    return words;
+}
+
+std::uint64_t logUniform(std::mt19937_64 &rng, std::uint64_t lo, std::uint64_t hi)
+{
+    if (hi <= lo)
+        return lo;
+    std::uniform_real_distribution<double> dist(std::log(static_cast<double>(lo) + 1.0),
+                                                std::log(static_cast<double>(hi) + 1.0));
+    return static_cast<std::uint64_t>(std::exp(dist(rng)) - 1.0);
+}
+
+// Creates a fresh, uniquely named directory under `parent`. The benchmark
+// only ever writes into and removes this directory, never `parent` itself.
+std::optional<fs::path> makeOwnedDirectory(const fs::path &parent)
+{
+    std::error_code ec;
+    fs::create_directories(parent, ec);
+    if (ec)
+    {
+        std::fprintf(stderr, "ck-find-bench: %s: %s\n", parent.c_str(), ec.message().c_str());
+        return std::nullopt;
+    }
+#if defined(_WIN32)
+    fs::path owned = parent / ("ck-find-bench-" + std::to_string(std::random_device{}()));
+    if (!fs::create_directory(owned, ec))
+    {
+        std::fprintf(stderr, "ck-find-bench: %s: %s\n", owned.string().c_str(),
+                     ec ? ec.message().c_str() : "already exists");
+        return std::nullopt;
+    }
+    return owned;
+#else
+    std::string templ = (parent / "ck-find-bench-XXXXXX").string();
+    if (::mkdtemp(templ.data()) == nullptr)
+    {
+        std::fprintf(stderr, "ck-find-bench: %s: %s\n", templ.c_str(), std::strerror(errno));
+        return std::nullopt;
+    }
+    return fs::path(templ);
+#endif
+}
+
+std::optional<TreeStats> buildTree(const TreeOptions &options)
+{
+    std::error_code ec;
+
+    std::mt19937_64 rng(options.seed);
+    std::vector<std::string> words = loadCorpus(options.corpus);
+    TreeStats stats;
+
+    std::vector<fs::path> directories{options.root};
+    std::vector<fs::path> frontier{options.root};
+    for (int level = 0; level < options.depth; ++level)
+    {
+        std::vector<fs::path> next;
+        for (const auto &parent : frontier)
+        {
+            for (int i = 0; i < options.fanout; ++i)
+            {
+                fs::path dir = parent / (words[rng() % words.size()] + "_" + std::to_string(i));
+                fs::create_directories(dir, ec);
+                next.push_back(dir);
+                directories.push_back(dir);
+                ++stats.entries;
+            }
+        }
+        frontier = std::move(next);
+    }
+
+    auto now = fs::file_time_type::clock::now();
+    std::string content;
+    for (std::size_t i = 0; i < options.files; ++i)
+    {
+        const fs::path &dir = directories[rng() % directories.size()];
+        bool binary = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < options.binaryRatio;
+        std::string name = words[rng() % words.size()] + "_" + std::to_string(i) +
+                           (binary ? std::string(".bin") : std::string(kExtensions[rng() % std::size(kExtensions)]));
+        std::uint64_t size = logUniform(rng, options.minSize, options.maxSize);
+
+        content.clear();
+        content.reserve(size);
+        if (binary)
+        {
+            while (content.size() < size)
+                content.push_back(static_cast<char>(rng() & 0xff));
+            if (!content.empty())
+                content[0] = '\0';
+        }
+        else
+        {
+            std::size_t column = 0;
+            while (content.size() < size)
+            {
+                const std::string &word = words[rng() % words.size()];
+                content.append(word);
+                column += word.size() + 1;
+                content.push_back(column > 72 ? '\n' : ' ');
+                if (column > 72)
+                    column = 0;
+            }
+            content.resize(size);
+        }
+
+        fs::path file = dir / name;
+        {
+            std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+            stream.write(content.data(), static_cast<std::streamsize>(content.size()));
+        }
+        auto age = std::chrono::hours(rng() % (24 * 60));
+        fs::last_write_time(file, now - age, ec);
+
+        ++stats.entries;
+        ++stats.files;
+        stats.bytes += content.size();
+    }
+    return stats;
+}
+
+struct Scenario
+{
+    std::string name;
+    SearchSpecification spec;
+    // Content scenarios report bytes/sec and need grep for the baseline.
+    bool readsContent = false;
+};
+
+std::vector<Scenario> makeScenarios(const fs::path &root)
+{
+    auto base = ck::find::makeDefaultSpecification();
+    ck::find::copyToArray(base.startLocation, root.c_str());
+    base.enableActionOptions = false;
+
+    std::vector<Scenario> scenarios;
+
+    auto glob = base;
+    ck::find::copyToArray(glob.includePatterns, "*.cpp");
+    scenarios.push_back({"name-glob", glob, false});
+
+    auto regex = base;
+    regex.enableNamePathTests = true;
+    regex.namePathOptions.regexEnabled = true;
+    ck::find::copyToArray(regex.namePathOptions.regexPattern, ".*[a-m][a-z]*_[0-9]+\\.hpp");
+    scenarios.push_back({"path-regex", regex, false});
+
+    // The builtin size filter passes directories unless "treat directories
+    // as files" is set, whereas find -size tests them; restrict both engines
+    // to regular files so the counts are comparable.
+    auto size = base;
+    size.enableSizeFilters = true;
+    size.sizeOptions.minEnabled = true;
+    ck::find::copyToArray(size.sizeOptions.minSpec, "16k");
+    size.enableTypeFilters = true;
+    size.typeOptions.typeEnabled = true;
+    ck::find::copyToArray(size.typeOptions.typeLetters, "f");
+    scenarios.push_back({"size-min", size, false});
+
+    auto time = base;
+    time.enableTimeFilters = true;
+    time.timeOptions.preset = ck::find::TimeFilterOptions::Preset::PastWeek;
+    scenarios.push_back({"time-week", time, false});
+
+    auto contains = base;
+    ck::find::copyToArray(contains.searchText, "glacier");
+    contains.textOptions.searchInContents = true;
+    contains.textOptions.searchInFileNames = false;
+    scenarios.push_back({"content-contains", contains, true});
+
+    auto contentRegex = contains;
+    ck::find::copyToArray(contentRegex.searchText, "harbor (comet|orbit)");
+    contentRegex.textOptions.mode = ck::find::TextSearchOptions::Mode::RegularExpression;
+    scenarios.push_back({"content-regex", contentRegex, true});
+
+    return scenarios;
+}
+
+struct Measurement
+{
+    double seconds = 0.0;
+    std::size_t matches = 0;
+    std::uint64_t allocations = 0;
+    bool ok = true;
+};
+
+Measurement bestOf(int iterations, const std::function<Measurement()> &run)
+{
+    Measurement best;
+    for (int i = 0; i < iterations; ++i)
+    {
+        Measurement current = run();
+        if (!current.ok)
+            return current;
+        if (i == 0 || current.seconds < best.seconds)
+            best = current;
+    }
+    return best;
+}
+
+Measurement runBuiltin(const SearchSpecification &spec)
+{
+    ck::find::SearchExecutionOptions options;
+    options.includeActions = false;
+    options.captureMatches = true;
+    options.useResultCache = false;
+
+    Measurement m;
+    std::uint64_t before = g_allocations.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    auto result = ck::find::executeSpecification(spec, options);
+    auto stop = std::chrono::steady_clock::now();
+    m.allocations = g_allocations.load(std::memory_order_relaxed) - before;
+    m.seconds = std::chrono::duration<double>(stop - start).count();
+    m.matches = result.matches.size();
+    m.ok = result.exitCode == 0;
+    return m;
+}
+
+#if !defined(_WIN32)
+// Runs `find ... -print` (optionally piped into grep) and counts output lines.
+Measurement runExternal(const std::vector<std::string> &findArgs, const std::vector<std::string> &grepArgs)
+{
+    Measurement m;
+    auto toArgv = [](const std::vector<std::string> &args) {
+        std::vector<char *> argv;
+        for (const auto &arg : args)
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        argv.push_back(nullptr);
+        return argv;
+    };
+    auto findArgv = toArgv(findArgs);
+    auto grepArgv = toArgv(grepArgs);
+
+    int output[2];
+    if (::pipe(output) != 0)
+        return Measurement{0.0, 0, 0, false};
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t findPid = -1;
+    pid_t grepPid = -1;
+    if (grepArgs.empty())
+    {
+        findPid = ::fork();
+        if (findPid == 0)
+        {
+            ::dup2(output[1], STDOUT_FILENO);
+            ::close(output[0]);
+            ::close(output[1]);
+            ::execvp(findArgv[0], findArgv.data());
+            ::_exit(127);
+        }
+    }
+    else
+    {
+        int link[2];
+        if (::pipe(link) != 0)
+            return Measurement{0.0, 0, 0, false};
+        findPid = ::fork();
+        if (findPid == 0)
+        {
+            ::dup2(link[1], STDOUT_FILENO);
+            ::close(link[0]);
+            ::close(link[1]);
+            ::close(output[0]);
+            ::close(output[1]);
+            ::execvp(findArgv[0], findArgv.data());
+            ::_exit(127);
+        }
+        grepPid = ::fork();
+        if (grepPid == 0)
+        {
+            ::dup2(link[0], STDIN_FILENO);
+            ::dup2(output[1], STDOUT_FILENO);
+            ::close(link[0]);
+            ::close(link[1]);
+            ::close(output[0]);
+            ::close(output[1]);
+            ::execvp(grepArgv[0], grepArgv.data());
+            ::_exit(127);
+        }
+        ::close(link[0]);
+        ::close(link[1]);
+    }
+    ::close(output[1]);
+
+    char buffer[65536];
+    ssize_t n = 0;
+    while ((n = ::read(output[0], buffer, sizeof(buffer))) > 0)
+        m.matches += static_cast<std::size_t>(std::count(buffer, buffer + n, '\n'));
+    ::close(output[0]);
+
+    int status = 0;
+    if (findPid > 0)
+    {
+        ::waitpid(findPid, &status, 0);
+        m.ok = WIFEXITED(status) && WEXITSTATUS(status) != 127;
+    }
+    if (grepPid > 0)
+    {
+        ::waitpid(grepPid, &status, 0);
+        // grep exits 1 when nothing matched.
+        m.ok = m.ok && WIFEXITED(status) && WEXITSTATUS(status) <= 1;
+    }
+    m.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return m;
+}
+
+Measurement runFind(const Scenario &scenario)
+{
+    std::vector<std::string> findArgs = ck::find::buildFindCommand(scenario.spec, false);
+    std::vector<std::string> grepArgs;
+    if (scenario.readsContent)
+    {
+        // buildFindCommand() does not express content tests; hand the file
+        // list to grep the way a shell pipeline would.
+        if (!findArgs.empty() && findArgs.back() == "-print")
+            findArgs.pop_back();
+        findArgs.insert(findArgs.end(), {"-type", "f", "-print0"});
+        const auto &text = scenario.spec.textOptions;
+        grepArgs = {"xargs", "-0", "grep", "-l", "-I"};
+        if (!text.matchCase)
+            grepArgs.emplace_back("-i");
+        grepArgs.emplace_back(text.mode == ck::find::TextSearchOptions::Mode::RegularExpression ? "-E" : "-F");
+        grepArgs.emplace_back("-e");
+        grepArgs.push_back(ck::find::bufferToString(scenario.spec.searchText));
+        grepArgs.emplace_back("--");
+    }
+    return runExternal(findArgs, grepArgs);
+}
+#endif
+
+void printRow(const std::string &scenario,
+              const char *engine,
+              const Measurement &m,
+              const TreeStats &stats,
+              bool readsContent)
+{
+    if (!m.ok)
+    {
+        std::printf("%-18s %-8s %10s\n", scenario.c_str(), engine, "failed");
+        return;
+    }
+    double entriesPerSecond = m.seconds > 0.0 ? static_cast<double>(stats.entries) / m.seconds : 0.0;
+    double megabytesPerSecond = readsContent && m.seconds > 0.0
+                                    ? static_cast<double>(stats.bytes) / m.seconds / (1024.0 * 1024.0)
+                                    : 0.0;
+    // Allocations are only observable for the in-process engine.
+    std::string allocations = std::strcmp(engine, "builtin") == 0 ? std::to_string(m.allocations) : "-";
+    std::printf("%-18s %-8s %10.2f %12.0f %10.1f %10s %8zu\n", scenario.c_str(), engine, m.seconds * 1000.0,
+                entriesPerSecond, megabytesPerSecond, allocations.c_str(), m.matches);
+}
+
+void printUsage(const char *binary)
+{
+    std::printf("Usage: %s [--root DIR] [--files N] [--depth N] [--fanout N] [--min-size BYTES]\n"
+                "       [--max-size BYTES] [--binary-ratio R] [--seed N] [--corpus FILE]\n"
+                "       [--iterations N] [--no-find] [--keep]\n",
+                binary);
+}
+
+bool parseArguments(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        auto value = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *v = nullptr;
+        if (arg == "--no-find")
+            options.runFind = false;
+        else if (arg == "--keep")
+            options.keepTree = true;
+        else if (arg == "--help" || arg == "-h")
+            return false;
+        else if ((v = value()) == nullptr)
+            return false;
+        else if (arg == "--root")
+            options.tree.root = v;
+        else if (arg == "--files")
+            options.tree.files = std::strtoull(v, nullptr, 10);
+        else if (arg == "--depth")
+            options.tree.depth = std::atoi(v);
+        else if (arg == "--fanout")
+            options.tree.fanout = std::atoi(v);
+        else if (arg == "--min-size")
+            options.tree.minSize = std::strtoull(v, nullptr, 10);
+        else if (arg == "--max-size")
+            options.tree.maxSize = std::strtoull(v, nullptr, 10);
+        else if (arg == "--binary-ratio")
+            options.tree.binaryRatio = std::atof(v);
+        else if (arg == "--seed")
+            options.tree.seed = static_cast<std::uint32_t>(std::strtoul(v, nullptr, 10));
+        else if (arg == "--corpus")
+            options.tree.corpus = v;
+        else if (arg == "--iterations")
+            options.iterations = std::max(1, std::atoi(v));
+        else
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options))
+    {
+        printUsage(argc > 0 ? argv[0] : "ck_find_benchmark");
+        return EXIT_FAILURE;
+    }
+    // --root names the parent directory; the tree itself goes into a fresh
+    // subdirectory so that cleanup can never touch pre-existing files.
+    auto owned = makeOwnedDirectory(options.tree.root.empty() ? fs::temp_directory_path() : options.tree.root);
+    if (!owned)
+        return EXIT_FAILURE;
+    options.tree.root = *owned;
+
+    auto stats = buildTree(options.tree);
+    if (!stats)
+        return EXIT_FAILURE;
+    std::printf("tree: %s\n      %zu entries, %zu files, %.1f MiB (seed %u)\n\n", options.tree.root.c_str(),
+                stats->entries, stats->files, static_cast<double>(stats->bytes) / (1024.0 * 1024.0),
+                options.tree.seed);
+    std::printf("%-18s %-8s %10s %12s %10s %10s %8s\n", "scenario", "engine", "ms", "entries/s", "MiB/s", "allocs",
+                "matches");
+
+    int exitCode = EXIT_SUCCESS;
+    for (const auto &scenario : makeScenarios(options.tree.root))
+    {
+        Measurement builtin = bestOf(options.iterations, [&] { return runBuiltin(scenario.spec); });
+        printRow(scenario.name, "builtin", builtin, *stats, scenario.readsContent);
+        if (!builtin.ok)
+            exitCode = EXIT_FAILURE;
+#if !defined(_WIN32)
+        if (options.runFind)
+        {
+            Measurement external = bestOf(options.iterations, [&] { return runFind(scenario); });
+            printRow(scenario.name, "find", external, *stats, scenario.readsContent);
+            if (external.ok && external.matches != builtin.matches)
+                std::printf("%-18s warning: builtin and find disagree on the match count\n", "");
+        }
+#endif
+    }
+
+    if (!options.keepTree)
+    {
+        std::error_code ec;
+        fs::remove_all(options.tree.root, ec);
+    }
+    return exitCode;
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/atomic_file.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using ck::edit::writeFileAtomically;
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+class TempDirectory
+{
+public:
+    TempDirectory()
+    {
+        root = fs::temp_directory_path() /
+               ("ck-edit-atomic-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        fs::create_directories(root);
+    }
+
+    ~TempDirectory()
+    {
+        std::error_code ec;
+        fs::remove_all(root, ec);
+    }
+
+    fs::path root;
+};
+
+void writeText(const fs::path &path, const std::string &text)
+{
+    std::ofstream stream(path, std::ios::binary);
+    stream << text;
+}
+
+std::string readText(const fs::path &path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    std::ostringstream text;
+    text << stream.rdbuf();
+    return text.str();
+}
+
+std::size_t entryCount(const fs::path &directory)
+{
+    std::size_t count = 0;
+    for (auto it = fs::directory_iterator(directory); it != fs::directory_iterator(); ++it)
+        ++count;
+    return count;
+}
+
+} // namespace
+
+TEST(AtomicFile, WritesPartsInOrder)
+{
+    TempDirectory directory;
+    fs::path path = directory.root / "new.md";
+    writeFileAtomically(path.string(), {"one ", "", "two\n"});
+    EXPECT_EQ(readText(path), "one two\n");
+    EXPECT_EQ(entryCount(directory.root), 1u);
+}
+
+TEST(AtomicFile, LeavesOtherFilesAlone)
+{
+    TempDirectory directory;
+    fs::path path = directory.root / "a.md";
+    writeText(path, "old\n");
+    writeText(directory.root / "a.md.tmp", "someone else's\n");
+
+    writeFileAtomically(path.string(), {"new\n"});
+    EXPECT_EQ(readText(path), "new\n");
+    EXPECT_EQ(readText(directory.root / "a.md.tmp"), "someone else's\n");
+    EXPECT_EQ(entryCount(directory.root), 2u);
+}
+
+#if !defined(_WIN32)
+TEST(AtomicFile, KeepsPermissions)
+{
+    TempDirectory directory;
+    fs::path path = directory.root / "script.sh";
+    writeText(path, "echo old\n");
+    fs::permissions(path, fs::perms::owner_all | fs::perms::group_read | fs::perms::group_exec);
+
+    writeFileAtomically(path.string(), {"echo new\n"});
+    EXPECT_EQ(readText(path), "echo new\n");
+    EXPECT_EQ(fs::status(path).permissions(), fs::perms::owner_all | fs::perms::group_read | fs::perms::group_exec);
+}
+
+TEST(AtomicFile, ReplacesTheFileALinkPointsTo)
+{
+    TempDirectory directory;
+    fs::path file = directory.root / "notes.md";
+    fs::path link = directory.root / "link.md";
+    writeText(file, "old\n");
+    fs::create_symlink(file.filename(), link);
+
+    writeFileAtomically(link.string(), {"new\n"});
+    EXPECT_TRUE(fs::is_symlink(link));
+    EXPECT_EQ(readText(file), "new\n");
+}
+#endif
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/large_file.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using ck::edit::LargeFileDocument;
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+fs::path writeTempFile(const std::string &text)
+{
+    fs::path path = fs::temp_directory_path() /
+                    ("ck-edit-large-file-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::ofstream stream(path, std::ios::binary);
+    stream << text;
+    return path;
+}
+
+void expectMatches(const LargeFileDocument &document, const std::string &text)
+{
+    std::vector<std::size_t> starts{0};
+    for (std::size_t i = 0; i < text.size(); ++i)
+        if (text[i] == '\n')
+            starts.push_back(i + 1);
+    ASSERT_EQ(document.size(), text.size());
+    ASSERT_EQ(document.lineCount(), starts.size());
+    for (std::size_t line = 0; line < starts.size(); line += 1 + line / 7)
+    {
+        ASSERT_EQ(document.lineStart(line), starts[line]) << "line " << line;
+        ASSERT_EQ(document.lineOf(starts[line]), line) << "line " << line;
+        std::size_t end = line + 1 < starts.size() ? starts[line + 1] - 1 : text.size();
+        ASSERT_EQ(document.line(line), text.substr(starts[line], end - starts[line])) << "line " << line;
+    }
+    EXPECT_EQ(document.read(0, text.size()), text);
+}
+
+} // namespace
+
+TEST(LargeFile, IndexesLinesInBackground)
+{
+    std::string text;
+    for (int i = 0; i < 5000; ++i)
+        text += "line " + std::to_string(i) + (i % 3 == 0 ? "\r\n" : "\n");
+    text += "last";
+    fs::path path = writeTempFile(text);
+    {
+        LargeFileDocument document(path.string());
+        // Lookups do not have to wait for the index.
+        EXPECT_EQ(document.line(4000), "line 4000");
+        document.waitForIndex();
+        EXPECT_TRUE(document.indexComplete());
+        EXPECT_EQ(document.indexedLines(), 5001u);
+        EXPECT_EQ(document.line(3), "line 3");
+        EXPECT_EQ(document.line(5000), "last");
+        EXPECT_EQ(document.line(2, 3), "lin");
+    }
+    fs::remove(path);
+}
+
+TEST(LargeFile, KeepsEditsAsPieces)
+{
+    std::string text;
+    for (int i = 0; i < 3000; ++i)
+        text += "row " + std::to_string(i) + "\n";
+    fs::path path = writeTempFile(text);
+    LargeFileDocument document(path.string());
+    document.waitForIndex();
+    EXPECT_FALSE(document.modified());
+
+    std::mt19937 random(5);
+    const char *inserts[] = {"", "x", "new\nlines\n", "\n", "tail"};
+    for (int step = 0; step < 60; ++step)
+    {
+        std::size_t offset = random() % (text.size() + 1);
+        std::size_t length = std::min<std::size_t>(random() % 40, text.size() - offset);
+        const char *insert = inserts[random() % 5];
+        text.replace(offset, length, insert);
+        document.replace(offset, length, insert);
+    }
+    EXPECT_TRUE(document.modified());
+    expectMatches(document, text);
+
+    text += "appended\nlines";
+    document.replace(document.size(), 0, "appended\nlines");
+    expectMatches(document, text);
+
+    fs::path copy = path;
+    copy += ".saved";
+    document.save(copy.string());
+    std::ifstream in(copy, std::ios::binary);
+    std::string saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(saved, text);
+    fs::remove(copy);
+    fs::remove(path);
+}
+
+TEST(LargeFile, FindsAcrossPieces)
+{
+    fs::path path = writeTempFile("alpha beta\ngamma delta\n");
+    LargeFileDocument document(path.string());
+    document.replace(13, 0, "XX");
+    document.replace(6, 2, "BE");
+    std::size_t found = 0;
+    ASSERT_TRUE(document.find("BEta", 0, true, found));
+    EXPECT_EQ(found, 6u);
+    ASSERT_TRUE(document.find("gaXXmma", 0, false, found));
+    EXPECT_EQ(found, 11u);
+    EXPECT_EQ(document.lineOf(found), 1u);
+    EXPECT_FALSE(document.find("beta", 7, false, found));
+    EXPECT_FALSE(document.find("alpha", 1, true, found));
+    fs::remove(path);
+}
+
+#if !defined(_WIN32)
+TEST(LargeFile, SavesOverItselfKeepingMode)
+{
+    std::string text;
+    for (int i = 0; i < 2000; ++i)
+        text += "entry " + std::to_string(i) + "\n";
+    fs::path path = writeTempFile(text);
+    fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+    {
+        LargeFileDocument document(path.string());
+        document.waitForIndex();
+        document.replace(6, 1, "zero");
+        text.replace(6, 1, "zero");
+        document.save(path.string());
+        // The old file stays mapped, so the document reads on unchanged.
+        expectMatches(document, text);
+    }
+    LargeFileDocument reopened(path.string());
+    reopened.waitForIndex();
+    expectMatches(reopened, text);
+    EXPECT_EQ(fs::status(path).permissions(), fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+    fs::remove(path);
+}
+#endif
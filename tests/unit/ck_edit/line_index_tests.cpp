@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/line_index.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using ck::edit::LineIndex;
+
+namespace
+{
+
+std::vector<std::size_t> lineStarts(const std::string &text)
+{
+    std::vector<std::size_t> starts{0};
+    for (std::size_t i = 0; i < text.size(); ++i)
+        if (text[i] == '\n')
+            starts.push_back(i + 1);
+    return starts;
+}
+
+void expectMatches(const LineIndex &index, const std::string &text)
+{
+    std::vector<std::size_t> starts = lineStarts(text);
+    ASSERT_EQ(index.lineCount(), starts.size());
+    ASSERT_EQ(index.byteCount(), text.size());
+    for (std::size_t line = 0; line < starts.size(); ++line)
+        ASSERT_EQ(index.lineStart(line), starts[line]) << "line " << line;
+    std::size_t line = 0;
+    for (std::size_t offset = 0; offset <= text.size(); ++offset)
+    {
+        while (line + 1 < starts.size() && starts[line + 1] <= offset)
+            ++line;
+        ASSERT_EQ(index.lineOf(offset), line) << "offset " << offset;
+    }
+}
+
+} // namespace
+
+TEST(LineIndex, IndexesLineStarts)
+{
+    LineIndex index;
+    EXPECT_EQ(index.lineCount(), 1u);
+    EXPECT_EQ(index.lineOf(0), 0u);
+    EXPECT_EQ(index.lineStart(3), 0u);
+
+    index.assign("# Title\r\n\nbody", "\ntail\n");
+    expectMatches(index, "# Title\r\n\nbody\ntail\n");
+    EXPECT_EQ(index.lineStart(5), index.byteCount());
+    EXPECT_EQ(index.lineOf(1000), 4u);
+}
+
+TEST(LineIndex, FollowsEdits)
+{
+    std::string text = "one\ntwo\nthree";
+    LineIndex index;
+    index.assign(text);
+
+    text.replace(4, 0, "inserted\nline ");
+    index.replace(4, 4, "inserted\nline ");
+    expectMatches(index, text);
+
+    text.replace(2, 12, "");
+    index.replace(2, 14, "");
+    expectMatches(index, text);
+
+    index.replace(0, text.size(), "");
+    expectMatches(index, "");
+
+    std::mt19937 random(7);
+    const char alphabet[] = "ab\n";
+    text.clear();
+    for (int step = 0; step < 2000; ++step)
+    {
+        std::size_t start = random() % (text.size() + 1);
+        std::size_t end = start + random() % (std::min<std::size_t>(text.size() - start, 40) + 1);
+        std::string inserted(random() % 12, 'x');
+        for (char &ch : inserted)
+            ch = alphabet[random() % 3];
+        text.replace(start, end - start, inserted);
+        index.replace(start, end, inserted);
+        if (step % 97 == 0)
+            expectMatches(index, text);
+    }
+    expectMatches(index, text);
+}
+
+TEST(LineIndex, CountsWrappedRows)
+{
+    LineIndex index;
+    index.assign("a\nb\nc\nd\n");
+    EXPECT_EQ(index.rowCount(), 5u);
+    index.setRows(1, 3);
+    index.setRows(3, 2);
+    EXPECT_TRUE(index.rowsMeasured(1));
+    EXPECT_FALSE(index.rowsMeasured(2));
+    EXPECT_EQ(index.rowCount(), 8u);
+    EXPECT_EQ(index.rowsBefore(2), 4u);
+    EXPECT_EQ(index.rowsBefore(4), 7u);
+
+    std::size_t rowInLine = 0;
+    EXPECT_EQ(index.lineAtRow(3, rowInLine), 1u);
+    EXPECT_EQ(rowInLine, 2u);
+    EXPECT_EQ(index.lineAtRow(6, rowInLine), 3u);
+    EXPECT_EQ(rowInLine, 1u);
+    EXPECT_EQ(index.lineAtRow(100, rowInLine), 4u);
+    EXPECT_EQ(rowInLine, 0u);
+
+    // Edited lines lose their measurement; the others keep it while moving.
+    index.replace(0, 0, "new\n");
+    EXPECT_TRUE(index.rowsMeasured(2));
+    EXPECT_EQ(index.rowsBefore(4), 6u);
+    index.replace(6, 7, "bb");
+    EXPECT_FALSE(index.rowsMeasured(2));
+    EXPECT_TRUE(index.rowsMeasured(4));
+    EXPECT_EQ(index.rowCount(), 7u);
+
+    index.resetRows();
+    EXPECT_EQ(index.rowCount(), index.lineCount());
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/markdown_analysis.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+using ck::edit::analyzeDocument;
+using ck::edit::fingerprintState;
+using ck::edit::MarkdownBackgroundAnalysis;
+using ck::edit::MarkdownDocumentAnalysis;
+using ck::edit::MarkdownLineKind;
+using ck::edit::MarkdownParserState;
+using ck::edit::MarkdownTextChange;
+using ck::edit::TextRope;
+
+namespace
+{
+
+void expectSameAnalysis(const MarkdownDocumentAnalysis &actual, const MarkdownDocumentAnalysis &expected)
+{
+    ASSERT_EQ(actual.lineKinds, expected.lineKinds);
+    ASSERT_EQ(actual.entryStates, expected.entryStates);
+    ASSERT_FALSE(actual.checkpointLines.empty());
+    EXPECT_EQ(actual.checkpointLines.front(), 0u);
+    for (std::size_t i = 0; i < actual.checkpointLines.size(); ++i)
+        EXPECT_EQ(fingerprintState(actual.checkpointStates[i]), expected.entryStates[actual.checkpointLines[i]]);
+}
+
+std::size_t countLines(std::string_view text)
+{
+    return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')) + 1;
+}
+
+// Replace [start, start + length) of text with inserted, recording the
+// change the way the editor does.
+void edit(std::string &text, MarkdownTextChange &change, std::size_t start, std::size_t length,
+          const std::string &inserted)
+{
+    std::size_t lineCount = countLines(text);
+    change.addEdit(countLines(text.substr(0, start)) - 1, countLines(text.substr(0, start + length)) - 1, lineCount);
+    change.lineCount = lineCount - countLines(text.substr(start, length)) + countLines(inserted);
+    text.replace(start, length, inserted);
+}
+
+} // namespace
+
+TEST(MarkdownAnalysis, AnalyzesEveryLine)
+{
+    auto analysis = analyzeDocument("# Title\r\n```sh\nls\n```\n\n| a | b |\n", 1);
+    EXPECT_EQ(analysis.lineKinds,
+              (std::vector<MarkdownLineKind>{MarkdownLineKind::Heading, MarkdownLineKind::CodeFenceStart,
+                                             MarkdownLineKind::FencedCode, MarkdownLineKind::CodeFenceEnd,
+                                             MarkdownLineKind::Blank, MarkdownLineKind::TableRow,
+                                             MarkdownLineKind::Blank}));
+    EXPECT_EQ(analysis.firstChangedLine, 0u);
+    EXPECT_EQ(analysis.endChangedLine, 7u);
+
+    MarkdownParserState state;
+    EXPECT_EQ(analysis.stateBefore(3, state), 0u);
+    EXPECT_FALSE(state.inFence);
+}
+
+TEST(MarkdownAnalysis, StopsWhereStatesReconverge)
+{
+    std::string text;
+    for (int i = 0; i < 1000; ++i)
+        text += i % 50 == 10 ? "```\n" : "line " + std::to_string(i) + "\n";
+    auto before = analyzeDocument(text, 1);
+
+    // A text edit inside a line touches only that line.
+    std::string edited = text;
+    MarkdownTextChange change;
+    edit(edited, change, text.find("line 500"), 0, "more ");
+    auto after = analyzeDocument(TextRope(edited), 2, &before, change);
+    expectSameAnalysis(after, analyzeDocument(edited, 2));
+    EXPECT_EQ(after.previousVersion, 1u);
+    EXPECT_EQ(after.firstChangedLine, 500u);
+    EXPECT_EQ(after.endChangedLine, 501u);
+
+    // A closed block settles right after it...
+    std::string block = text;
+    change = {};
+    edit(block, change, text.find("line 500"), 0, "```\ncode\n```\n");
+    auto inserted = analyzeDocument(TextRope(block), 3, &before, change);
+    expectSameAnalysis(inserted, analyzeDocument(block, 3));
+    EXPECT_EQ(inserted.firstChangedLine, 500u);
+    EXPECT_EQ(inserted.endChangedLine, 504u);
+
+    // ...while a lone fence flips every later one.
+    std::string fenced = text;
+    change = {};
+    edit(fenced, change, text.find("line 500"), 8, "```");
+    auto flipped = analyzeDocument(TextRope(fenced), 4, &before, change);
+    expectSameAnalysis(flipped, analyzeDocument(fenced, 4));
+    EXPECT_EQ(flipped.firstChangedLine, 500u);
+    EXPECT_EQ(flipped.endChangedLine, 1001u);
+
+    auto unchanged = analyzeDocument(TextRope(text), 5, &before, MarkdownTextChange{});
+    expectSameAnalysis(unchanged, before);
+    EXPECT_EQ(unchanged.endChangedLine, 0u);
+}
+
+TEST(MarkdownAnalysis, MatchesFullAnalysisAfterRandomEdits)
+{
+    const char *pieces[] = {"```", "text", "\n", "| a |", "|---|", "# h", "    ", "~~~", "\n\n"};
+    std::mt19937 random(11);
+    std::string text;
+    MarkdownDocumentAnalysis analysis = analyzeDocument(text, 1);
+    for (std::uint64_t version = 2; version < 400; ++version)
+    {
+        // Several edits between versions, as when requests are merged.
+        MarkdownTextChange change;
+        for (int edits = 1 + static_cast<int>(random() % 3); edits > 0; --edits)
+        {
+            std::size_t start = random() % (text.size() + 1);
+            std::size_t length = std::min<std::size_t>(random() % 30, text.size() - start);
+            edit(text, change, start, length, pieces[random() % 9]);
+        }
+        MarkdownDocumentAnalysis updated = analyzeDocument(TextRope(text), version, &analysis, change);
+        MarkdownDocumentAnalysis full = analyzeDocument(text, version);
+        expectSameAnalysis(updated, full);
+        EXPECT_EQ(updated.checkpointOffsets, full.checkpointOffsets);
+        analysis = std::move(updated);
+    }
+}
+
+TEST(MarkdownAnalysis, PublishesFromWorker)
+{
+    MarkdownBackgroundAnalysis background;
+    EXPECT_EQ(background.latest(), nullptr);
+    std::string text = "# a\n";
+    MarkdownTextChange change;
+    background.submit(1, TextRope(text), change);
+    edit(text, change, text.size(), 0, "```\n");
+    background.submit(2, TextRope(text), change);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((!background.latest() || background.latest()->version != 2) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto latest = background.latest();
+    ASSERT_NE(latest, nullptr);
+    EXPECT_EQ(latest->version, 2u);
+    EXPECT_EQ(latest->lineKinds.size(), 3u);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/markdown_editor.hpp"
+
+#include <string>
+
+using ck::edit::MarkdownFileEditor;
+
+namespace
+{
+
+class MarkdownFileEditorTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        editor = new MarkdownFileEditor(TRect(0, 0, 80, 25), nullptr, nullptr, nullptr, TStringView());
+    }
+
+    void TearDown() override
+    {
+        TObject::destroy(editor);
+    }
+
+    void load(const std::string &text)
+    {
+        editor->insertText(text.data(), static_cast<uint>(text.size()), False);
+        // Moving the cursor ends the insert's undo step.
+        editor->setCurPtr(0, 0);
+    }
+
+    std::string text() const
+    {
+        // The text before the gap, then the text after it.
+        std::string result(editor->buffer, editor->curPtr);
+        result.append(editor->buffer + editor->curPtr + editor->gapLen, editor->bufLen - editor->curPtr);
+        return result;
+    }
+
+    MarkdownFileEditor *editor = nullptr;
+};
+
+TEST_F(MarkdownFileEditorTest, UndoTakesBackAWholeFormat)
+{
+    const std::string original = "# Title \n\n\n\ntext\t\nmore\n\n\nend\n";
+    load(original);
+    editor->formatDocument();
+    EXPECT_EQ(text(), "# Title\n\ntext\nmore\n\nend\n");
+
+    editor->undo();
+    EXPECT_EQ(text(), original);
+}
+
+TEST_F(MarkdownFileEditorTest, UndoTakesBackAWholeReflow)
+{
+    const std::string original = "one two\nthree four\n\nfive\nsix";
+    load(original);
+    editor->setSelect(0, editor->bufLen, False);
+    editor->reflowParagraphs();
+    EXPECT_EQ(text(), "one two three four\n\nfive six");
+
+    editor->undo();
+    EXPECT_EQ(text(), original);
+}
+
+} // namespace
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/markdown_format.hpp"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using ck::edit::formatMarkdownEdits;
+using ck::edit::reflowParagraphEdits;
+using ck::edit::TextEdit;
+using ck::edit::TextRope;
+
+namespace
+{
+
+std::string applied(const std::string &text, const std::vector<TextEdit> &edits)
+{
+    for (std::size_t i = 1; i < edits.size(); ++i)
+        EXPECT_LT(edits[i - 1].end, edits[i].start);
+    TextRope rope(text);
+    rope.apply(edits);
+    return rope.str();
+}
+
+// The whole-text rewrite the edits stand for.
+std::string formatReference(const std::string &text)
+{
+    std::istringstream input(text);
+    std::string output;
+    std::string line;
+    bool previousBlank = false;
+    while (std::getline(input, line))
+    {
+        std::size_t end = line.size();
+        while (end > 0 && (line[end - 1] == ' ' || line[end - 1] == '\t'))
+            --end;
+        if (end == 0)
+        {
+            if (!previousBlank)
+                output += '\n';
+            previousBlank = true;
+            continue;
+        }
+        output += line.substr(0, end);
+        if (line.size() - end >= 2)
+            output += "  ";
+        output += '\n';
+        previousBlank = false;
+    }
+    return output;
+}
+
+std::string randomText(std::mt19937 &random, std::size_t length)
+{
+    const char alphabet[] = "ab  \t\n\n\r#-";
+    std::string text;
+    for (std::size_t i = 0; i < length; ++i)
+        text.push_back(alphabet[random() % (sizeof(alphabet) - 1)]);
+    return text;
+}
+
+} // namespace
+
+TEST(MarkdownFormat, TouchesOnlyChangedBytes)
+{
+    std::string text = "# Title   \n\n\n\nbody  \t\ntext\n  \nend";
+    std::vector<TextEdit> edits = formatMarkdownEdits(text);
+    EXPECT_EQ(applied(text, edits), "# Title  \n\nbody  \ntext\n\nend\n");
+    ASSERT_EQ(edits.size(), 5u);
+    EXPECT_EQ(edits.front().start, 9u);
+    EXPECT_TRUE(formatMarkdownEdits("clean\n\ntext\n").empty());
+    EXPECT_TRUE(formatMarkdownEdits("").empty());
+}
+
+TEST(MarkdownFormat, MatchesWholeTextRewrite)
+{
+    std::mt19937 random(11);
+    for (int round = 0; round < 300; ++round)
+    {
+        std::string text = randomText(random, random() % 200);
+        ASSERT_EQ(applied(text, formatMarkdownEdits(text)), formatReference(text)) << "round " << round;
+    }
+}
+
+TEST(MarkdownFormat, ReflowsParagraphs)
+{
+    std::string words;
+    for (int i = 0; i < 30; ++i)
+        words += "word" + std::to_string(i) + (i % 7 == 6 ? "\n" : " ");
+    std::string text = words + "\n\n\nshort\nparagraph\n\nkept as is";
+    std::string result = applied(text, reflowParagraphEdits(text, 40));
+
+    std::istringstream lines(result);
+    std::string line;
+    while (std::getline(lines, line))
+        EXPECT_LE(line.size(), 40u);
+    EXPECT_NE(result.find("\n\n\nshort paragraph\n\nkept as is"), std::string::npos);
+    EXPECT_EQ(result.substr(0, 12), "word0 word1 ");
+
+    std::vector<TextEdit> edits = reflowParagraphEdits("kept as is\n\nalso kept");
+    EXPECT_TRUE(edits.empty());
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/markdown_analysis.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using ck::edit::analyzeDocument;
+using ck::edit::MarkdownDocumentIndex;
+using ck::edit::MarkdownIndexEntry;
+using ck::edit::MarkdownIndexKind;
+using ck::edit::MarkdownTextChange;
+using ck::edit::TextRope;
+
+namespace
+{
+
+std::vector<std::tuple<MarkdownIndexKind, std::size_t, std::size_t, std::string>>
+flatten(const MarkdownDocumentIndex &index)
+{
+    std::vector<std::tuple<MarkdownIndexKind, std::size_t, std::size_t, std::string>> result;
+    for (const MarkdownIndexEntry &entry : index.entries())
+        result.emplace_back(entry.kind, entry.line, entry.column, entry.text);
+    return result;
+}
+
+std::size_t countLines(std::string_view text)
+{
+    return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')) + 1;
+}
+
+// What replacing [start, start + length) of text with inserted changes.
+MarkdownTextChange changeFor(const std::string &text, std::size_t start, std::size_t length,
+                             const std::string &inserted)
+{
+    MarkdownTextChange change;
+    std::size_t lineCount = countLines(text);
+    change.addEdit(countLines(text.substr(0, start)) - 1, countLines(text.substr(0, start + length)) - 1, lineCount);
+    change.lineCount = lineCount - countLines(text.substr(start, length)) + countLines(inserted);
+    return change;
+}
+
+} // namespace
+
+TEST(MarkdownIndex, CollectsHeadingsAndLinks)
+{
+    auto analysis = analyzeDocument("# Getting  Started #\n"
+                                    "See [the guide][Guide] and [setup](#getting--started)[^n1].\n"
+                                    "`[not][a-link]` and [missing][] and [top](#nowhere)\n"
+                                    "```\n"
+                                    "[code][fenced]\n"
+                                    "```\n"
+                                    "## Getting  Started\n"
+                                    "[guide]: https://example.com\n"
+                                    "[^N1]: Note [back](#getting--started-1).\n",
+                                    1);
+    const MarkdownDocumentIndex &index = analysis.index;
+    ASSERT_EQ(index.headings().size(), 2u);
+    const MarkdownIndexEntry &first = index.entries()[index.headings()[0]];
+    EXPECT_EQ(first.text, "Getting  Started");
+    EXPECT_EQ(first.level, 1);
+    EXPECT_EQ(index.entries()[index.headings()[1]].line, 6u);
+
+    EXPECT_TRUE(index.hasReference("GUIDE"));
+    EXPECT_TRUE(index.hasFootnote("n1"));
+    EXPECT_TRUE(index.hasAnchor("getting--started-1"));
+    EXPECT_FALSE(index.hasReference("fenced"));
+
+    std::vector<MarkdownIndexEntry> broken = index.brokenLinks();
+    ASSERT_EQ(broken.size(), 2u);
+    EXPECT_EQ(broken[0].kind, MarkdownIndexKind::ReferenceUse);
+    EXPECT_EQ(broken[0].text, "missing");
+    EXPECT_EQ(broken[0].column, 20u);
+    EXPECT_EQ(broken[1].kind, MarkdownIndexKind::AnchorLink);
+    EXPECT_EQ(broken[1].text, "nowhere");
+}
+
+TEST(MarkdownIndex, GeneratesUnusedIds)
+{
+    auto analysis = analyzeDocument("[ref1]: a\n[Ref2]: b\n[^fn1]: c\n", 1);
+    EXPECT_EQ(analysis.index.uniqueReferenceId("ref"), "ref3");
+    EXPECT_EQ(analysis.index.uniqueReferenceId(""), "ref3");
+    EXPECT_EQ(analysis.index.uniqueReferenceId("img"), "img1");
+    EXPECT_EQ(analysis.index.uniqueFootnoteId(), "fn2");
+}
+
+TEST(MarkdownIndex, FollowsIncrementalEdits)
+{
+    const char *lines[] = {"# Title\n", "text [a][r1] more\n", "[r1]: url\n", "```\n", "## Not [x][y]\n",
+                           "plain\n",   "[^f]: note\n",        "- [^f]\n",    "### Sub\n"};
+    std::mt19937 random(7);
+    std::string text;
+    for (int i = 0; i < 400; ++i)
+        text += lines[random() % std::size(lines)];
+    auto analysis = analyzeDocument(text, 1);
+    for (std::uint64_t version = 2; version < 60; ++version)
+    {
+        std::string edited = text;
+        std::size_t at = random() % (edited.size() + 1);
+        std::size_t length = 0;
+        std::string inserted;
+        if (random() % 2)
+            inserted = lines[random() % std::size(lines)];
+        else
+            length = std::min<std::size_t>(random() % 40, edited.size() - at);
+        edited.replace(at, length, inserted);
+        auto next = analyzeDocument(TextRope(edited), version, &analysis, changeFor(text, at, length, inserted));
+        auto full = analyzeDocument(edited, version);
+        ASSERT_EQ(flatten(next.index), flatten(full.index)) << "version " << version;
+        EXPECT_EQ(next.index.headings(), full.index.headings());
+        EXPECT_EQ(next.index.brokenLinks().size(), full.index.brokenLinks().size());
+        analysis = std::move(next);
+        text = std::move(edited);
+    }
+}
+
+TEST(MarkdownIndex, UpdatesLargeDocumentsLineByLine)
+{
+    std::string text;
+    for (int i = 0; i < 100000; ++i)
+        text += i % 100 == 0 ? "## Part " + std::to_string(i) + "\n[p" + std::to_string(i) + "]: x\n"
+                             : "line [link][p" + std::to_string(i - i % 100) + "]\n";
+    auto analysis = analyzeDocument(text, 1);
+    ASSERT_TRUE(analysis.index.brokenLinks().empty());
+
+    std::string edited = text;
+    edited.insert(text.size() / 2, "word ");
+    auto next = analyzeDocument(TextRope(edited), 2, &analysis, changeFor(text, text.size() / 2, 0, "word "));
+    // Only the edited line is analyzed again; the entries of every other
+    // line are taken over from the previous version.
+    EXPECT_EQ(next.endChangedLine - next.firstChangedLine, 1u);
+    auto before = flatten(analysis.index);
+    auto after = flatten(next.index);
+    ASSERT_EQ(after.size(), before.size());
+    std::size_t differing = 0;
+    for (std::size_t i = 0; i < after.size(); ++i)
+    {
+        if (after[i] != before[i])
+        {
+            EXPECT_EQ(std::get<1>(after[i]), next.firstChangedLine);
+            ++differing;
+        }
+    }
+    EXPECT_LE(differing, 1u);
+    EXPECT_EQ(after, flatten(analyzeDocument(edited, 2).index));
+    EXPECT_EQ(next.index.headings().size(), 1000u);
+    EXPECT_EQ(next.index.uniqueReferenceId("p"), "p1");
+}
@@ -3,6 +3,7 @@
 #include "ck/edit/markdown_parser.hpp"
 
 #include <string>
+#include <vector>
 
 using ck::edit::MarkdownAnalyzer;
 using ck::edit::MarkdownLineInfo;
@@ -10,6 +11,7 @@ using ck::edit::MarkdownLineKind;
 using ck::edit::MarkdownParserState;
 using ck::edit::MarkdownSpan;
 using ck::edit::MarkdownSpanKind;
+using ck::edit::MarkdownStateCheckpoints;
 
 namespace
 {
@@ -76,3 +78,34 @@ TEST(MarkdownParser, IdentifiesInlineSpans)
     ASSERT_NE(link, nullptr);
     EXPECT_EQ(link->attribute, "https://example.com");
 }
+
+TEST(MarkdownParser, ResumesFromStateCheckpoints)
+{
+    MarkdownAnalyzer analyzer;
+    std::vector<std::string> lines = {"# Title", "```cpp", "int x;", "", "```", "text", "```", "code"};
+    MarkdownStateCheckpoints checkpoints(2);
+    MarkdownParserState state;
+    for (std::size_t line = 0; line < lines.size(); ++line)
+    {
+        analyzer.analyzeLine(lines[line], state);
+        checkpoints.record(line + 1, state);
+    }
+
+    MarkdownParserState resumed;
+    EXPECT_EQ(checkpoints.nearest(3, resumed), 2u);
+    EXPECT_TRUE(resumed.inFence);
+    EXPECT_EQ(resumed.fenceLanguage, "cpp");
+    EXPECT_EQ(checkpoints.nearest(100, resumed), 8u);
+    EXPECT_TRUE(resumed.inFence);
+
+    // Editing line 4 keeps the checkpoint at line 4 but drops later ones.
+    checkpoints.invalidateFrom(4);
+    EXPECT_EQ(checkpoints.nearest(100, resumed), 4u);
+    EXPECT_TRUE(resumed.inFence);
+    checkpoints.record(8, resumed);
+    EXPECT_EQ(checkpoints.nearest(8, resumed), 4u);
+
+    checkpoints.clear();
+    EXPECT_EQ(checkpoints.nearest(5, resumed), 0u);
+    EXPECT_FALSE(resumed.inFence);
+}
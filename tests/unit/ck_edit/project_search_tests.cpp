@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/project_search.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using ck::edit::ProjectMatch;
+using ck::edit::ProjectMatcher;
+using ck::edit::ProjectSearchJob;
+using ck::edit::ProjectSearchQuery;
+using ck::edit::replaceInFiles;
+
+namespace
+{
+
+class ProjectTree
+{
+public:
+    ProjectTree()
+    {
+        root = std::filesystem::temp_directory_path() /
+               ("ck_edit_project_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::filesystem::create_directories(root);
+    }
+
+    ~ProjectTree()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+
+    std::string write(const std::string &name, const std::string &text) const
+    {
+        std::filesystem::path path = root / name;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path, std::ios::binary) << text;
+        return path.string();
+    }
+
+    std::string read(const std::string &name) const
+    {
+        std::ifstream in(root / name, std::ios::binary);
+        std::ostringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    std::filesystem::path root;
+};
+
+std::vector<ProjectMatch> collect(ProjectSearchJob &job)
+{
+    std::vector<ProjectMatch> matches;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!job.finished() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::vector<ProjectMatch> taken = job.takeResults();
+        matches.insert(matches.end(), taken.begin(), taken.end());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::sort(matches.begin(), matches.end(), [](const ProjectMatch &a, const ProjectMatch &b) {
+        return std::tie(a.path, a.line, a.column) < std::tie(b.path, b.line, b.column);
+    });
+    return matches;
+}
+
+ProjectSearchQuery markdownQuery(std::string pattern)
+{
+    ProjectSearchQuery query;
+    query.pattern = std::move(pattern);
+    query.fileFilter = [](const std::filesystem::path &path) { return path.extension() == ".md"; };
+    return query;
+}
+
+} // namespace
+
+TEST(ProjectSearch, MatchesLiteralsAndExpressions)
+{
+    ProjectSearchQuery query;
+    query.pattern = "Term";
+    ProjectMatcher literal(query);
+    auto matches = literal.findAll("term TERM\nxterm");
+    ASSERT_EQ(matches.size(), 3u);
+    EXPECT_EQ(matches[2].start, 11u);
+
+    query.caseSensitive = true;
+    EXPECT_TRUE(ProjectMatcher(query).findAll("term TERM").empty());
+
+    query.pattern = "^(\\w+) = (\\d+)$";
+    query.regex = true;
+    ProjectMatcher expression(query);
+    std::size_t count = 0;
+    EXPECT_EQ(expression.replaceAll("a = 1\r\nb = x\nc = 3", "$2 = $1", count), "1 = a\r\nb = x\n3 = c");
+    EXPECT_EQ(count, 2u);
+
+    query.pattern = "x*";
+    EXPECT_TRUE(ProjectMatcher(query).findAll("abc").empty());
+    query.pattern = "(";
+    EXPECT_THROW(ProjectMatcher{query}, std::regex_error);
+}
+
+TEST(ProjectSearch, SearchesTreeInParallel)
+{
+    ProjectTree tree;
+    for (int i = 0; i < 40; ++i)
+        tree.write("docs/part" + std::to_string(i % 4) + "/page" + std::to_string(i) + ".md",
+                   "# Page\n\nthe old name\nnothing\r\nOld Name again\n");
+    tree.write("docs/notes.txt", "old name\n");
+    tree.write(".git/objects/old.md", "old name\n");
+
+    ProjectSearchJob job(tree.root, markdownQuery("old name"), 4);
+    std::vector<ProjectMatch> matches = collect(job);
+    ASSERT_EQ(matches.size(), 80u);
+    EXPECT_EQ(job.filesSearched(), 40u);
+    EXPECT_EQ(matches[0].line, 2u);
+    EXPECT_EQ(matches[0].column, 4u);
+    EXPECT_EQ(matches[0].lineText, "the old name");
+    EXPECT_EQ(matches[1].line, 4u);
+    EXPECT_EQ(matches[1].lineText, "Old Name again");
+}
+
+TEST(ProjectSearch, ReplacesFileByFile)
+{
+    ProjectTree tree;
+    std::string first = tree.write("a.md", "old one\nold two\n");
+    std::string second = tree.write("b.md", "nothing here\n");
+    std::filesystem::path missing = tree.root / "gone.md";
+
+    auto summary = replaceInFiles({first, second, missing.string()}, markdownQuery("old"), "new");
+    EXPECT_EQ(summary.files, 1u);
+    EXPECT_EQ(summary.replacements, 2u);
+    EXPECT_EQ(summary.errors.size(), 1u);
+    EXPECT_EQ(tree.read("a.md"), "new one\nnew two\n");
+    EXPECT_EQ(tree.read("b.md"), "nothing here\n");
+    EXPECT_FALSE(std::filesystem::exists(tree.root / "a.md.tmp"));
+}
+
+TEST(ProjectSearch, ReplacesOnAThreadOfItsOwn)
+{
+    ProjectTree tree;
+    std::string first = tree.write("a.md", "old one\n");
+    std::string second = tree.write("b.md", "old two old\n");
+
+    ck::edit::ProjectReplaceJob job({first, second}, markdownQuery("old"), "new");
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!job.finished() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_TRUE(job.finished());
+    EXPECT_EQ(job.filesDone(), 2u);
+    EXPECT_EQ(job.summary().files, 2u);
+    EXPECT_EQ(job.summary().replacements, 3u);
+    EXPECT_EQ(tree.read("a.md"), "new one\n");
+    EXPECT_EQ(tree.read("b.md"), "new two new\n");
+}
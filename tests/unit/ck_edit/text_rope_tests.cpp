@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "ck/edit/text_rope.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using ck::edit::TextEdit;
+using ck::edit::TextRope;
+
+TEST(TextRope, FollowsEdits)
+{
+    std::mt19937 random(7);
+    std::string text(5000, 'x');
+    for (std::size_t i = 0; i < text.size(); ++i)
+        text[i] = static_cast<char>('a' + i % 26);
+    TextRope rope;
+    rope.assign(std::string_view(text).substr(0, 1200), std::string_view(text).substr(1200));
+    ASSERT_EQ(rope.str(), text);
+
+    for (int step = 0; step < 400; ++step)
+    {
+        std::size_t start = random() % (text.size() + 1);
+        std::size_t end = std::min(text.size(), start + random() % 40);
+        std::string inserted(random() % 3 == 0 ? random() % 3000 : random() % 8, static_cast<char>('A' + step % 26));
+        text.replace(start, end - start, inserted);
+        rope.replace(start, end, inserted);
+        ASSERT_EQ(rope.size(), text.size()) << "step " << step;
+    }
+    EXPECT_EQ(rope.str(), text);
+    EXPECT_EQ(rope.substr(100, 2500), text.substr(100, 2500));
+    EXPECT_EQ(rope.substr(text.size() - 3, 10), text.substr(text.size() - 3));
+
+    std::size_t chunks = 0;
+    rope.forEachChunk([&](std::string_view chunk) {
+        EXPECT_FALSE(chunk.empty());
+        EXPECT_LE(chunk.size(), 1024u);
+        ++chunks;
+    });
+    EXPECT_GE(chunks, text.size() / 1024);
+
+    std::string tail;
+    rope.forEachChunkFrom(2000, [&](std::string_view chunk) {
+        tail.append(chunk);
+        return true;
+    });
+    EXPECT_EQ(tail, text.substr(2000));
+    std::string head;
+    rope.forEachChunkFrom(10, [&](std::string_view chunk) {
+        head.append(chunk);
+        return head.size() < 3000;
+    });
+    EXPECT_EQ(head, text.substr(10, head.size()));
+    EXPECT_GE(head.size(), 3000u);
+    EXPECT_LT(head.size(), 3000u + 1024u);
+}
+
+TEST(TextRope, CopiesAreSnapshots)
+{
+    TextRope rope(std::string(3000, 'a'));
+    TextRope snapshot = rope;
+    rope.replace(10, 2990, "b");
+    rope.replace(0, 0, "head ");
+    EXPECT_EQ(snapshot.str(), std::string(3000, 'a'));
+    EXPECT_EQ(rope.str(), "head " + std::string(10, 'a') + "b" + std::string(10, 'a'));
+}
+
+TEST(TextRope, AppliesEditBatches)
+{
+    TextRope rope("one two three four");
+    rope.apply({{0, 3, "1"}, {14, 18, "4"}, {4, 7, "2"}, {8, 8, ">"}});
+    EXPECT_EQ(rope.str(), "1 2 >three 4");
+
+    rope.replace(0, rope.size(), "");
+    EXPECT_EQ(rope.size(), 0u);
+    rope.apply({{0, 0, "text"}});
+    EXPECT_EQ(rope.str(), "text");
+}
@@ -0,0 +1,85 @@
+#include "ck/find/content_detectors.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+using namespace ck::find;
+
+namespace
+{
+
+std::span<const unsigned char> bytesOf(std::string_view data)
+{
+    return {reinterpret_cast<const unsigned char *>(data.data()), data.size()};
+}
+
+bool hasTag(const DetectedContent &content, std::string_view tag)
+{
+    auto mask = contentTagMask(tag);
+    return mask && (content.tags & *mask) != 0;
+}
+
+} // namespace
+
+TEST(ContentDetectors, ClassifiesMagicNumbersIntoTagsAndFamilies)
+{
+    using namespace std::string_view_literals;
+
+    auto png = classifyContentHeader(bytesOf("\x89PNG\r\n\x1a\n\0\0\0\rIHDR"sv));
+    EXPECT_TRUE(png.binary);
+    EXPECT_TRUE(hasTag(png, "png"));
+    EXPECT_TRUE(hasTag(png, "image"));
+    EXPECT_TRUE(hasTag(png, "binary"));
+    EXPECT_FALSE(hasTag(png, "archive"));
+
+    auto elf = classifyContentHeader(bytesOf("\x7f" "ELF\x02\x01\x01\0"sv));
+    EXPECT_TRUE(hasTag(elf, "elf"));
+    EXPECT_TRUE(hasTag(elf, "executable"));
+
+    auto wav = classifyContentHeader(bytesOf("RIFF\x24\0\0\0WAVEfmt "sv));
+    EXPECT_TRUE(hasTag(wav, "wav"));
+    EXPECT_FALSE(hasTag(wav, "webp"));
+
+    auto script = classifyContentHeader(bytesOf("#!/bin/sh\necho hi\n"sv));
+    EXPECT_FALSE(script.binary);
+    EXPECT_TRUE(hasTag(script, "text"));
+    EXPECT_TRUE(hasTag(script, "script"));
+}
+
+TEST(ContentDetectors, ChecksHeadersBehindShortMagicNumbers)
+{
+    using namespace std::string_view_literals;
+
+    std::string bitmap("BM\x46\0\0\0\0\0\0\0\x36\0\0\0\x28\0\0\0"sv);
+    bitmap.resize(0x46, '\0');
+    EXPECT_TRUE(hasTag(classifyContentHeader(bytesOf(bitmap)), "bmp"));
+
+    std::string executable("MZ"sv);
+    executable.resize(0x80, '\0');
+    executable[0x3C] = '\x80';
+    executable += "PE\0\0"sv;
+    EXPECT_TRUE(hasTag(classifyContentHeader(bytesOf(executable)), "pe"));
+
+    // Plain text that merely starts with the same two letters.
+    auto note = classifyContentHeader(bytesOf("BM meeting notes: budget review moved to Thursday.\n"
+                                              "Bring the quarterly figures and the draft agenda.\n"sv));
+    EXPECT_TRUE(hasTag(note, "text"));
+    EXPECT_FALSE(hasTag(note, "bmp"));
+    EXPECT_FALSE(hasTag(note, "image"));
+
+    auto memo = classifyContentHeader(bytesOf("MZ-2041 release checklist\n"
+                                              "- update the changelog and tag the build before Friday\n"sv));
+    EXPECT_TRUE(hasTag(memo, "text"));
+    EXPECT_FALSE(hasTag(memo, "pe"));
+    EXPECT_FALSE(hasTag(memo, "executable"));
+}
+
+TEST(ContentDetectors, ResolvesTagAliasesCaseInsensitively)
+{
+    EXPECT_EQ(contentTagMask("JPG"), contentTagMask("jpeg"));
+    EXPECT_EQ(contentTagMask("mkv"), contentTagMask("matroska"));
+    EXPECT_TRUE(contentTagMask("Archive").has_value());
+    EXPECT_FALSE(contentTagMask("not-a-format").has_value());
+}
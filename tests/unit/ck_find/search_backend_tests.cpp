@@ -7,6 +7,7 @@
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -14,7 +15,7 @@ TEST(SearchBackend, BuildsDefaultFindCommand)
 {
     auto spec = ck::find::makeDefaultSpecification();
     auto command = ck::find::buildFindCommand(spec);
-    std::vector<std::string> expected = {"find", ".", "-P", "!", "-name", ".*", "!", "-path", "*/.*", "-print"};
+    std::vector<std::string> expected = {"find", "-P", ".", "!", "-name", ".*", "!", "-path", "*/.*", "-print"};
     EXPECT_EQ(command, expected);
 }
 
@@ -77,3 +78,187 @@ TEST(SearchBackend, ExecutesSpecificationWithoutExternalFind)
     fs::remove(textFile);
     fs::remove_all(tempDir);
 }
+
+TEST(SearchBackend, DetectorTagsMatchByContentNotExtension)
+{
+    namespace fs = std::filesystem;
+    fs::path tempDir = fs::temp_directory_path() /
+                       fs::path("ck-find-detector-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(tempDir);
+
+    fs::path disguisedImage = tempDir / "holiday.dat";
+    {
+        std::ofstream stream(disguisedImage, std::ios::binary);
+        stream.write("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16);
+    }
+    fs::path misnamedText = tempDir / "notes.png";
+    {
+        std::ofstream stream(misnamedText);
+        stream << "plain text" << std::endl;
+    }
+
+    auto spec = ck::find::makeDefaultSpecification();
+    std::snprintf(spec.startLocation.data(), spec.startLocation.size(), "%s", tempDir.c_str());
+    spec.enableTextSearch = false;
+    spec.enableTypeFilters = true;
+    spec.typeOptions.useDetectors = true;
+    std::snprintf(spec.typeOptions.detectorTags.data(), spec.typeOptions.detectorTags.size(), "%s", "image, bogus");
+
+    ck::find::SearchExecutionOptions options;
+    options.includeActions = false;
+    options.captureMatches = true;
+
+    std::ostringstream errors;
+    auto result = ck::find::executeSpecification(spec, options, nullptr, &errors);
+    ASSERT_EQ(result.matches.size(), 1u);
+    EXPECT_EQ(result.matches.front(), disguisedImage);
+    EXPECT_NE(errors.str().find("bogus"), std::string::npos);
+
+    fs::remove_all(tempDir);
+}
+
+TEST(SearchBackend, ResultCacheReplaysUnchangedDirectories)
+{
+    namespace fs = std::filesystem;
+    fs::path tempDir = fs::temp_directory_path() /
+                       fs::path("ck-find-cache-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::path tree = tempDir / "tree";
+    fs::path cacheDir = tempDir / "cache";
+    fs::create_directories(tree / "a");
+    fs::create_directories(tree / "b");
+    std::ofstream(tree / "a" / "x.txt") << "x";
+    std::ofstream(tree / "b" / "y.log") << "y";
+
+    // Timestamps within the last couple of seconds are never trusted, so
+    // age the directories before the first run.
+    auto past = fs::file_time_type::clock::now() - std::chrono::hours(1);
+    for (const auto &dir : {tree, tree / "a", tree / "b"})
+        fs::last_write_time(dir, past);
+
+    auto spec = ck::find::makeDefaultSpecification();
+    std::snprintf(spec.startLocation.data(), spec.startLocation.size(), "%s", tree.c_str());
+    std::snprintf(spec.includePatterns.data(), spec.includePatterns.size(), "%s", "*.txt");
+    spec.enableTextSearch = false;
+
+    ck::find::SearchExecutionOptions options;
+    options.includeActions = false;
+    options.captureMatches = true;
+    options.useResultCache = true;
+    options.resultCacheDirectory = cacheDir;
+
+    auto first = ck::find::executeSpecification(spec, options);
+    ASSERT_EQ(first.matches.size(), 1u);
+    EXPECT_EQ(first.directoriesScanned, 3u);
+    EXPECT_EQ(first.directoriesReused, 0u);
+
+    auto second = ck::find::executeSpecification(spec, options);
+    EXPECT_EQ(second.matches, first.matches);
+    EXPECT_EQ(second.directoriesScanned, 0u);
+    EXPECT_EQ(second.directoriesReused, 3u);
+
+    std::ofstream(tree / "b" / "z.txt") << "z";
+    auto third = ck::find::executeSpecification(spec, options);
+    EXPECT_EQ(third.matches.size(), 2u);
+    EXPECT_EQ(third.directoriesScanned, 1u);
+    EXPECT_EQ(third.directoriesReused, 2u);
+
+    // Another spelling of the same root reuses the same cache.
+    fs::last_write_time(tree / "b", past);
+    auto fourth = ck::find::executeSpecification(spec, options);
+    std::string respelled = (tree / "a" / ".." / "").string();
+    std::snprintf(spec.startLocation.data(), spec.startLocation.size(), "%s", respelled.c_str());
+    auto fifth = ck::find::executeSpecification(spec, options);
+    EXPECT_EQ(fifth.matches.size(), fourth.matches.size());
+    EXPECT_EQ(fifth.directoriesScanned, 0u);
+    EXPECT_EQ(fifth.directoriesReused, 3u);
+
+    fs::remove_all(tempDir);
+}
+
+TEST(SearchBackend, SharedTraversalMatchesStandaloneRuns)
+{
+    namespace fs = std::filesystem;
+    fs::path tempDir = fs::temp_directory_path() /
+                       fs::path("ck-find-bulk-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(tempDir / "a" / "skip");
+    fs::create_directories(tempDir / "b");
+    for (const char *name : {"a/x.txt", "a/skip/y.txt", "b/z.txt", "b/notes.md"})
+    {
+        std::ofstream stream(tempDir / name);
+        stream << "hello" << std::endl;
+    }
+
+    auto everything = ck::find::makeDefaultSpecification();
+    std::snprintf(everything.startLocation.data(), everything.startLocation.size(), "%s", tempDir.c_str());
+
+    auto pruned = everything;
+    std::snprintf(pruned.includePatterns.data(), pruned.includePatterns.size(), "%s", "*.txt");
+    pruned.enableNamePathTests = true;
+    pruned.namePathOptions.pruneEnabled = true;
+    pruned.namePathOptions.pruneTest = ck::find::NamePathOptions::PruneTest::Name;
+    std::snprintf(pruned.namePathOptions.prunePattern.data(), pruned.namePathOptions.prunePattern.size(), "%s", "skip");
+
+    auto nested = everything;
+    std::snprintf(nested.startLocation.data(), nested.startLocation.size(), "%s", (tempDir / "a").c_str());
+    nested.enableTraversalFilters = true;
+    nested.traversalOptions.maxDepthEnabled = true;
+    std::snprintf(nested.traversalOptions.maxDepth.data(), nested.traversalOptions.maxDepth.size(), "%s", "1");
+
+    ck::find::SearchExecutionOptions options;
+    options.includeActions = false;
+    options.captureMatches = true;
+
+    std::vector<ck::find::SearchSpecification> specs{everything, pruned, nested};
+    auto shared = ck::find::executeSpecifications(specs, options);
+    ASSERT_EQ(shared.size(), specs.size());
+    for (std::size_t i = 0; i < specs.size(); ++i)
+    {
+        auto standalone = ck::find::executeSpecification(specs[i], options);
+        auto expected = standalone.matches;
+        auto actual = shared[i].matches;
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(actual, expected) << "specification " << i;
+        EXPECT_EQ(shared[i].exitCode, 0);
+    }
+    EXPECT_EQ(shared[1].matches.size(), 2u);
+    EXPECT_EQ(shared[2].matches.size(), 3u);
+
+    fs::remove_all(tempDir);
+}
+
+TEST(SearchBackend, NameAndPathFiltersUseRootRelativePaths)
+{
+    namespace fs = std::filesystem;
+    fs::path tempDir = fs::temp_directory_path() /
+                       fs::path("ck-find-names-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(tempDir / "src" / "build");
+    fs::create_directories(tempDir / ".git");
+    for (const char *name : {"src/Main.CPP", "src/util.cpp", "src/build/gen.cpp", ".git/hook.cpp"})
+    {
+        std::ofstream stream(tempDir / name);
+        stream << "x" << std::endl;
+    }
+
+    auto spec = ck::find::makeDefaultSpecification();
+    // A trailing separator must not change the relative paths seen by -path.
+    std::snprintf(spec.startLocation.data(), spec.startLocation.size(), "%s/", tempDir.c_str());
+    spec.enableNamePathTests = true;
+    std::snprintf(spec.namePathOptions.inamePattern.data(), spec.namePathOptions.inamePattern.size(), "%s", "*.cpp");
+    spec.namePathOptions.pruneEnabled = true;
+    spec.namePathOptions.pruneTest = ck::find::NamePathOptions::PruneTest::Path;
+    std::snprintf(spec.namePathOptions.prunePattern.data(), spec.namePathOptions.prunePattern.size(), "%s", "src/build");
+
+    ck::find::SearchExecutionOptions options;
+    options.includeActions = false;
+    options.captureMatches = true;
+
+    auto result = ck::find::executeSpecification(spec, options);
+    std::vector<std::string> names;
+    for (const auto &match : result.matches)
+        names.push_back(match.filename().string());
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(names, (std::vector<std::string>{"Main.CPP", "util.cpp"}));
+
+    fs::remove_all(tempDir);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include "json_binary.hpp"
+#include "json_export.hpp"
+#include "json_query.hpp"
+#include "json_search.hpp"
+#include "json_view_core.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const json kSample = json::parse(R"({
+  "name": "sensor \"7\"",
+  "unicode": "héllo ☃",
+  "ints": [0, 1, -1, 23, 24, 255, 256, -129, 65536, -2147483649, 4294967296, -9223372036854775807],
+  "floats": [1.5, -0.25, 3.141592653589793, 1e300],
+  "flags": [true, false, null],
+  "empty": {"list": [], "map": {}},
+  "nested": [[[{"deep": "x"}]]]
+})");
+
+std::string bytesOf(const std::vector<std::uint8_t> &bytes)
+{
+    return std::string(bytes.begin(), bytes.end());
+}
+
+json decode(const std::string &bytes, JsonFormat format)
+{
+    auto document = JsonDocument::fromString(bytes, format);
+    return documentToJson(*document, document->root());
+}
+
+std::string writeTemp(const std::string &name, const std::string &bytes)
+{
+    std::string path = ::testing::TempDir() + name;
+    std::ofstream(path, std::ios::binary) << bytes;
+    return path;
+}
+
+} // namespace
+
+TEST(JsonBinary, DecodesEveryEncodingLikeNlohmann)
+{
+    EXPECT_EQ(decode(bytesOf(json::to_cbor(kSample)), JsonFormat::Cbor), kSample);
+    EXPECT_EQ(decode(bytesOf(json::to_msgpack(kSample)), JsonFormat::MessagePack), kSample);
+    EXPECT_EQ(decode(bytesOf(json::to_bson(kSample)), JsonFormat::Bson), kSample);
+    EXPECT_EQ(decode(bytesOf(json::to_ubjson(kSample)), JsonFormat::Ubjson), kSample);
+    EXPECT_EQ(decode(bytesOf(json::to_ubjson(kSample, true)), JsonFormat::Ubjson), kSample);
+    EXPECT_EQ(decode(bytesOf(json::to_ubjson(kSample, true, true)), JsonFormat::Ubjson), kSample);
+
+    json big = {{"max", 18446744073709551615u}, {"min", -9223372036854775807LL - 1}};
+    EXPECT_EQ(decode(bytesOf(json::to_cbor(big)), JsonFormat::Cbor), big);
+    EXPECT_EQ(decode(bytesOf(json::to_msgpack(big)), JsonFormat::MessagePack), big);
+}
+
+TEST(JsonBinary, HandlesEncodingDetails)
+{
+    // CBOR: indefinite map, array and string, a tag, a half float.
+    const char cbor[] = "\xbf\x61" "a" "\x9f\x01\xf9\x3e\x00\xff\x61" "b" "\xc1\x7f\x62" "he" "\x63" "llo" "\xff\xff";
+    EXPECT_EQ(decode(std::string(cbor, sizeof(cbor) - 1), JsonFormat::Cbor), json::parse(R"({"a": [1, 1.5], "b": "hello"})"));
+    // CBOR byte strings and MessagePack bin are shown as hex.
+    EXPECT_EQ(decode(std::string("\x42\x0f\xa0", 3), JsonFormat::Cbor), "0fa0");
+    EXPECT_EQ(decode(std::string("\x81\x01\xc4\x02\xde\xad", 6), JsonFormat::MessagePack), json::parse(R"({"1": "dead"})"));
+    // UBJSON: a strongly typed array and no-op padding.
+    EXPECT_EQ(decode("N[$i#i\x03\x01\x02\x03N", JsonFormat::Ubjson), json::parse("[1, 2, 3]"));
+    EXPECT_EQ(decode("{NU\x01kSU\x02hiN}", JsonFormat::Ubjson), json::parse(R"({"k": "hi"})"));
+
+    // Numbers keep their integer spelling and shortest float form.
+    auto document = JsonDocument::fromString(bytesOf(json::to_msgpack(json::parse("[-5, 0.1, 1e300]"))), JsonFormat::MessagePack);
+    auto items = document->members(document->root());
+    ASSERT_EQ(items.size(), 3u);
+    EXPECT_EQ(document->numberText(items[0].value), "-5");
+    EXPECT_EQ(document->numberText(items[1].value), "0.1");
+    EXPECT_EQ(document->numberValue(items[2].value), 1e300);
+}
+
+TEST(JsonBinary, RejectsMalformedInput)
+{
+    std::string cbor = bytesOf(json::to_cbor(kSample));
+    EXPECT_THROW(JsonDocument::fromString(cbor.substr(0, cbor.size() - 1), JsonFormat::Cbor), JsonParseError);
+    EXPECT_THROW(JsonDocument::fromString(cbor + "\x01", JsonFormat::Cbor), JsonParseError);
+    std::string bson = bytesOf(json::to_bson(kSample));
+    bson[bson.size() - 1] = 1;
+    EXPECT_THROW(JsonDocument::fromString(bson, JsonFormat::Bson), JsonParseError);
+    // A count the input cannot hold fails before anything is allocated.
+    EXPECT_THROW(JsonDocument::fromString("\xdd\x7f\xff\xff\xff", JsonFormat::MessagePack), JsonParseError);
+    EXPECT_THROW(JsonDocument::fromString("[#L\x7f\xff\xff\xff\xff\xff\xff\xff", JsonFormat::Ubjson), JsonParseError);
+}
+
+TEST(JsonBinary, OpensByExtensionOrContent)
+{
+    EXPECT_EQ(jsonFormatForPath("logs/a.CBOR"), JsonFormat::Cbor);
+    EXPECT_EQ(jsonFormatForPath("a.msgpack"), JsonFormat::MessagePack);
+    EXPECT_EQ(jsonFormatForPath("dump.bson"), JsonFormat::Bson);
+    EXPECT_EQ(jsonFormatForPath("a.ubj"), JsonFormat::Ubjson);
+    EXPECT_EQ(jsonFormatForPath("dir.cbor/data"), JsonFormat::Text);
+
+    std::string named = writeTemp("json_binary_test.cbor", bytesOf(json::to_cbor(kSample)));
+    EXPECT_EQ(JsonDocument::open(named)->format(), JsonFormat::Cbor);
+    std::string bare = writeTemp("json_binary_test_bson", bytesOf(json::to_bson(kSample)));
+    EXPECT_EQ(JsonDocument::open(bare)->format(), JsonFormat::Bson);
+    std::string text = writeTemp("json_binary_test_text", "{\"a\": [1,");
+    EXPECT_THROW(JsonDocument::open(text), JsonParseError);
+    std::remove(named.c_str());
+    std::remove(bare.c_str());
+    std::remove(text.c_str());
+}
+
+TEST(JsonBinary, ReportsTruncatedJsonFilesAsText)
+{
+    // "{" alone is also the MessagePack integer 123.
+    std::string truncated = writeTemp("json_binary_test_truncated.json", "  {");
+    try
+    {
+        JsonDocument::open(truncated);
+        ADD_FAILURE() << "a truncated JSON file opened";
+    }
+    catch (const JsonParseError &error)
+    {
+        EXPECT_EQ(error.offset(), 3u);
+    }
+    // Content that cannot be JSON is still tried as the binary encodings.
+    std::string misnamed = writeTemp("json_binary_test_misnamed.json", bytesOf(json::to_cbor(kSample)));
+    EXPECT_EQ(JsonDocument::open(misnamed)->format(), JsonFormat::Cbor);
+    std::remove(truncated.c_str());
+    std::remove(misnamed.c_str());
+}
+
+TEST(JsonBinary, BrowsesSearchesAndExportsThroughTheTree)
+{
+    auto document = JsonDocument::fromString(bytesOf(json::to_bson(kSample)), JsonFormat::Bson);
+    auto root = buildTree(document, "data.bson");
+    EXPECT_NE(getContentLabel(root.get()).find("BSON"), std::string::npos);
+    Node *floats = materializePath(root.get(), {2, 0});
+    ASSERT_NE(floats, nullptr);
+    EXPECT_EQ(getContentLabel(floats), "[0]: 1.5");
+    Node *name = materializePath(root.get(), {4});
+    ASSERT_NE(name, nullptr);
+    EXPECT_EQ(getContentLabel(name), "name: \"sensor \\\"7\\\"\"");
+
+    EXPECT_EQ(json::parse(nodeJsonText(root.get(), JsonWriteStyle::Raw)), kSample);
+    EXPECT_EQ(json::parse(nodeJsonText(root.get(), JsonWriteStyle::Pretty)), kSample);
+    EXPECT_EQ(evaluateQuery("$.nested[0][0][0].deep", root.get()), (std::vector<std::vector<std::uint32_t>>{{5, 0, 0, 0, 0}}));
+
+    auto index = JsonSearchIndex::build(document);
+    while (!index->waitFor(1000))
+    {
+    }
+    JsonSearchJob job(index, JsonSearchQuery{"deep", true, false, false, ""});
+    std::vector<std::vector<std::uint32_t>> found;
+    for (bool done = false; !done;)
+    {
+        done = job.finished();
+        auto batch = job.takeResults();
+        found.insert(found.end(), batch.begin(), batch.end());
+    }
+    EXPECT_EQ(found, (std::vector<std::vector<std::uint32_t>>{{5, 0, 0, 0, 0}}));
+}
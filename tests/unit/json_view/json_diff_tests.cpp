@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include "json_diff.hpp"
+#include "json_view_core.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::uint64_t rootHash(const std::string &text)
+{
+    auto document = JsonDocument::fromString(text);
+    return JsonSubtreeHashes(*document).hash(document->root());
+}
+
+// One line per entry: depth-indented marker and key.
+std::vector<std::string> describe(const std::string &left, const std::string &right, const JsonDiffOptions &options = {})
+{
+    auto a = JsonDocument::fromString(left);
+    auto b = JsonDocument::fromString(right);
+    std::vector<std::string> out;
+    for (const JsonDiffEntry &entry : diffDocuments(*a, *b, options))
+    {
+        const char *marker = entry.kind == JsonDiffKind::Added ? "+" : entry.kind == JsonDiffKind::Removed ? "-" : "~";
+        out.push_back(std::string(entry.depth, ' ') + marker + entry.key);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(JsonDiff, HashesValuesNotSpelling)
+{
+    EXPECT_EQ(rootHash(R"({"a": 1, "b": [true, null, "x"]})"), rootHash(R"({"b":[true,null,"x"],"a":1.0})"));
+    EXPECT_EQ(rootHash("[100, -0, 12345678901234567890]"), rootHash("[1e2, 0, 12345678901234567890]"));
+    EXPECT_NE(rootHash("[1, 2]"), rootHash("[2, 1]"));
+    EXPECT_NE(rootHash(R"({"a": 1})"), rootHash(R"({"b": 1})"));
+    EXPECT_NE(rootHash(R"({"a": [1]})"), rootHash(R"({"a": {"0": 1}})"));
+    EXPECT_NE(rootHash("[9007199254740993]"), rootHash("[9007199254740992]"));
+    EXPECT_NE(rootHash(R"(["1"])"), rootHash("[1]"));
+
+    // Binary encodings hash like the text they decode to.
+    json value = json::parse(R"({"name": "x", "list": [1, 2.5, false, {"k": null}]})");
+    auto text = JsonDocument::fromString(value.dump());
+    std::vector<std::uint8_t> cbor = json::to_cbor(value);
+    auto binary = JsonDocument::fromString(std::string(cbor.begin(), cbor.end()), JsonFormat::Cbor);
+    EXPECT_EQ(JsonSubtreeHashes(*text).hash(text->root()), JsonSubtreeHashes(*binary).hash(binary->root()));
+}
+
+TEST(JsonDiff, AlignsMembersByNameAndItemsByIndex)
+{
+    EXPECT_TRUE(describe(R"({"a": [1, 2], "b": {"c": 1}})", R"({"b": {"c": 1}, "a": [1, 2]})").empty());
+    EXPECT_EQ(describe(R"({"same": {"deep": [1, 2, 3]}, "x": 1, "gone": true, "list": [1, 2, 3]})",
+                       R"({"same": {"deep": [1, 2, 3]}, "x": "1", "list": [1, 5], "new": {"k": 1}})"),
+              (std::vector<std::string>{"~", " ~x", " ~list", "  ~[1]", "  -[2]", " +new", " -gone"}));
+    // Values of a different kind replace the old one as a whole.
+    EXPECT_EQ(describe(R"({"v": [1]})", R"({"v": {"0": 1}})"), (std::vector<std::string>{"~", " ~v"}));
+    EXPECT_EQ(describe("[1]", "{}"), (std::vector<std::string>{"~"}));
+}
+
+TEST(JsonDiff, MatchesArrayItemsById)
+{
+    const std::string left = R"([{"id": 1, "v": "a"}, {"id": 2, "v": "b"}, {"id": 3, "v": "c"}, 7])";
+    const std::string right = R"([{"id": 3, "v": "c"}, {"v": "z", "id": 1}, {"id": 4}, 8])";
+    EXPECT_EQ(describe(left, right, JsonDiffOptions{"id"}),
+              (std::vector<std::string>{"~", " ~[1]", "  ~v", " +[2]", " ~[3]", " -[1]"}));
+    // By position every item differs.
+    EXPECT_EQ(describe(left, right).size(), 11u);
+}
+
+TEST(JsonDiff, BuildsMergedTree)
+{
+    auto left = JsonDocument::fromString(R"({"keep": [1, 2], "n": 1, "gone": "x", "obj": {"a": 1, "b": 2}})");
+    auto right = JsonDocument::fromString(R"({"keep": [1, 2], "n": 2, "obj": {"a": 1, "b": 3}, "add": [1]})");
+    auto entries = diffDocuments(*left, *right);
+    auto root = buildDiffTree(left, right, entries, "a.json → b.json");
+    EXPECT_EQ(getContentLabel(root.get()), "a.json → b.json (± diff, 4 changes at the top)");
+    ASSERT_EQ(root->childCount, 4u);
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 0)), "~ n: 2 (was 1)");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 1)), "~ obj (dictionary, 2 keys)");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 2)), "+ add (list, 1 item)");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 3)), "- gone: \"x\"");
+    EXPECT_TRUE(childAt(root.get(), 3)->isLastChild);
+
+    // Only the changed member of obj is shown; added values expand as usual.
+    Node *b = materializePath(root.get(), {1, 0});
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(getContentLabel(b), "~ b: 3 (was 2)");
+    EXPECT_EQ(childAt(root.get(), 1)->childCount, 1u);
+    Node *added = materializePath(root.get(), {2, 0});
+    ASSERT_NE(added, nullptr);
+    EXPECT_EQ(getContentLabel(added), "[0]: 1");
+
+    auto same = buildDiffTree(left, left, diffDocuments(*left, *left), "a.json → a.json");
+    EXPECT_EQ(getContentLabel(same.get()), "a.json → a.json (± identical)");
+    EXPECT_FALSE(hasChildren(same.get()));
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include "json_document.hpp"
+#include "json_lines.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector<std::string> keysOf(const JsonDocument &doc, JsonValue value)
+{
+    std::vector<std::string> keys;
+    for (const auto &member : doc.members(value))
+        keys.push_back(doc.key(member));
+    return keys;
+}
+
+} // namespace
+
+TEST(JsonDocument, SkipsUtf8ByteOrderMark)
+{
+    auto doc = JsonDocument::fromString("\xEF\xBB\xBF{\"a\": [1]}");
+    ASSERT_EQ(doc->kind(doc->root()), JsonKind::Object);
+    EXPECT_EQ(doc->source(doc->root()), "{\"a\": [1]}");
+    EXPECT_EQ(keysOf(*doc, doc->root()), (std::vector<std::string>{"a"}));
+
+    auto lines = JsonLines::fromString("\xEF\xBB\xBF{\"n\": 1}\n{\"n\": 2}\n");
+    ASSERT_EQ(lines->recordCount(), 2u);
+    EXPECT_EQ(lines->recordText(0), "{\"n\": 1}");
+    EXPECT_EQ(lines->parseRecord(0)->size(lines->parseRecord(0)->root()), 1u);
+}
+
+TEST(JsonDocument, IndexesContainersAndDecodesLazily)
+{
+    auto doc = JsonDocument::fromString(R"(  {"a": [1, {"b": "x\ny"}, []], "c\u0041": -2.5e1, "d": true, "e": null} )");
+    JsonValue root = doc->root();
+    ASSERT_EQ(doc->kind(root), JsonKind::Object);
+    EXPECT_EQ(doc->size(root), 4u);
+    EXPECT_EQ(doc->containerCount(), 4u);
+    EXPECT_EQ(keysOf(*doc, root), (std::vector<std::string>{"a", "cA", "d", "e"}));
+
+    auto members = doc->members(root);
+    JsonValue array = members[0].value;
+    ASSERT_EQ(doc->kind(array), JsonKind::Array);
+    EXPECT_EQ(doc->source(array), R"([1, {"b": "x\ny"}, []])");
+
+    auto items = doc->members(array);
+    ASSERT_EQ(items.size(), 3u);
+    EXPECT_EQ(items[0].keyOffset, JsonMember::kNoKey);
+    EXPECT_EQ(doc->numberValue(items[0].value), 1.0);
+    auto inner = doc->members(items[1].value);
+    ASSERT_EQ(inner.size(), 1u);
+    EXPECT_EQ(doc->stringValue(inner[0].value), "x\ny");
+    EXPECT_EQ(doc->size(items[2].value), 0u);
+    EXPECT_TRUE(doc->members(items[2].value).empty());
+
+    EXPECT_EQ(doc->numberValue(members[1].value), -25.0);
+    EXPECT_TRUE(doc->booleanValue(members[2].value));
+    EXPECT_EQ(doc->kind(members[3].value), JsonKind::Null);
+
+    // Handles without a cached container slot are resolved by offset.
+    JsonValue byOffset{array.offset};
+    EXPECT_EQ(doc->size(byOffset), 3u);
+}
+
+TEST(JsonDocument, AcceptsSpecialNumbersAndScalarRoots)
+{
+    auto doc = JsonDocument::fromString("[NaN, Infinity, -Infinity]");
+    auto items = doc->members(doc->root());
+    ASSERT_EQ(items.size(), 3u);
+    EXPECT_TRUE(std::isnan(doc->numberValue(items[0].value)));
+    EXPECT_GT(doc->numberValue(items[1].value), 0);
+    EXPECT_TRUE(std::isinf(doc->numberValue(items[2].value)));
+    EXPECT_LT(doc->numberValue(items[2].value), 0);
+
+    auto scalar = JsonDocument::fromString(" \"\\ud83d\\ude00\" ");
+    EXPECT_EQ(doc->kind(doc->root()), JsonKind::Array);
+    EXPECT_EQ(scalar->kind(scalar->root()), JsonKind::String);
+    EXPECT_EQ(scalar->stringValue(scalar->root()), "\xF0\x9F\x98\x80");
+}
+
+TEST(JsonDocument, ReportsMalformedInputWithPosition)
+{
+    const std::vector<std::string> invalid = {
+        "", "{", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[01]", "[1.]", "[tru]", "\"abc", "[1] 2", "{1:2}", "[\"\\x\"]",
+        "[\"a\nb\"]",
+    };
+    for (const auto &text : invalid)
+        EXPECT_THROW(JsonDocument::fromString(text), JsonParseError) << text;
+
+    try
+    {
+        JsonDocument::fromString("{\n  \"a\": [1 2]\n}");
+        FAIL() << "expected a parse error";
+    }
+    catch (const JsonParseError &error)
+    {
+        EXPECT_EQ(std::string(error.what()), "line 2, column 11: expected ',' or ']'");
+        EXPECT_EQ(error.offset(), 12u);
+    }
+}
+
+TEST(JsonDocument, HandlesDeepNestingWithoutRecursion)
+{
+    std::string text(100000, '[');
+    text.append(100000, ']');
+    auto doc = JsonDocument::fromString(text);
+    EXPECT_EQ(doc->containerCount(), 100000u);
+    EXPECT_EQ(doc->end(doc->root()), text.size());
+}
+
+TEST(JsonDocument, MapsFilesFromDisk)
+{
+    auto path = std::filesystem::temp_directory_path() / "ck_json_document_test.json";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << R"({"long": "a string that is longer than one machine word, with \"escapes\" inside"})";
+    }
+    auto doc = JsonDocument::open(path.string());
+    auto members = doc->members(doc->root());
+    ASSERT_EQ(members.size(), 1u);
+    EXPECT_EQ(doc->stringValue(members[0].value), "a string that is longer than one machine word, with \"escapes\" inside");
+    EXPECT_EQ(doc->byteSize(), std::filesystem::file_size(path));
+    std::filesystem::remove(path);
+
+    EXPECT_THROW(JsonDocument::open((std::filesystem::temp_directory_path() / "ck_json_missing.json").string()),
+                 std::runtime_error);
+}
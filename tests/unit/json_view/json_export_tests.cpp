@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "json_export.hpp"
+#include "json_view_core.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+std::string format(const std::string &text, JsonWriteStyle style)
+{
+    std::string out;
+    writeJsonText(text, style, [&](std::string_view chunk) { out.append(chunk); });
+    return out;
+}
+
+} // namespace
+
+TEST(JsonExport, ReformatsWithoutDecoding)
+{
+    const std::string text = " {\"b\" : [1.50, {}, [ ], \"a, \\\"b\\\" ]\"], \"a\":{\"x\":NaN, \"y\": -Infinity}} \n";
+    EXPECT_EQ(format(text, JsonWriteStyle::Raw), text.substr(1, text.size() - 3));
+    EXPECT_EQ(format(text, JsonWriteStyle::Minified), R"({"b":[1.50,{},[],"a, \"b\" ]"],"a":{"x":null,"y":null}})");
+    EXPECT_EQ(format(text, JsonWriteStyle::Pretty),
+              "{\n"
+              "  \"b\": [\n"
+              "    1.50,\n"
+              "    {},\n"
+              "    [],\n"
+              "    \"a, \\\"b\\\" ]\"\n"
+              "  ],\n"
+              "  \"a\": {\n"
+              "    \"x\": null,\n"
+              "    \"y\": null\n"
+              "  }\n"
+              "}");
+}
+
+TEST(JsonExport, MinifiedOutputParsesToTheSameValue)
+{
+    std::string text = "[";
+    for (int i = 0; i < 20000; ++i)
+        text += (i ? ", " : "") + std::string("{ \"id\" : ") + std::to_string(i) + ", \"s\" : \"\\u00e9\\n\" }";
+    text += "]";
+    std::size_t chunks = 0;
+    std::string out;
+    writeJsonText(text, JsonWriteStyle::Minified, [&](std::string_view chunk) {
+        ++chunks;
+        out.append(chunk);
+    });
+    EXPECT_GT(chunks, 1u);
+    EXPECT_EQ(json::parse(out), json::parse(text));
+    EXPECT_EQ(json::parse(format(text, JsonWriteStyle::Pretty)), json::parse(text));
+}
+
+TEST(JsonExport, WritesSubtreesFromTheSource)
+{
+    auto root = buildTree(JsonDocument::fromString(R"({"z": 1, "list": [ 1,  2 ]})"), "");
+    const Node *list = childAt(root.get(), 1);
+    EXPECT_EQ(nodeJsonText(list, JsonWriteStyle::Raw), "[ 1,  2 ]");
+    EXPECT_EQ(nodeJsonText(list, JsonWriteStyle::Minified), "[1,2]");
+    // Keys stay in source order.
+    EXPECT_EQ(nodeJsonText(root.get(), JsonWriteStyle::Minified), R"({"z":1,"list":[1,2]})");
+
+    auto lines = JsonLines::fromString("{\"a\": 1}\n{\"b\": [2]}\n");
+    auto linesRoot = buildLinesTree(lines, "log.jsonl");
+    EXPECT_EQ(nodeJsonText(linesRoot.get(), JsonWriteStyle::Minified), "{\"a\":1}\n{\"b\":[2]}\n");
+    EXPECT_EQ(nodeJsonText(childAt(linesRoot.get(), 1), JsonWriteStyle::Raw), "{\"b\": [2]}");
+}
+
+TEST(JsonExport, ExportsToFile)
+{
+    auto root = buildTree(JsonDocument::fromString(R"({"a": [1, 2]})"), "");
+    std::string path = ::testing::TempDir() + "json_export_test.json";
+    exportNodeJson(root.get(), JsonWriteStyle::Pretty, path);
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    EXPECT_EQ(contents.str(), "{\n  \"a\": [\n    1,\n    2\n  ]\n}\n");
+    std::remove(path.c_str());
+
+    EXPECT_THROW(exportNodeJson(root.get(), JsonWriteStyle::Raw, "/nonexistent-dir/out.json"), std::runtime_error);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "json_lines.hpp"
+#include "json_view_core.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST(JsonLines, IndexesNonBlankLines)
+{
+    auto lines = JsonLines::fromString("{\"a\": 1}\r\n\n   \n[1, 2]\n\"last\"");
+    ASSERT_EQ(lines->recordCount(), 3u);
+    EXPECT_EQ(lines->recordText(0), "{\"a\": 1}");
+    EXPECT_EQ(lines->recordText(1), "[1, 2]");
+    EXPECT_EQ(lines->recordText(2), "\"last\"");
+
+    auto record = lines->parseRecord(1);
+    EXPECT_EQ(record->kind(record->root()), JsonKind::Array);
+    EXPECT_EQ(record->size(record->root()), 2u);
+
+    auto broken = JsonLines::fromString("{\"a\": 1}\n{\"b\": \n");
+    EXPECT_THROW(broken->parseRecord(1), JsonParseError);
+}
+
+TEST(JsonLines, SplitsLargeInputsAcrossThreadsWithoutLosingLines)
+{
+    std::string text;
+    std::vector<std::uint64_t> expected;
+    for (int i = 0; text.size() < (24u << 20); ++i)
+    {
+        expected.push_back(text.size());
+        text += "{\"id\": " + std::to_string(i) + ", \"pad\": \"" + std::string(i % 97, 'x') + "\"}\n";
+        if (i % 1000 == 0)
+            text += "\n";
+    }
+    EXPECT_EQ(findRecordStarts(text, 0), expected);
+}
+
+TEST(JsonLines, FollowsAppendedRecords)
+{
+    auto path = std::filesystem::temp_directory_path() / "ck_json_lines_test.jsonl";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "{\"n\": 1}\n{\"n\": ";
+    }
+    EXPECT_TRUE(isJsonLinesPath(path.string()));
+    auto lines = JsonLines::open(path.string());
+    auto root = buildLinesTree(lines, path.string());
+    ensureChildren(root.get());
+    ASSERT_EQ(root->childCount, 2u);
+    Node *partial = childAt(root.get(), 1);
+    ensureChildren(partial);
+    EXPECT_FALSE(partial->error.empty());
+    EXPECT_EQ(lines->refresh(), JsonLines::RefreshResult::Unchanged);
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "2}\n{\"n\": 3}\n";
+    }
+    EXPECT_EQ(lines->refresh(), JsonLines::RefreshResult::Appended);
+    EXPECT_EQ(lines->recordCount(), 3u);
+    EXPECT_EQ(appendNewRecords(root.get()), 1u);
+    ASSERT_EQ(root->childCount, 3u);
+    EXPECT_FALSE(partial->isLastChild);
+    EXPECT_TRUE(childAt(root.get(), 2)->isLastChild);
+    EXPECT_TRUE(partial->error.empty());
+    EXPECT_TRUE(hasChildren(partial));
+    ensureChildren(partial);
+    ASSERT_EQ(partial->childCount, 1u);
+    EXPECT_EQ(getContentLabel(childAt(partial, 0)), "n: 2");
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "{}\n";
+    }
+    EXPECT_EQ(lines->refresh(), JsonLines::RefreshResult::Reset);
+    EXPECT_EQ(lines->recordCount(), 1u);
+    std::filesystem::remove(path);
+}
+
+TEST(JsonLines, ParsesRecordsOnlyWhenExploredOrSearched)
+{
+    auto lines = JsonLines::fromString("{\"user\": \"ada\"}\n{\"user\": \"grace\", \"tags\": [\"x\"]}\n42\n");
+    auto root = buildLinesTree(lines, "log.jsonl");
+    ensureChildren(root.get());
+    ASSERT_EQ(root->childCount, 3u);
+    // Counting records goes by the line index; no row exists yet.
+    EXPECT_TRUE(root->children.empty());
+    for (size_t idx = 0; Node *record = childAt(root.get(), idx); ++idx)
+        EXPECT_EQ(record->document, nullptr);
+    EXPECT_EQ(getContentLabel(root.get()), "log.jsonl (📜 JSON Lines, 3 records, 52 Bytes)");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 0)), "[0] {\"user\": \"ada\"}");
+    EXPECT_EQ(getTypeIcon(childAt(root.get(), 2)), "⅑ ");
+    EXPECT_TRUE(hasChildren(childAt(root.get(), 1)));
+    EXPECT_FALSE(hasChildren(childAt(root.get(), 2)));
+
+    std::vector<const Node *> matches;
+    searchTree(root.get(), "grace", false, true, matches);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0]->key, "user");
+    EXPECT_EQ(matches[0]->parent, childAt(root.get(), 1));
+    EXPECT_EQ(childAt(root.get(), 0)->document, nullptr);
+
+    json all = reconstructJson(root.get());
+    ASSERT_TRUE(all.is_array());
+    EXPECT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[1]["tags"][0], "x");
+    EXPECT_EQ(reconstructJson(childAt(root.get(), 2)), 42);
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include "json_query.hpp"
+#include "json_view_core.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Paths = std::vector<std::vector<std::uint32_t>>;
+
+const char *kStore = R"({
+  "store": {
+    "book": [
+      {"title": "Sayings", "price": 8.95, "tags": ["old"]},
+      {"title": "Sword", "price": 12.99, "isbn": "0-553"},
+      {"title": "Moby", "price": 8.99, "isbn": "0-395"},
+      {"title": "Rings", "price": 22.99}
+    ],
+    "bicycle": {"color": "red", "price": 19.95}
+  },
+  "price": 1
+})";
+
+Paths query(const std::string &text, const char *document = kStore)
+{
+    auto root = buildTree(JsonDocument::fromString(document), "");
+    return evaluateQuery(text, root.get());
+}
+
+} // namespace
+
+TEST(JsonQuery, SelectsFieldsIndicesAndWildcards)
+{
+    EXPECT_EQ(query("$.store.bicycle.color"), (Paths{{0, 1, 0}}));
+    EXPECT_EQ(query("$['store']['book'][1].title"), (Paths{{0, 0, 1, 0}}));
+    EXPECT_EQ(query("$.store.book[-1].title"), (Paths{{0, 0, 3, 0}}));
+    EXPECT_EQ(query("$.store.book[*].title"), (Paths{{0, 0, 0, 0}, {0, 0, 1, 0}, {0, 0, 2, 0}, {0, 0, 3, 0}}));
+    EXPECT_EQ(query("$.store.*"), (Paths{{0, 0}, {0, 1}}));
+    EXPECT_EQ(query("$.store.book[2,0]"), (Paths{{0, 0, 2}, {0, 0, 0}}));
+    EXPECT_EQ(query("$"), (Paths{{}}));
+    EXPECT_TRUE(query("$.store.missing").empty());
+    EXPECT_TRUE(query("$.store.book.title").empty());
+}
+
+TEST(JsonQuery, SlicesArrays)
+{
+    EXPECT_EQ(query("$.store.book[1:3]"), (Paths{{0, 0, 1}, {0, 0, 2}}));
+    EXPECT_EQ(query("$.store.book[::2]"), (Paths{{0, 0, 0}, {0, 0, 2}}));
+    EXPECT_EQ(query("$.store.book[-2:]"), (Paths{{0, 0, 2}, {0, 0, 3}}));
+    EXPECT_EQ(query("$.store.book[::-1]"), (Paths{{0, 0, 3}, {0, 0, 2}, {0, 0, 1}, {0, 0, 0}}));
+    EXPECT_TRUE(query("$.store.book[3:1]").empty());
+}
+
+TEST(JsonQuery, DescendsRecursively)
+{
+    EXPECT_EQ(query("$..price"),
+              (Paths{{1}, {0, 0, 0, 1}, {0, 0, 1, 1}, {0, 0, 2, 1}, {0, 0, 3, 1}, {0, 1, 1}}));
+    EXPECT_EQ(query("$..tags[0]"), (Paths{{0, 0, 0, 2, 0}}));
+    EXPECT_EQ(query("$..book[?(@.isbn)].title"), (Paths{{0, 0, 1, 0}, {0, 0, 2, 0}}));
+}
+
+TEST(JsonQuery, FiltersWithComparisons)
+{
+    EXPECT_EQ(query("$.store.book[?(@.price < 10)].title"), (Paths{{0, 0, 0, 0}, {0, 0, 2, 0}}));
+    EXPECT_EQ(query("$.store.book[?(@.price >= 10 && @.title != 'Rings')]"), (Paths{{0, 0, 1}}));
+    EXPECT_EQ(query("$.store.book[?(@.title == \"Moby\" || @['price'] > 20)]"), (Paths{{0, 0, 2}, {0, 0, 3}}));
+    EXPECT_EQ(query("$.store.book[?(!@.isbn)]"), (Paths{{0, 0, 0}, {0, 0, 3}}));
+    EXPECT_EQ(query("$.store.book[?(@.tags[0] == 'old')]"), (Paths{{0, 0, 0}}));
+    EXPECT_EQ(query("$[?(@ == 1)]"), (Paths{{1}}));
+}
+
+TEST(JsonQuery, AcceptsJqSpellings)
+{
+    EXPECT_EQ(query(".store.book[].price"), query("$.store.book[*].price"));
+    EXPECT_EQ(query(".store.book.[0]"), (Paths{{0, 0, 0}}));
+    EXPECT_EQ(query("."), (Paths{{}}));
+    EXPECT_EQ(query("store.bicycle"), (Paths{{0, 1}}));
+}
+
+TEST(JsonQuery, ReportsSyntaxErrors)
+{
+    EXPECT_THROW(JsonQuery("$.store["), std::invalid_argument);
+    EXPECT_THROW(JsonQuery("$.store.book[1:2:0]"), std::invalid_argument);
+    EXPECT_THROW(JsonQuery("$.store.book[?(@.price <)]"), std::invalid_argument);
+    EXPECT_THROW(JsonQuery("$.."), std::invalid_argument);
+    EXPECT_THROW(JsonQuery("$ store"), std::invalid_argument);
+}
+
+TEST(JsonQuery, ProducesResultsLazily)
+{
+    std::string big = "[";
+    for (int i = 0; i < 100000; ++i)
+        big += (i ? ",{\"n\":" : "{\"n\":") + std::to_string(i) + "}";
+    big += "]";
+    auto root = buildTree(JsonDocument::fromString(big), "");
+    JsonQueryCursor cursor(std::make_shared<const JsonQuery>("$[*].n"), root.get());
+
+    Paths first = cursor.next(3);
+    EXPECT_EQ(first, (Paths{{0, 0}, {1, 0}, {2, 0}}));
+    EXPECT_FALSE(cursor.done());
+    // A visit budget bounds the work even when nothing matches yet.
+    JsonQueryCursor sparse(std::make_shared<const JsonQuery>("$[?(@.n == 99999)]"), root.get());
+    EXPECT_TRUE(sparse.next(10, 100).empty());
+    EXPECT_FALSE(sparse.done());
+    Paths rest;
+    while (!sparse.done())
+    {
+        Paths batch = sparse.next(10, 1000);
+        rest.insert(rest.end(), batch.begin(), batch.end());
+    }
+    EXPECT_EQ(rest, (Paths{{99999}}));
+
+    Node *match = materializePath(root.get(), first[1]);
+    ASSERT_NE(match, nullptr);
+    EXPECT_EQ(getContentLabel(match), "n: 1");
+}
+
+TEST(JsonQuery, QueriesJsonLinesRecords)
+{
+    auto lines = JsonLines::fromString("{\"level\": \"info\"}\nnot json\n{\"level\": \"error\", \"code\": 7}\n");
+    auto root = buildLinesTree(lines, "log.jsonl");
+    EXPECT_EQ(evaluateQuery("$[?(@.level == 'error')].code", root.get()), (Paths{{2, 1}}));
+    EXPECT_EQ(evaluateQuery("$..level", root.get()), (Paths{{0, 0}, {2, 0}}));
+    EXPECT_EQ(evaluateQuery("$[-1]", root.get()), (Paths{{2}}));
+    EXPECT_EQ(evaluateQuery("$[1:]", root.get()), (Paths{{2}}));
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include "json_search.hpp"
+#include "json_view_core.hpp"
+
+#include <algorithm>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Paths = std::vector<std::vector<std::uint32_t>>;
+
+std::shared_ptr<JsonSearchIndex> indexOf(const std::string &text)
+{
+    auto index = JsonSearchIndex::build(JsonDocument::fromString(text));
+    while (!index->waitFor(1000))
+    {
+    }
+    return index;
+}
+
+Paths runQuery(const std::shared_ptr<JsonSearchIndex> &index, JsonSearchQuery query, std::size_t limit = SIZE_MAX)
+{
+    JsonSearchJob job(index, std::move(query));
+    Paths all;
+    for (;;)
+    {
+        bool done = job.finished();
+        Paths batch = job.takeResults(limit);
+        all.insert(all.end(), batch.begin(), batch.end());
+        if (done && batch.empty())
+            return all;
+    }
+}
+
+const char *kUsers = R"({"Users": [{"Name": "Ada", "id": 1}, {"name": "GRACE", "id": 2, "tags": ["admin"]}], "id": "top"})";
+
+} // namespace
+
+TEST(JsonSearch, IndexesKeysAndLowercasedValues)
+{
+    auto index = indexOf(kUsers);
+    ASSERT_EQ(index->entryCount(), 11u);
+    const auto &root = index->entry(0);
+    EXPECT_EQ(root.parent, JsonSearchIndex::kNoParent);
+    EXPECT_EQ(index->value(root), "dictionary");
+    const auto &users = index->entry(1);
+    EXPECT_EQ(index->key(users), "Users");
+    EXPECT_EQ(index->value(users), "list");
+    EXPECT_EQ(index->value(index->entry(3)), "ada");
+    EXPECT_EQ(index->pathOf(3), (std::vector<std::uint32_t>{0, 0, 0}));
+}
+
+TEST(JsonSearch, MatchesCaseInsensitivelyInDocumentOrder)
+{
+    auto index = indexOf(kUsers);
+    JsonSearchQuery byKey{"NAME", true, false, false, ""};
+    EXPECT_EQ(runQuery(index, byKey), (Paths{{0, 0, 0}, {0, 1, 0}}));
+
+    JsonSearchQuery byValue{"grace", false, true, false, ""};
+    EXPECT_EQ(runQuery(index, byValue), (Paths{{0, 1, 0}}));
+
+    JsonSearchQuery arrayLabel{"[1]", true, false, false, ""};
+    EXPECT_EQ(runQuery(index, arrayLabel), (Paths{{0, 1}}));
+
+    JsonSearchQuery regex{"^(ada|grace)$", false, true, true, ""};
+    EXPECT_EQ(runQuery(index, regex), (Paths{{0, 0, 0}, {0, 1, 0}}));
+    EXPECT_THROW(JsonSearchJob(index, JsonSearchQuery{"(", false, true, true, ""}), std::regex_error);
+}
+
+TEST(JsonSearch, FiltersByPath)
+{
+    auto index = indexOf(kUsers);
+    JsonSearchQuery ids{"", true, true, false, "$.Users[*].id"};
+    EXPECT_EQ(runQuery(index, ids), (Paths{{0, 0, 1}, {0, 1, 1}}));
+
+    JsonSearchQuery anyDepth{"", true, true, false, "$..id"};
+    EXPECT_EQ(runQuery(index, anyDepth), (Paths{{0, 0, 1}, {0, 1, 1}, {1}}));
+
+    JsonSearchQuery quoted{"admin", false, true, false, "$['Users'][1]..[0]"};
+    EXPECT_EQ(runQuery(index, quoted), (Paths{{0, 1, 2, 0}}));
+
+    JsonSearchQuery termAndPath{"2", false, true, false, "Users..*"};
+    EXPECT_EQ(runQuery(index, termAndPath), (Paths{{0, 1, 1}}));
+
+    // Names are matched with their case, as in the query view.
+    EXPECT_EQ(runQuery(index, JsonSearchQuery{"", true, true, false, "$.users"}), (Paths{}));
+    EXPECT_EQ(runQuery(index, JsonSearchQuery{"", true, true, false, "$"}), (Paths{{}}));
+
+    EXPECT_THROW(parseSearchPath("$.users["), std::invalid_argument);
+    EXPECT_THROW(parseSearchPath("$.users[x]"), std::invalid_argument);
+    EXPECT_THROW(parseSearchPath("$.Users[?(@.id > 1)]"), std::invalid_argument);
+    EXPECT_THROW(parseSearchPath("$.Users[-1]"), std::invalid_argument);
+}
+
+TEST(JsonSearch, PathsSelectWhatTheQueryViewSelects)
+{
+    const char *text = R"({"a": [{"B": 1, "b": [2, 3, 4]}, {"B": [5]}, 6, {"b": {"B": 7}}], "B": 8})";
+    auto index = indexOf(text);
+    auto root = buildTree(JsonDocument::fromString(text), "");
+    for (const char *path : {"$.a", "$.B", "$.b", "$.a[*].B", "$..B", "$..b[*]", "$.a[0,2]", "$['a'][0]['b'][1:]",
+                             "$.a[1:4:2]", "$..[0]", "$.a[:2]..*", ".a[].b", "a..B"})
+    {
+        Paths searched = runQuery(index, JsonSearchQuery{"", true, true, false, path});
+        Paths queried = evaluateQuery(path, root.get());
+        std::sort(queried.begin(), queried.end());
+        EXPECT_EQ(searched, queried) << path;
+    }
+}
+
+TEST(JsonSearch, StreamsLargeResultSetsAcrossChunks)
+{
+    std::string text = "[";
+    for (int i = 0; i < 200000; ++i)
+        text += (i ? ",{\"v\":" : "{\"v\":") + std::to_string(i % 10) + "}";
+    text += "]";
+    auto index = indexOf(text);
+
+    JsonSearchQuery sevens{"7", false, true, false, "$[*].v"};
+    Paths found = runQuery(index, sevens, 1000);
+    ASSERT_EQ(found.size(), 20000u);
+    for (std::size_t i = 0; i < found.size(); ++i)
+        ASSERT_EQ(found[i], (std::vector<std::uint32_t>{static_cast<std::uint32_t>(i * 10 + 7), 0}));
+
+    // Destroying a job mid-scan cancels it.
+    JsonSearchJob abandoned(index, JsonSearchQuery{"", false, true, false, "$..*"});
+}
+
+TEST(JsonSearch, IndexesJsonLinesRecordsAsListItems)
+{
+    auto lines = JsonLines::fromString("{\"user\": \"ada\"}\n{\"user\": \n[\"Grace\"]\n");
+    auto index = JsonSearchIndex::build(*lines);
+    while (!index->waitFor(1000))
+    {
+    }
+    // The record that does not parse is left out; later ones keep their position.
+    EXPECT_EQ(index->value(index->entry(0)), "list");
+    EXPECT_EQ(runQuery(index, JsonSearchQuery{"grace", false, true, false, ""}), (Paths{{2, 0}}));
+    EXPECT_EQ(runQuery(index, JsonSearchQuery{"[1]", true, false, false, ""}), (Paths{}));
+    EXPECT_EQ(runQuery(index, JsonSearchQuery{"", true, false, false, "$[*].user"}), (Paths{{0, 0}}));
+}
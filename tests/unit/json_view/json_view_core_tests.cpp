@@ -9,43 +9,117 @@
 namespace
 {
 
-json makeSampleJson()
+std::shared_ptr<const JsonDocument> makeSampleDocument()
 {
-    return json::parse(R"({"name":"sample","numbers":[1,2,3],"nested":{"flag":true}})");
+    return JsonDocument::fromString(R"({"name":"sample","numbers":[1,2,3],"nested":{"flag":true}})");
 }
 
-const Node *findChildByKey(const Node *parent, const std::string &key)
+Node *findChildByKey(Node *parent, const std::string &key)
 {
-    for (const auto &child : parent->children)
+    for (size_t idx = 0; Node *child = childAt(parent, idx); ++idx)
     {
         if (child->key == key)
-            return child.get();
+            return child;
     }
     return nullptr;
 }
 
+json parseToJson(const std::string &text)
+{
+    auto document = JsonDocument::fromString(text);
+    return documentToJson(*document, document->root());
+}
+
 } // namespace
 
 TEST(JsonViewCore, BuildsTreeWithVisibleNodes)
 {
-    json data = makeSampleJson();
-    auto root = buildTree(&data, "", nullptr, true);
+    auto root = buildTree(makeSampleDocument(), "");
     ASSERT_NE(root, nullptr);
-    ASSERT_EQ(root->children.size(), 3u);
+    // Even the root's members are only counted once they are asked for.
+    EXPECT_FALSE(root->childrenLoaded);
+    ensureChildren(root.get());
+    ASSERT_EQ(root->childCount, 3u);
+    EXPECT_TRUE(root->children.empty());
 
     std::vector<const Node *> visible;
     collectVisible(root.get(), visible);
     ASSERT_GE(visible.size(), 4u);
-    const Node *numbers = findChildByKey(root.get(), "numbers");
+    Node *numbers = findChildByKey(root.get(), "numbers");
     ASSERT_NE(numbers, nullptr);
-    ASSERT_FALSE(numbers->children.empty());
-    EXPECT_EQ(numbers->children.front()->key, "[0]");
+    EXPECT_TRUE(hasChildren(numbers));
+    EXPECT_FALSE(numbers->childrenLoaded);
+    // Children are created one at a time, not as a whole list.
+    Node *last = childAt(numbers, 2);
+    ASSERT_NE(last, nullptr);
+    EXPECT_EQ(numbers->children.size(), 1u);
+    EXPECT_EQ(childAt(numbers, 3), nullptr);
+    EXPECT_EQ(childAt(numbers, 0)->key, "[0]");
 
-    std::string prefix = buildPrefix(numbers->children.back().get());
+    std::string prefix = buildPrefix(last);
     EXPECT_FALSE(prefix.empty());
     EXPECT_NE(prefix.find("└"), std::string::npos);
 }
 
+TEST(JsonViewCore, BuildsBranchPrefixesTopDown)
+{
+    auto root = buildTree(JsonDocument::fromString(R"({"a": [[1, 2], 3], "b": {"c": [4]}})"), "");
+    EXPECT_EQ(buildPrefix(root.get()), "");
+    EXPECT_EQ(buildPrefix(materializePath(root.get(), {0})), "├── ");
+    EXPECT_EQ(buildPrefix(materializePath(root.get(), {0, 0, 1})), "│   │   └── ");
+    EXPECT_EQ(buildPrefix(materializePath(root.get(), {1, 0, 0})), "        └── ");
+    EXPECT_EQ(buildPrefix(materializePath(root.get(), {1, 0})), "    └── ");
+}
+
+TEST(JsonViewCore, LabelsDecodeValuesFromTheDocument)
+{
+    auto root = buildTree(JsonDocument::fromString(R"({"s":"a\"b\u00e9","n":1.50,"b":false,"z":null,"o":{}})"), "");
+    ensureChildren(root.get());
+    ASSERT_EQ(root->childCount, 5u);
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 0)), "s: \"a\\\"b\u00e9\"");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 1)), "n: 1.50");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 2)), "b: false");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 3)), "z: null");
+    EXPECT_EQ(getContentLabel(childAt(root.get(), 4)), "o (dictionary, 0 keys)");
+    EXPECT_EQ(getTypeIcon(childAt(root.get(), 4)), "⁞ ");
+
+    json rebuilt = reconstructJson(root.get());
+    EXPECT_EQ(rebuilt.at("s").get<std::string>(), "a\"b\u00e9");
+    EXPECT_DOUBLE_EQ(rebuilt.at("n").get<double>(), 1.5);
+    EXPECT_TRUE(rebuilt.at("o").is_object());
+}
+
+TEST(JsonViewCore, MaterializesOnlyExploredNodes)
+{
+    auto root = buildTree(JsonDocument::fromString(R"({"a":{"b":{"c":[10,20,{"needle":1}]}},"z":{"needle":2}})"), "");
+    Node *a = findChildByKey(root.get(), "a");
+    ASSERT_NE(a, nullptr);
+    EXPECT_FALSE(a->childrenLoaded);
+
+    expandToLevel(root.get(), 2);
+    EXPECT_TRUE(a->expanded);
+    ASSERT_TRUE(a->childrenLoaded);
+    Node *b = findChildByKey(a, "b");
+    ASSERT_NE(b, nullptr);
+    EXPECT_FALSE(b->childrenLoaded);
+
+    std::vector<const Node *> matches;
+    searchTree(root.get(), "needle", true, false, matches);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0]->key, "needle");
+    EXPECT_EQ(matches[0]->parent->key, "[2]");
+    EXPECT_EQ(matches[1]->parent->key, "z");
+    // Only the ancestors of matches were created, not their siblings' subtrees.
+    Node *c = findChildByKey(b, "c");
+    ASSERT_NE(c, nullptr);
+    EXPECT_FALSE(childAt(c, 0)->childrenLoaded);
+
+    std::vector<const Node *> values;
+    searchTree(root.get(), "20", false, true, values);
+    ASSERT_EQ(values.size(), 1u);
+    EXPECT_EQ(values[0]->key, "[1]");
+}
+
 TEST(JsonViewCore, ShortensLongPaths)
 {
     std::string path = "/very/long/path/segment/file.json";
@@ -64,7 +138,7 @@ TEST(JsonViewCore, FormatsFileSizes)
 TEST(JsonViewCore, ParsesSpecialFloatingPointLiterals)
 {
     const std::string input = R"({"value": NaN, "inf": Infinity, "neg": -Infinity, "arr": [NaN]})";
-    json parsed = parseJsonWithSpecialNumbers(input);
+    json parsed = parseToJson(input);
 
     ASSERT_TRUE(parsed.is_object());
     EXPECT_TRUE(std::isnan(parsed.at("value").get<double>()));
@@ -75,3 +149,24 @@ TEST(JsonViewCore, ParsesSpecialFloatingPointLiterals)
     ASSERT_TRUE(parsed.at("arr").is_array());
     EXPECT_TRUE(std::isnan(parsed.at("arr")[0].get<double>()));
 }
+
+TEST(JsonViewCore, ParsesSpecialNumbersWithoutTouchingStrings)
+{
+    const std::string input = R"([{"NaN": "Infinity", "n": -7, "big": 18446744073709551615, "e": 1.5e2}, "x\"NaN", true, null])";
+    json parsed = parseToJson(input);
+
+    ASSERT_TRUE(parsed.is_array());
+    ASSERT_EQ(parsed.size(), 4u);
+    EXPECT_EQ(parsed[0].at("NaN"), "Infinity");
+    EXPECT_TRUE(parsed[0].at("n").is_number_integer());
+    EXPECT_EQ(parsed[0].at("n").get<int>(), -7);
+    EXPECT_TRUE(parsed[0].at("big").is_number_unsigned());
+    EXPECT_EQ(parsed[0].at("e").get<double>(), 150.0);
+    EXPECT_EQ(parsed[1], "x\"NaN");
+    EXPECT_EQ(parsed[2], true);
+    EXPECT_TRUE(parsed[3].is_null());
+    EXPECT_EQ(parsed, json::parse(input));
+
+    EXPECT_TRUE(std::isinf(parseToJson("-Infinity").get<double>()));
+    EXPECT_THROW(parseToJson("[NaNa]"), JsonParseError);
+}